@@ -0,0 +1,55 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#ifndef THREAD_ANALYZER_H
+#define THREAD_ANALYZER_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+class AnalyzerJob;
+
+// Run one CodeAnalyzer job and send ID_THREAD_ANALYZE to the editor when done
+class AnalyzerThread : public wxThread
+{
+private:
+    void *m_pEdit;
+    AnalyzerJob *m_pJob;
+    int m_iRun; // run number given by the analyzer, sent back with the end event
+
+public:
+    AnalyzerThread() : wxThread(wxTHREAD_JOINABLE)
+    {
+        m_pEdit = NULL;
+        m_pJob = NULL;
+        m_iRun = 0;
+    }
+
+    ~AnalyzerThread();
+
+    // The thread takes ownership of the job
+    wxThreadError Create(void *pEdit, AnalyzerJob *pJob, int iRun);
+
+    // Give the job back (once the thread finished)
+    AnalyzerJob *releaseJob(void)
+    {
+        AnalyzerJob *pJob = m_pJob;
+        m_pJob = NULL;
+        return pJob;
+    }
+
+protected:
+    virtual ExitCode Entry();
+};
+
+#endif
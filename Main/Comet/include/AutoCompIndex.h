@@ -0,0 +1,103 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#ifndef AUTOCOMP_INDEX_H
+#define AUTOCOMP_INDEX_H
+
+#include <wx/wx.h>
+
+#include <vector>
+#include <map>
+
+#define AUTOCOMP_MINCHARS 2           // typed characters before the list is shown
+#define AUTOCOMP_MAXITEMS 64          // items in the list
+#define AUTOCOMP_WORDMIN  3           // shorter document words are not listed
+#define AUTOCOMP_WORDMAX  LM_STRSIZEN // longer document words are not listed
+#define AUTOCOMP_MAXLINES 200000      // larger documents: API words and functions only
+
+struct AutoCList;
+class wxStyledTextCtrl;
+
+struct AutoCompItem
+{
+    wxString word;
+    int len; // typed characters before the word is listed
+};
+
+// Completion candidates: the words of the AUTOC_API_* lists, sorted once per language,
+// the words of the document, kept per line and updated from the modification notifications,
+// and the functions listed by the analyzer.
+// A lookup is a binary search in each source: its cost depends on the number of items
+// listed, not on the size of the lists or of the document.
+class AutoCompIndex
+{
+private:
+    typedef std::map<wxString, int> WordMap; // word -> occurrences
+    typedef std::vector<WordMap::iterator> LineWords;
+
+    WordMap m_Words;
+    std::vector<LineWords> m_Lines;
+    int m_iDirtyFirst;
+    int m_iDirtyLast;
+    bool m_bDirtyAll;
+    bool m_bEnabled;
+
+    std::vector<wxString> m_Symbols; // sorted
+
+    static std::map<const AutoCList *, std::vector<AutoCompItem> > s_Api;
+
+    static const std::vector<AutoCompItem> &getApi(const AutoCList *pList, int iListLen);
+
+    void clearLine(int iLine);
+    void addLine(int iLine, const wxString &strLine);
+
+public:
+    AutoCompIndex()
+    {
+        m_iDirtyFirst = -1;
+        m_iDirtyLast = -1;
+        m_bDirtyAll = true;
+        m_bEnabled = false;
+    }
+
+    ~AutoCompIndex()
+    {
+    }
+
+    // Document words are listed only if the modifications are notified (see modified)
+    void enableDocument(bool bEnable)
+    {
+        m_bEnabled = bEnable;
+        invalidate();
+    }
+
+    void invalidate(void)
+    {
+        m_bDirtyAll = true;
+    }
+
+    // Same as CodeAnalyzer::modified
+    void modified(int iLine, int iLinesAdded);
+
+    // Words of the changed lines, read before a lookup
+    void update(wxStyledTextCtrl *pEdit);
+
+    void setSymbols(const std::vector<wxString> &vecSymbols);
+
+    // Sorted words starting with strTyped (at most AUTOCOMP_MAXITEMS) from the first iListLen lists
+    // of pList, the document and the functions. pbShow is set if the list should be shown for
+    // strTyped, i.e. if strTyped has just reached the length needed by one of the words.
+    int find(const AutoCList *pList, int iListLen, const wxString &strTyped, std::vector<wxString> &vecItems, bool *pbShow);
+};
+
+#endif
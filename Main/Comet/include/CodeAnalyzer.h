@@ -15,10 +15,12 @@
 #define CODE_ANALYZER_H
 
 #include <vector>
+#include <utility>
 
 #include <wx/wx.h>
 
-#define ANALYZER_NAMESIZE (LM_STRSIZEN << 1)
+#define ANALYZER_NAMESIZE       (LM_STRSIZEN << 1) // longest name kept from a line
+#define ANALYZER_ASYNC_MINLINES 2048               // smaller documents are analyzed on the UI thread
 
 struct AnalyzerElement
 {
@@ -35,47 +37,134 @@ struct AnalyzerElement
         ETYPE_FIND = 1
     };
 
-    int id;                         // Index
-    int type;                       // Type
-    char_t name[ANALYZER_NAMESIZE]; // Function name
-    int line;                       // line
-    AnalyzerElement::SCOPE scope;   // Scope (local, global)
+    int id;                       // Index
+    int type;                     // Type
+    int name;                     // Function name (offset in the symbol table names)
+    int line;                     // line
+    AnalyzerElement::SCOPE scope; // Scope (local, global)
 
-    void reset(void)
+    AnalyzerElement()
     {
         id = 0;
         type = AnalyzerElement::ETYPE_FUNC;
-        Tmemset(name, 0, ANALYZER_NAMESIZE);
+        name = 0;
         line = 0;
         scope = AnalyzerElement::SCOPE_GLOBAL;
     }
+};
 
-    AnalyzerElement()
+// Functions (or sections) of a document, as published by the analyzer: never modified once built.
+// The names are interned in one buffer and indexed by hash (open addressing).
+class AnalyzerSymbols
+{
+private:
+    std::vector<char_t> m_Names;
+    std::vector<AnalyzerElement> m_Elements;
+    std::vector<int> m_Index; // first element with a given name, or -1
+    int m_iMainLine;
+    bool m_bFailed;
+
+    static unsigned int hashName(const char_t *pszName, size_t iLen);
+    int findSlot(const char_t *pszName, size_t iLen, unsigned int iHash) const;
+    void grow(void);
+
+public:
+    AnalyzerSymbols()
+    {
+        m_iMainLine = -1;
+        m_bFailed = false;
+    }
+
+    ~AnalyzerSymbols()
+    {
+    }
+
+    // Used while the list is built
+    bool add(const char_t *pszName, AnalyzerElement::SCOPE iScope, int iLine);
+    void setMainLine(int iLine)
+    {
+        m_iMainLine = iLine;
+    }
+    void setFailed(bool bFailed)
+    {
+        m_bFailed = bFailed;
+    }
+
+    int getCount(void) const
+    {
+        return static_cast<int>(m_Elements.size());
+    }
+
+    const AnalyzerElement &getElement(int ii) const
     {
-        reset();
+        return m_Elements[ii];
     }
 
-    AnalyzerElement(int tid, AnalyzerElement::SCOPE tscope, AnalyzerElement::ETYPE ttype, int tline, const char_t *tname)
+    const char_t *getName(int ii) const
     {
-        id = tid;             // Id
-        type = ttype;         // Type
-        Tstrcpy(name, tname); // Function name
-        line = tline;         // end line
-        scope = tscope;       // Scope (local, global)
+        return &m_Names[m_Elements[ii].name];
     }
 
-    ~AnalyzerElement()
+    // Index of the first element named pszName, or -1
+    int find(const char_t *pszName) const;
+
+    int getMainLine(void) const
     {
+        return m_iMainLine;
     }
+
+    bool isFailed(void) const
+    {
+        return m_bFailed;
+    }
+
+    // Same names and scopes, in the same order
+    bool isSame(const AnalyzerSymbols *pOther) const;
 };
 
-class CodeAnalyzer
+// Analyzer state at the start of a line and what was found on it
+struct AnalyzerLine
 {
+    int balanceFunc;
+    int balanceLoop;
+    int balanceComment;
+    char_t *name;                 // function or section defined on the line (malloc'ed), if any
+    AnalyzerElement::SCOPE scope; // its scope
+    bool failed;                  // unbalanced code: the list stops before this line
+    bool main;                    // C main function
+
+    void reset(void)
+    {
+        balanceFunc = 0;
+        balanceLoop = 0;
+        balanceComment = 0;
+        name = NULL;
+        scope = AnalyzerElement::SCOPE_GLOBAL;
+        failed = false;
+        main = false;
+    }
 
+    bool sameState(const AnalyzerLine &tLine) const
+    {
+        return (balanceFunc == tLine.balanceFunc) && (balanceLoop == tLine.balanceLoop) && (balanceComment == tLine.balanceComment);
+    }
+};
+
+// One analysis of a document: the raw UTF-8 text and the line states are owned by the job,
+// so that it can run on the UI thread or in AnalyzerThread without touching the editor.
+class AnalyzerJob
+{
 private:
-    wxString m_strFilename;
-    std::vector<AnalyzerElement *> *m_pData;
-    int m_iMainLine;
+    char_t m_szFound[ANALYZER_NAMESIZE];
+    AnalyzerElement::SCOPE m_iFoundScope;
+    bool m_bMainFound;
+
+    void setFound(AnalyzerElement::SCOPE iScope, const char_t *pszName)
+    {
+        m_iFoundScope = iScope;
+        Tstrncpy(m_szFound, pszName, ANALYZER_NAMESIZE - 1);
+        m_szFound[ANALYZER_NAMESIZE - 1] = uT('\0');
+    }
 
     static bool isSeparator(char_t cT)
     {
@@ -85,14 +174,77 @@ private:
         return false;
     }
 
+    bool analyzeLine(char_t *pszLine, int iLen, int *piBalanceFunc, int *piBalanceLoop);
+    void analyzeLine(int iLine, const char *pszLineA, int iLenA, char_t *pszLine, AnalyzerLine &tState);
+
+public:
+    int lang;
+    const char *text; // raw UTF-8 document bytes
+    size_t length;
+    char *owned;      // copy of the document freed with the job (background analysis)
+    std::vector<AnalyzerLine> lines;
+    int dirtyFirst;
+    int dirtyLast;
+    bool dirtyAll;
+    AnalyzerSymbols *symbols; // result
+
+    AnalyzerJob()
+    {
+        m_szFound[0] = uT('\0');
+        m_iFoundScope = AnalyzerElement::SCOPE_GLOBAL;
+        m_bMainFound = false;
+        lang = 0;
+        text = NULL;
+        length = 0;
+        owned = NULL;
+        dirtyFirst = -1;
+        dirtyLast = -1;
+        dirtyAll = true;
+        symbols = NULL;
+    }
+
+    ~AnalyzerJob();
+
+    static void clearLines(std::vector<AnalyzerLine> &vecLines, int iFirst, int iLast);
+
+    void run(void);
+};
+
+class wxStyledTextCtrl;
+class AnalyzerThread;
+
+// Functions (or sections) of a document, analyzed from the editor buffer.
+// The results are kept per line: after a modification (see modified), only the changed
+// lines are analyzed again, and the following ones until the analyzer state is the same
+// as before at a line start. Large documents are analyzed by a worker thread (see analyzeAsync)
+// that publishes a new symbol table when done.
+class CodeAnalyzer
+{
+
+private:
+    wxString m_strFilename;
+    AnalyzerSymbols *m_pSymbols;             // published list
+    std::vector<int> m_ElementLines;         // lines of the listed elements, follow the modifications
+    std::vector<AnalyzerLine> m_Lines;       // given to the job while it runs
+    std::vector<std::pair<int, int> > m_Pending; // modifications made while the job runs
+    int m_iDirtyFirst;
+    int m_iDirtyLast;
+    bool m_bDirtyAll;
+    AnalyzerThread *m_pThread;
+    int m_iRun;        // number of the last background analysis (the thread address may be reused)
+    int m_iGeneration; // incremented when the published list changes
+
     bool isIndexValid(int ii)
     {
-        if ((m_pData == NULL) || (ii < 0)) {
+        if ((m_pSymbols == NULL) || (ii < 0)) {
             return false;
         }
-        return (ii < static_cast<int>(m_pData->size()));
+        return (ii < m_pSymbols->getCount());
     }
 
+    AnalyzerJob *createJob(void);
+    bool publish(AnalyzerJob *pJob);
+
 public:
     CodeAnalyzer();
     ~CodeAnalyzer();
@@ -112,23 +264,64 @@ public:
         return (strT.IsEmpty());
     }
 
+    // Name of a listed function without arguments and table/class prefix (f for t.f(a) or int f(int a))
+    static wxString getKey(const wxString &strName);
+
     void setFilename(wxString strFilename)
     {
         m_strFilename = strFilename;
     }
 
-    static const int MAXCOUNT;
-
     void reset(void);
-    bool analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine, int *piBalanceFunc, int *piBalanceLoop);
-    bool analyze(void);
+
+    // Lines changed in the editor: iLinesAdded lines inserted (or removed if negative) after iLine.
+    // Called from the modification notifications, before the next analyze.
+    void modified(int iLine, int iLinesAdded);
+
+    // The whole document has to be analyzed again (text replaced without notification)
+    void invalidate(void)
+    {
+        m_bDirtyAll = true;
+    }
+
+    bool isDirty(void)
+    {
+        return m_bDirtyAll || (m_iDirtyFirst >= 0) || (m_Pending.empty() == false);
+    }
+
+    bool isRunning(void)
+    {
+        return (m_pThread != NULL);
+    }
+
+    // Analyze the changed lines of the editor buffer (waits for the background analysis, if any).
+    // pbChanged (optional) is set when the list of functions changed.
+    bool analyze(wxStyledTextCtrl *pEdit, bool *pbChanged = NULL);
+
+    // Same as analyze, on a copy of the document in a worker thread.
+    // Returns true if started (or already running): ID_THREAD_ANALYZE is then sent to pEdit
+    // and the results are published by finish. Otherwise, nothing was to be done or the
+    // analysis was done right away (pbChanged set as with analyze).
+    bool analyzeAsync(wxStyledTextCtrl *pEdit, bool *pbChanged = NULL);
+    bool finish(int iRun, bool *pbChanged = NULL);
+    void wait(bool *pbChanged = NULL);
+
+    bool isFailed(void)
+    {
+        return (m_pSymbols != NULL) && m_pSymbols->isFailed();
+    }
+
+    int getGeneration(void)
+    {
+        return m_iGeneration;
+    }
 
     const char_t *getName(int ii)
     {
         if (isIndexValid(ii) == false) {
             return NULL;
         }
-        return static_cast<const char_t *>(((*m_pData)[ii])->name);
+        return m_pSymbols->getName(ii);
     }
 
     AnalyzerElement::SCOPE getScope(int ii)
@@ -136,7 +329,7 @@ public:
         if (isIndexValid(ii) == false) {
             return AnalyzerElement::SCOPE_UNKNOWN;
         }
-        return ((*m_pData)[ii])->scope;
+        return m_pSymbols->getElement(ii).scope;
     }
 
     int getLine(int ii)
@@ -144,7 +337,7 @@ public:
         if (isIndexValid(ii) == false) {
             return -1;
         }
-        return ((*m_pData)[ii])->line;
+        return m_ElementLines[ii];
     }
 
     int getLine(const char_t *funcName)
@@ -152,12 +345,7 @@ public:
         if ((funcName == NULL) || (*funcName == uT('\0')) || (getCount() < 1)) {
             return -1;
         }
-        for (int ii = 0; ii < getCount(); ii++) {
-            if (Tstrcmp(funcName, static_cast<const char_t *>(((*m_pData)[ii])->name)) == 0) {
-                return ((*m_pData)[ii])->line;
-            }
-        }
-        return -1;
+        return getLine(m_pSymbols->find(funcName));
     }
 
     void setLine(const char_t *funcName, int iLine)
@@ -165,33 +353,36 @@ public:
         if ((funcName == NULL) || (*funcName == uT('\0')) || (getCount() < 1)) {
             return;
         }
-        for (int ii = 0; ii < getCount(); ii++) {
-            if (Tstrcmp(funcName, static_cast<const char_t *>(((*m_pData)[ii])->name)) == 0) {
-                ((*m_pData)[ii])->line = iLine;
-                return;
-            }
+        int ii = m_pSymbols->find(funcName);
+        if (ii >= 0) {
+            m_ElementLines[ii] = iLine;
         }
-        return;
     }
 
     int getIndex(const char_t *funcName, bool bComplete = true);
 
     int getCount(void)
     {
-        if (m_pData == NULL) {
+        if (m_pSymbols == NULL) {
             return 0;
         }
-        return (int)(m_pData->size());
+        return m_pSymbols->getCount();
     }
 
     void setLanguage(CodeAnalyzer::LANGUAGE iLang)
     {
-        m_iLang = iLang;
+        if (iLang != m_iLang) {
+            m_iLang = iLang;
+            m_bDirtyAll = true;
+        }
     }
 
     int getMainLine(void)
     {
-        return m_iMainLine;
+        if (m_pSymbols == NULL) {
+            return -1;
+        }
+        return m_pSymbols->getMainLine();
     }
 
 private:
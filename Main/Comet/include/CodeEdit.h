@@ -18,6 +18,8 @@
 
 #include "../../LibLua/LuaExt/include/LuaExt.h"
 
+#include "AutoCompIndex.h"
+
 #include <wx/stc/stc.h>
 #include <wx/fdrepdlg.h>
 #include <wx/filename.h>
@@ -74,6 +76,14 @@
 
 #define INFOBAR_WIDTH 12
 
+#define STYLE_ASYNC_MINSIZE (LM_STRSIZEW * LM_STRSIZEW) // smaller documents are styled at once
+#define STYLE_SLICE_TIME    4                           // ms of idle-time styling per slice
+#define STYLE_SLICE_MINSIZE (LM_STRSIZEW * 16)          // initial slice (adapted to the time budget)
+#define STYLE_RESTART_LINES 256                         // lines searched backward for a restart point
+
+#define UNDO_MEMORY_DEFAULT 64   // MB of undo data kept in memory per document (0: no limit)
+#define UNDO_MEMORY_MAX     1024 // MB
+
 #define LEXERTYPE_FIRST  0
 #define LEXERTYPE_SECOND 1
 #define LEXERTYPE_THIRD  2
@@ -105,6 +115,9 @@ struct CommonInfo
     unsigned long marckerColorFind;
     unsigned long marckerColorError;
     int reloadDelay;
+    int saveDurability;
+    int undoMemory;      // MB, see UNDO_MEMORY_DEFAULT
+    bool undoSpill;      // undo data over undoMemory is compressed to a temporary file instead of dropped
 };
 
 struct LanguageInfo
@@ -200,6 +213,9 @@ class CodeEdit : public wxStyledTextCtrl
 
 private:
     wxString m_strAutoCompList;
+    std::vector<wxString> m_AutoCompItems; // shown word list (sorted)
+    int m_iAutoCompStart;
+    bool m_bAutoCompWords;                 // the word list is shown (not a Lua library list)
 
     bool isSeparator(int iPos)
     {
@@ -233,6 +249,14 @@ protected:
     bool m_bWordEnclosed;
     bool m_bPopmenuShown;
 
+    AutoCompIndex m_AutoComp;
+
+    // Document words and functions up to date before a lookup
+    virtual void updateAutoComp(void)
+    {
+        m_AutoComp.update(this);
+    }
+
     static const int AUTOC_API_LUA_LEN;
     static const AutoCList AUTOC_API_LUA[];
     static const CallTipList CALLTIP_API_LUA[];
@@ -317,6 +341,16 @@ protected:
 
     int m_iRunningLine;
 
+    // Idle-time styling: the document is styled with the current lexer up to m_iStyleNext (-1 if done)
+    int m_iStyleNext;
+    int m_iStyleSlice;
+    int m_iStyleViewStart; // lines styled before painting, ahead of the idle pass (-1 if none)
+    int m_iStyleViewEnd;
+
+    void DoColouriseAsync(void);
+    bool colouriseSlice(void);
+    int findStyleRestart(int iLine);
+
     DECLARE_EVENT_TABLE()
 
 public:
@@ -350,6 +384,7 @@ public:
 
     // >> Communication between threads
     wxMutex *m_pMutex;
+    wxCondition *m_pCondition; // signaled (with m_pMutex) when the user answered or resumed the script
     long m_iPlotCreatedId;
     bool m_bReadDone;
     bool m_bAskDone;
@@ -486,6 +521,9 @@ public:
     void OnDwellStart(wxStyledTextEvent &tEvent);
     void OnDwellEnd(wxStyledTextEvent &tEvent);
     void OnUIupdate(wxStyledTextEvent &tEvent);
+    void OnStyleNeeded(wxStyledTextEvent &tEvent);
+    void OnModified(wxStyledTextEvent &tEvent);
+    void OnIdle(wxIdleEvent &tEvent);
 };
 
 class SigmaBusyCursor
@@ -0,0 +1,163 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#ifndef COMET_BATCH_H
+#define COMET_BATCH_H
+
+#include "../../LibLua/LuaExt/include/LuaExt.h"
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+#include <stdio.h>
+
+#include <vector>
+#include <string>
+
+#define BATCH_MAXJOBS    64
+#define BATCH_MAXSCRIPTS 100000
+#define BATCH_MAXOUTPUT  (LM_STRSIZEW * 64) // output kept for the test report
+#define BATCH_HOOKCOUNT  10000              // instructions between two timeout checks
+#define BATCH_TIMEOUT    60.0               // seconds, default test timeout
+#define BATCH_TESTFILES  uT("test_*.lua")
+#define BATCH_LUAFILES   uT("*.lua")
+
+struct BatchScript
+{
+    std::string path;   // as given (UTF-8)
+    std::string name;   // reported name (path relative to the test directory)
+    std::string output; // file receiving the script output (empty: printed after the script)
+    std::string error;  // first line of the error message
+    std::string text;   // output kept for the test report, or bytecode (bundle)
+    bool ok;
+    bool skipped;       // compiled file newer than the script
+    bool timeout;       // stopped by the timeout hook
+    double deadline;    // batchTime at which the script is stopped (0: no timeout)
+    double time;        // milliseconds, engine creation included
+
+    BatchScript()
+    {
+        ok = false;
+        skipped = false;
+        timeout = false;
+        deadline = 0.0;
+        time = 0.0;
+    }
+};
+
+class CometBatch;
+
+class CometBatchThread : public wxThread
+{
+private:
+    CometBatch *m_pBatch;
+
+public:
+    CometBatchThread(CometBatch *pBatch) : wxThread(wxTHREAD_JOINABLE)
+    {
+        m_pBatch = pBatch;
+    }
+
+protected:
+    virtual ExitCode Entry();
+};
+
+// Command-line batch mode (comet -batch): the scripts, given on the command line or listed
+// in manifests, are run by worker threads, each script in its own LuaEngine, so that the
+// wxWidgets and process startup is paid once for all of them.
+// Except under Windows, each worker runs its script in a forked process: the modules keeping
+// process-wide state (lmapm workspaces, working directory, locale) and os.exit only affect
+// the script itself. Under Windows, the scripts run in the worker threads, one job by default.
+// The output of each script is kept apart (one file per script, or printed as a block when
+// the script ends) and a summary (status and time of each script) is written in JSON.
+// In test mode (comet -test), the test_*.lua files of a directory are run the same way, each
+// one stopped by a count hook after a timeout (and, in its process, by an alarm if the hook is
+// not reached from JIT compiled code), and the results are reported in TAP or JUnit XML.
+// In compile mode (comet -compile dir), the scripts are compiled instead, skipping those whose
+// compiled file is newer, or bundled in one precompiled file registering them in package.preload.
+class CometBatch
+{
+public:
+    enum REPORT
+    {
+        REPORT_NONE = 0,
+        REPORT_TAP = 1,
+        REPORT_JUNIT = 2
+    };
+
+private:
+    const luaL_Reg *m_pFunctions;
+    std::vector<BatchScript> m_Scripts;
+    std::string m_strOutputDir;
+    std::string m_strSummary;
+    int m_iJobs;
+    double m_fTimeout; // seconds (0: none)
+    bool m_bJIT;       // JIT compiler kept on with a timeout (compiled loops are not stopped)
+    REPORT m_iReport;
+    std::string m_strReport; // report file (empty: stdout, instead of the status lines)
+    bool m_bCompile;
+    std::string m_strBundle; // bundle file (empty: one compiled file per script)
+
+    wxMutex m_Mutex;
+    size_t m_iNext; // next script to run
+    int m_iFailed;
+
+    bool addManifest(const char *pszManifest);
+    void runScript(size_t iScript);
+    void runEngine(BatchScript &tScript, char *pszFilename, FILE *fpOutput, double fStart, bool bProcess);
+#ifndef WIN32
+    void runProcess(BatchScript &tScript, char *pszFilename, FILE *fpOutput, double fStart);
+#endif
+    void compileScript(size_t iScript, FILE *fpOutput);
+    bool isBundleUpdated(void);
+    bool writeBundle(void);
+    bool writeSummary(double fTime);
+    bool writeReport(double fTime);
+
+    bool isQuiet(void)
+    {
+        return (m_iReport != REPORT_NONE) && m_strReport.empty();
+    }
+
+public:
+    CometBatch(const luaL_Reg *pFunctions);
+    ~CometBatch();
+
+    // Script, or manifest if prefixed by @ (one script per line, # for comments,
+    // relative paths from the manifest directory)
+    bool add(const char *pszArg);
+
+    // Scripts (BATCH_TESTFILES or BATCH_LUAFILES) found in the directory and its subdirectories,
+    // named from their path relative to the directory
+    bool addDirectory(const char *pszDir, const char_t *pszPattern);
+
+    void setJobs(int iJobs);
+    void setOutputDir(const char *pszDir);
+    void setSummary(const char *pszFilename);
+    void setTimeout(double fTimeout, bool bJIT);
+    void setReport(REPORT iReport, const char *pszFilename);
+    void setCompile(const char *pszBundle);
+
+    int getCount(void)
+    {
+        return (int)(m_Scripts.size());
+    }
+
+    // Runs all the scripts and returns the number of failed ones
+    int run(void);
+
+    // Called by the workers
+    void work(void);
+};
+
+#endif
@@ -0,0 +1,116 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#ifndef COMET_BENCH_H
+#define COMET_BENCH_H
+
+#include "../../LibLua/LuaExt/include/LuaExt.h"
+
+#include <stdint.h>
+
+#include <vector>
+#include <map>
+#include <string>
+
+#define BENCH_TABLE      "bench"
+#define BENCH_WARMUP     10       // untimed runs of each benchmark
+#define BENCH_ITERATIONS 100      // timed samples
+#define BENCH_MAXSAMPLES 1000000
+#define BENCH_MINSAMPLE  20000    // ns: fast functions are called many times per sample
+#define BENCH_MAXREPEAT  (1 << 20)
+#define BENCH_THRESHOLD  10.0     // %: slower median than the baseline reported as a regression
+
+struct BenchResult
+{
+    std::string name;
+    bool ok;
+    int samples;
+    int repeat;      // calls per sample
+    double mean;     // ns per call
+    double median;
+    double p90;
+    double p99;
+    double min;
+    double max;
+    int traces;      // JIT traces recorded during the timed runs
+    int aborts;      // JIT trace aborts
+    double gc;       // KB allocated per call (untimed pass, with the collector stopped)
+
+    BenchResult()
+    {
+        ok = false;
+        samples = 0;
+        repeat = 1;
+        mean = median = p90 = p99 = min = max = 0.0;
+        traces = aborts = 0;
+        gc = 0.0;
+    }
+};
+
+// JIT trace events counted by the jit.attach callback
+struct BenchTrace
+{
+    int traces;
+    int aborts;
+};
+
+// Command-line benchmark mode (comet -bench): the script is run once, then each function of
+// its global bench table is run BENCH_WARMUP times, then timed with a monotonic nanosecond
+// clock. The results can be saved as a baseline and compared with a saved one.
+class CometBench
+{
+private:
+    const luaL_Reg *m_pFunctions;
+    int m_iWarmup;
+    int m_iIterations;
+    double m_fThreshold;
+    std::string m_strBaseline; // compared with
+    std::string m_strSave;     // saved to
+
+    std::vector<BenchResult> m_Results;
+    std::map<std::string, double> m_Baseline; // name -> median (ns)
+    BenchTrace m_Trace;                       // reset before each timed loop
+
+    bool loadBaseline(void);
+    bool saveBaseline(void);
+
+    bool runBenchmark(lua_State *pLua, int iFunc, BenchResult &tResult);
+    void printResult(const BenchResult &tResult, int *piRegressions);
+
+public:
+    CometBench(const luaL_Reg *pFunctions);
+    ~CometBench();
+
+    void setWarmup(int iWarmup);
+    void setIterations(int iIterations);
+    void setThreshold(double fThreshold)
+    {
+        m_fThreshold = fThreshold;
+    }
+    void setBaseline(const char *pszFilename)
+    {
+        m_strBaseline = (pszFilename != NULL) ? pszFilename : "";
+    }
+    void setSave(const char *pszFilename)
+    {
+        m_strSave = (pszFilename != NULL) ? pszFilename : "";
+    }
+
+    // Runs the benchmarks of the script, returns the number of failures and regressions (-1 on error)
+    int run(const char *pszFilename);
+
+    // Monotonic clock, in nanoseconds
+    static int64_t clock(void);
+};
+
+#endif
@@ -94,7 +94,7 @@ public:
     }
     void doSetDir(const wxString &strDir);
     void doBrowseDir(void);
-    void doRefreshDir(void);
+    void doRefreshDir(bool bSilent = false);
     bool doOpenFile(const wxString &strFilename);
     bool doRenameItem(void);
     void doDeleteItemPrepare(void)
@@ -24,6 +24,8 @@
 #include "FindDirDlg.h"
 #include "FindFileDlg.h"
 #include "BookmarkList.h"
+#include "FileWatcher.h"
+#include "SymbolIndex.h"
 
 #include <wx/aui/aui.h>
 #include <wx/aui/auibook.h>
@@ -31,8 +33,10 @@
 #include <wx/arrstr.h>
 #include <wx/tokenzr.h>
 #include <wx/notebook.h>
+#include <wx/treectrl.h>
 
 #include <vector>
+#include <map>
 #include <algorithm>
 
 #define FRAME_MINSIZE       wxSize(400, 300)
@@ -387,6 +391,27 @@ public:
     DECLARE_EVENT_TABLE()
 };
 
+// Item of the debug window trees: a variable (table fields listed when expanded),
+// a stack level (locals listed when expanded) or the link to the next page of fields
+class DebugTreeData : public wxTreeItemData
+{
+public:
+    wxString name;
+    wxString value;
+    int handle; // table handle, or 0
+    int level;  // stack level, or -1
+    int next;   // link: position of the next page, or -1
+    bool requested;
+
+    DebugTreeData(int iHandle, int iLevel, int iNext = -1) : wxTreeItemData()
+    {
+        handle = iHandle;
+        level = iLevel;
+        next = iNext;
+        requested = false;
+    }
+};
+
 class CometFrame : public wxFrame
 {
 private:
@@ -443,8 +468,9 @@ private:
     wxAuiNotebook *CreateToolNotebook(void);
     void UpdateToolNotebook(void);
 
-    wxListCtrl *CreateStackWindow(void);
-    wxListCtrl *CreateWatchWindow(void);
+    wxTreeCtrl *CreateStackWindow(void);
+    wxTreeCtrl *CreateWatchWindow(void);
+    wxTreeCtrl *CreateDebugTree(wxWindowID idT, const wxString &strRoot);
     wxAuiNotebook *CreateDebugNotebook(void);
     void UpdateDebugNotebook(const wxString &strFilename);
 
@@ -463,17 +489,13 @@ private:
 
     wxPanel *m_pDebugPanel;
     wxAuiNotebook *m_pNotebookDebug;
-    wxListCtrl *m_pListStack;
-    wxListCtrl *m_pListWatch;
+    wxTreeCtrl *m_pTreeStack;
+    wxTreeCtrl *m_pTreeWatch;
+    int m_iDebugShown;                                                   // serial of the pause shown, or 0
+    std::map<int, std::pair<wxTreeCtrl *, wxTreeItemId> > m_DebugPending; // request -> item to fill
 
-    enum LIST_SORTDIRECTION
-    {
-        NONE,
-        ASC,
-        DESC
-    };
-    int m_iListWatchSorted;
-    int m_iListStackSorted;
+    void DoDebugRequest(wxTreeCtrl *pTree, const wxTreeItemId &itemT, int iHandle, int iLevel, int iFirst);
+    void DoDebugAppend(wxTreeCtrl *pTree, const wxTreeItemId &itemParent, const LuaDebugItem &tItem);
 
     std::vector<bookmark_t *> m_arBookmark;
 
@@ -491,6 +513,15 @@ private:
     int m_iTimerCounter;
     int m_iTimerDuration;
 
+    // Changes outside Comet (open documents and explorer root)
+    FileWatcher *m_pFileWatcher;
+    bool m_bFileWatchDisabled;
+    bool m_bFileWatchBusy;
+    wxString m_strFileWatchPending;
+
+    // Functions of the files under the explorer root (go to definition)
+    SymbolIndex *m_pSymbolIndex;
+
     CodeSample *m_pExample;
     CodeSample *m_pSnippet;
 
@@ -989,7 +1020,8 @@ public:
     void DoSetStatusbarText(const wxString &strT, int iNum);
     void updateStatusbarLexer(const wxString &strT);
 
-    void UpdateDebugNotebook(const wxString &strFilename, const wxString &strT);
+    void UpdateDebugNotebook(const wxString &strFilename, const DebugPage *pPause);
+    void UpdateDebugItems(const DebugPage *pPause, const DebugPage *pPage);
     bool GetDebugSymbol(const wxString &strN, wxString &strV);
     void ClearDebugWindow(const wxString &strFilename);
 
@@ -1144,7 +1176,20 @@ public:
     wxString explorerGetCurrentDir(void);
 
     void DoFindPrevNext(int idT);
-    void DoUpdateExplorer(void);
+    void DoUpdateExplorer(bool bSilent = false);
+
+    void updateFileWatch(void);
+    void stopFileWatch(void);
+    void OnFileWatch(wxCommandEvent &tEvent);
+
+    SymbolIndex *getSymbolIndex(void)
+    {
+        return m_pSymbolIndex;
+    }
+    void updateSymbolIndex(void);
+    void stopSymbolIndex(void);
+    void OnSymbolIndex(wxCommandEvent &tEvent);
+    void OnActivate(wxActivateEvent &tEvent);
 
     void OnSize(wxSizeEvent &tEvent);
     void OnMove(wxMoveEvent &tEvent);
@@ -1227,7 +1272,8 @@ public:
 
     void OnDebugClose(wxAuiNotebookEvent &tEvent);
 
-    void OnDebugHeaderClick(wxListEvent &tEvent);
+    void OnDebugExpanding(wxTreeEvent &tEvent);
+    void OnDebugActivated(wxTreeEvent &tEvent);
 
     void OnBookmarkDeleteAll(wxCommandEvent &tEvent);
     void OnBookmarkRefresh(wxCommandEvent &tEvent);
@@ -1274,6 +1320,7 @@ public:
     void OnScriptFileProps(wxCommandEvent &tEvent);
     void OnScriptFileStats(wxCommandEvent &tEvent);
     void OnScriptFileReadOnly(wxCommandEvent &tEvent);
+    void OnScriptFileSaveMode(wxCommandEvent &tEvent);
 
     void OnOpenExamplesDir(wxCommandEvent &tEvent);
 
@@ -1293,6 +1340,9 @@ public:
     void OnAnalyzerToolbarUpdate(wxUpdateUIEvent &tEvent);
     void OnAnalyzerChange(wxCommandEvent &tEvent);
 
+    // Definition(s) of strName in the workspace (names starting with strName if bPrefix)
+    bool DoSymbolGoto(const wxString &strName, bool bPrefix = false);
+
     void OnUpdateBookmark(wxUpdateUIEvent &tEvent);
     void OnUpdateBreakpoint(wxUpdateUIEvent &tEvent);
     void OnUpdateEditorOptions(wxUpdateUIEvent &tEvent);
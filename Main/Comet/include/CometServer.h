@@ -0,0 +1,68 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#ifndef COMET_SERVER_H
+#define COMET_SERVER_H
+
+#include "../../LibLua/LuaExt/include/LuaExt.h"
+
+#include <vector>
+#include <string>
+
+#define SERVER_WORKERS      4
+#define SERVER_MAXWORKERS   64
+#define SERVER_BACKLOG      128
+#define SERVER_TIMEOUT      5         // s: a request not received in time is dropped
+#define SERVER_MAGIC        "COMET1"
+#define SERVER_TRAILER      "\0COMET"  // followed by the status ('0' ok, '1' failed) and '\n'
+#define SERVER_TRAILER_SIZE 8
+
+// Command-line server mode (comet -serve socket), not available under Windows.
+// The server creates the Lua engine (and runs the -preload script, if any) once, then forks
+// workers sharing this warm engine (copy-on-write). Each worker waits on the Unix socket,
+// runs one script with its standard output and error sent to the client, then exits and is
+// replaced by a new fork of the server, so that every script starts from the same state.
+// Request: SERVER_MAGIC "\n" working directory "\n" script path "\n".
+// Response: the script output, then the SERVER_TRAILER_SIZE bytes trailer.
+class CometServer
+{
+private:
+    const luaL_Reg *m_pFunctions;
+    std::string m_strSocket;
+    std::string m_strPreload;
+    int m_iWorkers;
+    int m_iListen;
+    LuaEngine *m_pEngine;
+    std::vector<long> m_Workers; // process ids
+
+    bool spawn(void);
+    void serve(void);
+
+public:
+    CometServer(const luaL_Reg *pFunctions, const char *pszSocket);
+    ~CometServer();
+
+    void setWorkers(int iWorkers);
+    void setPreload(const char *pszFilename)
+    {
+        m_strPreload = (pszFilename != NULL) ? pszFilename : "";
+    }
+
+    // Serves until SIGINT or SIGTERM, returns false if the server could not start
+    bool run(void);
+
+    // Runs a script through the server (comet -run infile -server socket), output to stdout
+    static bool runClient(const char *pszSocket, const char *pszFilename);
+};
+
+#endif
@@ -0,0 +1,81 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#ifndef THREAD_FILEWATCH_H
+#define THREAD_FILEWATCH_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+#include <stdint.h>
+
+#define FILEWATCH_MAXDIRS    64
+#define FILEWATCH_BUFFERSIZE (LM_STRSIZEW * 16) // changed paths, '\n' separated, sent in one event
+#define FILEWATCH_DELAY      250                // ms without new event before the changes are sent
+#define FILEWATCH_DELAYMAX   1000               // ms: changes are sent at least once per second
+
+// Watch the directories of the open documents and the explorer root (inotify).
+// Events are coalesced and sent to the main frame as one ID_THREAD_FILEWATCH event.
+// Not available on Windows: the change detection falls back to the modification time.
+class FileWatcher : public wxThread
+{
+private:
+    void *m_pFrame;
+
+    wxMutex *m_pMutex;
+
+    int m_iFd;
+    int m_iStopFd[2]; // pipe written by stop, to wake the blocking poll
+    int m_iWatch[FILEWATCH_MAXDIRS];
+    char m_szDirA[FILEWATCH_MAXDIRS][LM_STRSIZEW];
+    int m_iDirCount;
+
+    char m_szPendingA[FILEWATCH_BUFFERSIZE];
+    size_t m_iPendingLen;
+
+    volatile bool m_bStop;
+
+    void addPending(const char *pszPathA);
+    void sendPending(void);
+
+public:
+    FileWatcher() : wxThread(wxTHREAD_JOINABLE)
+    {
+        m_pFrame = NULL;
+        m_pMutex = NULL;
+        m_iFd = -1;
+        m_iStopFd[0] = -1;
+        m_iStopFd[1] = -1;
+        m_iDirCount = 0;
+        m_iPendingLen = 0;
+        m_szPendingA[0] = '\0';
+        m_bStop = false;
+    }
+
+    ~FileWatcher();
+
+    wxThreadError Create(void *pFrame);
+
+    // Replace the watched directories (called from the main thread)
+    void setDirs(const wxArrayString &arrDirs);
+
+    void stop(void);
+
+    // xxHash64 (seed 0): used to skip reloading files whose content did not change
+    static uint64_t hashBuffer(const void *pBuffer, size_t iSize);
+
+protected:
+    virtual ExitCode Entry();
+};
+
+#endif
@@ -0,0 +1,110 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#ifndef FIND_ENGINE_H
+#define FIND_ENGINE_H
+
+#include <vector>
+#include <string>
+
+#include <wx/wx.h>
+
+#define FINDENGINE_ITEMSIZE 8
+
+// One character of the pattern, in lower and upper case (UTF-8)
+struct FindEngineItem
+{
+    char lower[FINDENGINE_ITEMSIZE];
+    char upper[FINDENGINE_ITEMSIZE];
+    int lowerLen;
+    int upperLen;
+};
+
+// Plain text search in the raw (UTF-8) document bytes, without copying lines.
+// The pattern is compiled once (case folded per character);
+// whole word and word start follow Scintilla's default character classes.
+// Regular expressions are not handled: compile() returns false.
+class FindEngine
+{
+private:
+    wxString m_strFind;
+    int m_iStyle;
+    bool m_bCompiled;
+
+    std::string m_strFindA;
+    std::vector<FindEngineItem> m_arItem;
+    int m_iMinLen;
+
+    bool matchAt(const char *pszBuf, int iBufStart, int iPos, int iTo, int *piEnd) const;
+    bool isWordStart(const char *pszBuf, int iBufStart, int iPos) const;
+    bool isWordEnd(const char *pszBuf, int iBufStart, int iBufEnd, int iDocLen, int iPos) const;
+
+public:
+    FindEngine()
+    {
+        m_iStyle = 0;
+        m_bCompiled = false;
+        m_iMinLen = 0;
+    }
+
+    bool compile(const wxString &strFind, int iStyle);
+
+    void reset(void)
+    {
+        m_strFind = wxEmptyString;
+        m_iStyle = 0;
+        m_bCompiled = false;
+        m_strFindA.clear();
+        m_arItem.clear();
+        m_iMinLen = 0;
+    }
+
+    bool isCompiled(void) const
+    {
+        return m_bCompiled;
+    }
+
+    bool isCompiled(const wxString &strFind, int iStyle) const
+    {
+        return m_bCompiled && (m_iStyle == iStyle) && m_strFind.IsSameAs(strFind);
+    }
+
+    const wxString &getFind(void) const
+    {
+        return m_strFind;
+    }
+
+    int getStyle(void) const
+    {
+        return m_iStyle;
+    }
+
+    // Shortest match, in bytes
+    int getMinLength(void) const
+    {
+        return m_iMinLen;
+    }
+
+    // pszBuf holds the document bytes [iBufStart, iBufEnd), one byte more on each side of
+    // [iFrom, iTo] when available (word boundaries). Matches lie within [iFrom, iTo].
+    // Returns the start of the first (or last, if bBackward) match, or -1.
+    int find(const char *pszBuf, int iBufStart, int iBufEnd, int iDocLen,
+             int iFrom, int iTo, bool bBackward, int *piEnd) const;
+
+    // Find all the non overlapping matches in [iFrom, iTo], from left to right.
+    // Stops after iMax matches if iMax > 0. Returns the number of matches.
+    int findAll(const char *pszBuf, int iBufStart, int iBufEnd, int iDocLen,
+                int iFrom, int iTo, std::vector<int> *parStart, std::vector<int> *parEnd, int iMax = 0) const;
+};
+
+#endif
@@ -137,6 +137,13 @@
 
 #define ID_FILE_EXIT (ID_SIGMAFIRST + 175)
 
+// ID_FILE_SAVEMODExx order is mandatory (same order as SAVE_DURABILITY_xx)
+#define ID_FILE_SAVEMODE_FIRST  (ID_SIGMAFIRST + 176)
+#define ID_FILE_SAVEMODE_DIRECT ID_FILE_SAVEMODE_FIRST
+#define ID_FILE_SAVEMODE_ATOMIC (ID_SIGMAFIRST + 177)
+#define ID_FILE_SAVEMODE_SYNC   (ID_SIGMAFIRST + 178)
+#define ID_FILE_SAVEMODE_LAST   ID_FILE_SAVEMODE_SYNC
+
 #define ID_VIEW_EXPLORER  (ID_SIGMAFIRST + 180)
 #define ID_VIEW_CONSOLE   (ID_SIGMAFIRST + 182)
 #define ID_VIEW_OUTPUT    (ID_SIGMAFIRST + 183)
@@ -168,6 +175,11 @@
 #define ID_THREAD_BREAKPOINT  (ID_SIGMAFIRST + 265)
 #define ID_THREAD_READ        (ID_SIGMAFIRST + 266)
 #define ID_THREAD_STACK       (ID_SIGMAFIRST + 267)
+#define ID_THREAD_SAVE        (ID_SIGMAFIRST + 268)
+#define ID_THREAD_FILEWATCH   (ID_SIGMAFIRST + 269)
+#define ID_THREAD_ANALYZE     (ID_SIGMAFIRST + 270)
+#define ID_THREAD_SYMBOLS     (ID_SIGMAFIRST + 271)
+#define ID_THREAD_INSPECT     (ID_SIGMAFIRST + 272)
 #define ID_THREAD_MESSAGE     (ID_SIGMAFIRST + 278)
 #define ID_THREAD_UPDATE      (ID_SIGMAFIRST + 279)
 #define ID_THREAD_CURLINE     (ID_SIGMAFIRST + 280)
@@ -193,6 +205,7 @@
 #define ID_SCRIPT_STOP       (ID_SIGMAFIRST + 326)
 
 #define ID_SCRIPT_BREAKPOINT_MOD     (ID_SIGMAFIRST + 327)
+#define ID_SCRIPT_BREAKPOINT_EDIT    (ID_SIGMAFIRST + 328)
 #define ID_SCRIPT_BREAKPOINT_DELALL  (ID_SIGMAFIRST + 329)
 #define ID_SCRIPT_COMMENTSELECTION   (ID_SIGMAFIRST + 341)
 #define ID_SCRIPT_UNCOMMENTSELECTION (ID_SIGMAFIRST + 342)
@@ -644,13 +657,16 @@
 
 #define IDC_ANALYZE_LIST (ID_SIGMAFIRST + 5601)
 #define ID_ANALYZE_GOTO  (ID_SIGMAFIRST + 5602)
+#define ID_SYMBOL_GOTO   (ID_SIGMAFIRST + 5603)
 #define ID_ANALYZE_RESET (ID_SIGMAFIRST + 5611)
 #define ID_INCLUDE_GOTO  (ID_SIGMAFIRST + 5612)
 
-#define TIMER_ID_SIGMAFRAME        (ID_SIGMAFIRST + 8901)
-#define TIMER_ID_SCRIPTEDIT        (ID_SIGMAFIRST + 8902)
-#define TIMER_ID_FINDDIR           (ID_SIGMAFIRST + 8903)
-#define TIMER_ID_SCRIPTEDIT_RELOAD (ID_SIGMAFIRST + 8904)
+#define TIMER_ID_SIGMAFRAME           (ID_SIGMAFIRST + 8901)
+#define TIMER_ID_SCRIPTEDIT           (ID_SIGMAFIRST + 8902)
+#define TIMER_ID_FINDDIR              (ID_SIGMAFIRST + 8903)
+#define TIMER_ID_SCRIPTEDIT_RELOAD    (ID_SIGMAFIRST + 8904)
+#define TIMER_ID_SCRIPTEDIT_FINDCOUNT (ID_SIGMAFIRST + 8905)
+#define TIMER_ID_SCRIPTEDIT_ANALYZER  (ID_SIGMAFIRST + 8906)
 
 // Common (9800-9999)
 #define ID_APPLY     (ID_SIGMAFIRST + 9801)
@@ -0,0 +1,93 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#ifndef THREAD_SAVE_H
+#define THREAD_SAVE_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+#include <stdint.h>
+
+// Save durability (per file, default set in the Common preferences)
+#define SAVE_DURABILITY_DIRECT  0 // overwrite the file in place (no temporary file)
+#define SAVE_DURABILITY_ATOMIC  1 // write to a temporary file, then rename it over the target
+#define SAVE_DURABILITY_SYNC    2 // same as atomic, with the file and its directory flushed to disk
+#define SAVE_DURABILITY_DEFAULT SAVE_DURABILITY_ATOMIC
+#define SAVE_DURABILITY_LAST    SAVE_DURABILITY_SYNC
+
+#define SAVE_CHUNKSIZE     (LM_STRSIZEW * LM_STRSIZEW) // 1 MB written per call
+#define SAVE_ASYNC_MINSIZE (LF_SCRIPT_MAXCHARS_SM)     // smaller documents are saved on the UI thread
+
+class SaveThread : public wxThread
+{
+private:
+    void *m_pEdit;
+
+    char *m_pszBufferA;
+    size_t m_iBufferSize;
+
+    wxString m_strFilename;
+    int m_iDurability;
+
+    bool m_bSaved;
+    uint64_t m_iHash;
+    int m_iGeneration; // save number given by the document, sent back with the end event
+
+public:
+    SaveThread() : wxThread(wxTHREAD_JOINABLE)
+    {
+        m_pEdit = NULL;
+        m_pszBufferA = NULL;
+        m_iBufferSize = 0;
+        m_strFilename = wxEmptyString;
+        m_iDurability = SAVE_DURABILITY_DEFAULT;
+        m_bSaved = false;
+        m_iHash = 0;
+        m_iGeneration = 0;
+    }
+
+    ~SaveThread()
+    {
+        if (m_pszBufferA) {
+            free(m_pszBufferA);
+            m_pszBufferA = NULL;
+        }
+    }
+
+    // pszBufferA is a malloc'ed snapshot of the document: the thread takes ownership
+    wxThreadError Create(void *pEdit, char *pszBufferA, size_t iBufferSize, const wxString &strFilename, int iDurability, int iGeneration);
+
+    const wxString &getFilename(void)
+    {
+        return (const wxString &)m_strFilename;
+    }
+
+    bool isSaved(void)
+    {
+        return m_bSaved;
+    }
+
+    // Content hash of the saved snapshot (FileWatcher::hashBuffer)
+    uint64_t getHash(void)
+    {
+        return m_iHash;
+    }
+
+    static bool saveBuffer(const wxString &strFilename, const char *pszBufferA, size_t iBufferSize, int iDurability);
+
+protected:
+    virtual ExitCode Entry();
+};
+
+#endif
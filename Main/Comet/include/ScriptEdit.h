@@ -18,12 +18,23 @@
 #include "FindFileDlg.h"
 #include "CometProcess.h"
 #include "CodeAnalyzer.h"
+#include "SaveThread.h"
+#include "FindEngine.h"
+#include "ScriptThread.h"
+
+#include <atomic>
 
 #define FIND_ITEMFOUND     0
 #define FIND_PARAMERR     -1
 #define FIND_LIMITREACHED -2
 #define FIND_NOTFOUND     -3
 
+#define FIND_VIEWMARGIN   32                              // lines highlighted above and below the visible ones
+#define FIND_COUNTCHUNK   (LM_STRSIZEW * LM_STRSIZEW * 4) // bytes counted per timer event
+#define FIND_COUNTDELAY   10                              // ms between two counted chunks
+
+#define ANALYZER_DELAY 300 // ms without modification before the function list is refreshed
+
 #define FILE_FILTER_LUA      0
 #define FILE_FILTER_CPP      1
 #define FILE_FILTER_BASH     2
@@ -112,14 +123,40 @@ private:
 
     int m_iBookmarkCount;
     int m_iBreakpointCount;
+    std::map<int, DebugBreakpoint> m_BreakpointOptions; // breakpoint marker handle -> options (the marker follows the edits)
 
-    wxString m_strDebugTrace;
+    DebugPage *m_pDebugPause; // locals, globals and call stack of the current pause
+    int m_iDebugRequest;
 
     wxString m_strErrMsg;
 
     int m_iFindMarkerCount;
     int m_iFindIndicCount;
 
+    // Current find pattern and the document range where its matches are highlighted
+    FindEngine m_FindEngine;
+    int m_iFindViewStart;
+    int m_iFindViewEnd;
+
+    // Range where the find indicator may be set (cleared by DoFindReset)
+    int m_iFindIndicStart;
+    int m_iFindIndicEnd;
+
+    // Total number of matches, counted in the background (-1 if unknown)
+    wxTimer *m_pFindCountTimer;
+    int m_iFindCount;
+    int m_iFindCountRun;
+    int m_iFindCountPos;
+    bool m_bFindCountVerbose;
+
+    int findRaw(int iFrom, int iTo, bool bBackward, int *piEnd);
+    void highlightRange(int iFrom, int iTo);
+    void addFindIndicRange(int iStartPos, int iEndPos);
+    void updateFindOnModified(int iModType, int iPos, int iLength);
+    void startFindCount(bool bVerbose);
+    void stopFindCount(void);
+    bool isFindCounting(void);
+
     bool canSearch(wxString &strFind, wxString strReplace, bool bReplace, int *iFindLen, int *iLineCount, int *iCurLine);
 
     int lexerFromExtension(const wxString &strExt, const wxString &strShortFilename);
@@ -135,6 +172,19 @@ private:
 
     wxTimer *m_pReloadTimer;
 
+    // Background save of large documents
+    SaveThread *m_pSaveThread;
+    int m_iSaveGeneration; // number of the last background save (the thread address may be reused)
+    int m_iSaveDurability;
+    bool m_bSaveFailed;
+    bool DoSaveBuffer(const wxString &strFilename);
+
+    // Content hash of the file as last loaded or saved: reloads are skipped if unchanged
+    uint64_t m_iFileHash;
+    bool m_bFileHash;
+    static unsigned char *readFile(const wxString &strFilename, size_t *piFileSize);
+    bool DoReloadChanges(const unsigned char *pszBufferA, size_t iFileSize);
+
     // UTF8
     bool m_bUTF8done[UTF8FROM_LAST + 1];
 
@@ -167,7 +217,13 @@ private:
 
     bool m_bEnableCodeAnalyzer;
     CodeAnalyzer *m_pCodeAnalyzer;
+    wxTimer *m_pAnalyzerTimer;
+    bool m_bAnalyzerGotoMain; // go to the C main function when the background analysis is done
+    int m_iAutoCompGeneration; // analyzer list given to the autocompletion
+
+    void updateAutoComp(void);
     wxString m_strSelectedFunc;
+    wxString m_strSelectedSymbol; // defined in another file of the workspace
     wxString m_strFileToOpen;
 
     bool m_bFindin;
@@ -197,8 +253,29 @@ public:
     bool m_bDebugging;
     bool m_bDebugIt;
     bool m_bStopIt;
+    std::vector<DebugRequest> m_DebugRequests; // debug window -> paused script
+    std::vector<DebugPage *> m_DebugPages;     // paused script -> debug window
+    std::vector<int> m_DebugBreakpoints;       // breakpoint lines, sorted (see luaBreakpoints)
+    std::vector<DebugBreakpoint> m_DebugConditions; // breakpoints with options
+    int m_iBreakpointGeneration;               // incremented when the breakpoints change
+    std::atomic<int> m_iDebugState;            // incremented after any of the above (or step into) changes
     // <<
 
+    // Fields of the table iHandle (or locals of the stack level iLevel) of the current pause,
+    // sent to the debug window (ID_THREAD_INSPECT). Returns the request number, or 0.
+    int luaInspect(int iHandle, int iLevel, int iFirst);
+    void luaDebugClear(void);
+    void luaDebugPages(void);
+
+    // Breakpoint lines read by the script thread: taken when the script starts and
+    // each time a breakpoint is set or removed
+    void luaBreakpoints(void);
+
+    const DebugPage *getDebugPause(void)
+    {
+        return (const DebugPage *)m_pDebugPause;
+    }
+
     bool luaReset(void);
     bool luaRunScript(void);
     bool luaDebugScript(void);
@@ -279,6 +356,8 @@ public:
 
     bool DoReload(bool bSilent, bool bUserAction);
     void OnTimerReload(wxTimerEvent &tEvent);
+    void OnTimerFindCount(wxTimerEvent &tEvent);
+    void OnTimerAnalyzer(wxTimerEvent &tEvent);
     void resetTimerReload(void);
     bool autoReload(void)
     {
@@ -289,11 +368,15 @@ public:
 
     void DoFindReset(void);
     void DoFindHighlight(int iStartPos, int iEndPos);
+    void DoFindHighlightVisible(void);
     int DoFindPrev(wxString &strFind, bool bVerbose = false, int iStyle = 0,
                    bool bSel = false, int *iFindEnd = NULL, bool bAddMarker = true);
     int DoFindReplace(wxString &strFind, bool bVerbose = false, int iStyle = 0,
                       wxString strReplace = wxEmptyString, bool bReplace = false, bool bAll = false,
                       int *iCount = NULL, bool bSel = false, int *iFindStart = NULL, bool bAddMarker = true);
+    int DoFindAll(const wxString &strFind, int iStyle, int iStartPos, int iEndPos, bool bAddMarker);
+    int DoReplaceAll(const wxString &strFind, const wxString &strReplace, int iStyle,
+                     int iStartPos, int iEndPos, int *piDelta);
 
     void OnSize(wxSizeEvent &tEvent);
     void OnSetFocus(wxFocusEvent &tEvent);
@@ -306,6 +389,8 @@ public:
 
     int CodeAnalyzerGetCount(void);
     int CodeAnalyzerUpdate(wxComboBox *pCombo, bool bRecreate);
+    void CodeAnalyzerModified(int iPos, int iLinesAdded);
+    void CodeAnalyzerFinished(int iRun);
     int CodeAnalyzerGetLine(int ii);
     int CodeAnalyzerGetLine(const char_t *funcName);
     void CodeAnalyzerSetLine(const char_t *funcName, int iLine);
@@ -404,12 +489,14 @@ public:
     void DoFindPrevBookmark(void);
 
     void DoDeleteAllBreakpoints(void);
+    void DoEditBreakpoint(void);
 
     void DoShowStats(void);
 
     void OnMarginClick(wxStyledTextEvent &tEvent);
     void OnCharAdded(wxStyledTextEvent &tEvent);
     void OnModified(wxStyledTextEvent &tEvent);
+    void OnPainted(wxStyledTextEvent &tEvent);
     void OnDwellStart(wxStyledTextEvent &tEvent);
     void OnDwellEnd(wxStyledTextEvent &tEvent);
 
@@ -502,6 +589,12 @@ public:
         return m_iFindIndicCount;
     }
 
+    // Total number of matches of the current find pattern, -1 while counting
+    int getFindMatchCount(void)
+    {
+        return m_iFindCount;
+    }
+
     bool isFindin(void)
     {
         return m_bFindin;
@@ -526,6 +619,22 @@ public:
     bool DoLoadFile(const wxString &filenameT = wxEmptyString, bool bRun = false, bool bReload = false, bool bOpenRecent = false, bool bSelect = true, bool bFocus = true);
     bool DoUTF8Encode(int iFrom);
     bool DoSaveFile(const wxString &filenameT = wxEmptyString, bool bSelect = true);
+    void DoSaveFinished(int iGeneration);
+    bool isSaving(void)
+    {
+        return (m_pSaveThread != NULL);
+    }
+    void waitSave(void);
+    int getSaveDurability(void)
+    {
+        return m_iSaveDurability;
+    }
+    void setSaveDurability(int iDurability)
+    {
+        if ((iDurability >= SAVE_DURABILITY_DIRECT) && (iDurability <= SAVE_DURABILITY_LAST)) {
+            m_iSaveDurability = iDurability;
+        }
+    }
     bool isModified(void);
     wxString GetFilename() { return m_strFilename; };
     void SetFilename(const wxString &strFilename)
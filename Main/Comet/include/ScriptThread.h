@@ -22,6 +22,75 @@
 #define STOPPED_BY_USER  uT("Script stopped by the user")
 #define STOPPED_BY_USERA "Script stopped by the user"
 
+#define SCRIPT_HOOKCOUNT 10000 // instructions between two checks when the line events are off
+#define SCRIPT_HOOKDEPTH 64    // stack levels looked at by the debugger
+
+#include <vector>
+#include <map>
+#include <utility>
+#include <string>
+
+// Options of a breakpoint, set in the editor (see ScriptEdit::DoEditBreakpoint)
+// and checked by the script thread when the line is reached (see ScriptThread::checkBreakpoint)
+struct DebugBreakpoint
+{
+    int line;              // editor line
+    std::string condition; // Lua expression (UTF-8): breaks only if true
+    int hits;              // breaks from the hits-th time the condition is true (0: always)
+    std::string message;   // logpoint: printed instead of breaking, {expression} replaced by its value
+
+    DebugBreakpoint()
+    {
+        line = -1;
+        hits = 0;
+    }
+
+    bool isPlain(void) const
+    {
+        return condition.empty() && (hits <= 0) && message.empty();
+    }
+
+    bool isSame(const DebugBreakpoint &tOther) const
+    {
+        return (condition == tOther.condition) && (hits == tOther.hits) && (message == tOther.message);
+    }
+};
+
+// Request of the debug window, served by the paused script thread (see ScriptThread::waitResume)
+struct DebugRequest
+{
+    int id;     // request number given by the debug window (0: pause summary)
+    int pause;  // pause the handles belong to
+    int handle; // table whose fields are listed, or 0
+    int level;  // stack level whose locals are listed if handle is 0 (-1: pause summary)
+    int first;  // position of the first field
+
+    DebugRequest()
+    {
+        id = 0;
+        pause = 0;
+        handle = 0;
+        level = -1;
+        first = 0;
+    }
+};
+
+// Result of a request, or summary of a pause (locals, globals and call stack)
+struct DebugPage
+{
+    DebugRequest request;
+    std::vector<LuaDebugItem> items;
+    std::vector<LuaDebugFrame> frames; // pause summary only
+    int next;                          // position of the next page of fields, or -1
+    int serial;                        // pause summary shown in the debug window (unique)
+
+    DebugPage()
+    {
+        next = -1;
+        serial = 0;
+    }
+};
+
 class ScriptThread : public wxThread
 {
 private:
@@ -33,9 +102,58 @@ private:
 
     bool m_bFirstCall;
 
-    char *m_pszBufferA;
-    char *m_pszBufferStack;
+    char *m_pszBufferA;     // script (raw UTF-8 editor bytes)
     int m_iLineCount;
+    int m_iPause; // the handles given to the debug window are valid during one pause
+
+    // Line events are enabled only where a break can occur (see updateHook)
+    std::vector<int> m_Breakpoints;                       // copy of ScriptEdit::m_DebugBreakpoints
+    int m_iBreakpointGeneration;
+    bool m_bHookFunctions;                                // functions cache valid (see hasBreakpoint)
+    int m_iDebugState;                                    // ScriptEdit::m_iDebugState when last read
+    bool m_bSyncStop;                                     // state read then
+    bool m_bSyncDebugIt;
+    bool m_bSyncStepInto;
+    const char *m_pszHookSource;                         // chunk name of the script, once seen
+    int m_iHookMask;
+
+    // Breakpoints with options, by line: the names used by the condition and the message are
+    // found once among the locals and upvalues of the line, and compiled as upvalues
+    struct DebugCondition
+    {
+        DebugBreakpoint options;
+        int count;                         // condition true count
+        int condition;                     // compiled functions (registry references)
+        int message;
+        int bind;                          // sets the bound names
+        std::vector<std::string> names;    // names used by the condition and the message
+        std::vector<std::string> bound;    // names bound when compiled (the others are globals)
+        const void *function;              // function where the slots were found
+        std::vector<int> slots;            // by bound name: local index (> 0) or upvalue number (< 0)
+        std::vector<const char *> slotnames; // names given by Lua for the slots, compared by address
+        bool compiled;
+        bool reported;                     // one error printed per breakpoint
+
+        DebugCondition()
+        {
+            count = 0;
+            condition = LUA_NOREF;
+            message = LUA_NOREF;
+            bind = LUA_NOREF;
+            function = NULL;
+            compiled = false;
+            reported = false;
+        }
+    };
+    std::map<int, DebugCondition> m_Conditions;
+
+    bool isScript(const char *pszSource);
+    bool hasBreakpoint(lua_State *pLua, lua_Debug *pDebug);
+    void setConditions(const std::vector<DebugBreakpoint> &vecOptions);
+    bool pushSlots(lua_State *pLua, lua_Debug *pDebug, DebugCondition &tCondition, int iFunction);
+    void findSlots(lua_State *pLua, lua_Debug *pDebug, DebugCondition &tCondition, int iFunction, int iLine);
+    bool compileCondition(lua_State *pLua, DebugCondition &tCondition, int iLine);
+    void reportCondition(DebugCondition &tCondition, int iLine, const char *pszError);
 
     wxString m_strLastPrint;
 
@@ -48,8 +166,16 @@ public:
         m_pEdit = NULL;
         m_pLuaEngine = NULL;
         m_pszBufferA = NULL;
-        m_pszBufferStack = NULL;
+        m_iPause = 0;
         m_iLineCount = 0;
+        m_iBreakpointGeneration = -1;
+        m_bHookFunctions = false;
+        m_iDebugState = -1;
+        m_bSyncStop = false;
+        m_bSyncDebugIt = false;
+        m_bSyncStepInto = false;
+        m_pszHookSource = NULL;
+        m_iHookMask = 0;
 
         m_bFirstCall = true;
 
@@ -60,7 +186,8 @@ public:
         Tmemset(m_szUserDir, 0, LM_STRSIZE);
     }
 
-    wxThreadError Create(void *pEdit, char *pszBufferA, size_t iBufferSize, int iLineCount);
+    // Takes pszBufferA (malloc'ed, null-terminated), freed when the thread exits or if Create fails
+    wxThreadError Create(void *pEdit, char *pszBufferA, int iLineCount);
 
     LuaEngine *getLuaEngine(void)
     {
@@ -94,12 +221,17 @@ public:
         }
     }
 
-    bool breakpointIn(int iLine);
+    bool breakpointIn(const char *pszSource, int iLine, bool bPlain = false);
+    bool conditionIn(const char *pszSource, int iLine);
+    bool checkBreakpoint(lua_State *pLua, lua_Debug *pDebug, int iLine);
+    bool syncDebug(bool *pbDebugIt, bool *pbStepInto);
+    void updateHook(lua_State *pLua, int iLevel, bool bStepInto);
     void highlightLine(int iLine);
-    bool stepInto(void);
     bool debugIt(void);
     bool breakIt(lua_Debug *pDebug);
     bool stopIt(void);
+    void waitResume(void);
+    void inspect(const DebugRequest &tRequest);
     wxString readStr(void);
     int getAnswer(void);
 
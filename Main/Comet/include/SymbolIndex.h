@@ -0,0 +1,175 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#ifndef SYMBOL_INDEX_H
+#define SYMBOL_INDEX_H
+
+#include <wx/wx.h>
+#include <wx/thread.h>
+
+#include <stdint.h>
+
+#include <vector>
+#include <map>
+#include <string>
+
+#define SYMINDEX_MAXFILES    20000                            // files indexed under the workspace root
+#define SYMINDEX_MAXDEPTH    64                               // subdirectory levels listed
+#define SYMINDEX_RESCAN      10000                            // ms between two listings (see rescan)
+#define SYMINDEX_MAXFILESIZE (LM_STRSIZEW * LM_STRSIZEW * 8)  // larger files are not indexed
+#define SYMINDEX_MAXTHREADS  4
+#define SYMINDEX_MAXMATCHES  256
+#define SYMINDEX_VERSION     1
+
+struct SymbolMatch
+{
+    wxString path;
+    wxString name;
+    int line;
+};
+
+class SymbolIndex;
+
+// Worker of the symbol index: the first one lists the workspace files, then all parse the queued files
+class SymbolIndexThread : public wxThread
+{
+private:
+    SymbolIndex *m_pIndex;
+    bool m_bScan;
+
+public:
+    SymbolIndexThread(SymbolIndex *pIndex, bool bScan) : wxThread(wxTHREAD_JOINABLE)
+    {
+        m_pIndex = pIndex;
+        m_bScan = bScan;
+    }
+
+protected:
+    virtual ExitCode Entry();
+};
+
+// Functions (and sections) of the supported files under the workspace root (the explorer root),
+// parsed with the CodeAnalyzer parsers by worker threads.
+// The index is kept on disk, in the user directory: at start, only the files whose modification
+// time or size changed are parsed again; then the file watcher notifications keep it up to date,
+// and the files are listed again when the frame is activated (rescan).
+// Queries only lock the index for the lookup, so editing never waits for the indexing.
+class SymbolIndex
+{
+private:
+    struct Symbol
+    {
+        std::string name; // as listed by the analyzer (UTF-8)
+        int line;
+    };
+
+    struct File
+    {
+        std::string path; // UTF-8
+        int64_t mtime;
+        int64_t size;
+        bool present; // seen by the last scan
+        std::vector<Symbol> symbols;
+    };
+
+    struct Location
+    {
+        int file;
+        int symbol;
+    };
+
+    void *m_pFrame;
+
+    wxMutex m_Mutex;
+    wxCondition m_Condition; // queue filled or scan done
+
+    wxString m_strRoot;
+    std::string m_strRootA;
+    wxString m_strIndexFile;
+
+    std::vector<File *> m_Files;                         // removed files are NULL
+    std::map<std::string, int> m_FileIds;                // path -> index in m_Files
+    std::map<std::string, std::vector<Location> > m_Symbols; // key (see getKey) -> definitions
+    std::vector<std::string> m_Queue;                    // files to parse
+
+    std::vector<SymbolIndexThread *> m_Threads;
+    int m_iRunning;
+    int m_iGeneration;
+    bool m_bScanning;
+    bool m_bRescan;  // asked while the workers were running
+    bool m_bLoaded;  // index file read for this root
+    wxLongLong m_tScan;
+    bool m_bModified;
+    volatile bool m_bStop;
+
+    void clear(void);
+    void start(bool bScan);
+    void join(void);
+
+    bool load(void);
+    bool save(void);
+    void scan(void);
+    void parseFile(const std::string &strPathA);
+
+    // locked
+    void setFile(const std::string &strPathA, int64_t iMtime, int64_t iSize, std::vector<Symbol> &vecSymbols);
+    void removeFile(const std::string &strPathA);
+    void removeSymbols(int iFile);
+
+    static bool getFileInfo(const wxString &strPath, int64_t *piMtime, int64_t *piSize);
+
+public:
+    SymbolIndex(void *pFrame);
+    ~SymbolIndex();
+
+    // Workspace root: the files under it are indexed (empty to stop)
+    void setRoot(const wxString &strRoot);
+
+    const wxString &getRoot(void)
+    {
+        return (const wxString &)m_strRoot;
+    }
+
+    // File created, modified or removed (file watcher notification)
+    void changed(const wxString &strPath);
+
+    // Files listed again, for the changes not notified
+    void rescan(void);
+
+    // ID_THREAD_SYMBOLS received: the workers finished
+    void finish(int iGeneration);
+
+    void stop(void);
+
+    bool isRunning(void)
+    {
+        return (m_Threads.empty() == false);
+    }
+
+    // Definitions of strName (or of the names starting with strName), at most SYMINDEX_MAXMATCHES
+    int find(const wxString &strName, std::vector<SymbolMatch> &vecMatch, bool bPrefix = false);
+    bool contains(const wxString &strName);
+
+    int getFileCount(void);
+
+    // Called by the workers
+    void work(bool bScan);
+
+    // CodeAnalyzer::LANGUAGE of a file, from its extension (-1 if not supported)
+    static int getLanguage(const wxString &strPath);
+
+    // Name looked up (CodeAnalyzer::getKey, UTF-8)
+    static std::string getKey(const wxString &strName);
+};
+
+#endif
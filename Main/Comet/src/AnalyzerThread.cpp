@@ -0,0 +1,57 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#include "Identifiers.h"
+
+#include "CometApp.h"
+#include "AnalyzerThread.h"
+#include "CodeAnalyzer.h"
+
+#include <wx/stc/stc.h>
+
+AnalyzerThread::~AnalyzerThread()
+{
+    if (m_pJob) {
+        delete m_pJob;
+        m_pJob = NULL;
+    }
+}
+
+wxThreadError AnalyzerThread::Create(void *pEdit, AnalyzerJob *pJob, int iRun)
+{
+    if ((pEdit == NULL) || (pJob == NULL)) {
+        return wxTHREAD_MISC_ERROR;
+    }
+
+    m_pEdit = pEdit;
+    m_pJob = pJob;
+    m_iRun = iRun;
+
+    return wxThread::Create();
+}
+
+wxThread::ExitCode AnalyzerThread::Entry()
+{
+    if ((m_pEdit == NULL) || (m_pJob == NULL)) {
+        return 0;
+    }
+
+    m_pJob->run();
+
+    wxStyledTextCtrl *pEdit = (wxStyledTextCtrl *)m_pEdit;
+    wxCommandEvent eventT(wxEVT_COMMAND_TEXT_UPDATED, ID_THREAD_ANALYZE);
+    eventT.SetExtraLong((long)m_iRun);
+    pEdit->GetEventHandler()->AddPendingEvent(eventT);
+
+    return 0;
+}
@@ -0,0 +1,246 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#include "Identifiers.h"
+
+#include "CodeEdit.h"
+#include "AutoCompIndex.h"
+
+#include <algorithm>
+
+std::map<const AutoCList *, std::vector<AutoCompItem> > AutoCompIndex::s_Api;
+
+static bool compareItems(const AutoCompItem &tA, const AutoCompItem &tB)
+{
+    return (tA.word < tB.word);
+}
+
+const std::vector<AutoCompItem> &AutoCompIndex::getApi(const AutoCList *pList, int iListLen)
+{
+    std::map<const AutoCList *, std::vector<AutoCompItem> >::const_iterator itT = s_Api.find(pList);
+    if (itT != s_Api.end()) {
+        return itT->second;
+    }
+
+    // Built once per language
+    std::vector<AutoCompItem> &vecApi = s_Api[pList];
+    for (int ii = 0; (ii < iListLen) && (pList[ii].len != 0); ii++) {
+        const char_t *pszStart = pList[ii].words;
+        int ll = 0;
+        while ((*pszStart != uT('\0')) && (ll < pList[ii].count)) {
+            const char_t *pszEnd = pszStart;
+            while ((*pszEnd != uT('\0')) && (*pszEnd != uT('|'))) {
+                pszEnd += 1;
+            }
+            if (pszEnd > pszStart) {
+                AutoCompItem tItem;
+                tItem.word = wxString(pszStart, (size_t)(pszEnd - pszStart));
+                tItem.len = pList[ii].len;
+                vecApi.push_back(tItem);
+            }
+            ll += 1;
+            pszStart = (*pszEnd == uT('|')) ? (pszEnd + 1) : pszEnd;
+        }
+    }
+    std::stable_sort(vecApi.begin(), vecApi.end(), compareItems);
+
+    return vecApi;
+}
+
+void AutoCompIndex::clearLine(int iLine)
+{
+    LineWords &vecWords = m_Lines[iLine];
+    for (size_t ii = 0; ii < vecWords.size(); ii++) {
+        vecWords[ii]->second -= 1;
+        if (vecWords[ii]->second <= 0) {
+            m_Words.erase(vecWords[ii]);
+        }
+    }
+    vecWords.clear();
+}
+
+void AutoCompIndex::addLine(int iLine, const wxString &strLine)
+{
+    LineWords &vecWords = m_Lines[iLine];
+
+    const int iLen = (int)(strLine.Length());
+    int ii = 0;
+    while (ii < iLen) {
+        char_t cT = strLine.GetChar(ii);
+        // \command (LaTeX) or identifier
+        if ((cT != uT('\\')) && (cT != uT('_')) && (Tisalpha(cT) == 0)) {
+            ii += 1;
+            continue;
+        }
+        int iStart = ii;
+        ii += 1;
+        while (ii < iLen) {
+            cT = strLine.GetChar(ii);
+            if ((cT != uT('_')) && (Tisalnum(cT) == 0)) {
+                break;
+            }
+            ii += 1;
+        }
+        if (((ii - iStart) < AUTOCOMP_WORDMIN) || ((ii - iStart) > AUTOCOMP_WORDMAX)) {
+            continue;
+        }
+        WordMap::iterator itT = m_Words.insert(std::make_pair(strLine.Mid(iStart, ii - iStart), 0)).first;
+        itT->second += 1;
+        vecWords.push_back(itT);
+    }
+}
+
+void AutoCompIndex::modified(int iLine, int iLinesAdded)
+{
+    if ((m_bEnabled == false) || m_bDirtyAll) {
+        return;
+    }
+
+    const int iCount = static_cast<int>(m_Lines.size());
+    if ((iLine < 0) || (iLine >= iCount) || ((iLinesAdded < 0) && ((iLine - iLinesAdded) >= iCount))) {
+        m_bDirtyAll = true;
+        return;
+    }
+
+    if (iLinesAdded > 0) {
+        m_Lines.insert(m_Lines.begin() + iLine + 1, iLinesAdded, LineWords());
+    }
+    else if (iLinesAdded < 0) {
+        for (int ii = iLine + 1; ii <= (iLine - iLinesAdded); ii++) {
+            clearLine(ii);
+        }
+        m_Lines.erase(m_Lines.begin() + iLine + 1, m_Lines.begin() + iLine + 1 - iLinesAdded);
+    }
+
+    const int iLast = iLine + ((iLinesAdded > 0) ? iLinesAdded : 0);
+    if (m_iDirtyFirst < 0) {
+        m_iDirtyFirst = iLine;
+        m_iDirtyLast = iLast;
+        return;
+    }
+    if (m_iDirtyLast > iLine) {
+        m_iDirtyLast += iLinesAdded;
+        if (m_iDirtyLast < iLine) {
+            m_iDirtyLast = iLine;
+        }
+    }
+    if (m_iDirtyFirst > iLine) {
+        m_iDirtyFirst = iLine;
+    }
+    if (m_iDirtyLast < iLast) {
+        m_iDirtyLast = iLast;
+    }
+}
+
+void AutoCompIndex::update(wxStyledTextCtrl *pEdit)
+{
+    if ((m_bEnabled == false) || (pEdit == NULL)) {
+        return;
+    }
+
+    const int iLineCount = pEdit->GetLineCount();
+
+    if (m_bDirtyAll) {
+        m_Words.clear();
+        m_Lines.clear();
+        m_iDirtyFirst = -1;
+        m_iDirtyLast = -1;
+        if (iLineCount > AUTOCOMP_MAXLINES) {
+            // Stays dirty: checked again after the next modifications
+            return;
+        }
+        m_Lines.resize(iLineCount);
+        m_bDirtyAll = false;
+        m_iDirtyFirst = 0;
+        m_iDirtyLast = iLineCount - 1;
+    }
+
+    if (m_iDirtyFirst < 0) {
+        return;
+    }
+
+    if (static_cast<int>(m_Lines.size()) != iLineCount) {
+        // Modification not notified
+        m_bDirtyAll = true;
+        update(pEdit);
+        return;
+    }
+
+    const int iLast = (m_iDirtyLast < iLineCount) ? m_iDirtyLast : (iLineCount - 1);
+    for (int ii = m_iDirtyFirst; ii <= iLast; ii++) {
+        clearLine(ii);
+        addLine(ii, pEdit->GetLine(ii));
+    }
+
+    m_iDirtyFirst = -1;
+    m_iDirtyLast = -1;
+}
+
+void AutoCompIndex::setSymbols(const std::vector<wxString> &vecSymbols)
+{
+    m_Symbols = vecSymbols;
+    std::sort(m_Symbols.begin(), m_Symbols.end());
+    m_Symbols.erase(std::unique(m_Symbols.begin(), m_Symbols.end()), m_Symbols.end());
+}
+
+int AutoCompIndex::find(const AutoCList *pList, int iListLen, const wxString &strTyped, std::vector<wxString> &vecItems, bool *pbShow)
+{
+    vecItems.clear();
+    *pbShow = false;
+
+    const int iTyped = (int)(strTyped.Length());
+    if (iTyped < AUTOCOMP_MINCHARS) {
+        return 0;
+    }
+
+    // API words
+    const std::vector<AutoCompItem> &vecApi = getApi(pList, iListLen);
+    AutoCompItem tTyped;
+    tTyped.word = strTyped;
+    tTyped.len = 0;
+    for (std::vector<AutoCompItem>::const_iterator itA = std::lower_bound(vecApi.begin(), vecApi.end(), tTyped, compareItems);
+         (itA != vecApi.end()) && ((int)(vecItems.size()) < AUTOCOMP_MAXITEMS) && itA->word.StartsWith(strTyped); ++itA) {
+        if (itA->len > iTyped) {
+            continue;
+        }
+        if (itA->len == iTyped) {
+            *pbShow = true;
+        }
+        vecItems.push_back(itA->word);
+    }
+
+    const size_t iApi = vecItems.size();
+
+    // Functions
+    for (std::vector<wxString>::const_iterator itS = std::lower_bound(m_Symbols.begin(), m_Symbols.end(), strTyped);
+         (itS != m_Symbols.end()) && ((int)(vecItems.size()) < AUTOCOMP_MAXITEMS) && itS->StartsWith(strTyped); ++itS) {
+        vecItems.push_back(*itS);
+    }
+
+    // Document words (the word being typed excluded)
+    for (WordMap::const_iterator itW = m_Words.lower_bound(strTyped);
+         (itW != m_Words.end()) && ((int)(vecItems.size()) < AUTOCOMP_MAXITEMS) && itW->first.StartsWith(strTyped); ++itW) {
+        if (itW->first.IsSameAs(strTyped) == false) {
+            vecItems.push_back(itW->first);
+        }
+    }
+
+    if ((vecItems.size() > iApi) && (iTyped == AUTOCOMP_MINCHARS)) {
+        *pbShow = true;
+    }
+
+    std::sort(vecItems.begin(), vecItems.end());
+    vecItems.erase(std::unique(vecItems.begin(), vecItems.end()), vecItems.end());
+
+    return (int)(vecItems.size());
+}
@@ -16,15 +16,139 @@
 #include "CometApp.h"
 #include "CometFrame.h"
 #include "CodeAnalyzer.h"
+#include "AnalyzerThread.h"
+#include "FileWatcher.h"
 
-const int CodeAnalyzer::MAXCOUNT = 256;
+#include <wx/stc/stc.h>
+
+unsigned int AnalyzerSymbols::hashName(const char_t *pszName, size_t iLen)
+{
+    return static_cast<unsigned int>(FileWatcher::hashBuffer(pszName, iLen * sizeof(char_t)));
+}
+
+// Slot of pszName in the index, or the free slot where to add it
+int AnalyzerSymbols::findSlot(const char_t *pszName, size_t iLen, unsigned int iHash) const
+{
+    // The index size is a power of two, and never more than half full
+    const size_t iMask = m_Index.size() - 1;
+    size_t iSlot = iHash & iMask;
+    while (m_Index[iSlot] >= 0) {
+        const char_t *pszT = &m_Names[m_Elements[m_Index[iSlot]].name];
+        if ((Tstrlen(pszT) == iLen) && (Tstrcmp(pszT, pszName) == 0)) {
+            break;
+        }
+        iSlot = (iSlot + 1) & iMask;
+    }
+    return static_cast<int>(iSlot);
+}
+
+void AnalyzerSymbols::grow(void)
+{
+    const size_t iSize = m_Index.empty() ? 64 : (m_Index.size() << 1);
+    m_Index.assign(iSize, -1);
+    for (size_t ii = 0; ii < m_Elements.size(); ii++) {
+        const char_t *pszT = &m_Names[m_Elements[ii].name];
+        const size_t iLen = Tstrlen(pszT);
+        const int iSlot = findSlot(pszT, iLen, hashName(pszT, iLen));
+        if (m_Index[iSlot] < 0) {
+            m_Index[iSlot] = static_cast<int>(ii);
+        }
+    }
+}
+
+bool AnalyzerSymbols::add(const char_t *pszName, AnalyzerElement::SCOPE iScope, int iLine)
+{
+    if ((pszName == NULL) || (*pszName == uT('\0'))) {
+        return false;
+    }
+
+    try {
+        if (((m_Elements.size() + 1) << 1) > m_Index.size()) {
+            grow();
+        }
+
+        const size_t iLen = Tstrlen(pszName);
+        const int iSlot = findSlot(pszName, iLen, hashName(pszName, iLen));
+
+        AnalyzerElement tElement;
+        tElement.id = static_cast<int>(m_Elements.size()) + 1;
+        tElement.line = iLine;
+        tElement.scope = iScope;
+        if (m_Index[iSlot] >= 0) {
+            // Same name defined again: stored once
+            tElement.name = m_Elements[m_Index[iSlot]].name;
+            m_Elements.push_back(tElement);
+        }
+        else {
+            tElement.name = static_cast<int>(m_Names.size());
+            m_Names.insert(m_Names.end(), pszName, pszName + iLen + 1);
+            m_Elements.push_back(tElement);
+            m_Index[iSlot] = static_cast<int>(m_Elements.size()) - 1;
+        }
+    }
+    catch (...) {
+        return false;
+    }
+
+    return true;
+}
+
+int AnalyzerSymbols::find(const char_t *pszName) const
+{
+    if ((pszName == NULL) || (*pszName == uT('\0')) || m_Index.empty()) {
+        return -1;
+    }
+    const size_t iLen = Tstrlen(pszName);
+    return m_Index[findSlot(pszName, iLen, hashName(pszName, iLen))];
+}
+
+bool AnalyzerSymbols::isSame(const AnalyzerSymbols *pOther) const
+{
+    if ((pOther == NULL) || (pOther->getCount() != getCount())) {
+        return false;
+    }
+    for (int ii = 0; ii < getCount(); ii++) {
+        if ((m_Elements[ii].scope != pOther->m_Elements[ii].scope) || (Tstrcmp(getName(ii), pOther->getName(ii)) != 0)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+AnalyzerJob::~AnalyzerJob()
+{
+    AnalyzerJob::clearLines(lines, 0, static_cast<int>(lines.size()) - 1);
+    if (owned) {
+        free(owned);
+        owned = NULL;
+    }
+    if (symbols) {
+        delete symbols;
+        symbols = NULL;
+    }
+}
+
+void AnalyzerJob::clearLines(std::vector<AnalyzerLine> &vecLines, int iFirst, int iLast)
+{
+    for (int ii = iFirst; ii <= iLast; ii++) {
+        if (vecLines[ii].name) {
+            free(vecLines[ii].name);
+            vecLines[ii].name = NULL;
+        }
+    }
+}
 
 CodeAnalyzer::CodeAnalyzer()
 {
-    m_pData = NULL;
+    m_pSymbols = NULL;
     m_strFilename = wxEmptyString;
     m_iLang = CodeAnalyzer::LANGUAGE_LUA;
-    m_iMainLine = -1;
+    m_iDirtyFirst = -1;
+    m_iDirtyLast = -1;
+    m_bDirtyAll = true;
+    m_pThread = NULL;
+    m_iRun = 0;
+    m_iGeneration = 0;
 }
 
 CodeAnalyzer::~CodeAnalyzer()
@@ -34,23 +158,57 @@ CodeAnalyzer::~CodeAnalyzer()
 
 void CodeAnalyzer::reset(void)
 {
-    if (m_pData == NULL) {
-        return;
+    wait();
+
+    AnalyzerJob::clearLines(m_Lines, 0, static_cast<int>(m_Lines.size()) - 1);
+    m_Lines.clear();
+    m_Pending.clear();
+
+    if (m_pSymbols) {
+        delete m_pSymbols;
+        m_pSymbols = NULL;
+        m_iGeneration += 1;
     }
+    m_ElementLines.clear();
 
-    int iCount = (int)(m_pData->size());
-    if (iCount > 0) {
-        for (int ii = 0; ii < iCount; ii++) {
-            if ((*m_pData)[ii]) {
-                delete ((*m_pData)[ii]);
-                (*m_pData)[ii] = NULL;
+    m_iDirtyFirst = -1;
+    m_iDirtyLast = -1;
+    m_bDirtyAll = true;
+}
+
+wxString CodeAnalyzer::getKey(const wxString &strName)
+{
+    wxString strKey = strName;
+
+    // f(a, b), t.f(a), t:f(a), int f(int a), f = function(a)
+    int iF = strKey.Find(uT('('));
+    if (iF != wxNOT_FOUND) {
+        strKey = strKey.Mid(0, iF);
+        iF = strKey.Find(uT('='));
+        if (iF != wxNOT_FOUND) {
+            strKey = strKey.Mid(0, iF);
+        }
+        strKey.Trim(true);
+        int iStart = (int)(strKey.Length());
+        while (iStart > 0) {
+            const char_t cc = strKey.GetChar(iStart - 1);
+            if ((Tisalnum(cc) == 0) && (cc != uT('_'))) {
+                break;
             }
+            iStart -= 1;
+        }
+        strKey = strKey.Mid(iStart);
+    }
+    else {
+        // local f
+        if (strKey.StartsWith(uT("local "))) {
+            strKey = strKey.Mid(6);
         }
-        m_pData->clear();
+        strKey.Trim(true);
+        strKey.Trim(false);
     }
-    delete m_pData;
-    m_pData = NULL;
-    m_iMainLine = -1;
+
+    return strKey;
 }
 
 int CodeAnalyzer::getIndex(const char_t *funcName, bool bComplete /* = true*/)
@@ -58,57 +216,41 @@ int CodeAnalyzer::getIndex(const char_t *funcName, bool bComplete /* = true*/)
     if ((funcName == NULL) || (*funcName == uT('\0')) || (getCount() < 1)) {
         return -1;
     }
-    char_t *pszF = NULL, *pszT = NULL;
 
+    if (bComplete) {
+        return m_pSymbols->find(funcName);
+    }
+
+    const char_t *pszF = NULL;
     for (int ii = 0; ii < getCount(); ii++) {
-        if (bComplete) {
-            if (Tstrcmp(funcName, static_cast<const char_t *>(((*m_pData)[ii])->name)) == 0) {
-                return ii;
-            }
-        }
-        else {
-            pszF = static_cast<char_t *>(((*m_pData)[ii])->name);
-            pszT = Tstrstr(pszF, funcName);
-            if (pszT == pszF) {
-                return ii;
-            }
+        pszF = m_pSymbols->getName(ii);
+        if (Tstrstr(pszF, funcName) == pszF) {
+            return ii;
         }
     }
     return -1;
 }
 
-bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine, int *piBalanceFunc, int *piBalanceLoop)
+bool AnalyzerJob::analyzeLine(char_t *pszLine, int iLen, int *piBalanceFunc, int *piBalanceLoop)
 {
-    if (m_pData == NULL) {
-        m_pData = new (std::nothrow) std::vector<AnalyzerElement *>;
-    }
-
-    if (m_pData == NULL) {
-        return false;
-    }
-
     if (iLen < 0) {
         iLen = lm_trim(pszLine);
     }
 
     // Empty line?
     if ((iLen < 2) || (pszLine[0] == uT('\0')) || (pszLine[1] == uT('\0')) || (pszLine[2] == uT('\0'))) {
-        *piLine += 1;
         return true;
     }
 
-    if ((m_iLang != CodeAnalyzer::LANGUAGE_LATEX) && (m_iLang != CodeAnalyzer::LANGUAGE_SOLIS) && !Tisalpha(pszLine[0])) {
-        *piLine += 1;
+    if ((lang != CodeAnalyzer::LANGUAGE_LATEX) && (lang != CodeAnalyzer::LANGUAGE_SOLIS) && !Tisalpha(pszLine[0])) {
         return true;
     }
 
-    if ((m_iLang == CodeAnalyzer::LANGUAGE_LATEX) && (pszLine[0] != uT('\\'))) {
-        *piLine += 1;
+    if ((lang == CodeAnalyzer::LANGUAGE_LATEX) && (pszLine[0] != uT('\\'))) {
         return true;
     }
 
-    if ((m_iLang == CodeAnalyzer::LANGUAGE_SOLIS) && (pszLine[0] != uT('['))) {
-        *piLine += 1;
+    if ((lang == CodeAnalyzer::LANGUAGE_SOLIS) && (pszLine[0] != uT('['))) {
         return true;
     }
 
@@ -116,23 +258,21 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
 
     AnalyzerElement::SCOPE funcScope = AnalyzerElement::SCOPE_GLOBAL;
 
-    int funcLine;
     char_t funcName[ANALYZER_NAMESIZE];
     Tmemset(funcName, 0, ANALYZER_NAMESIZE);
 
     int iT = 0;
 
-    if (m_iLang == CodeAnalyzer::LANGUAGE_PYTHON) {
+    if (lang == CodeAnalyzer::LANGUAGE_PYTHON) {
 
         if (iLen <= 7) {
-            *piLine += 1;
             return true;
         }
 
-        if ((pszLine[0] == uT('d')) && (pszLine[1] == uT('e')) && (pszLine[2] == uT('f')) && CodeAnalyzer::isSeparator(pszLine[3]) && (pszLine[iLen - 1] == uT(':'))) {
+        if ((pszLine[0] == uT('d')) && (pszLine[1] == uT('e')) && (pszLine[2] == uT('f')) && isSeparator(pszLine[3]) && (pszLine[iLen - 1] == uT(':'))) {
 
             pszT = &pszLine[3];
-            while (CodeAnalyzer::isSeparator(*pszT)) {
+            while (isSeparator(*pszT)) {
                 pszT += 1;
             }
 
@@ -147,8 +287,8 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
                     pszT = Tstrstr(pszT + 1, uT(")"));
                     if (pszT && *pszT) {
                         pszT += 1;
-                        if (CodeAnalyzer::isSeparator(*pszT)) {
-                            while (CodeAnalyzer::isSeparator(*pszT)) {
+                        if (isSeparator(*pszT)) {
+                            while (isSeparator(*pszT)) {
                                 pszT += 1;
                             }
                         }
@@ -162,33 +302,20 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
         }
 
         if (funcName[0] != uT('\0')) {
-
-            *piId += 1;
-            funcLine = *piLine;
-
-            AnalyzerElement *pFunc = new (std::nothrow) AnalyzerElement(*piId, funcScope, AnalyzerElement::ETYPE_FUNC, funcLine, static_cast<const char_t *>(funcName));
-            if (pFunc == NULL) {
-                *piLine += 1;
-                return false;
-            }
-
-            m_pData->push_back(pFunc);
+            setFound(funcScope, funcName);
         }
 
-        *piLine += 1;
         return true;
     }
 
-    else if (m_iLang == CodeAnalyzer::LANGUAGE_LATEX) {
+    else if (lang == CodeAnalyzer::LANGUAGE_LATEX) {
 
         if (iLen <= 10) {
-            *piLine += 1;
             return true;
         }
 
         // Section or Subsection?
         if ((pszLine[0] != uT('\\')) || (pszLine[1] != uT('s')) || (pszLine[iLen - 1] != uT('}'))) {
-            *piLine += 1;
             return true;
         }
 
@@ -219,14 +346,12 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
         pszLine[iZ] = cT;
 
         if (pszT != pszLine) {
-            *piLine += 1;
             return true;
         }
 
         pszT += iT;
 
         if ((*pszT != uT('{')) && (*pszT != uT('['))) {
-            *piLine += 1;
             return true;
         }
         char_t cQstart = *pszT;
@@ -244,34 +369,25 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
             if ((pszT - pszStart) > 0) {
                 *pszT = uT('\0');
                 Tstrncpy(funcName, static_cast<const char_t *>(pszStart), ANALYZER_NAMESIZE - 1);
-                *piId += 1;
-                funcLine = *piLine;
-                AnalyzerElement *pFunc = new (std::nothrow) AnalyzerElement(*piId, funcScope, AnalyzerElement::ETYPE_FUNC, funcLine, static_cast<const char_t *>(funcName));
-                if (pFunc != NULL) {
-                    m_pData->push_back(pFunc);
-                }
+                setFound(funcScope, funcName);
             }
         }
 
-        *piLine += 1;
         return true;
     }
 
-    else if (m_iLang == CodeAnalyzer::LANGUAGE_C) {
+    else if (lang == CodeAnalyzer::LANGUAGE_C) {
 
         if (iLen <= 10) {
-            *piLine += 1;
             return true;
         }
 
         // Comment, Preproc, ...?
         if (!Tisspace(pszLine[0]) && !Tisalpha(pszLine[0])) {
-            *piLine += 1;
             return true;
         }
 
         if (pszLine[iLen - 1] == uT(';')) {
-            *piLine += 1;
             return true;
         }
 
@@ -282,13 +398,11 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
         for (int ii = 0; szItems[ii] != NULL; ii++) {
             iRet = Tstartwith(static_cast<const char_t *>(pszLine), szItems[ii]);
             if ((iRet > 0) && !Tisalnum(pszLine[iRet]) && (pszLine[iRet] != uT('_'))) {
-                *piLine += 1;
                 return true;
             }
         }
 
         bool bF = false;
-        m_iMainLine = -1;
         int iB = 0, iF = 0;
         for (int ii = (iLen - 1); ii >= 5; ii--) {
             if (pszLine[ii] == uT('(')) {
@@ -331,7 +445,7 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
                 }
 
                 if (bF && (pszLine[iB] == uT('m')) && (pszLine[iB + 1] == uT('a')) && (pszLine[iB + 2] == uT('i')) && (pszLine[iB + 3] == uT('n'))) {
-                    m_iMainLine = *piLine;
+                    m_bMainFound = true;
                 }
 
                 break;
@@ -339,7 +453,6 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
         }
 
         if ((bF == false) || (iB >= (iF - 1))) {
-            *piLine += 1;
             return true;
         }
 
@@ -368,30 +481,19 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
             *(pszLine + iF + 1) = cc;
         }
 
-        *piId += 1;
-        funcLine = *piLine;
-
-        AnalyzerElement *pFunc = new (std::nothrow) AnalyzerElement(*piId, funcScope, AnalyzerElement::ETYPE_FUNC, funcLine, static_cast<const char_t *>(funcName));
-        if (pFunc == NULL) {
-            *piLine += 1;
-            return false;
-        }
+        setFound(funcScope, funcName);
 
-        m_pData->push_back(pFunc);
-        *piLine += 1;
         return true;
     }
 
-    else if (m_iLang == CodeAnalyzer::LANGUAGE_SOLIS) {
+    else if (lang == CodeAnalyzer::LANGUAGE_SOLIS) {
 
         if (iLen <= 6) {
-            *piLine += 1;
             return true;
         }
 
         // Section?
         if (pszLine[0] != uT('[')) {
-            *piLine += 1;
             return true;
         }
 
@@ -399,12 +501,10 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
 
         pszT = Tstrstr(pszLine, uT("]"));
         if ((pszT == NULL) || ((int)(pszT - pszLine) < 6) || ((int)(pszT - pszLine) > 32)) {
-            *piLine += 1;
             return true;
         }
         for (char_t *pzi = pszLine + 1; pzi < pszT; pzi++) {
             if (!Tisalpha(*pzi)) {
-                *piLine += 1;
                 return true;
             }
         }
@@ -415,20 +515,9 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
         *pszT = cT;
 
         if (funcName[0] != uT('\0')) {
-
-            *piId += 1;
-            funcLine = *piLine;
-
-            AnalyzerElement *pFunc = new (std::nothrow) AnalyzerElement(*piId, funcScope, AnalyzerElement::ETYPE_FUNC, funcLine, static_cast<const char_t *>(funcName));
-            if (pFunc == NULL) {
-                *piLine += 1;
-                return false;
-            }
-
-            m_pData->push_back(pFunc);
+            setFound(funcScope, funcName);
         }
 
-        *piLine += 1;
         return true;
     }
 
@@ -443,7 +532,6 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
                 *piBalanceFunc -= 1;
             }
         }
-        *piLine += 1;
         return true;
     }
 
@@ -463,25 +551,23 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
     }
 
     if (iT > 0) {
-        if (CodeAnalyzer::isSeparator(*(pszT + iT))) {
+        if (isSeparator(*(pszT + iT))) {
             *piBalanceLoop += 1;
             pszT = Tstrstr(pszT + iT, uT("end"));
             if (pszT) {
-                if ((pszT == (pszLine + iLen - 3)) && CodeAnalyzer::isSeparator(*(pszT - 1))) {
+                if ((pszT == (pszLine + iLen - 3)) && isSeparator(*(pszT - 1))) {
                     *piBalanceLoop -= 1;
                 }
             }
         }
-        *piLine += 1;
         return true;
     }
 
     if ((pszT = Tstrstr(pszLine, uT("until"))) != NULL) {
         iT = 5;
-        if (CodeAnalyzer::isSeparator(*(pszT + iT))) {
+        if (isSeparator(*(pszT + iT))) {
             *piBalanceLoop -= 1;
         }
-        *piLine += 1;
         return true;
     }
 
@@ -491,7 +577,6 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
 
     // function f()
     if (iLen < 12) {
-        *piLine += 1;
         return true;
     }
 
@@ -500,12 +585,11 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
 
     pszT = Tstrstr(pszLine, uT("local"));
     if (pszT) {
-        if (CodeAnalyzer::isSeparator(*(pszT + 5))) {
+        if (isSeparator(*(pszT + 5))) {
             pszT += 5;
             funcScope = AnalyzerElement::SCOPE_LOCAL;
         }
         else {
-            *piLine += 1;
             return true;
         }
     }
@@ -523,7 +607,6 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
             pszT += 9;
             pszT = Tstrstr(pszT, uT(")"));
             if (pszT == NULL) {
-                *piLine += 1;
                 return true;
             }
             pszEnd = pszT + 1;
@@ -532,12 +615,12 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
                 pszT += 1;
             }
             if (pszT && *pszT && (pszT < (pszEnd - 10))) {
-                while (CodeAnalyzer::isSeparator(*pszT)) {
+                while (isSeparator(*pszT)) {
                     pszT += 1;
                 }
                 if ((*pszT) == uT('=')) {
                     pszT += 1;
-                    while (CodeAnalyzer::isSeparator(*pszT)) {
+                    while (isSeparator(*pszT)) {
                         pszT += 1;
                     }
                     if (pszT == pszStart) {
@@ -550,10 +633,10 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
             }
             // :END: name = function(arg)
         }
-        else if (CodeAnalyzer::isSeparator(*(pszT + 8))) {
+        else if (isSeparator(*(pszT + 8))) {
 
             pszT += 8;
-            while (CodeAnalyzer::isSeparator(*pszT)) {
+            while (isSeparator(*pszT)) {
                 pszT += 1;
             }
 
@@ -564,7 +647,6 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
                 pszT += 9;
                 pszT = Tstrstr(pszT, uT(")"));
                 if (pszT == NULL) {
-                    *piLine += 1;
                     return true;
                 }
                 pszEnd = pszT + 1;
@@ -573,12 +655,12 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
                     pszT += 1;
                 }
                 if (pszT && *pszT && (pszT < (pszEnd - 10))) {
-                    while (CodeAnalyzer::isSeparator(*pszT)) {
+                    while (isSeparator(*pszT)) {
                         pszT += 1;
                     }
                     if ((*pszT) == uT('=')) {
                         pszT += 1;
-                        while (CodeAnalyzer::isSeparator(*pszT)) {
+                        while (isSeparator(*pszT)) {
                             pszT += 1;
                         }
                         if (pszT == pszStart) {
@@ -610,11 +692,10 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
                         *pszT = cT;
                     }
                     else {
-                        if (CodeAnalyzer::isSeparator(*pszT) == false) {
-                            *piLine += 1;
+                        if (isSeparator(*pszT) == false) {
                             return true;
                         }
-                        while (CodeAnalyzer::isSeparator(*pszT)) {
+                        while (isSeparator(*pszT)) {
                             pszT += 1;
                         }
                         if (*pszT == uT('(')) {
@@ -636,119 +717,433 @@ bool CodeAnalyzer::analyzeLine(char_t *pszLine, int iLen, int *piId, int *piLine
     }
 
     if (funcName[0] == uT('\0')) {
-        *piLine += 1;
         return true;
     }
 
-    *piId += 1;
-    funcLine = *piLine;
-
-    AnalyzerElement *pFunc = new (std::nothrow) AnalyzerElement(*piId, funcScope, AnalyzerElement::ETYPE_FUNC, funcLine, static_cast<const char_t *>(funcName));
-    if (pFunc == NULL) {
-        *piLine += 1;
-        return false;
-    }
-
-    m_pData->push_back(pFunc);
+    setFound(funcScope, funcName);
 
     *piBalanceFunc += 1;
 
     pszT = Tstrstr(pszLine, uT("end"));
     if (pszT) {
-        if ((pszT == (pszLine + iLen - 3)) && CodeAnalyzer::isSeparator(*(pszT - 1))) {
+        if ((pszT == (pszLine + iLen - 3)) && isSeparator(*(pszT - 1))) {
             *piBalanceFunc -= 1;
         }
     }
 
-    *piLine += 1;
     return true;
 }
 
-bool CodeAnalyzer::analyze(void)
+// Analyze one line, starting from the state tState, updated to the state at the next line
+void AnalyzerJob::analyzeLine(int iLine, const char *pszLineA, int iLenA, char_t *pszLine, AnalyzerLine &tState)
 {
-    if (::wxFileExists(m_strFilename) == false) {
-        return false;
+    AnalyzerLine &tLine = lines[iLine];
+    if (tLine.name) {
+        free(tLine.name);
     }
+    tLine = tState;
+    tLine.name = NULL;
 
-    reset();
-
-    m_pData = new (std::nothrow) std::vector<AnalyzerElement *>;
-    if (m_pData == NULL) {
-        return false;
+    if (iLenA <= 0) {
+        return;
     }
-
-    FILE *fp = Tfopen(LM_CSTR(m_strFilename), uT("rt"));
-    if (fp == NULL) {
-        return false;
+    if (iLenA >= LM_STRSIZEL) {
+        // Truncated, not in the middle of an UTF-8 sequence
+        iLenA = LM_STRSIZEL - 1;
+        while ((iLenA > 0) && ((pszLineA[iLenA] & 0xC0) == 0x80)) {
+            iLenA -= 1;
+        }
     }
 
-    char szLineA[LM_STRSIZEL];
-    memset(szLineA, 0, LM_STRSIZEL * sizeof(char));
+    // Convert from UTF-8
+    wxString strLine = wxString::FromUTF8(pszLineA, (size_t)iLenA);
+    Tstrncpy(pszLine, LM_CSTR(strLine), LM_STRSIZEL - 1);
+    pszLine[LM_STRSIZEL - 1] = uT('\0');
 
-    char_t szLine[LM_STRSIZEL];
-    Tmemset(szLine, 0, LM_STRSIZEL);
+    int iLen = lm_trim(pszLine);
 
-    wxString strLine;
+    if (lang == CodeAnalyzer::LANGUAGE_LUA) {
+        if (iLen >= 4) {
+            // Comment block?
+            if ((pszLine[0] == uT('-')) && (pszLine[1] == uT('-')) && (pszLine[2] == uT('[')) && (pszLine[3] == uT('['))) {
+                tState.balanceComment += 1;
+                return;
+            }
+            else if ((pszLine[0] == uT('-')) && (pszLine[1] == uT('-')) && (pszLine[2] == uT(']')) && (pszLine[3] == uT(']'))) {
+                tState.balanceComment -= 1;
+                return;
+            }
+            else if ((pszLine[iLen - 2] == uT(']')) && (pszLine[iLen - 1] == uT(']'))) {
+                tState.balanceComment -= 1;
+                return;
+            }
+        }
+        else if (iLen >= 2) {
+            // Comment block?
+            if ((pszLine[iLen - 2] == uT(']')) && (pszLine[iLen - 1] == uT(']'))) {
+                tState.balanceComment -= 1;
+                return;
+            }
+        }
 
-    int iLine = 0, iLen, iId = 0, iBalanceFunc = 0, iBalanceLoop = 0, iBalanceComment = 0;
+        if (tState.balanceComment > 0) {
+            return;
+        }
+    }
 
-    while (fgets(szLineA, LM_STRSIZEL - 1, fp) != NULL) {
+    m_szFound[0] = uT('\0');
+    m_bMainFound = false;
+    if (analyzeLine(pszLine, iLen, &tState.balanceFunc, &tState.balanceLoop) == false) {
+        tLine.failed = true;
+    }
+    if (m_szFound[0] != uT('\0')) {
+        const size_t iSize = (Tstrlen(m_szFound) + 1) * sizeof(char_t);
+        tLine.name = (char_t *)malloc(iSize);
+        if (tLine.name) {
+            memcpy(tLine.name, m_szFound, iSize);
+            tLine.scope = m_iFoundScope;
+        }
+        else {
+            tLine.failed = true;
+        }
+    }
+    tLine.main = m_bMainFound;
+}
 
-        // Convert from UTF-8
-        strLine = wxString::FromUTF8((const char *)(szLineA));
-        Tstrcpy(szLine, LM_CSTR(strLine));
+void AnalyzerJob::run(void)
+{
+    // Line starts, as in the editor: "\r\n", "\r" and "\n" end a line
+    std::vector<size_t> vecStart;
+    vecStart.push_back(0);
+    for (size_t ii = 0; ii < length; ii++) {
+        if (text[ii] == '\r') {
+            if (((ii + 1) < length) && (text[ii + 1] == '\n')) {
+                ii += 1;
+            }
+            vecStart.push_back(ii + 1);
+        }
+        else if (text[ii] == '\n') {
+            vecStart.push_back(ii + 1);
+        }
+    }
+    const int iLineCount = static_cast<int>(vecStart.size());
+
+    if (dirtyAll || (static_cast<int>(lines.size()) != iLineCount)) {
+        AnalyzerJob::clearLines(lines, 0, static_cast<int>(lines.size()) - 1);
+        AnalyzerLine tLine;
+        tLine.reset();
+        lines.assign(iLineCount, tLine);
+        dirtyFirst = 0;
+        dirtyLast = iLineCount - 1;
+        dirtyAll = false;
+    }
 
-        iLen = lm_trim(szLine);
+    if (dirtyFirst >= 0) {
 
-        if (m_iLang == CodeAnalyzer::LANGUAGE_LUA) {
-            if (iLen >= 4) {
-                // Comment block?
-                if ((szLine[0] == uT('-')) && (szLine[1] == uT('-')) && (szLine[2] == uT('[')) && (szLine[3] == uT('['))) {
-                    iBalanceComment += 1;
-                    iLine += 1;
-                    continue;
-                }
-                else if ((szLine[0] == uT('-')) && (szLine[1] == uT('-')) && (szLine[2] == uT(']')) && (szLine[3] == uT(']'))) {
-                    iBalanceComment -= 1;
-                    iLine += 1;
-                    continue;
-                }
-                else if ((szLine[iLen - 2] == uT(']')) && (szLine[iLen - 1] == uT(']'))) {
-                    iBalanceComment -= 1;
-                    iLine += 1;
-                    continue;
-                }
+        char_t szLine[LM_STRSIZEL];
+        Tmemset(szLine, 0, LM_STRSIZEL);
+
+        AnalyzerLine tState = lines[dirtyFirst];
+        tState.name = NULL;
+        tState.failed = false;
+        tState.main = false;
+
+        // The lines after the changed ones are analyzed again until the state is the same as before
+        for (int iLine = dirtyFirst; iLine < iLineCount; iLine++) {
+            if ((iLine > dirtyLast) && lines[iLine].sameState(tState)) {
+                break;
             }
-            else if (iLen >= 2) {
-                // Comment block?
-                if ((szLine[iLen - 2] == uT(']')) && (szLine[iLen - 1] == uT(']'))) {
-                    iBalanceComment -= 1;
-                    iLine += 1;
-                    continue;
+            size_t iStart = vecStart[iLine];
+            size_t iEnd = length;
+            if ((iLine + 1) < iLineCount) {
+                iEnd = vecStart[iLine + 1] - 1;
+                if ((text[iEnd] == '\n') && (iEnd > iStart) && (text[iEnd - 1] == '\r')) {
+                    iEnd -= 1;
                 }
             }
+            analyzeLine(iLine, text + iStart, static_cast<int>(iEnd - iStart), szLine, tState);
+        }
+
+        dirtyFirst = -1;
+        dirtyLast = -1;
+    }
 
-            if (iBalanceComment > 0) {
-                iLine += 1;
-                continue;
+    // The list, from the lines
+    symbols = new (std::nothrow) AnalyzerSymbols();
+    if (symbols == NULL) {
+        return;
+    }
+
+    for (int ii = 0; ii < iLineCount; ii++) {
+        const AnalyzerLine &tLine = lines[ii];
+        if (tLine.failed) {
+            // As when reading the lines one by one: the analysis stops here
+            symbols->setFailed(true);
+            break;
+        }
+        if (tLine.main && (symbols->getMainLine() < 0)) {
+            symbols->setMainLine(ii);
+        }
+        if (tLine.name && (symbols->add(tLine.name, tLine.scope, ii) == false)) {
+            symbols->setFailed(true);
+            break;
+        }
+    }
+}
+
+void CodeAnalyzer::modified(int iLine, int iLinesAdded)
+{
+    // The listed lines follow the modification until the next analysis
+    if (iLinesAdded != 0) {
+        for (size_t ii = 0; ii < m_ElementLines.size(); ii++) {
+            if (m_ElementLines[ii] > iLine) {
+                m_ElementLines[ii] += iLinesAdded;
+                if (m_ElementLines[ii] < iLine) {
+                    m_ElementLines[ii] = iLine;
+                }
             }
         }
+    }
 
-        if (analyzeLine(szLine, iLen, &iId, &iLine, &iBalanceFunc, &iBalanceLoop) == false) {
-            fclose(fp);
-            fp = NULL;
-            return false;
+    if (m_bDirtyAll) {
+        return;
+    }
+
+    if (m_pThread) {
+        // The lines belong to the running job: replayed when it is done
+        m_Pending.push_back(std::make_pair(iLine, iLinesAdded));
+        return;
+    }
+
+    const int iCount = static_cast<int>(m_Lines.size());
+    if ((iLine < 0) || (iLine >= iCount) || ((iLinesAdded < 0) && ((iLine - iLinesAdded) >= iCount))) {
+        m_bDirtyAll = true;
+        return;
+    }
+
+    if (iLinesAdded > 0) {
+        AnalyzerLine tLine;
+        tLine.reset();
+        m_Lines.insert(m_Lines.begin() + iLine + 1, iLinesAdded, tLine);
+    }
+    else if (iLinesAdded < 0) {
+        AnalyzerJob::clearLines(m_Lines, iLine + 1, iLine - iLinesAdded);
+        m_Lines.erase(m_Lines.begin() + iLine + 1, m_Lines.begin() + iLine + 1 - iLinesAdded);
+    }
+
+    const int iLast = iLine + ((iLinesAdded > 0) ? iLinesAdded : 0);
+    if (m_iDirtyFirst < 0) {
+        m_iDirtyFirst = iLine;
+        m_iDirtyLast = iLast;
+        return;
+    }
+    if (m_iDirtyLast > iLine) {
+        m_iDirtyLast += iLinesAdded;
+        if (m_iDirtyLast < iLine) {
+            m_iDirtyLast = iLine;
         }
+    }
+    if (m_iDirtyFirst > iLine) {
+        m_iDirtyFirst = iLine;
+    }
+    if (m_iDirtyLast < iLast) {
+        m_iDirtyLast = iLast;
+    }
+}
 
-        if (getCount() >= CodeAnalyzer::MAXCOUNT) {
-            fclose(fp);
-            fp = NULL;
-            return true;
+// The job takes the line states and the changes to analyze
+AnalyzerJob *CodeAnalyzer::createJob(void)
+{
+    AnalyzerJob *pJob = new (std::nothrow) AnalyzerJob();
+    if (pJob == NULL) {
+        return NULL;
+    }
+
+    pJob->lang = static_cast<int>(m_iLang);
+    pJob->lines.swap(m_Lines);
+    pJob->dirtyFirst = m_iDirtyFirst;
+    pJob->dirtyLast = m_iDirtyLast;
+    pJob->dirtyAll = m_bDirtyAll;
+
+    m_iDirtyFirst = -1;
+    m_iDirtyLast = -1;
+    m_bDirtyAll = false;
+
+    return pJob;
+}
+
+// Take the line states back, publish the new list and apply the changes made meanwhile.
+// Returns true if the list changed.
+bool CodeAnalyzer::publish(AnalyzerJob *pJob)
+{
+    m_Lines.swap(pJob->lines);
+
+    bool bChanged = false;
+    if (pJob->symbols) {
+        bChanged = (m_pSymbols == NULL) || (m_pSymbols->isSame(pJob->symbols) == false);
+        if (m_pSymbols) {
+            delete m_pSymbols;
+        }
+        m_pSymbols = pJob->symbols;
+        pJob->symbols = NULL;
+
+        m_ElementLines.resize(m_pSymbols->getCount());
+        for (int ii = 0; ii < m_pSymbols->getCount(); ii++) {
+            m_ElementLines[ii] = m_pSymbols->getElement(ii).line;
+        }
+        if (bChanged) {
+            m_iGeneration += 1;
+        }
+    }
+    else {
+        m_bDirtyAll = true;
+    }
+
+    std::vector<std::pair<int, int> > vecPending;
+    vecPending.swap(m_Pending);
+    for (size_t ii = 0; ii < vecPending.size(); ii++) {
+        modified(vecPending[ii].first, vecPending[ii].second);
+    }
+
+    return bChanged;
+}
+
+bool CodeAnalyzer::analyze(wxStyledTextCtrl *pEdit, bool *pbChanged /* = NULL*/)
+{
+    if (pbChanged) {
+        *pbChanged = false;
+    }
+
+    if (pEdit == NULL) {
+        return false;
+    }
+
+    bool bChanged = false;
+    wait(&bChanged);
+
+    if ((isDirty() == false) && (m_pSymbols != NULL)) {
+        if (pbChanged) {
+            *pbChanged = bChanged;
         }
+        return (m_pSymbols->isFailed() == false);
+    }
+
+    AnalyzerJob *pJob = createJob();
+    if (pJob == NULL) {
+        return false;
+    }
+
+    // The buffer is read in place, the job being run right now
+    pJob->length = (size_t)(pEdit->GetLength());
+    pJob->text = (pJob->length > 0) ? pEdit->GetRangePointer(0, static_cast<int>(pJob->length)) : NULL;
+    if (pJob->text == NULL) {
+        pJob->length = 0;
     }
+    pJob->run();
 
-    fclose(fp);
-    fp = NULL;
+    bChanged = publish(pJob) || bChanged;
+    delete pJob;
+
+    if (pbChanged) {
+        *pbChanged = bChanged;
+    }
+
+    return (m_pSymbols != NULL) && (m_pSymbols->isFailed() == false);
+}
+
+bool CodeAnalyzer::analyzeAsync(wxStyledTextCtrl *pEdit, bool *pbChanged /* = NULL*/)
+{
+    if (pbChanged) {
+        *pbChanged = false;
+    }
+
+    if (pEdit == NULL) {
+        return false;
+    }
+
+    if (m_pThread) {
+        return true;
+    }
+
+    if ((isDirty() == false) && (m_pSymbols != NULL)) {
+        return false;
+    }
+
+    AnalyzerThread *pThread = new (std::nothrow) AnalyzerThread();
+    if (pThread == NULL) {
+        analyze(pEdit, pbChanged);
+        return false;
+    }
 
+    // Snapshot of the document (raw UTF-8 bytes): editing can go on while it is analyzed
+    size_t iLength = (size_t)(pEdit->GetTextLength());
+    wxCharBuffer strBuffer = pEdit->GetTextRaw();
+
+    AnalyzerJob *pJob = createJob();
+    if (pJob == NULL) {
+        delete pThread;
+        return false;
+    }
+    pJob->owned = strBuffer.release();
+    pJob->text = (const char *)(pJob->owned);
+    pJob->length = (pJob->text != NULL) ? iLength : 0;
+
+    m_iRun += 1;
+    if ((pThread->Create(pEdit, pJob, m_iRun) == wxTHREAD_NO_ERROR) && (pThread->Run() == wxTHREAD_NO_ERROR)) {
+        m_pThread = pThread;
+        return true;
+    }
+
+    // No thread: done right away
+    pJob = pThread->releaseJob();
+    delete pThread;
+    pJob->run();
+    bool bChanged = publish(pJob);
+    delete pJob;
+
+    if (pbChanged) {
+        *pbChanged = bChanged;
+    }
+
+    return false;
+}
+
+bool CodeAnalyzer::finish(int iRun, bool *pbChanged /* = NULL*/)
+{
+    if (pbChanged) {
+        *pbChanged = false;
+    }
+
+    // Already completed by wait (and maybe followed by another analysis)
+    if ((m_pThread == NULL) || (iRun != m_iRun)) {
+        return false;
+    }
+
+    wait(pbChanged);
     return true;
 }
+
+void CodeAnalyzer::wait(bool *pbChanged /* = NULL*/)
+{
+    if (pbChanged) {
+        *pbChanged = false;
+    }
+
+    if (m_pThread == NULL) {
+        return;
+    }
+
+    m_pThread->Wait();
+
+    AnalyzerJob *pJob = m_pThread->releaseJob();
+    delete m_pThread;
+    m_pThread = NULL;
+
+    if (pJob) {
+        bool bChanged = publish(pJob);
+        delete pJob;
+        if (pbChanged) {
+            *pbChanged = bChanged;
+        }
+    }
+}
@@ -16,6 +16,7 @@
 #include "CometApp.h"
 #include "CometFrame.h"
 #include "CodeEdit.h"
+#include "SaveThread.h"
 
 #include <wx/file.h>     // raw file io support
 #include <wx/filename.h> // filename support
@@ -25,6 +26,8 @@
 
 #include <wx/stc/stc.h>
 
+#include <algorithm>
+
 BEGIN_EVENT_TABLE(CodeEdit, wxStyledTextCtrl)
     EVT_SET_FOCUS(CodeEdit::OnSetFocus)
     EVT_KILL_FOCUS(CodeEdit::OnKillFocus)
@@ -34,6 +37,9 @@ BEGIN_EVENT_TABLE(CodeEdit, wxStyledTextCtrl)
     EVT_STC_DWELLSTART(wxID_ANY, CodeEdit::OnDwellStart)
     EVT_STC_DWELLEND(wxID_ANY, CodeEdit::OnDwellEnd)
     EVT_STC_UPDATEUI(wxID_ANY, CodeEdit::OnUIupdate)
+    EVT_STC_STYLENEEDED(wxID_ANY, CodeEdit::OnStyleNeeded)
+    EVT_STC_MODIFIED(wxID_ANY, CodeEdit::OnModified)
+    EVT_IDLE(CodeEdit::OnIdle)
     EVT_COMMAND(ID_THREAD_READ, wxEVT_COMMAND_TEXT_UPDATED, CodeEdit::OnMessageReceived)
     EVT_COMMAND(ID_THREAD_MESSAGE, wxEVT_COMMAND_TEXT_UPDATED, CodeEdit::OnMessageReceived)
     EVT_COMMAND(ID_THREAD_FINISH, wxEVT_COMMAND_TEXT_UPDATED, CodeEdit::OnMessageReceived)
@@ -49,17 +55,17 @@ CodeEdit::CodeEdit(wxWindow *parentT, wxWindowID idT,
     m_iLexerType = LEXERTYPE_FIRST;
 
     m_pMutex = new wxMutex(wxMUTEX_DEFAULT);
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_iPlotCreatedId = 0L;
-        m_bReadDone = false;
-        m_strRead = uT("");
-        m_bAskDone = false;
-        m_iAnswer = -1;
-        m_pLuaEngine = NULL;
-        m_iRunningLine = -1;
-        m_bGuierrSet = false;
-        m_pMutex->Unlock();
-    }
+    m_pCondition = new wxCondition(*m_pMutex);
+    m_pMutex->Lock();
+    m_iPlotCreatedId = 0L;
+    m_bReadDone = false;
+    m_strRead = uT("");
+    m_bAskDone = false;
+    m_iAnswer = -1;
+    m_pLuaEngine = NULL;
+    m_iRunningLine = -1;
+    m_bGuierrSet = false;
+    m_pMutex->Unlock();
 
     m_LinenumberID = 0;
     m_MarkerID = 1;
@@ -74,16 +80,24 @@ CodeEdit::CodeEdit(wxWindow *parentT, wxWindowID idT,
     m_fEndTime = 0.0;
 
     m_strAutoCompList = wxEmptyString;
+    m_iAutoCompStart = -1;
+    m_bAutoCompWords = false;
 
     m_bWordEnclosed = false;
     m_bPopmenuShown = false;
 
     m_bRunning = false;
 
+    m_iStyleNext = -1;
+    m_iStyleSlice = STYLE_SLICE_MINSIZE;
+    m_iStyleViewStart = -1;
+    m_iStyleViewEnd = -1;
+
     m_strName = uT("");
 
     this->SetModEventMask(wxSTC_MOD_INSERTTEXT | wxSTC_MOD_DELETETEXT);
     this->SetCodePage(wxSTC_CP_UTF8);
+    this->SetStyleNeededNotify(true);
 }
 
 void CodeEdit::createCometLexer(void)
@@ -208,6 +222,9 @@ void ScintillaPrefs::loadDefault(ScintillaPrefs &tScintillaPrefs)
     tScintillaPrefs.common.marckerColorError = 0x0000FF;
 
     tScintillaPrefs.common.reloadDelay = 5;
+    tScintillaPrefs.common.saveDurability = SAVE_DURABILITY_DEFAULT;
+    tScintillaPrefs.common.undoMemory = UNDO_MEMORY_DEFAULT;
+    tScintillaPrefs.common.undoSpill = true;
 
     for (int ii = 0; ii < STYLEINFO_COUNT; ii++) {
         tScintillaPrefs.style[ii].id = CodeEdit::STYLE_LIGHT[ii].id;
@@ -259,6 +276,10 @@ void CodeEdit::initCaret(const int iSpacing)
 
 CodeEdit::~CodeEdit()
 {
+    if (m_pCondition) {
+        delete m_pCondition;
+        m_pCondition = NULL;
+    }
     if (m_pMutex) {
         delete m_pMutex;
         m_pMutex = NULL;
@@ -323,6 +344,9 @@ void CodeEdit::initCommonPrefs(void)
     SetBackSpaceUnIndents(m_ScintillaPrefs.common.useTab);
     SetIndentationGuides(m_ScintillaPrefs.common.indentGuideEnable);
 
+    SetUndoSpill(m_ScintillaPrefs.common.undoSpill);
+    SetUndoMemoryLimit(m_ScintillaPrefs.common.undoMemory * LM_STRSIZEW * LM_STRSIZEW);
+
     initCaret(m_ScintillaPrefs.common.lineSpacing);
 }
 
@@ -663,7 +687,8 @@ bool CodeEdit::initPrefs(void)
     SetMarginWidth(m_FoldingID, m_ScintillaPrefs.common.foldEnable ? m_FoldingMargin : 0);
     SetMarginSensitive(m_FoldingID, true);
 
-    SetProperty(uT("fold"), uT("1"));
+    // Fold levels are only computed if the folding margin is shown
+    SetProperty(uT("fold"), m_ScintillaPrefs.common.foldEnable ? uT("1") : uT("0"));
     SetProperty(uT("fold.comment"), uT("1"));
     SetProperty(uT("fold.compact"), uT("0"));
     SetProperty(uT("fold.preprocessor"), uT("1"));
@@ -751,12 +776,11 @@ void CodeEdit::OnMessageReceived(wxCommandEvent &tEvent)
 
 bool CodeEdit::luaDoRead(int iNum /* = 0*/, const wxString &strLabel /* = uT("")*/)
 {
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bReadDone = false;
-        m_strRead = uT("");
-        m_iAnswer = -1;
-        m_pMutex->Unlock();
-    }
+    m_pMutex->Lock();
+    m_bReadDone = false;
+    m_strRead = uT("");
+    m_iAnswer = -1;
+    m_pMutex->Unlock();
 
     // >> Show Dialog
     wxString strT = strLabel;
@@ -764,12 +788,12 @@ bool CodeEdit::luaDoRead(int iNum /* = 0*/, const wxString &strLabel /* = uT("")
     strT.Trim(false);
     wxTextEntryDialog *pDlg = new (std::nothrow) wxTextEntryDialog(this, strT.IsEmpty() ? uT("Input:") : strT, uT("Comet"), uT(""), wxOK, wxDefaultPosition, wxSize(250, wxDefaultCoord));
     if (pDlg == NULL) {
-        if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-            m_strRead = uT("");
-            m_iAnswer = -1;
-            m_bReadDone = true;
-            m_pMutex->Unlock();
-        }
+        m_pMutex->Lock();
+        m_strRead = uT("");
+        m_iAnswer = -1;
+        m_bReadDone = true;
+        m_pCondition->Broadcast();
+        m_pMutex->Unlock();
         return false;
     }
     pDlg->SetMaxLength(LM_STRSIZE);
@@ -790,11 +814,12 @@ bool CodeEdit::luaDoRead(int iNum /* = 0*/, const wxString &strLabel /* = uT("")
     strT = pDlg->GetValue();
     pDlg->Destroy();
 
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bReadDone = true;
-        m_strRead = strT;
-        m_pMutex->Unlock();
-    }
+    // Wake up the script thread waiting for the answer (see ScriptThread::readStr)
+    m_pMutex->Lock();
+    m_bReadDone = true;
+    m_strRead = strT;
+    m_pCondition->Broadcast();
+    m_pMutex->Unlock();
 
     // <<
 
@@ -803,19 +828,18 @@ bool CodeEdit::luaDoRead(int iNum /* = 0*/, const wxString &strLabel /* = uT("")
 
 bool CodeEdit::luaDoAsk(const wxString &strMessage, const wxString &strTitle /* = uT("Comet")*/)
 {
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bAskDone = false;
-        m_iAnswer = -1;
-        m_pMutex->Unlock();
-    }
+    m_pMutex->Lock();
+    m_bAskDone = false;
+    m_iAnswer = -1;
+    m_pMutex->Unlock();
 
     int iret = SigmaMessageBox(strMessage, strTitle, wxYES_NO | wxICON_QUESTION, NULL);
 
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bAskDone = true;
-        m_iAnswer = (iret == wxYES) ? 1 : 0;
-        m_pMutex->Unlock();
-    }
+    m_pMutex->Lock();
+    m_bAskDone = true;
+    m_iAnswer = (iret == wxYES) ? 1 : 0;
+    m_pCondition->Broadcast();
+    m_pMutex->Unlock();
 
     return true;
 }
@@ -875,8 +899,151 @@ void CodeEdit::DoHighlightSyntax(bool bEnable)
         StyleSetBold(wxSTC_STYLE_BRACEBAD, false);
     }
 
-    // Immediately refresh colouring
-    this->Colourise(0, this->GetLineEndPosition(this->GetLineCount() - 1));
+    // Refresh colouring: the visible lines immediately, the rest when idle
+    DoColouriseAsync();
+}
+
+// Restyle the whole document without blocking the UI: the lines to paint when Scintilla
+// needs them (OnStyleNeeded), the rest in idle-time slices (OnIdle)
+void CodeEdit::DoColouriseAsync(void)
+{
+    const int iTextLen = this->GetTextLength();
+    if (iTextLen < STYLE_ASYNC_MINSIZE) {
+        m_iStyleNext = -1;
+        this->Colourise(0, iTextLen);
+        return;
+    }
+
+    m_iStyleNext = 0;
+    m_iStyleSlice = STYLE_SLICE_MINSIZE;
+    m_iStyleViewStart = -1;
+    m_iStyleViewEnd = -1;
+    this->StartStyling(0, (1 << this->GetStyleBits()) - 1);
+    this->Refresh(false);
+}
+
+// Start of a line where the lexer can restart, searched backward from iLine: the end of the
+// previous line has the default style and line state (as styled before, or never styled),
+// preferably a line not indented after an empty line. Otherwise, the end of the styled text.
+int CodeEdit::findStyleRestart(int iLine)
+{
+    const int iStyled = this->PositionFromLine(this->LineFromPosition(this->GetEndStyled()));
+    const int iLineMin = iLine - STYLE_RESTART_LINES;
+    if (iLineMin <= this->LineFromPosition(iStyled)) {
+        return iStyled;
+    }
+
+    const int iMask = (1 << this->GetStyleBits()) - 1;
+    int iDefaultLine = -1;
+    for (int ii = iLine; ii > iLineMin; ii--) {
+        const int iPos = this->PositionFromLine(ii);
+        if (((this->GetStyleAt(iPos - 1) & iMask) != 0) || (this->GetLineState(ii - 1) != 0)) {
+            continue;
+        }
+        if ((this->GetLineEndPosition(ii - 1) == this->PositionFromLine(ii - 1)) && (this->GetCharAt(iPos) > ' ')) {
+            return iPos;
+        }
+        iDefaultLine = ii;
+    }
+    return (iDefaultLine >= 0) ? this->PositionFromLine(iDefaultLine) : iStyled;
+}
+
+// Style the next part of the document, within the time budget. Returns true if not finished.
+// The styled text ends where the pass is, or earlier if modified (Scintilla moves the end back).
+bool CodeEdit::colouriseSlice(void)
+{
+    const int iTextLen = this->GetTextLength();
+    const int iStyled = this->PositionFromLine(this->LineFromPosition(this->GetEndStyled()));
+    if (iStyled != m_iStyleNext) {
+        // modified before the pass, or styling kept after a change reached (see Document::CheckStyledKeptEnd)
+        m_iStyleNext = iStyled;
+    }
+
+    wxStopWatch swT;
+    while ((m_iStyleNext < iTextLen) && (swT.Time() < STYLE_SLICE_TIME)) {
+        int iEnd = m_iStyleNext + m_iStyleSlice;
+        if (iEnd >= iTextLen) {
+            iEnd = iTextLen;
+        }
+        else {
+            iEnd = this->PositionFromLine(this->LineFromPosition(iEnd) + 1);
+        }
+
+        const long iStart = swT.Time();
+        this->Colourise(m_iStyleNext, iEnd);
+        const long iElapsed = swT.Time() - iStart;
+        if (iElapsed < (STYLE_SLICE_TIME / 2)) {
+            m_iStyleSlice *= 2;
+        }
+        else if ((iElapsed > STYLE_SLICE_TIME) && (m_iStyleSlice > STYLE_SLICE_MINSIZE)) {
+            m_iStyleSlice /= 2;
+        }
+        m_iStyleNext = std::max(iEnd, this->GetEndStyled());
+    }
+
+    if (m_iStyleNext >= iTextLen) {
+        m_iStyleNext = -1;
+        m_iStyleViewStart = -1;
+        return false;
+    }
+    return true;
+}
+
+// Styling needed by Scintilla up to the event position, before painting mostly.
+// During the idle pass, the lines to paint are styled from a restart line found near them
+// (findStyleRestart), not from the end of the styled text which stays where the pass is.
+void CodeEdit::OnStyleNeeded(wxStyledTextEvent &tEvent)
+{
+    const int iEndPos = tEvent.GetPosition();
+    const int iStyled = this->PositionFromLine(this->LineFromPosition(this->GetEndStyled()));
+
+    if (m_iStyleNext >= 0) {
+        const int iFirstVisible = this->GetFirstVisibleLine();
+        const int iFirstLine = this->DocLineFromVisible(iFirstVisible);
+        const int iStartPos = this->PositionFromLine(iFirstLine);
+        // Scintilla styles one line more than painted
+        const int iLastLine = this->DocLineFromVisible(iFirstVisible + this->LinesOnScreen() + 2) + 1;
+        const int iViewEnd = (iLastLine >= this->GetLineCount()) ? this->GetTextLength() : this->PositionFromLine(iLastLine);
+
+        if ((iEndPos > iStartPos) && (iEndPos <= iViewEnd)) {
+            if ((m_iStyleViewStart >= 0) && (iStartPos >= m_iStyleViewStart) && (iEndPos <= m_iStyleViewEnd)) {
+                // styled since the last change
+                return;
+            }
+            const int iRestart = findStyleRestart(iFirstLine);
+            if (iRestart > iStyled) {
+                const int iEndStyled = this->GetEndStyled();
+                this->Colourise(iRestart, iViewEnd);
+                m_iStyleViewStart = iRestart;
+                m_iStyleViewEnd = iViewEnd;
+                // The text before the restart line is still to be styled by the idle pass
+                this->StartStyling(iEndStyled, (1 << this->GetStyleBits()) - 1);
+                return;
+            }
+        }
+    }
+
+    // From the end of the styled text, as done by Scintilla
+    if (iEndPos > iStyled) {
+        this->Colourise(iStyled, iEndPos);
+    }
+}
+
+void CodeEdit::OnModified(wxStyledTextEvent &tEvent)
+{
+    // Lines styled before painting: styled again if changed
+    if ((m_iStyleViewStart >= 0) && (tEvent.GetPosition() < m_iStyleViewEnd)) {
+        m_iStyleViewStart = -1;
+    }
+    tEvent.Skip();
+}
+
+void CodeEdit::OnIdle(wxIdleEvent &tEvent)
+{
+    if ((m_iStyleNext >= 0) && colouriseSlice()) {
+        tEvent.RequestMore();
+    }
+    tEvent.Skip();
 }
 
 void CodeEdit::DoEnableAutocomplete(bool bEnable)
@@ -973,104 +1140,36 @@ void CodeEdit::OnCharAdded(wxStyledTextEvent &WXUNUSED(tEvent))
 
     const int is = *pAutoCListLen;
 
-    for (ii = 0; (pAutoCList[ii].len != 0) && (ii < is); ii++) {
-
-        nStart = nStartSel - pAutoCList[ii].len;
-        if (nStart < 0) {
-            continue;
-        }
-
-        // Whole word
-        if (!bAutoCompActive) {
-            if (!isSeparator(nStart - 1)) {
-                continue;
-            }
-        }
-        //
-
-        strList = pAutoCList[ii].words;
-
-        if (!bAutoCompActive) {
-            strT = GetTextRange(nStart, nEndSel);
-            wxStringTokenizer tokenizerT(strList, uT("|"));
-            ll = 0;
-            while (tokenizerT.HasMoreTokens() && (ll < pAutoCList[ii].count)) {
-                strItem = tokenizerT.GetNextToken();
-                if (strItem.StartsWith(strT) && !bAutoCompActive) {
-                    m_strAutoCompList = strItem;
-                    AutoCompSetChooseSingle(false);
-                    AutoCompShow(pAutoCList[ii].len, strList, ll);
-                    bAutoShown = true;
-                    break;
-                }
-                ll += 1;
-            }
-        }
+    // Word being typed
+    nStart = nStartSel;
+    while ((nStart > 0) && ((nStartSel - nStart) < AUTOCOMP_WORDMAX) && !isSeparator(nStart - 1)) {
+        nStart -= 1;
+    }
 
-        if (bAutoShown) {
+    if (bAutoCompActive && m_bAutoCompWords) {
+        // Select the first word starting with the typed text (complete if the same)
+        strT = GetTextRange(m_iAutoCompStart, nEndSel);
+        std::vector<wxString>::const_iterator itT = std::lower_bound(m_AutoCompItems.begin(), m_AutoCompItems.end(), strT);
+        if ((nStart == m_iAutoCompStart) && (itT != m_AutoCompItems.end()) && itT->StartsWith(strT)) {
+            AutoCompUpdate(nEndSel - m_iAutoCompStart, m_strAutoCompList, (int)(itT - m_AutoCompItems.begin()), itT->IsSameAs(strT));
             return;
         }
-
-        if (!bAutoCompActive) {
-            continue;
-        }
-
+        DoCallTipCancel();
+    }
+    else if ((bAutoCompActive == false) && (nStart < nStartSel)) {
+        updateAutoComp();
         strT = GetTextRange(nStart, nEndSel);
-
-        if (strT.Contains(uT("(")) == false) {
-            for (jj = 1; jj < pAutoCList[ii].maxi; jj++) {
-
-                nStart -= 1;
-                if (nStart < 0) {
-                    break;
-                }
-
-                // Whole word
-                if (!isSeparator(nStart - 1)) {
-                    continue;
-                }
-                //
-
-                strT = GetTextRange(nStart, nEndSel);
-
-                wxStringTokenizer tokenizerT(strList, uT("|"));
-                ll = 0;
-                bAutoUpdate = false;
-                bAutoCancel = false;
-                strItem = wxEmptyString;
-                while (tokenizerT.HasMoreTokens() && (ll < pAutoCList[ii].count)) {
-                    strItem = tokenizerT.GetNextToken();
-
-                    if (strItem.IsSameAs(strT)) {
-                        bAutoUpdate = true;
-                        bAutoCancel = true;
-                        break;
-                    }
-                    else if (strItem.StartsWith(strT)) {
-                        bAutoUpdate = true;
-                        bAutoCancel = false;
-                        break;
-                    }
-                    ll += 1;
-                }
-
-                if (bAutoUpdate && (strItem.IsEmpty() == false)) {
-                    if (m_strAutoCompList.IsSameAs(strItem)) {
-                        AutoCompUpdate(pAutoCList[ii].len + jj, strItem, ll, false);
-                    }
-                    else {
-                        DoCallTipCancel();
-                        m_strAutoCompList = strItem;
-                        AutoCompSetChooseSingle(false);
-                        AutoCompShow(pAutoCList[ii].len + jj, strItem, 0);
-                    }
-                    bAutoShown = true;
-                    break;
-                }
+        bool bShow = false;
+        if ((m_AutoComp.find(pAutoCList, is, strT, m_AutoCompItems, &bShow) > 0) && bShow) {
+            m_strAutoCompList = m_AutoCompItems[0];
+            for (size_t kk = 1; kk < m_AutoCompItems.size(); kk++) {
+                m_strAutoCompList += uT("|");
+                m_strAutoCompList += m_AutoCompItems[kk];
             }
-        }
-
-        if (bAutoShown) {
+            m_iAutoCompStart = nStart;
+            m_bAutoCompWords = true;
+            AutoCompSetChooseSingle(false);
+            AutoCompShow(nEndSel - nStart, m_strAutoCompList, 0);
             return;
         }
     }
@@ -1113,6 +1212,7 @@ void CodeEdit::OnCharAdded(wxStyledTextEvent &WXUNUSED(tEvent))
         // Display the auto completion list for the first time.
         if (!bAutoCompActiveB && strT.StartsWith(pAutoCList[ii].prefix)) {
             m_strAutoCompList = strList;
+            m_bAutoCompWords = false;
             AutoCompSetChooseSingle(false);
             AutoCompShow(0, strList, 0);
             bAutoShown = true;
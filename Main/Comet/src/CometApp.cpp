@@ -15,6 +15,9 @@
 
 #include "CometApp.h"
 #include "CometFrame.h"
+#include "CometBatch.h"
+#include "CometBench.h"
+#include "CometServer.h"
 
 #include <wx/filefn.h>
 #include <wx/html/htmlwin.h>
@@ -66,10 +69,28 @@ static void consoleShowHelp(void)
     Tprintf(uT("\nCopyright(C) 2010-2022 Pr. Sidi HAMADY"));
     Tprintf(uT("\nhttp://www.hamady.org"));
     Tprintf(uT("\nUsage: comet -run infile [-out outfile] [-show]\n"));
+    Tprintf(uT("\n       comet -run infile -server socket\n"));
+    Tprintf(uT("\n       comet -serve socket [-workers N] [-preload script]\n"));
     Tprintf(uT("\n       comet -compile infile [-out outfile]\n"));
+    Tprintf(uT("\n       comet -compile dir... [-jobs N] [-outdir dir] [-bundle file.luac]\n"));
+    Tprintf(uT("\n       comet -batch script... | @manifest [-jobs N] [-outdir dir] [-summary file.json]\n"));
+    Tprintf(uT("\n       comet -bench infile [-warmup N] [-iterations N] [-save baseline] [-baseline baseline] [-threshold pct]\n"));
+    Tprintf(uT("\n       comet -test dir... [-jobs N] [-timeout seconds] [-jit] [-tap [file] | -junit [file]] [-outdir dir]\n"));
     lf_println();
 }
 
+// Ends a console mode with a status built from a count of failures (0 if all succeeded).
+// The status of OnInit returning false is not usable by the calling scripts.
+static void consoleExit(int iFailed)
+{
+    fflush(stdout);
+    fflush(stderr);
+    if (iFailed == 0) {
+        exit(EXIT_SUCCESS);
+    }
+    exit((iFailed < 0) ? 126 : ((iFailed > 125) ? 125 : iFailed));
+}
+
 static int consoleRunScript(const char *pszFilename, bool bAction, const char *pszOutputFilename)
 {
     if (pszFilename == NULL) {
@@ -219,8 +240,26 @@ static int consoleRunScript(const char *pszFilename, bool bAction, const char *p
     return (bRet) ? EXIT_SUCCESS : EXIT_FAILURE;
 }
 
+#ifdef __WXMSW__
+
 IMPLEMENT_APP(CometApp)
 
+#else
+
+IMPLEMENT_APP_NO_MAIN(CometApp)
+
+// The client of a script server (comet -run infile -server socket) is run before wxWidgets
+// and GTK are initialized, so that it only costs the process startup.
+int main(int argc, char **argv)
+{
+    if ((argc == 5) && (strcasecmp(argv[1], "-run") == 0) && (strcasecmp(argv[3], "-server") == 0)) {
+        return CometServer::runClient(argv[4], argv[2]) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    return wxEntry(argc, argv);
+}
+
+#endif
+
 wxString CometApp::APPDIR = wxEmptyString;
 wxString CometApp::BINDIR = wxEmptyString;
 wxString CometApp::INCDIR = wxEmptyString;
@@ -464,6 +503,256 @@ bool CometApp::OnInit()
     const char_t *pszRun = cmdLine.getArg(1);
     const char_t *pszInputFilename = cmdLine.getArg(2);
 
+    // run many scripts, each in its own Lua state, by a pool of worker threads
+    if (cmdLine.isOK() && (iArgc >= 3) && (pszRun != NULL) && (Tstricmp(pszRun, uT("-batch")) == 0)) {
+
+        CometApp::COMETCONSOLE = true;
+
+#ifdef __WXMSW__
+        // under Windows, enable std IO
+        win32EnableConsole();
+        //
+#endif
+
+        CometBatch *pBatch = new (std::nothrow) CometBatch(CONSOLE_CFUNCTION_IO);
+        if (pBatch == NULL) {
+            printf("\n! Cannot run the batch: insufficient memory\n");
+            return false;
+        }
+
+        bool bArgs = true;
+        for (int ii = 2; ii < iArgc; ii++) {
+            const char_t *pszT = cmdLine.getArg(ii);
+            if (pszT == NULL) {
+                continue;
+            }
+            const bool bOption = (Tstricmp(pszT, uT("-jobs")) == 0) || (Tstricmp(pszT, uT("-outdir")) == 0) || (Tstricmp(pszT, uT("-summary")) == 0);
+            if (bOption && ((ii >= (iArgc - 1)) || (cmdLine.getArg(ii + 1) == NULL))) {
+                bArgs = false;
+                break;
+            }
+            wxString strT(bOption ? cmdLine.getArg(ii + 1) : pszT);
+            if (Tstricmp(pszT, uT("-jobs")) == 0) {
+                long iJobs = 0;
+                if (strT.ToLong(&iJobs) == false) {
+                    bArgs = false;
+                    break;
+                }
+                pBatch->setJobs((int)iJobs);
+            }
+            else if (Tstricmp(pszT, uT("-outdir")) == 0) {
+                pBatch->setOutputDir(LM_U8STR(strT));
+            }
+            else if (Tstricmp(pszT, uT("-summary")) == 0) {
+                pBatch->setSummary(LM_U8STR(strT));
+            }
+            else if (pBatch->add(LM_U8STR(strT)) == false) {
+                bArgs = false;
+                break;
+            }
+            if (bOption) {
+                ii += 1;
+            }
+        }
+
+        int iFailed = -1;
+        if (bArgs && (pBatch->getCount() > 0)) {
+            iFailed = pBatch->run();
+        }
+        else {
+            consoleShowHelp();
+        }
+
+        delete pBatch;
+        pBatch = NULL;
+
+#ifdef __WXMSW__
+        win32SendEnterKey();
+#endif
+        consoleExit(iFailed);
+        return false;
+    }
+
+    // run the test_*.lua scripts of directories, as the batch mode, with a timeout and a report
+    if (cmdLine.isOK() && (iArgc >= 3) && (pszRun != NULL) && (Tstricmp(pszRun, uT("-test")) == 0)) {
+
+        CometApp::COMETCONSOLE = true;
+
+#ifdef __WXMSW__
+        // under Windows, enable std IO
+        win32EnableConsole();
+        //
+#endif
+
+        CometBatch *pBatch = new (std::nothrow) CometBatch(CONSOLE_CFUNCTION_IO);
+        if (pBatch == NULL) {
+            printf("\n! Cannot run the tests: insufficient memory\n");
+            return false;
+        }
+
+        double fTimeout = BATCH_TIMEOUT;
+        bool bJIT = false;
+        CometBatch::REPORT iReport = CometBatch::REPORT_TAP;
+        std::string strReport;
+
+        bool bArgs = true;
+        for (int ii = 2; ii < iArgc; ii++) {
+            const char_t *pszT = cmdLine.getArg(ii);
+            if (pszT == NULL) {
+                continue;
+            }
+            const char_t *pszV = (ii < (iArgc - 1)) ? cmdLine.getArg(ii + 1) : NULL;
+            if ((Tstricmp(pszT, uT("-tap")) == 0) || (Tstricmp(pszT, uT("-junit")) == 0)) {
+                iReport = (Tstricmp(pszT, uT("-tap")) == 0) ? CometBatch::REPORT_TAP : CometBatch::REPORT_JUNIT;
+                strReport.clear();
+                // report file optional
+                if ((pszV != NULL) && (*pszV != uT('\0')) && (*pszV != uT('-'))) {
+                    wxString strT(pszV);
+                    strReport = LM_U8STR(strT);
+                    ii += 1;
+                }
+                continue;
+            }
+            if (Tstricmp(pszT, uT("-jit")) == 0) {
+                bJIT = true;
+                continue;
+            }
+            const bool bOption = (Tstricmp(pszT, uT("-jobs")) == 0) || (Tstricmp(pszT, uT("-timeout")) == 0) || (Tstricmp(pszT, uT("-outdir")) == 0);
+            if (bOption && (pszV == NULL)) {
+                bArgs = false;
+                break;
+            }
+            wxString strT(bOption ? pszV : pszT);
+            if (Tstricmp(pszT, uT("-jobs")) == 0) {
+                long iJobs = 0;
+                if (strT.ToLong(&iJobs) == false) {
+                    bArgs = false;
+                    break;
+                }
+                pBatch->setJobs((int)iJobs);
+            }
+            else if (Tstricmp(pszT, uT("-timeout")) == 0) {
+                if (strT.ToDouble(&fTimeout) == false) {
+                    bArgs = false;
+                    break;
+                }
+            }
+            else if (Tstricmp(pszT, uT("-outdir")) == 0) {
+                pBatch->setOutputDir(LM_U8STR(strT));
+            }
+            else if (wxDirExists(strT)) {
+                if (pBatch->addDirectory(LM_U8STR(strT), BATCH_TESTFILES) == false) {
+                    bArgs = false;
+                    break;
+                }
+            }
+            else if (pBatch->add(LM_U8STR(strT)) == false) {
+                bArgs = false;
+                break;
+            }
+            if (bOption) {
+                ii += 1;
+            }
+        }
+
+        int iFailed = -1;
+        if (bArgs) {
+            pBatch->setTimeout(fTimeout, bJIT);
+            pBatch->setReport(iReport, strReport.empty() ? NULL : strReport.c_str());
+            if (pBatch->getCount() > 0) {
+                iFailed = pBatch->run();
+            }
+            else {
+                printf("No test found\n");
+            }
+        }
+        else {
+            consoleShowHelp();
+        }
+
+        delete pBatch;
+        pBatch = NULL;
+
+#ifdef __WXMSW__
+        win32SendEnterKey();
+#endif
+        consoleExit(iFailed);
+        return false;
+    }
+
+    // run the functions of the script bench table, timed
+    if (cmdLine.isOK() && (iArgc >= 3) && (pszRun != NULL) && (pszInputFilename != NULL) && (Tstricmp(pszRun, uT("-bench")) == 0)) {
+
+        CometApp::COMETCONSOLE = true;
+
+#ifdef __WXMSW__
+        // under Windows, enable std IO
+        win32EnableConsole();
+        //
+#endif
+
+        CometBench *pBench = new (std::nothrow) CometBench(CONSOLE_CFUNCTION_IO);
+        if (pBench == NULL) {
+            printf("\n! Cannot run the benchmarks: insufficient memory\n");
+            return false;
+        }
+
+        bool bArgs = true;
+        for (int ii = 3; ii < iArgc; ii++) {
+            const char_t *pszT = cmdLine.getArg(ii);
+            const char_t *pszV = (ii < (iArgc - 1)) ? cmdLine.getArg(ii + 1) : NULL;
+            if ((pszT == NULL) || (pszV == NULL)) {
+                bArgs = false;
+                break;
+            }
+            wxString strT(pszV);
+            double fT = 0.0;
+            if (Tstricmp(pszT, uT("-warmup")) == 0) {
+                bArgs = strT.ToDouble(&fT);
+                pBench->setWarmup((int)fT);
+            }
+            else if (Tstricmp(pszT, uT("-iterations")) == 0) {
+                bArgs = strT.ToDouble(&fT);
+                pBench->setIterations((int)fT);
+            }
+            else if (Tstricmp(pszT, uT("-threshold")) == 0) {
+                bArgs = strT.ToDouble(&fT);
+                pBench->setThreshold(fT);
+            }
+            else if (Tstricmp(pszT, uT("-save")) == 0) {
+                pBench->setSave(LM_U8STR(strT));
+            }
+            else if (Tstricmp(pszT, uT("-baseline")) == 0) {
+                pBench->setBaseline(LM_U8STR(strT));
+            }
+            else {
+                bArgs = false;
+            }
+            if (bArgs == false) {
+                break;
+            }
+            ii += 1;
+        }
+
+        int iFailed = -1;
+        if (bArgs) {
+            wxString strT(pszInputFilename);
+            iFailed = pBench->run(LM_U8STR(strT));
+        }
+        else {
+            consoleShowHelp();
+        }
+
+        delete pBench;
+        pBench = NULL;
+
+#ifdef __WXMSW__
+        win32SendEnterKey();
+#endif
+        consoleExit(iFailed);
+        return false;
+    }
+
     bool bCompile = false;
     bool bRun = false;
     if ((iArgc >= 3) && (pszRun != NULL) && (pszInputFilename != NULL)) {
@@ -471,6 +760,159 @@ bool CometApp::OnInit()
         bRun = (Tstricmp(pszRun, uT("-run")) == 0);
     }
 
+    // serve the scripts sent on a Unix socket by pre-forked workers
+    if (cmdLine.isOK() && (iArgc >= 3) && (pszRun != NULL) && (pszInputFilename != NULL) && (Tstricmp(pszRun, uT("-serve")) == 0)) {
+
+        CometApp::COMETCONSOLE = true;
+
+        wxString strSocket(pszInputFilename);
+        CometServer *pServer = new (std::nothrow) CometServer(CONSOLE_CFUNCTION_IO, LM_U8STR(strSocket));
+        if (pServer == NULL) {
+            printf("\n! Cannot start the server: insufficient memory\n");
+            return false;
+        }
+
+        bool bArgs = true;
+        for (int ii = 3; ii < iArgc; ii++) {
+            const char_t *pszT = cmdLine.getArg(ii);
+            const char_t *pszV = (ii < (iArgc - 1)) ? cmdLine.getArg(ii + 1) : NULL;
+            if ((pszT == NULL) || (pszV == NULL)) {
+                bArgs = false;
+                break;
+            }
+            wxString strT(pszV);
+            if (Tstricmp(pszT, uT("-workers")) == 0) {
+                long iWorkers = 0;
+                bArgs = strT.ToLong(&iWorkers);
+                pServer->setWorkers((int)iWorkers);
+            }
+            else if (Tstricmp(pszT, uT("-preload")) == 0) {
+                pServer->setPreload(LM_U8STR(strT));
+            }
+            else {
+                bArgs = false;
+            }
+            if (bArgs == false) {
+                break;
+            }
+            ii += 1;
+        }
+
+        if (bArgs) {
+            pServer->run();
+        }
+        else {
+            consoleShowHelp();
+        }
+
+        delete pServer;
+        pServer = NULL;
+
+        return false;
+    }
+
+    // run the script by a server started with -serve (only reached under Windows, see main)
+    if (cmdLine.isOK() && bRun && (iArgc == 5) && (cmdLine.getArg(3) != NULL) && (Tstricmp(cmdLine.getArg(3), uT("-server")) == 0) && (cmdLine.getArg(4) != NULL)) {
+
+        CometApp::COMETCONSOLE = true;
+
+        wxString strSocket(cmdLine.getArg(4));
+        wxString strT(pszInputFilename);
+        const bool bRet = CometServer::runClient(LM_U8STR(strSocket), LM_U8STR(strT));
+
+        consoleExit(bRet ? 0 : 1);
+        return false;
+    }
+
+    // compile directories (only the scripts newer than their compiled file) or make a bundle, in parallel
+    bool bCompileBatch = false;
+    if (cmdLine.isOK() && bCompile) {
+        for (int ii = 2; ii < iArgc; ii++) {
+            const char_t *pszT = cmdLine.getArg(ii);
+            if ((pszT != NULL) && ((Tstricmp(pszT, uT("-jobs")) == 0) || (Tstricmp(pszT, uT("-outdir")) == 0) || (Tstricmp(pszT, uT("-bundle")) == 0) || wxDirExists(pszT))) {
+                bCompileBatch = true;
+                break;
+            }
+        }
+    }
+    if (bCompileBatch) {
+
+        CometApp::COMETCONSOLE = true;
+
+#ifdef __WXMSW__
+        // under Windows, enable std IO
+        win32EnableConsole();
+        //
+#endif
+
+        CometBatch *pBatch = new (std::nothrow) CometBatch(NULL);
+        if (pBatch == NULL) {
+            printf("\n! Cannot compile: insufficient memory\n");
+            return false;
+        }
+
+        std::string strBundle;
+
+        bool bArgs = true;
+        for (int ii = 2; ii < iArgc; ii++) {
+            const char_t *pszT = cmdLine.getArg(ii);
+            if (pszT == NULL) {
+                continue;
+            }
+            const bool bOption = (Tstricmp(pszT, uT("-jobs")) == 0) || (Tstricmp(pszT, uT("-outdir")) == 0) || (Tstricmp(pszT, uT("-bundle")) == 0);
+            if (bOption && ((ii >= (iArgc - 1)) || (cmdLine.getArg(ii + 1) == NULL))) {
+                bArgs = false;
+                break;
+            }
+            wxString strT(bOption ? cmdLine.getArg(ii + 1) : pszT);
+            if (Tstricmp(pszT, uT("-jobs")) == 0) {
+                long iJobs = 0;
+                if (strT.ToLong(&iJobs) == false) {
+                    bArgs = false;
+                    break;
+                }
+                pBatch->setJobs((int)iJobs);
+            }
+            else if (Tstricmp(pszT, uT("-outdir")) == 0) {
+                pBatch->setOutputDir(LM_U8STR(strT));
+            }
+            else if (Tstricmp(pszT, uT("-bundle")) == 0) {
+                strBundle = LM_U8STR(strT);
+            }
+            else if (wxDirExists(strT)) {
+                if (pBatch->addDirectory(LM_U8STR(strT), BATCH_LUAFILES) == false) {
+                    bArgs = false;
+                    break;
+                }
+            }
+            else if (pBatch->add(LM_U8STR(strT)) == false) {
+                bArgs = false;
+                break;
+            }
+            if (bOption) {
+                ii += 1;
+            }
+        }
+
+        int iFailed = -1;
+        if (bArgs && (pBatch->getCount() > 0)) {
+            pBatch->setCompile(strBundle.empty() ? NULL : strBundle.c_str());
+            iFailed = pBatch->run();
+        }
+        else {
+            consoleShowHelp();
+        }
+
+        delete pBatch;
+        pBatch = NULL;
+
+#ifdef __WXMSW__
+        win32SendEnterKey();
+#endif
+        consoleExit(iFailed);
+        return false;
+    }
+
     if (cmdLine.isOK() && (bCompile || bRun)) {
 
         CometApp::COMETCONSOLE = true;
@@ -0,0 +1,963 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#include "Identifiers.h"
+
+#include "CometApp.h"
+#include "CometBatch.h"
+
+#include <wx/filename.h>
+#include <wx/dir.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <set>
+
+#ifndef __WXMSW__
+#include <sys/time.h>
+#endif
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#ifdef __WXMSW__
+#define BATCH_SEPARATOR '\\'
+#else
+#define BATCH_SEPARATOR '/'
+#endif
+
+static double batchTime(void)
+{
+    struct timeval timevalNow;
+    gettimeofday(&timevalNow, NULL);
+    return (((double)(timevalNow.tv_sec)) * 1000.0) + (((double)(timevalNow.tv_usec)) / 1000.0);
+}
+
+static void batchWriteJSON(FILE *fpT, const std::string &strT)
+{
+    fputc('"', fpT);
+    for (size_t ii = 0; ii < strT.size(); ii++) {
+        unsigned char cT = (unsigned char)(strT[ii]);
+        if ((cT == '"') || (cT == '\\')) {
+            fputc('\\', fpT);
+            fputc(cT, fpT);
+        }
+        else if (cT == '\n') {
+            fputs("\\n", fpT);
+        }
+        else if (cT == '\r') {
+            fputs("\\r", fpT);
+        }
+        else if (cT == '\t') {
+            fputs("\\t", fpT);
+        }
+        else if (cT < 0x20) {
+            fprintf(fpT, "\\u%04x", (unsigned int)cT);
+        }
+        else {
+            fputc(cT, fpT);
+        }
+    }
+    fputc('"', fpT);
+}
+
+static void batchWriteXML(FILE *fpT, const std::string &strT)
+{
+    for (size_t ii = 0; ii < strT.size(); ii++) {
+        unsigned char cT = (unsigned char)(strT[ii]);
+        if (cT == '<') {
+            fputs("&lt;", fpT);
+        }
+        else if (cT == '>') {
+            fputs("&gt;", fpT);
+        }
+        else if (cT == '&') {
+            fputs("&amp;", fpT);
+        }
+        else if (cT == '"') {
+            fputs("&quot;", fpT);
+        }
+        else if ((cT < 0x20) && (cT != '\n') && (cT != '\r') && (cT != '\t')) {
+            // not allowed in XML 1.0
+            fputc('?', fpT);
+        }
+        else {
+            fputc(cT, fpT);
+        }
+    }
+}
+
+// Lua string literal, any byte escaped as \ddd (the bytecode included)
+static void batchQuoteLua(std::string &strT, const std::string &strS)
+{
+    char szT[LM_STRSIZET];
+    strT += '"';
+    for (size_t ii = 0; ii < strS.size(); ii++) {
+        unsigned char cT = (unsigned char)(strS[ii]);
+        if ((cT >= 0x20) && (cT < 0x7F) && (cT != '"') && (cT != '\\')) {
+            strT += (char)cT;
+        }
+        else {
+            snprintf(szT, LM_STRSIZET - 1, "\\%03u", (unsigned int)cT);
+            strT += szT;
+        }
+    }
+    strT += '"';
+}
+
+// Module name for require: a/b.lua -> a.b and a/init.lua -> a
+static std::string batchModuleName(const std::string &strName)
+{
+    std::string strModule = strName;
+    while ((strModule.size() > 2) && (strModule[0] == '.') && ((strModule[1] == '/') || (strModule[1] == '\\'))) {
+        strModule.erase(0, 2);
+    }
+    if ((strModule.size() > 4) && (strModule.compare(strModule.size() - 4, 4, ".lua") == 0)) {
+        strModule.erase(strModule.size() - 4);
+    }
+    for (size_t ii = 0; ii < strModule.size(); ii++) {
+        if ((strModule[ii] == '/') || (strModule[ii] == '\\')) {
+            strModule[ii] = '.';
+        }
+    }
+    if ((strModule.size() > 5) && (strModule.compare(strModule.size() - 5, 5, ".init") == 0)) {
+        strModule.erase(strModule.size() - 5);
+    }
+    return strModule;
+}
+
+// Count hook: stops the script when its deadline is reached
+static void batchHook(lua_State *pLua, lua_Debug *pDebug)
+{
+    UNUSED(pDebug);
+
+    lua_pushliteral(pLua, "___CometBatch___");
+    lua_rawget(pLua, LUA_REGISTRYINDEX);
+    BatchScript *pScript = (BatchScript *)lua_touserdata(pLua, -1);
+    lua_pop(pLua, 1);
+
+    if ((pScript != NULL) && (pScript->deadline > 0.0) && (batchTime() >= pScript->deadline)) {
+        pScript->timeout = true;
+        luaL_error(pLua, "timeout");
+    }
+}
+
+#ifndef WIN32
+// os.exit in a script run by a forked worker: ends the script process only, without the application cleanup
+static int batchExit(lua_State *pLua)
+{
+    int iCode = EXIT_SUCCESS;
+    if (lua_isboolean(pLua, 1)) {
+        iCode = lua_toboolean(pLua, 1) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+    else {
+        iCode = (int)luaL_optinteger(pLua, 1, EXIT_SUCCESS);
+    }
+    fflush(NULL);
+    _exit(iCode);
+    return 0;
+}
+#endif
+
+wxThread::ExitCode CometBatchThread::Entry()
+{
+    if (m_pBatch) {
+        m_pBatch->work();
+    }
+    return 0;
+}
+
+CometBatch::CometBatch(const luaL_Reg *pFunctions)
+{
+    m_pFunctions = pFunctions;
+    m_iJobs = 0; // set by run if not given
+    m_fTimeout = 0.0;
+    m_bJIT = true;
+    m_iReport = REPORT_NONE;
+    m_bCompile = false;
+    m_iNext = 0;
+    m_iFailed = 0;
+}
+
+CometBatch::~CometBatch()
+{
+}
+
+bool CometBatch::add(const char *pszArg)
+{
+    if ((pszArg == NULL) || (*pszArg == '\0')) {
+        return false;
+    }
+
+    if (*pszArg == '@') {
+        return addManifest(pszArg + 1);
+    }
+
+    if (m_Scripts.size() >= BATCH_MAXSCRIPTS) {
+        return false;
+    }
+    BatchScript tScript;
+    tScript.path = pszArg;
+    tScript.name = tScript.path;
+    m_Scripts.push_back(tScript);
+    return true;
+}
+
+bool CometBatch::addDirectory(const char *pszDir, const char_t *pszPattern)
+{
+    wxString strDir = LM_U8TOWC(pszDir);
+    if (wxDirExists(strDir) == false) {
+        printf("! Invalid directory %s\n", pszDir);
+        return false;
+    }
+
+    wxArrayString arrFiles;
+    wxDir::GetAllFiles(strDir, &arrFiles, pszPattern, wxDIR_FILES | wxDIR_DIRS);
+    arrFiles.Sort();
+
+    std::string strRoot = pszDir;
+    if ((strRoot.empty() == false) && (strRoot[strRoot.size() - 1] != '/') && (strRoot[strRoot.size() - 1] != '\\')) {
+        strRoot += BATCH_SEPARATOR;
+    }
+
+    for (size_t ii = 0; ii < arrFiles.GetCount(); ii++) {
+        if (m_Scripts.size() >= BATCH_MAXSCRIPTS) {
+            printf("! Too many scripts (maximum = %d)\n", BATCH_MAXSCRIPTS);
+            return false;
+        }
+        BatchScript tScript;
+        tScript.path = LM_U8STR(arrFiles[ii]);
+        tScript.name = (tScript.path.compare(0, strRoot.size(), strRoot) == 0) ? tScript.path.substr(strRoot.size()) : tScript.path;
+        m_Scripts.push_back(tScript);
+    }
+
+    return true;
+}
+
+bool CometBatch::addManifest(const char *pszManifest)
+{
+    FILE *fpManifest = fopen(pszManifest, "r");
+    if (fpManifest == NULL) {
+        printf("! Cannot read the manifest %s\n", pszManifest);
+        return false;
+    }
+
+    std::string strDir = pszManifest;
+    size_t iSep = strDir.find_last_of("/\\");
+    strDir = (iSep == std::string::npos) ? std::string() : strDir.substr(0, iSep + 1);
+
+    bool bRet = true;
+
+    char szLine[LM_STRSIZEW];
+    szLine[LM_STRSIZEW - 1] = '\0';
+    while (fgets(szLine, LM_STRSIZEW - 1, fpManifest) != NULL) {
+        std::string strLine = szLine;
+        size_t iFirst = strLine.find_first_not_of(" \t\r\n");
+        if ((iFirst == std::string::npos) || (strLine[iFirst] == '#')) {
+            continue;
+        }
+        strLine = strLine.substr(iFirst, strLine.find_last_not_of(" \t\r\n") - iFirst + 1);
+
+        const bool bAbsolute = (strLine[0] == '/') || (strLine[0] == '\\') || ((strLine.size() > 1) && (strLine[1] == ':'));
+        if (bAbsolute == false) {
+            strLine = strDir + strLine;
+        }
+
+        if (m_Scripts.size() >= BATCH_MAXSCRIPTS) {
+            printf("! Too many scripts (maximum = %d)\n", BATCH_MAXSCRIPTS);
+            bRet = false;
+            break;
+        }
+        BatchScript tScript;
+        tScript.path = strLine;
+        tScript.name = strLine;
+        m_Scripts.push_back(tScript);
+    }
+
+    fclose(fpManifest);
+    return bRet;
+}
+
+void CometBatch::setJobs(int iJobs)
+{
+    m_iJobs = (iJobs < 1) ? 1 : ((iJobs > BATCH_MAXJOBS) ? BATCH_MAXJOBS : iJobs);
+}
+
+void CometBatch::setOutputDir(const char *pszDir)
+{
+    m_strOutputDir = (pszDir != NULL) ? pszDir : "";
+    while ((m_strOutputDir.size() > 1) && ((m_strOutputDir[m_strOutputDir.size() - 1] == '/') || (m_strOutputDir[m_strOutputDir.size() - 1] == '\\'))) {
+        m_strOutputDir.erase(m_strOutputDir.size() - 1);
+    }
+}
+
+void CometBatch::setSummary(const char *pszFilename)
+{
+    m_strSummary = (pszFilename != NULL) ? pszFilename : "";
+}
+
+void CometBatch::setTimeout(double fTimeout, bool bJIT)
+{
+    m_fTimeout = (fTimeout > 0.0) ? fTimeout : 0.0;
+    m_bJIT = bJIT;
+}
+
+void CometBatch::setReport(REPORT iReport, const char *pszFilename)
+{
+    m_iReport = iReport;
+    m_strReport = (pszFilename != NULL) ? pszFilename : "";
+}
+
+void CometBatch::setCompile(const char *pszBundle)
+{
+    m_bCompile = true;
+    m_strBundle = (pszBundle != NULL) ? pszBundle : "";
+}
+
+int CometBatch::run(void)
+{
+    if (m_Scripts.empty()) {
+        return 0;
+    }
+
+    if (m_strOutputDir.empty() == false) {
+        wxString strDir = LM_U8TOWC(m_strOutputDir.c_str());
+        if ((wxDirExists(strDir) == false) && (wxFileName::Mkdir(strDir, 0777, wxPATH_MKDIR_FULL) == false)) {
+            printf("! Cannot create the output directory %s\n", m_strOutputDir.c_str());
+            return (int)(m_Scripts.size());
+        }
+    }
+
+#ifdef __WXMSW__
+    try {
+        lmSocket::startup();
+    }
+    catch (...) {
+    }
+#endif
+
+    if (m_bCompile && (m_strBundle.empty() == false) && isBundleUpdated()) {
+        printf("%s is up to date (%d scripts)\n", m_strBundle.c_str(), (int)(m_Scripts.size()));
+        return 0;
+    }
+
+    m_iNext = 0;
+    m_iFailed = 0;
+
+    const double fStart = batchTime();
+
+    if (m_iJobs < 1) {
+#ifdef WIN32
+        // the scripts share the process state
+        setJobs(m_bCompile ? wxThread::GetCPUCount() : 1);
+#else
+        setJobs(wxThread::GetCPUCount());
+#endif
+    }
+
+    const int iJobs = ((size_t)m_iJobs < m_Scripts.size()) ? m_iJobs : (int)(m_Scripts.size());
+
+    std::vector<CometBatchThread *> vecThreads;
+    for (int ii = 0; ii < iJobs; ii++) {
+        CometBatchThread *pThread = new (std::nothrow) CometBatchThread(this);
+        if ((pThread != NULL) && (pThread->Create() == wxTHREAD_NO_ERROR) && (pThread->Run() == wxTHREAD_NO_ERROR)) {
+            vecThreads.push_back(pThread);
+            continue;
+        }
+        if (pThread) {
+            delete pThread;
+        }
+        break;
+    }
+
+    if (vecThreads.empty()) {
+        // No worker: the scripts are run by the main thread
+        work();
+    }
+    for (size_t ii = 0; ii < vecThreads.size(); ii++) {
+        vecThreads[ii]->Wait();
+        delete vecThreads[ii];
+    }
+
+    if (m_bCompile && (m_strBundle.empty() == false)) {
+        if (m_iFailed > 0) {
+            printf("! %s not written: %d scripts not compiled\n", m_strBundle.c_str(), m_iFailed);
+        }
+        else if (writeBundle() == false) {
+            printf("! Cannot write the bundle %s\n", m_strBundle.c_str());
+            m_iFailed = (int)(m_Scripts.size());
+        }
+    }
+
+    const double fTime = batchTime() - fStart;
+
+#ifdef __WXMSW__
+    lmSocket::shutdown();
+#endif
+
+    if (isQuiet() == false) {
+        printf("%d scripts, %d failed, %.1f ms (%d jobs)\n", (int)(m_Scripts.size()), m_iFailed, fTime, vecThreads.empty() ? 1 : (int)(vecThreads.size()));
+    }
+
+    if ((m_strSummary.empty() == false) && (writeSummary(fTime) == false)) {
+        printf("! Cannot write the summary %s\n", m_strSummary.c_str());
+    }
+
+    if ((m_iReport != REPORT_NONE) && (writeReport(fTime) == false)) {
+        printf("! Cannot write the report %s\n", m_strReport.c_str());
+    }
+
+    return m_iFailed;
+}
+
+void CometBatch::work(void)
+{
+    for (;;) {
+        size_t iScript = 0;
+        {
+            wxMutexLocker lockT(m_Mutex);
+            if (m_iNext >= m_Scripts.size()) {
+                return;
+            }
+            iScript = m_iNext;
+            m_iNext += 1;
+        }
+        runScript(iScript);
+    }
+}
+
+void CometBatch::runScript(size_t iScript)
+{
+    BatchScript &tScript = m_Scripts[iScript];
+
+    const double fStart = batchTime();
+
+    // Output file named after the script and its position in the batch
+    FILE *fpOutput = NULL;
+    if (m_bCompile) {
+        // Only the engine messages, if any
+        fpOutput = tmpfile();
+    }
+    else if (m_strOutputDir.empty() == false) {
+        size_t iSep = tScript.path.find_last_of("/\\");
+        char szIndex[LM_STRSIZET];
+        snprintf(szIndex, LM_STRSIZET - 1, "%d-", (int)iScript + 1);
+        tScript.output = m_strOutputDir + BATCH_SEPARATOR + szIndex + ((iSep == std::string::npos) ? tScript.path : tScript.path.substr(iSep + 1)) + ".out";
+        fpOutput = fopen(tScript.output.c_str(), (m_iReport != REPORT_NONE) ? "w+b" : "wb");
+    }
+    else {
+        fpOutput = tmpfile();
+    }
+
+    char *pszFilename = ((fpOutput != NULL) && (m_bCompile == false)) ? lf_realpath(tScript.path.c_str(), NULL) : NULL;
+
+    if (fpOutput == NULL) {
+        tScript.error = "Cannot create the output file";
+    }
+    else if (m_bCompile) {
+        compileScript(iScript, fpOutput);
+    }
+    else if (pszFilename == NULL) {
+        tScript.error = "Cannot run script: invalid file";
+    }
+    else {
+#ifdef WIN32
+        runEngine(tScript, pszFilename, fpOutput, fStart, false);
+#else
+        runProcess(tScript, pszFilename, fpOutput, fStart);
+#endif
+        free(pszFilename);
+        pszFilename = NULL;
+    }
+
+    tScript.time = batchTime() - fStart;
+
+    if ((fpOutput != NULL) && (m_iReport != REPORT_NONE)) {
+        rewind(fpOutput);
+        char szBuffer[LM_STRSIZEW];
+        size_t iRead = 0;
+        while (((iRead = fread(szBuffer, 1, LM_STRSIZEW, fpOutput)) > 0) && (tScript.text.size() < BATCH_MAXOUTPUT)) {
+            tScript.text.append(szBuffer, iRead);
+        }
+    }
+
+    // Status line, then the output if not kept in a file (one script at a time)
+    wxMutexLocker lockT(m_Mutex);
+    if (tScript.ok == false) {
+        m_iFailed += 1;
+    }
+    if (isQuiet() == false) {
+        printf("%s\t%.1f ms\t%s\n", tScript.skipped ? "skipped" : (tScript.ok ? "ok" : "failed"), tScript.time, tScript.path.c_str());
+        if ((tScript.ok == false) && (tScript.error.empty() == false)) {
+            printf("\t%s\n", tScript.error.c_str());
+        }
+    }
+    if (fpOutput != NULL) {
+        if (tScript.output.empty() && (m_iReport == REPORT_NONE) && (m_bCompile == false)) {
+            rewind(fpOutput);
+            char szBuffer[LM_STRSIZEW];
+            size_t iRead = 0;
+            while ((iRead = fread(szBuffer, 1, LM_STRSIZEW, fpOutput)) > 0) {
+                fwrite(szBuffer, 1, iRead, stdout);
+            }
+        }
+        fclose(fpOutput);
+    }
+}
+
+#ifndef WIN32
+
+// The script runs in a child process writing to fpOutput (standard output and error included).
+// Its result (ok, timeout and error) is sent back through a pipe, in one write.
+void CometBatch::runProcess(BatchScript &tScript, char *pszFilename, FILE *fpOutput, double fStart)
+{
+    int iPipe[2] = { -1, -1 };
+    if (pipe(iPipe) != 0) {
+        tScript.error = "Cannot create the script process";
+        return;
+    }
+
+    fflush(fpOutput);
+
+    pid_t iPid = fork();
+    if (iPid < 0) {
+        close(iPipe[0]);
+        close(iPipe[1]);
+        tScript.error = "Cannot create the script process";
+        return;
+    }
+
+    if (iPid == 0) {
+        // Script process: only this thread exists, the batch mutex is never locked here
+        close(iPipe[0]);
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        if (m_fTimeout > 0.0) {
+            // The hook is not reached from the JIT compiled loops: the alarm ends the process
+            signal(SIGALRM, SIG_DFL);
+            alarm((unsigned int)(m_fTimeout) + 2);
+        }
+        dup2(fileno(fpOutput), STDOUT_FILENO);
+        dup2(fileno(fpOutput), STDERR_FILENO);
+
+        runEngine(tScript, pszFilename, stdout, fStart, true);
+
+        fflush(NULL);
+        std::string strResult;
+        strResult += tScript.ok ? '1' : '0';
+        strResult += tScript.timeout ? '1' : '0';
+        strResult += tScript.error.substr(0, LM_STRSIZE);
+        ssize_t iWritten = write(iPipe[1], strResult.c_str(), strResult.size());
+        UNUSED(iWritten);
+        _exit(tScript.ok ? EXIT_SUCCESS : EXIT_FAILURE);
+    }
+
+    close(iPipe[1]);
+
+    int iStatus = 0;
+    while ((waitpid(iPid, &iStatus, 0) < 0) && (errno == EINTR)) {
+    }
+
+    // The result was written before the process ended. The write end may still be open in
+    // the processes forked meanwhile by the other workers: read once, without blocking.
+    char szResult[LM_STRSIZE + 4];
+    fcntl(iPipe[0], F_SETFL, O_NONBLOCK);
+    ssize_t iRead = read(iPipe[0], szResult, LM_STRSIZE + 2);
+    close(iPipe[0]);
+
+    if (iRead >= 2) {
+        tScript.ok = (szResult[0] == '1');
+        tScript.timeout = (szResult[1] == '1');
+        tScript.error.assign(szResult + 2, (size_t)iRead - 2);
+        return;
+    }
+
+    // os.exit, or killed
+    char szT[LM_STRSIZE];
+    szT[0] = '\0';
+    if (WIFEXITED(iStatus)) {
+        tScript.ok = (WEXITSTATUS(iStatus) == EXIT_SUCCESS);
+        if (tScript.ok == false) {
+            snprintf(szT, LM_STRSIZE - 1, "Exited with status %d", WEXITSTATUS(iStatus));
+        }
+    }
+    else if (WIFSIGNALED(iStatus) && (WTERMSIG(iStatus) == SIGALRM) && (m_fTimeout > 0.0)) {
+        tScript.ok = false;
+        tScript.timeout = true;
+        snprintf(szT, LM_STRSIZE - 1, "Timeout: stopped after %.0f s", m_fTimeout);
+    }
+    else if (WIFSIGNALED(iStatus)) {
+        tScript.ok = false;
+        snprintf(szT, LM_STRSIZE - 1, "Terminated by signal %d", WTERMSIG(iStatus));
+    }
+    tScript.error = szT;
+}
+
+#endif
+
+void CometBatch::runEngine(BatchScript &tScript, char *pszFilename, FILE *fpOutput, double fStart, bool bProcess)
+{
+    LuaEngine *pEngine = new (std::nothrow) LuaEngine(LUA_ENGINE_CONSOLE, m_pFunctions, true);
+    if (pEngine == NULL) {
+        tScript.error = "Cannot create Lua state: insufficient memory";
+        return;
+    }
+
+    pEngine->setOutput(fpOutput);
+
+    lua_State *pLua = pEngine->getLuaState();
+    if ((pLua != NULL) && (m_fTimeout > 0.0)) {
+        // Hooks are not called from the JIT compiled code: without the compiler,
+        // the hook is reached in any loop
+#ifdef USE_LUAJIT
+        if (m_bJIT == false) {
+            luaJIT_setmode(pLua, 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+        }
+#endif
+        tScript.deadline = fStart + (m_fTimeout * 1000.0);
+        lua_pushliteral(pLua, "___CometBatch___");
+        lua_pushlightuserdata(pLua, (void *)(&tScript));
+        lua_rawset(pLua, LUA_REGISTRYINDEX);
+        lua_sethook(pLua, batchHook, LUA_MASKCOUNT, BATCH_HOOKCOUNT);
+    }
+
+#ifndef WIN32
+    if ((pLua != NULL) && bProcess) {
+        lua_getglobal(pLua, "os");
+        if (lua_istable(pLua, -1)) {
+            lua_pushcfunction(pLua, batchExit);
+            lua_setfield(pLua, -2, "exit");
+        }
+        lua_pop(pLua, 1);
+    }
+#else
+    UNUSED(bProcess);
+#endif
+
+    // The working directory is not changed (shared by the workers under Windows):
+    // the modules are looked for in the script directory first
+    if (pLua != NULL) {
+        std::string strDir = pszFilename;
+        strDir = strDir.substr(0, strDir.find_last_of("/\\") + 1) + "?.lua;";
+        lua_getglobal(pLua, "package");
+        if (lua_istable(pLua, -1)) {
+            lua_getfield(pLua, -1, "path");
+            if (lua_isstring(pLua, -1)) {
+                lua_pushstring(pLua, strDir.c_str());
+                lua_insert(pLua, -2);
+                lua_concat(pLua, 2);
+                lua_setfield(pLua, -2, "path");
+            }
+            else {
+                lua_pop(pLua, 1);
+            }
+        }
+        lua_pop(pLua, 1);
+    }
+
+    tScript.ok = pEngine->runScriptFile(pszFilename, -1, NULL, LUA_ENGINE_RUN, NULL);
+    if (tScript.timeout) {
+        char szT[LM_STRSIZET];
+        snprintf(szT, LM_STRSIZET - 1, "%.0f s", m_fTimeout);
+        tScript.ok = false;
+        tScript.error = std::string("Timeout: stopped after ") + szT;
+    }
+    else if (tScript.ok == false) {
+        wxString strT = pEngine->getMessage();
+        std::string strError = LM_U8STR(strT);
+        size_t iFirst = strError.find_first_not_of(" \t\r\n");
+        if (iFirst != std::string::npos) {
+            size_t iEnd = strError.find_first_of("\r\n", iFirst);
+            tScript.error = strError.substr(iFirst, (iEnd == std::string::npos) ? std::string::npos : (iEnd - iFirst));
+        }
+    }
+
+    delete pEngine;
+    pEngine = NULL;
+}
+
+void CometBatch::compileScript(size_t iScript, FILE *fpOutput)
+{
+    BatchScript &tScript = m_Scripts[iScript];
+
+    wxString strSource = LM_U8TOWC(tScript.path.c_str());
+    wxString strCompiled;
+
+    // One compiled file per script, skipped if newer than the script
+    if (m_strBundle.empty()) {
+        // scripts given by an absolute path: compiled in the output directory itself
+        std::string strName = tScript.name;
+        if ((strName.empty() == false) && ((strName[0] == '/') || (strName[0] == '\\') || ((strName.size() > 1) && (strName[1] == ':')))) {
+            strName = strName.substr(strName.find_last_of("/\\") + 1);
+        }
+        tScript.output = m_strOutputDir.empty() ? tScript.path : (m_strOutputDir + BATCH_SEPARATOR + strName);
+        if ((tScript.output.size() > 4) && (tScript.output.compare(tScript.output.size() - 4, 4, ".lua") == 0)) {
+            tScript.output += "c";
+        }
+        else {
+            tScript.output += ".luac";
+        }
+        strCompiled = LM_U8TOWC(tScript.output.c_str());
+        if (wxFileExists(strCompiled) && wxFileExists(strSource) && (wxFileModificationTime(strCompiled) >= wxFileModificationTime(strSource))) {
+            tScript.ok = true;
+            tScript.skipped = true;
+            return;
+        }
+    }
+
+    // The standard libraries are not needed to compile
+    LuaEngine *pEngine = new (std::nothrow) LuaEngine(LUA_ENGINE_CONSOLE, NULL, false);
+    if (pEngine == NULL) {
+        tScript.error = "Cannot create Lua state: insufficient memory";
+        return;
+    }
+    pEngine->setOutput(fpOutput);
+
+    std::string strBytecode;
+    std::string strChunkname = std::string("@") + tScript.name;
+    tScript.ok = pEngine->compileFile(tScript.path.c_str(), strChunkname.c_str(), strBytecode);
+    if (tScript.ok == false) {
+        wxString strT = pEngine->getMessage();
+        std::string strError = LM_U8STR(strT);
+        size_t iFirst = strError.find_first_not_of(" \t\r\n");
+        if (iFirst != std::string::npos) {
+            size_t iEnd = strError.find_first_of("\r\n", iFirst);
+            tScript.error = strError.substr(iFirst, (iEnd == std::string::npos) ? std::string::npos : (iEnd - iFirst));
+        }
+    }
+
+    delete pEngine;
+    pEngine = NULL;
+
+    if (tScript.ok == false) {
+        return;
+    }
+
+    if (m_strBundle.empty() == false) {
+        // Bundled when all the scripts are compiled
+        tScript.text.swap(strBytecode);
+        return;
+    }
+
+    wxString strDir = wxFileName(strCompiled).GetPath();
+    if ((strDir.IsEmpty() == false) && (wxDirExists(strDir) == false)) {
+        // may have been created meanwhile by another worker
+        if ((wxFileName::Mkdir(strDir, 0777, wxPATH_MKDIR_FULL) == false) && (wxDirExists(strDir) == false)) {
+            tScript.ok = false;
+            tScript.error = "Cannot create the output directory";
+            return;
+        }
+    }
+
+    FILE *fpCompiled = fopen(tScript.output.c_str(), "wb");
+    if ((fpCompiled == NULL) || (fwrite(strBytecode.data(), 1, strBytecode.size(), fpCompiled) != strBytecode.size())) {
+        tScript.ok = false;
+        tScript.error = "Cannot write the compiled file";
+    }
+    if (fpCompiled != NULL) {
+        fclose(fpCompiled);
+    }
+}
+
+// Bundle newer than the scripts and than their directories (files added or removed)
+bool CometBatch::isBundleUpdated(void)
+{
+    wxString strBundle = LM_U8TOWC(m_strBundle.c_str());
+    if (wxFileExists(strBundle) == false) {
+        return false;
+    }
+    const time_t tBundle = wxFileModificationTime(strBundle);
+
+    std::set<wxString> setDirs;
+    for (size_t ii = 0; ii < m_Scripts.size(); ii++) {
+        wxString strSource = LM_U8TOWC(m_Scripts[ii].path.c_str());
+        if ((wxFileExists(strSource) == false) || (wxFileModificationTime(strSource) > tBundle)) {
+            return false;
+        }
+        setDirs.insert(wxFileName(strSource).GetPath());
+    }
+    for (std::set<wxString>::const_iterator itD = setDirs.begin(); itD != setDirs.end(); ++itD) {
+        if ((itD->IsEmpty() == false) && (wxFileModificationTime(*itD) > tBundle)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// One precompiled chunk: each module registered in package.preload as its bytecode,
+// loaded (not parsed) when required. Loaded with dofile or loadfile, then require as usual.
+bool CometBatch::writeBundle(void)
+{
+    std::string strSource = "local preload, loadstring = package.preload, loadstring\n";
+    for (size_t ii = 0; ii < m_Scripts.size(); ii++) {
+        const std::string strModule = batchModuleName(m_Scripts[ii].name);
+        strSource += "preload[";
+        batchQuoteLua(strSource, strModule);
+        strSource += "] = function(...) return assert(loadstring(";
+        batchQuoteLua(strSource, m_Scripts[ii].text);
+        strSource += ", ";
+        batchQuoteLua(strSource, std::string("=") + strModule);
+        strSource += "))(...) end\n";
+        std::string().swap(m_Scripts[ii].text);
+    }
+
+    LuaEngine *pEngine = new (std::nothrow) LuaEngine(LUA_ENGINE_CONSOLE, NULL, false);
+    if (pEngine == NULL) {
+        return false;
+    }
+
+    std::string strBytecode;
+    std::string strChunkname = std::string("=") + m_strBundle;
+    bool bRet = pEngine->compileBuffer(strSource.c_str(), strSource.size(), strChunkname.c_str(), strBytecode);
+
+    delete pEngine;
+    pEngine = NULL;
+
+    if (bRet == false) {
+        return false;
+    }
+
+    FILE *fpBundle = fopen(m_strBundle.c_str(), "wb");
+    if (fpBundle == NULL) {
+        return false;
+    }
+    bRet = (fwrite(strBytecode.data(), 1, strBytecode.size(), fpBundle) == strBytecode.size());
+    fclose(fpBundle);
+
+    if (bRet) {
+        printf("%s: %d modules, %d bytes\n", m_strBundle.c_str(), (int)(m_Scripts.size()), (int)(strBytecode.size()));
+    }
+    return bRet;
+}
+
+bool CometBatch::writeSummary(double fTime)
+{
+    FILE *fpSummary = fopen(m_strSummary.c_str(), "wb");
+    if (fpSummary == NULL) {
+        return false;
+    }
+
+    fprintf(fpSummary, "{\n  \"count\": %d,\n  \"failed\": %d,\n  \"jobs\": %d,\n  \"time_ms\": %.3f,\n  \"scripts\": [\n",
+            (int)(m_Scripts.size()), m_iFailed, m_iJobs, fTime);
+    for (size_t ii = 0; ii < m_Scripts.size(); ii++) {
+        const BatchScript &tScript = m_Scripts[ii];
+        fprintf(fpSummary, "    { \"path\": ");
+        batchWriteJSON(fpSummary, tScript.path);
+        fprintf(fpSummary, ", \"status\": \"%s\", \"time_ms\": %.3f", tScript.skipped ? "skipped" : (tScript.ok ? "ok" : "failed"), tScript.time);
+        if (tScript.output.empty() == false) {
+            fprintf(fpSummary, ", \"output\": ");
+            batchWriteJSON(fpSummary, tScript.output);
+        }
+        if (tScript.error.empty() == false) {
+            fprintf(fpSummary, ", \"error\": ");
+            batchWriteJSON(fpSummary, tScript.error);
+        }
+        fprintf(fpSummary, " }%s\n", (ii < (m_Scripts.size() - 1)) ? "," : "");
+    }
+    fprintf(fpSummary, "  ]\n}\n");
+
+    bool bRet = (ferror(fpSummary) == 0);
+    fclose(fpSummary);
+    return bRet;
+}
+
+bool CometBatch::writeReport(double fTime)
+{
+    FILE *fpReport = m_strReport.empty() ? stdout : fopen(m_strReport.c_str(), "wb");
+    if (fpReport == NULL) {
+        return false;
+    }
+
+    if (m_iReport == REPORT_TAP) {
+        // Failed tests: error and output as diagnostic lines
+        fprintf(fpReport, "TAP version 13\n1..%d\n", (int)(m_Scripts.size()));
+        for (size_t ii = 0; ii < m_Scripts.size(); ii++) {
+            const BatchScript &tScript = m_Scripts[ii];
+            fprintf(fpReport, "%s %d - %s # time=%.1fms\n", tScript.ok ? "ok" : "not ok", (int)ii + 1, tScript.name.c_str(), tScript.time);
+            if (tScript.ok) {
+                continue;
+            }
+            if (tScript.error.empty() == false) {
+                fprintf(fpReport, "# %s\n", tScript.error.c_str());
+            }
+            size_t iStart = 0;
+            while (iStart < tScript.text.size()) {
+                size_t iEnd = tScript.text.find('\n', iStart);
+                if (iEnd == std::string::npos) {
+                    iEnd = tScript.text.size();
+                }
+                std::string strLine = tScript.text.substr(iStart, iEnd - iStart);
+                if ((strLine.empty() == false) && (strLine[strLine.size() - 1] == '\r')) {
+                    strLine.erase(strLine.size() - 1);
+                }
+                if (strLine.empty() == false) {
+                    fprintf(fpReport, "#   %s\n", strLine.c_str());
+                }
+                iStart = iEnd + 1;
+            }
+        }
+        fprintf(fpReport, "# %d tests, %d failed, %.1f ms\n", (int)(m_Scripts.size()), m_iFailed, fTime);
+    }
+    else if (m_iReport == REPORT_JUNIT) {
+        // Timeouts reported as errors, other failures as failures
+        int iTimeouts = 0;
+        for (size_t ii = 0; ii < m_Scripts.size(); ii++) {
+            if (m_Scripts[ii].timeout) {
+                iTimeouts += 1;
+            }
+        }
+        fprintf(fpReport, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+        fprintf(fpReport, "<testsuites tests=\"%d\" failures=\"%d\" errors=\"%d\" time=\"%.3f\">\n",
+                (int)(m_Scripts.size()), m_iFailed - iTimeouts, iTimeouts, fTime / 1000.0);
+        fprintf(fpReport, "  <testsuite name=\"comet\" tests=\"%d\" failures=\"%d\" errors=\"%d\" time=\"%.3f\">\n",
+                (int)(m_Scripts.size()), m_iFailed - iTimeouts, iTimeouts, fTime / 1000.0);
+        for (size_t ii = 0; ii < m_Scripts.size(); ii++) {
+            const BatchScript &tScript = m_Scripts[ii];
+            fprintf(fpReport, "    <testcase classname=\"comet\" name=\"");
+            batchWriteXML(fpReport, tScript.name);
+            fprintf(fpReport, "\" time=\"%.3f\"", tScript.time / 1000.0);
+            if (tScript.ok && tScript.text.empty()) {
+                fprintf(fpReport, "/>\n");
+                continue;
+            }
+            fprintf(fpReport, ">\n");
+            if (tScript.ok == false) {
+                fprintf(fpReport, "      <%s message=\"", tScript.timeout ? "error" : "failure");
+                batchWriteXML(fpReport, tScript.error);
+                fprintf(fpReport, "\"/>\n");
+            }
+            if (tScript.text.empty() == false) {
+                fprintf(fpReport, "      <system-out>");
+                batchWriteXML(fpReport, tScript.text);
+                fprintf(fpReport, "</system-out>\n");
+            }
+            fprintf(fpReport, "    </testcase>\n");
+        }
+        fprintf(fpReport, "  </testsuite>\n</testsuites>\n");
+    }
+
+    bool bRet = (ferror(fpReport) == 0);
+    if (fpReport != stdout) {
+        fclose(fpReport);
+    }
+    return bRet;
+}
@@ -0,0 +1,456 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#include "Identifiers.h"
+
+#include "CometApp.h"
+#include "CometBench.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+
+#ifdef WIN32
+#include <direct.h>
+#include <windows.h>
+#include <wx/msw/winundef.h>
+#else
+#include <time.h>
+#include <unistd.h>
+#endif
+
+// jit.attach callback: what, tr, func, pc, otr, oex
+static int benchTraceEvent(lua_State *pLua)
+{
+    BenchTrace *pTrace = (BenchTrace *)lua_touserdata(pLua, lua_upvalueindex(1));
+    const char *pszWhat = lua_tostring(pLua, 1);
+    if ((pTrace != NULL) && (pszWhat != NULL)) {
+        if (strcmp(pszWhat, "stop") == 0) {
+            pTrace->traces += 1;
+        }
+        else if (strcmp(pszWhat, "abort") == 0) {
+            pTrace->aborts += 1;
+        }
+    }
+    return 0;
+}
+
+// jit.attach(fn, "trace") or jit.attach(fn) to detach: false without JIT
+static bool benchAttach(lua_State *pLua, int iCallback, bool bAttach)
+{
+    lua_getglobal(pLua, "jit");
+    if (lua_istable(pLua, -1) == 0) {
+        lua_pop(pLua, 1);
+        return false;
+    }
+    lua_getfield(pLua, -1, "attach");
+    lua_remove(pLua, -2);
+    if (lua_isfunction(pLua, -1) == 0) {
+        lua_pop(pLua, 1);
+        return false;
+    }
+    lua_pushvalue(pLua, iCallback);
+    if (bAttach) {
+        lua_pushstring(pLua, "trace");
+    }
+    if (lua_pcall(pLua, bAttach ? 2 : 1, 0, 0) != 0) {
+        lua_pop(pLua, 1);
+        return false;
+    }
+    return true;
+}
+
+static double benchMemory(lua_State *pLua)
+{
+    return (double)lua_gc(pLua, LUA_GCCOUNT, 0) + ((double)lua_gc(pLua, LUA_GCCOUNTB, 0) / 1024.0);
+}
+
+static void benchFormat(double fNs, char *pszT, size_t iSize)
+{
+    if (fNs < 1000.0) {
+        snprintf(pszT, iSize, "%.1f ns", fNs);
+    }
+    else if (fNs < 1000000.0) {
+        snprintf(pszT, iSize, "%.2f us", fNs / 1000.0);
+    }
+    else if (fNs < 1000000000.0) {
+        snprintf(pszT, iSize, "%.2f ms", fNs / 1000000.0);
+    }
+    else {
+        snprintf(pszT, iSize, "%.3f s", fNs / 1000000000.0);
+    }
+}
+
+// Nearest rank of the sorted samples
+static double benchPercentile(const std::vector<double> &vecSorted, double fRank)
+{
+    size_t iIndex = (size_t)(fRank * (double)(vecSorted.size()) + 0.999999);
+    iIndex = (iIndex < 1) ? 0 : (iIndex - 1);
+    return vecSorted[(iIndex < vecSorted.size()) ? iIndex : (vecSorted.size() - 1)];
+}
+
+int64_t CometBench::clock(void)
+{
+#ifdef WIN32
+    static LARGE_INTEGER liFrequency = { 0 };
+    if (liFrequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&liFrequency);
+    }
+    LARGE_INTEGER liNow;
+    QueryPerformanceCounter(&liNow);
+    return (int64_t)((double)(liNow.QuadPart) * (1000000000.0 / (double)(liFrequency.QuadPart)));
+#else
+    struct timespec tsNow;
+    clock_gettime(CLOCK_MONOTONIC, &tsNow);
+    return ((int64_t)(tsNow.tv_sec) * 1000000000) + (int64_t)(tsNow.tv_nsec);
+#endif
+}
+
+CometBench::CometBench(const luaL_Reg *pFunctions)
+{
+    m_pFunctions = pFunctions;
+    m_iWarmup = BENCH_WARMUP;
+    m_iIterations = BENCH_ITERATIONS;
+    m_fThreshold = BENCH_THRESHOLD;
+    m_Trace.traces = m_Trace.aborts = 0;
+}
+
+CometBench::~CometBench()
+{
+}
+
+void CometBench::setWarmup(int iWarmup)
+{
+    m_iWarmup = (iWarmup < 0) ? 0 : ((iWarmup > BENCH_MAXSAMPLES) ? BENCH_MAXSAMPLES : iWarmup);
+}
+
+void CometBench::setIterations(int iIterations)
+{
+    m_iIterations = (iIterations < 1) ? 1 : ((iIterations > BENCH_MAXSAMPLES) ? BENCH_MAXSAMPLES : iIterations);
+}
+
+bool CometBench::loadBaseline(void)
+{
+    m_Baseline.clear();
+
+    FILE *fpBaseline = fopen(m_strBaseline.c_str(), "r");
+    if (fpBaseline == NULL) {
+        return false;
+    }
+
+    // name <tab> median (ns) <tab> mean (ns)
+    char szLine[LM_STRSIZEW];
+    szLine[LM_STRSIZEW - 1] = '\0';
+    while (fgets(szLine, LM_STRSIZEW - 1, fpBaseline) != NULL) {
+        if ((szLine[0] == '#') || (szLine[0] == '\r') || (szLine[0] == '\n')) {
+            continue;
+        }
+        char *pszTab = strchr(szLine, '\t');
+        if ((pszTab == NULL) || (pszTab == szLine)) {
+            continue;
+        }
+        *pszTab = '\0';
+        char *pszEnd = NULL;
+        double fMedian = strtod(pszTab + 1, &pszEnd);
+        if ((pszEnd != (pszTab + 1)) && (fMedian > 0.0)) {
+            m_Baseline[szLine] = fMedian;
+        }
+    }
+
+    fclose(fpBaseline);
+    return true;
+}
+
+bool CometBench::saveBaseline(void)
+{
+    FILE *fpBaseline = fopen(m_strSave.c_str(), "wb");
+    if (fpBaseline == NULL) {
+        return false;
+    }
+
+    fprintf(fpBaseline, "# Comet benchmark baseline: name, median (ns), mean (ns)\n");
+    for (size_t ii = 0; ii < m_Results.size(); ii++) {
+        if (m_Results[ii].ok) {
+            fprintf(fpBaseline, "%s\t%.3f\t%.3f\n", m_Results[ii].name.c_str(), m_Results[ii].median, m_Results[ii].mean);
+        }
+    }
+
+    bool bRet = (ferror(fpBaseline) == 0);
+    fclose(fpBaseline);
+    return bRet;
+}
+
+bool CometBench::runBenchmark(lua_State *pLua, int iFunc, BenchResult &tResult)
+{
+    // Warmup: lets the JIT compiler record the hot paths before timing
+    for (int ii = 0; ii < m_iWarmup; ii++) {
+        lua_pushvalue(pLua, iFunc);
+        if (lua_pcall(pLua, 0, 0, 0) != 0) {
+            printf("! %s: %s\n", tResult.name.c_str(), lua_isstring(pLua, -1) ? lua_tostring(pLua, -1) : "error");
+            lua_pop(pLua, 1);
+            return false;
+        }
+    }
+
+    // Calls per sample, so that a sample is long compared with the clock resolution
+    int iRepeat = 1;
+    for (;;) {
+        const int64_t iStart = CometBench::clock();
+        for (int ii = 0; ii < iRepeat; ii++) {
+            lua_pushvalue(pLua, iFunc);
+            if (lua_pcall(pLua, 0, 0, 0) != 0) {
+                printf("! %s: %s\n", tResult.name.c_str(), lua_isstring(pLua, -1) ? lua_tostring(pLua, -1) : "error");
+                lua_pop(pLua, 1);
+                return false;
+            }
+        }
+        if (((CometBench::clock() - iStart) >= BENCH_MINSAMPLE) || (iRepeat >= BENCH_MAXREPEAT)) {
+            break;
+        }
+        iRepeat <<= 1;
+    }
+    tResult.repeat = iRepeat;
+
+    std::vector<double> vecSamples;
+    vecSamples.reserve(m_iIterations);
+
+    lua_gc(pLua, LUA_GCCOLLECT, 0);
+
+    // Only the traces recorded while timing (not during warmup and calibration)
+    m_Trace.traces = m_Trace.aborts = 0;
+
+    for (int ii = 0; ii < m_iIterations; ii++) {
+        const int64_t iStart = CometBench::clock();
+        for (int jj = 0; jj < iRepeat; jj++) {
+            lua_pushvalue(pLua, iFunc);
+            if (lua_pcall(pLua, 0, 0, 0) != 0) {
+                printf("! %s: %s\n", tResult.name.c_str(), lua_isstring(pLua, -1) ? lua_tostring(pLua, -1) : "error");
+                lua_pop(pLua, 1);
+                return false;
+            }
+        }
+        vecSamples.push_back((double)(CometBench::clock() - iStart) / (double)iRepeat);
+    }
+
+    tResult.traces = m_Trace.traces;
+    tResult.aborts = m_Trace.aborts;
+
+    // Allocations: one untimed sample with the collector stopped, so that the memory
+    // in use only grows by what the calls allocate
+    lua_gc(pLua, LUA_GCCOLLECT, 0);
+    lua_gc(pLua, LUA_GCSTOP, 0);
+    const double fMemory = benchMemory(pLua);
+    bool bRet = true;
+    for (int ii = 0; ii < iRepeat; ii++) {
+        lua_pushvalue(pLua, iFunc);
+        if (lua_pcall(pLua, 0, 0, 0) != 0) {
+            printf("! %s: %s\n", tResult.name.c_str(), lua_isstring(pLua, -1) ? lua_tostring(pLua, -1) : "error");
+            lua_pop(pLua, 1);
+            bRet = false;
+            break;
+        }
+    }
+    tResult.gc = (benchMemory(pLua) - fMemory) / (double)iRepeat;
+    lua_gc(pLua, LUA_GCRESTART, 0);
+    lua_gc(pLua, LUA_GCCOLLECT, 0);
+    if (bRet == false) {
+        return false;
+    }
+
+    std::sort(vecSamples.begin(), vecSamples.end());
+    double fSum = 0.0;
+    for (size_t ii = 0; ii < vecSamples.size(); ii++) {
+        fSum += vecSamples[ii];
+    }
+    tResult.samples = (int)(vecSamples.size());
+    tResult.mean = fSum / (double)(vecSamples.size());
+    tResult.median = (vecSamples.size() & 1) ? vecSamples[vecSamples.size() >> 1]
+                                             : (0.5 * (vecSamples[(vecSamples.size() >> 1) - 1] + vecSamples[vecSamples.size() >> 1]));
+    tResult.p90 = benchPercentile(vecSamples, 0.90);
+    tResult.p99 = benchPercentile(vecSamples, 0.99);
+    tResult.min = vecSamples.front();
+    tResult.max = vecSamples.back();
+
+    return true;
+}
+
+void CometBench::printResult(const BenchResult &tResult, int *piRegressions)
+{
+    if (tResult.ok == false) {
+        printf("%-24s failed\n", tResult.name.c_str());
+        return;
+    }
+
+    char szMean[LM_STRSIZET], szMedian[LM_STRSIZET], szP90[LM_STRSIZET], szP99[LM_STRSIZET], szMin[LM_STRSIZET];
+    benchFormat(tResult.mean, szMean, LM_STRSIZET);
+    benchFormat(tResult.median, szMedian, LM_STRSIZET);
+    benchFormat(tResult.p90, szP90, LM_STRSIZET);
+    benchFormat(tResult.p99, szP99, LM_STRSIZET);
+    benchFormat(tResult.min, szMin, LM_STRSIZET);
+
+    printf("%-24s %11s %11s %11s %11s %11s %5d/%-3d %10.3f", tResult.name.c_str(), szMean, szMedian, szP90, szP99, szMin,
+           tResult.traces, tResult.aborts, tResult.gc);
+
+    std::map<std::string, double>::const_iterator itB = m_Baseline.find(tResult.name);
+    if (itB != m_Baseline.end()) {
+        const double fChange = 100.0 * (tResult.median - itB->second) / itB->second;
+        const bool bRegression = (fChange > m_fThreshold);
+        printf("  %+7.1f %%%s", fChange, bRegression ? "  REGRESSION" : "");
+        if (bRegression) {
+            *piRegressions += 1;
+        }
+    }
+    else if (m_Baseline.empty() == false) {
+        printf("  (new)");
+    }
+    printf("\n");
+}
+
+int CometBench::run(const char *pszFilename)
+{
+    m_Results.clear();
+
+    if ((m_strBaseline.empty() == false) && (loadBaseline() == false)) {
+        printf("! Cannot read the baseline %s\n", m_strBaseline.c_str());
+        return -1;
+    }
+
+    char *pszRealname = lf_realpath(pszFilename, NULL);
+    if (pszRealname == NULL) {
+        printf("! Cannot run script: invalid file\n");
+        return -1;
+    }
+
+    // The script and the benchmarks are run from the script directory
+    char szCurDir[LM_STRSIZEW];
+    szCurDir[0] = szCurDir[LM_STRSIZEW - 1] = '\0';
+    bool bDirChanged = false;
+    if (getcwd(szCurDir, LM_STRSIZEW - 1) != NULL) {
+        char *pszSep = strrchr(pszRealname, '/');
+#ifdef WIN32
+        char *pszSepW = strrchr(pszRealname, '\\');
+        if ((pszSep == NULL) || (pszSepW > pszSep)) {
+            pszSep = pszSepW;
+        }
+#endif
+        if (pszSep != NULL) {
+            const char cT = *(pszSep + 1);
+            *(pszSep + 1) = '\0';
+            bDirChanged = (chdir(pszRealname) == 0);
+            *(pszSep + 1) = cT;
+        }
+    }
+
+#ifdef __WXMSW__
+    try {
+        lmSocket::startup();
+    }
+    catch (...) {
+    }
+#endif
+
+    int iRet = -1;
+
+    LuaEngine *pEngine = new (std::nothrow) LuaEngine(LUA_ENGINE_CONSOLE, m_pFunctions, true);
+    if (pEngine == NULL) {
+        printf("! Cannot create Lua state: insufficient memory\n");
+    }
+    else if (pEngine->runScriptFile(pszRealname, -1, NULL, LUA_ENGINE_RUN, NULL)) {
+
+        lua_State *pLua = pEngine->getLuaState();
+        const int iTop = lua_gettop(pLua);
+
+        lua_getglobal(pLua, BENCH_TABLE);
+        if (lua_istable(pLua, -1) == 0) {
+            printf("! No benchmark: the script should define a global table named %s\n", BENCH_TABLE);
+        }
+        else {
+            const int iTable = lua_gettop(pLua);
+
+            std::vector<std::string> vecNames;
+            lua_pushnil(pLua);
+            while (lua_next(pLua, iTable) != 0) {
+                if ((lua_type(pLua, -2) == LUA_TSTRING) && lua_isfunction(pLua, -1)) {
+                    vecNames.push_back(lua_tostring(pLua, -2));
+                }
+                lua_pop(pLua, 1);
+            }
+            std::sort(vecNames.begin(), vecNames.end());
+
+            m_Trace.traces = m_Trace.aborts = 0;
+            lua_pushlightuserdata(pLua, &m_Trace);
+            lua_pushcclosure(pLua, benchTraceEvent, 1);
+            const int iCallback = lua_gettop(pLua);
+            const bool bTrace = benchAttach(pLua, iCallback, true);
+
+            printf("%d benchmarks, %d warmup runs, %d samples%s\n", (int)(vecNames.size()), m_iWarmup, m_iIterations,
+                   bTrace ? "" : " (no JIT trace count)");
+            printf("%-24s %11s %11s %11s %11s %11s %9s %10s%s\n", "benchmark", "mean", "median", "p90", "p99", "min",
+                   "traces", "KB/call", m_Baseline.empty() ? "" : "  baseline");
+
+            int iFailed = 0, iRegressions = 0;
+            for (size_t ii = 0; ii < vecNames.size(); ii++) {
+                BenchResult tResult;
+                tResult.name = vecNames[ii];
+                lua_getfield(pLua, iTable, vecNames[ii].c_str());
+                if (lua_isfunction(pLua, -1)) {
+                    lua_gc(pLua, LUA_GCCOLLECT, 0);
+                    tResult.ok = runBenchmark(pLua, lua_gettop(pLua), tResult);
+                }
+                lua_settop(pLua, iCallback);
+                if (tResult.ok == false) {
+                    iFailed += 1;
+                }
+                printResult(tResult, &iRegressions);
+                m_Results.push_back(tResult);
+            }
+
+            if (bTrace) {
+                benchAttach(pLua, iCallback, false);
+            }
+
+            printf("%d benchmarks, %d failed", (int)(vecNames.size()), iFailed);
+            if (m_Baseline.empty() == false) {
+                printf(", %d regressions (threshold %.1f %%)", iRegressions, m_fThreshold);
+            }
+            printf("\n");
+
+            if ((m_strSave.empty() == false) && (saveBaseline() == false)) {
+                printf("! Cannot write the baseline %s\n", m_strSave.c_str());
+            }
+
+            iRet = iFailed + iRegressions;
+        }
+
+        lua_settop(pLua, iTop);
+    }
+
+    if (pEngine) {
+        delete pEngine;
+        pEngine = NULL;
+    }
+
+#ifdef __WXMSW__
+    lmSocket::shutdown();
+#endif
+
+    if (bDirChanged) {
+        chdir(szCurDir);
+    }
+    free(pszRealname);
+    pszRealname = NULL;
+
+    return iRet;
+}
@@ -638,6 +638,7 @@ void CometFileExplorer::doSetDir(const wxString &strDir)
     this->ReCreateTree();
     wxTreeCtrl *pTreeCtrl = GetTreeCtrl();
     pTreeCtrl->SetScrollPos(wxHORIZONTAL, 0);
+    pFrame->updateFileWatch();
 }
 
 void CometFileExplorer::doBrowseDir(void)
@@ -654,7 +655,7 @@ void CometFileExplorer::doBrowseDir(void)
     }
 }
 
-void CometFileExplorer::doRefreshDir(void)
+void CometFileExplorer::doRefreshDir(bool bSilent /* = false*/)
 {
     wxTreeCtrl *pTreeCtrl = GetTreeCtrl();
 
@@ -663,7 +664,7 @@ void CometFileExplorer::doRefreshDir(void)
     pTreeCtrl->SetScrollPos(wxHORIZONTAL, 0);
 
     CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
-    if (pFrame) {
+    if (pFrame && (false == bSilent)) {
         pFrame->OutputStatusbar(uT("Explorer refresh done"), SIGMAFRAME_TIMER_SHORT);
     }
 }
@@ -39,6 +39,7 @@ BEGIN_EVENT_TABLE(CometFrame, wxFrame)
     EVT_SIZE(CometFrame::OnSize)
     EVT_MOVE(CometFrame::OnMove)
     EVT_KILL_FOCUS(CometFrame::OnKillFocus)
+    EVT_ACTIVATE(CometFrame::OnActivate)
 
     EVT_MENU(ID_FILE_NEW, CometFrame::OnFileNew)
     EVT_MENU_RANGE(ID_FILE_TEMPLATE01, ID_FILE_TEMPLATELAST, CometFrame::OnFileTemplate)
@@ -192,6 +193,7 @@ BEGIN_EVENT_TABLE(CometFrame, wxFrame)
 
     EVT_UPDATE_UI_RANGE(ID_SCRIPT_BREAKPOINT_MOD, ID_SCRIPT_BREAKPOINT_DELALL, CometFrame::OnUpdateBreakpoint)
     EVT_MENU(ID_SCRIPT_BREAKPOINT_MOD, CometFrame::OnScriptAction)
+    EVT_MENU(ID_SCRIPT_BREAKPOINT_EDIT, CometFrame::OnScriptAction)
     EVT_MENU(ID_SCRIPT_BREAKPOINT_DELALL, CometFrame::OnScriptAction)
 
     EVT_MENU(ID_SCRIPT_LINESPACING_100, CometFrame::OnScriptAction)
@@ -271,8 +273,10 @@ BEGIN_EVENT_TABLE(CometFrame, wxFrame)
     EVT_AUINOTEBOOK_PAGE_CLOSE(ID_NOTEBOOK_DEBUG, CometFrame::OnDebugClose)
     EVT_MENU(ID_BOOKMARK_DELETEALL, CometFrame::OnBookmarkDeleteAll)
     EVT_MENU(ID_BOOKMARK_REFRESH, CometFrame::OnBookmarkRefresh)
-    EVT_LIST_COL_CLICK(IDL_DEBUG_STACK, CometFrame::OnDebugHeaderClick)
-    EVT_LIST_COL_CLICK(IDL_DEBUG_WATCH, CometFrame::OnDebugHeaderClick)
+    EVT_TREE_ITEM_EXPANDING(IDL_DEBUG_STACK, CometFrame::OnDebugExpanding)
+    EVT_TREE_ITEM_EXPANDING(IDL_DEBUG_WATCH, CometFrame::OnDebugExpanding)
+    EVT_TREE_ITEM_ACTIVATED(IDL_DEBUG_STACK, CometFrame::OnDebugActivated)
+    EVT_TREE_ITEM_ACTIVATED(IDL_DEBUG_WATCH, CometFrame::OnDebugActivated)
 
     EVT_MENU(ID_FILE_CLOSE, CometFrame::OnScriptCloseX)
     EVT_MENU(ID_FILE_CLOSEALL, CometFrame::OnScriptCloseAll)
@@ -287,6 +291,7 @@ BEGIN_EVENT_TABLE(CometFrame, wxFrame)
     EVT_MENU(ID_FILE_FILEPROPS, CometFrame::OnScriptFileProps)
     EVT_MENU(ID_FILE_FILESTATS, CometFrame::OnScriptFileStats)
     EVT_MENU(ID_FILE_READONLY, CometFrame::OnScriptFileReadOnly)
+    EVT_MENU_RANGE(ID_FILE_SAVEMODE_FIRST, ID_FILE_SAVEMODE_LAST, CometFrame::OnScriptFileSaveMode)
     EVT_UPDATE_UI(ID_FILE_CLOSE, CometFrame::OnUpdateScriptClose)
     EVT_UPDATE_UI(ID_FILE_CLOSEALL, CometFrame::OnUpdateScriptClose)
     EVT_UPDATE_UI(ID_FILE_CLOSEOTHERS, CometFrame::OnUpdateScriptClose)
@@ -301,6 +306,7 @@ BEGIN_EVENT_TABLE(CometFrame, wxFrame)
     EVT_UPDATE_UI(ID_FILE_FILEPROPS, CometFrame::OnUpdateScriptPath)
     EVT_UPDATE_UI(ID_FILE_FILESTATS, CometFrame::OnUpdateScriptPath)
     EVT_UPDATE_UI(ID_FILE_READONLY, CometFrame::OnUpdateScriptPath)
+    EVT_UPDATE_UI_RANGE(ID_FILE_SAVEMODE_FIRST, ID_FILE_SAVEMODE_LAST, CometFrame::OnUpdateScriptPath)
 
     EVT_MENU(ID_FILE_OPENEXAMPLESDIR, CometFrame::OnOpenExamplesDir)
 
@@ -318,6 +324,9 @@ BEGIN_EVENT_TABLE(CometFrame, wxFrame)
 
     EVT_COMMAND(ID_THREAD_CHECKUPDATE, wxEVT_COMMAND_TEXT_UPDATED, CometFrame::OnCheckUpdateEnd)
 
+    EVT_COMMAND(ID_THREAD_FILEWATCH, wxEVT_COMMAND_TEXT_UPDATED, CometFrame::OnFileWatch)
+    EVT_COMMAND(ID_THREAD_SYMBOLS, wxEVT_COMMAND_TEXT_UPDATED, CometFrame::OnSymbolIndex)
+
     EVT_CLOSE(CometFrame::OnClose)
 
 END_EVENT_TABLE()
@@ -432,10 +441,9 @@ CometFrame::CometFrame(int iWidth, int iHeight) : wxFrame(NULL, wxID_ANY, uT("Co
 
     m_pDebugPanel = NULL;
     m_pNotebookDebug = NULL;
-    m_pListStack = NULL;
-    m_pListWatch = NULL;
-    m_iListWatchSorted = CometFrame::LIST_SORTDIRECTION::NONE;
-    m_iListStackSorted = CometFrame::LIST_SORTDIRECTION::NONE;
+    m_pTreeStack = NULL;
+    m_pTreeWatch = NULL;
+    m_iDebugShown = 0;
 
     m_pMenuBar = NULL;
     m_pToolBar = NULL;
@@ -552,6 +560,12 @@ CometFrame::CometFrame(int iWidth, int iHeight) : wxFrame(NULL, wxID_ANY, uT("Co
     m_iTimerCounter = 0;
     m_iTimerDuration = 20000;
 
+    m_pFileWatcher = NULL;
+    m_bFileWatchDisabled = false;
+    m_bFileWatchBusy = false;
+    m_strFileWatchPending = wxEmptyString;
+    m_pSymbolIndex = NULL;
+
     m_pExample = NULL;
     m_pSnippet = NULL;
 
@@ -630,6 +644,10 @@ CometFrame::~CometFrame()
         m_pTimer = NULL;
     }
 
+    // normally already stopped in fileExit
+    stopFileWatch();
+    stopSymbolIndex();
+
     if (m_dlgTab != NULL) {
         m_dlgTab->Destroy();
         m_dlgTab = NULL;
@@ -676,103 +694,171 @@ CometFrame::~CometFrame()
     CodeEdit::deleteCometLexer();
 }
 
-void CometFrame::UpdateDebugNotebook(const wxString &strFilename, const wxString &strT)
+void CometFrame::UpdateDebugNotebook(const wxString &strFilename, const DebugPage *pPause)
 {
-    if (strT.IsEmpty()) {
+    if (pPause == NULL) {
         ClearDebugWindow(strFilename);
         return;
     }
 
-    if ((m_pNotebookDebug == NULL) || (m_pListWatch == NULL) || (m_pListStack == NULL)) {
+    if ((m_pNotebookDebug == NULL) || (m_pTreeWatch == NULL) || (m_pTreeStack == NULL)) {
         CreateStackWindow();
         CreateWatchWindow();
     }
 
-    if (m_pNotebookDebug && m_pListStack && m_pListWatch) {
+    if ((m_pNotebookDebug == NULL) || (m_pTreeWatch == NULL) || (m_pTreeStack == NULL)) {
+        return;
+    }
 
-        int iPos = (int)(strT.find(uT("\nSTACKTRACE\n")));
-        if (iPos < 0) {
-            ClearDebugWindow(strFilename);
-            return;
-        }
+    wxAuiPaneInfo &paneTT = m_auiManager.GetPane(m_pDebugPanel);
+    if (paneTT.IsShown() == false) {
+        paneTT.Show();
+        m_auiManager.Update();
+    }
 
-        wxString strWatch = strT.Mid(0, iPos);
-        wxString strStack = strT.Mid(iPos + 12);
+    if (pPause->serial == m_iDebugShown) {
+        // Same pause (editor focused again): the expanded items are kept
+        return;
+    }
 
-        wxAuiPaneInfo &paneTT = m_auiManager.GetPane(m_pDebugPanel);
-        if (paneTT.IsShown() == false) {
-            paneTT.Show();
-            m_auiManager.Update();
-        }
+    ClearDebugWindow(strFilename);
+    m_iDebugShown = pPause->serial;
 
-        ClearDebugWindow(strFilename);
+    // Only the top level: the fields and the locals are requested when expanded
+    wxTreeItemId rootWatch = m_pTreeWatch->GetRootItem();
+    for (size_t ii = 0; ii < pPause->items.size(); ii++) {
+        DoDebugAppend(m_pTreeWatch, rootWatch, pPause->items[ii]);
+    }
 
-        wxStringTokenizer tokenizerT(strWatch, uT("\n"));
-        int ii = 0, jj = 0, iLen = 0;
-        char_t cT;
-        long itemIndex = 0L;
-        while (tokenizerT.HasMoreTokens() && (ii < 64)) {
+    wxTreeItemId rootStack = m_pTreeStack->GetRootItem();
+    for (size_t ii = 0; ii < pPause->frames.size(); ii++) {
+        const LuaDebugFrame &tFrame = pPause->frames[ii];
+        wxString strT = wxString::Format(uT("%d: "), tFrame.level);
+        strT += LM_U8TOWC(tFrame.name);
+        strT += uT(" (");
+        strT += LM_U8TOWC(tFrame.what);
+        strT += wxString::Format(uT(") line %d"), tFrame.line);
+        wxTreeItemId itemT = m_pTreeStack->AppendItem(rootStack, strT, -1, -1, new DebugTreeData(0, tFrame.level));
+        m_pTreeStack->SetItemHasChildren(itemT, true);
+    }
+}
 
-            wxString strToken = tokenizerT.GetNextToken();
+void CometFrame::DoDebugAppend(wxTreeCtrl *pTree, const wxTreeItemId &itemParent, const LuaDebugItem &tItem)
+{
+    DebugTreeData *pData = new DebugTreeData(tItem.handle, -1);
+    pData->name = LM_U8TOWC(tItem.name);
+    pData->value = LM_U8TOWC(tItem.value);
 
-            iLen = (int)(strToken.Length());
-            if ((iLen < 1) || (iLen >= LM_STRSIZE)) {
-                continue;
-            }
+    wxString strT = pData->name;
+    strT += uT(" = ");
+    strT += pData->value;
+    strT += uT("  (");
+    strT += LM_U8TOWC(tItem.type);
+    strT += uT(")");
 
-            jj = iLen - 1;
-            while (jj >= 0) {
-                cT = strToken.at(jj);
-                if ((cT != LM_NEWLINE_CHARA) && (cT != ('\t')) && (cT != (' ')) && (cT != ('*'))) {
-                    break;
-                }
-                jj -= 1;
-            }
-            if (jj <= 0) {
-                continue;
-            }
+    wxTreeItemId itemT = pTree->AppendItem(itemParent, strT, -1, -1, pData);
+    if (tItem.handle > 0) {
+        pTree->SetItemHasChildren(itemT, true);
+    }
+}
 
-            wxStringTokenizer tokenizerTT(strToken, uT("\t"));
-            jj = 0;
-            while (tokenizerTT.HasMoreTokens() && (jj < 8)) {
-                wxString strTT = tokenizerTT.GetNextToken();
-                if (jj == 0) {
-                    itemIndex = m_pListWatch->InsertItem(0, strTT);
-                }
-                else {
-                    m_pListWatch->SetItem(itemIndex, jj, strTT);
-                }
-                jj += 1;
-            }
+void CometFrame::DoDebugRequest(wxTreeCtrl *pTree, const wxTreeItemId &itemT, int iHandle, int iLevel, int iFirst)
+{
+    ScriptEdit *pEdit = getActiveEditor();
+    if ((pEdit == NULL) || (pEdit->getDebugPause() == NULL) || (pEdit->getDebugPause()->serial != m_iDebugShown)) {
+        return;
+    }
 
-            ii += 1;
-        }
-        m_pListWatch->Update();
+    int iId = pEdit->luaInspect(iHandle, iLevel, iFirst);
+    if (iId <= 0) {
+        return;
+    }
+    m_DebugPending[iId] = std::make_pair(pTree, itemT);
 
-        wxStringTokenizer tokenizerX(strStack, uT("\n"));
-        while (tokenizerX.HasMoreTokens() && (ii < 64)) {
-            wxString strToken = tokenizerX.GetNextToken();
-            wxStringTokenizer tokenizerTT(strToken, uT("\t"));
-            jj = 0;
-            while (tokenizerTT.HasMoreTokens() && (jj < 8)) {
-                wxString strTT = tokenizerTT.GetNextToken();
-                if (jj == 0) {
-                    itemIndex = m_pListStack->InsertItem(0, strTT);
-                }
-                else {
-                    m_pListStack->SetItem(itemIndex, jj, strTT);
-                }
-                jj += 1;
-            }
-            ii += 1;
-        }
-        m_pListStack->Update();
+    // Replaced by the fields when received (see UpdateDebugItems)
+    pTree->AppendItem(itemT, uT("..."));
+}
+
+void CometFrame::UpdateDebugItems(const DebugPage *pPause, const DebugPage *pPage)
+{
+    if ((pPause == NULL) || (pPause->serial != m_iDebugShown)) {
+        return;
+    }
+
+    std::map<int, std::pair<wxTreeCtrl *, wxTreeItemId> >::iterator itT = m_DebugPending.find(pPage->request.id);
+    if (itT == m_DebugPending.end()) {
+        return;
+    }
+    wxTreeCtrl *pTree = itT->second.first;
+    wxTreeItemId itemParent = itT->second.second;
+    m_DebugPending.erase(itT);
+
+    // Remove the "..." item
+    wxTreeItemId itemT = pTree->GetLastChild(itemParent);
+    if (itemT.IsOk() && (pTree->GetItemData(itemT) == NULL)) {
+        pTree->Delete(itemT);
+    }
+
+    pTree->Freeze();
+    for (size_t ii = 0; ii < pPage->items.size(); ii++) {
+        DoDebugAppend(pTree, itemParent, pPage->items[ii]);
+    }
+    if (pPage->next >= 0) {
+        // Next page listed when activated
+        DebugTreeData *pData = new DebugTreeData(pPage->request.handle, pPage->request.level, pPage->next);
+        pTree->AppendItem(itemParent, wxString::Format(uT("[more fields from %d]"), pPage->next + 1), -1, -1, pData);
+    }
+    pTree->Thaw();
+
+    if (pTree->GetChildrenCount(itemParent, false) == 0) {
+        pTree->SetItemHasChildren(itemParent, false);
     }
 }
 
+void CometFrame::OnDebugExpanding(wxTreeEvent &tEvent)
+{
+    wxTreeCtrl *pTree = (tEvent.GetId() == IDL_DEBUG_WATCH) ? m_pTreeWatch : m_pTreeStack;
+    if (pTree == NULL) {
+        return;
+    }
+
+    wxTreeItemId itemT = tEvent.GetItem();
+    DebugTreeData *pData = itemT.IsOk() ? (DebugTreeData *)(pTree->GetItemData(itemT)) : NULL;
+    if ((pData == NULL) || pData->requested || (pData->next >= 0)) {
+        return;
+    }
+    if ((pData->handle <= 0) && (pData->level < 0)) {
+        return;
+    }
+
+    pData->requested = true;
+    DoDebugRequest(pTree, itemT, pData->handle, pData->level, 0);
+}
+
+void CometFrame::OnDebugActivated(wxTreeEvent &tEvent)
+{
+    wxTreeCtrl *pTree = (tEvent.GetId() == IDL_DEBUG_WATCH) ? m_pTreeWatch : m_pTreeStack;
+    if (pTree == NULL) {
+        return;
+    }
+
+    wxTreeItemId itemT = tEvent.GetItem();
+    DebugTreeData *pData = itemT.IsOk() ? (DebugTreeData *)(pTree->GetItemData(itemT)) : NULL;
+    if ((pData == NULL) || (pData->next < 0)) {
+        tEvent.Skip();
+        return;
+    }
+
+    // Link to the next page of fields
+    wxTreeItemId itemParent = pTree->GetItemParent(itemT);
+    int iHandle = pData->handle, iLevel = pData->level, iNext = pData->next;
+    pTree->Delete(itemT);
+    DoDebugRequest(pTree, itemParent, iHandle, iLevel, iNext);
+}
+
 bool CometFrame::GetDebugSymbol(const wxString &strN, wxString &strV)
 {
-    if ((m_pNotebookDebug == NULL) || (m_pListWatch == NULL) || (m_pListStack == NULL)) {
+    if ((m_pNotebookDebug == NULL) || (m_pTreeWatch == NULL) || (m_pTreeStack == NULL)) {
         return false;
     }
 
@@ -780,9 +866,6 @@ bool CometFrame::GetDebugSymbol(const wxString &strN, wxString &strV)
     if (iLen < 1) {
         return false;
     }
-    if (strN == uT("*")) {
-        return false;
-    }
 
     wxAuiPaneInfo &paneT = m_auiManager.GetPane(m_pDebugPanel);
     if (paneT.IsShown() == false) {
@@ -790,27 +873,15 @@ bool CometFrame::GetDebugSymbol(const wxString &strN, wxString &strV)
         m_auiManager.Update();
     }
 
-    int iCount = m_pListWatch->GetItemCount();
-    if (iCount < 1) {
-        return false;
-    }
-
-    wxListItem rowInfo;
-    rowInfo.m_col = 0;
-    rowInfo.m_mask = wxLIST_MASK_TEXT;
-    for (int ii = 0; ii < wxMin(iCount, 64); ii++) {
-        rowInfo.m_itemId = ii;
-        m_pListWatch->GetItem(rowInfo);
-        rowInfo.m_text.Replace(uT("\n"), uT(""));
-        rowInfo.m_text.Replace(uT("\r"), uT(""));
-        rowInfo.m_text.Replace(uT("\t"), uT(""));
-        rowInfo.m_text.Replace(uT(" "), uT(""));
-        if (rowInfo.m_text == strN) {
-            rowInfo.m_col = 1;
-            m_pListWatch->GetItem(rowInfo);
-            strV = rowInfo.m_text;
+    wxTreeItemIdValue cookieT;
+    wxTreeItemId itemT = m_pTreeWatch->GetFirstChild(m_pTreeWatch->GetRootItem(), cookieT);
+    while (itemT.IsOk()) {
+        DebugTreeData *pData = (DebugTreeData *)(m_pTreeWatch->GetItemData(itemT));
+        if (pData && (pData->name == strN)) {
+            strV = pData->value;
             return true;
         }
+        itemT = m_pTreeWatch->GetNextChild(m_pTreeWatch->GetRootItem(), cookieT);
     }
 
     return false;
@@ -818,11 +889,14 @@ bool CometFrame::GetDebugSymbol(const wxString &strN, wxString &strV)
 
 void CometFrame::ClearDebugWindow(const wxString &strFilename)
 {
+    m_iDebugShown = 0;
+    m_DebugPending.clear();
+
     if (m_pNotebookDebug == NULL) {
         return;
     }
 
-    if (m_pDebugPanel && m_pNotebookDebug && m_pListStack && m_pListWatch) {
+    if (m_pDebugPanel && m_pNotebookDebug && m_pTreeStack && m_pTreeWatch) {
         wxString strT = uT("Debug Window");
         if (strFilename.IsEmpty() == false) {
             strT += uT(" - ");
@@ -837,11 +911,11 @@ void CometFrame::ClearDebugWindow(const wxString &strFilename)
         }
     }
 
-    if (m_pListWatch) {
-        m_pListWatch->DeleteAllItems();
+    if (m_pTreeWatch) {
+        m_pTreeWatch->DeleteChildren(m_pTreeWatch->GetRootItem());
     }
-    if (m_pListStack) {
-        m_pListStack->DeleteAllItems();
+    if (m_pTreeStack) {
+        m_pTreeStack->DeleteChildren(m_pTreeStack->GetRootItem());
     }
 }
 
@@ -2705,123 +2779,6 @@ void CometFrame::OnToolboxClose(wxAuiNotebookEvent &tEvent)
     }
 }
 
-// Sort wxListCtrl
-int listDoCompare(long itemL, long itemR, long listPtr, int iCol, bool bAsc)
-{
-    if (itemL == itemR) {
-        return 0;
-    }
-
-    wxListCtrl *pListCtrl = (wxListCtrl *)listPtr;
-    if (pListCtrl == NULL) {
-        return 0;
-    }
-
-    wxListItem listItemL, listItemR;
-    listItemL.m_itemId = itemL;
-    listItemL.m_col = iCol;
-    listItemR.m_itemId = itemR;
-    listItemR.m_col = iCol;
-    listItemL.m_mask = listItemR.m_mask = wxLIST_MASK_TEXT;
-    if (pListCtrl->GetItem(listItemL) && pListCtrl->GetItem(listItemR)) {
-        wxString strL = (bAsc) ? listItemL.m_text : listItemR.m_text;
-        wxString strR = (bAsc) ? listItemR.m_text : listItemL.m_text;
-        int iC = strL.Cmp(strR);
-        return (iC < 0) ? -1 : ((iC > 0) ? 1 : 0);
-    }
-    return 0;
-}
-int wxCALLBACK listCompareCol0Asc(long itemL, long itemR, long listPtr)
-{
-    return listDoCompare(itemL, itemR, listPtr, 0, true);
-}
-int wxCALLBACK listCompareCol1Asc(long itemL, long itemR, long listPtr)
-{
-    return listDoCompare(itemL, itemR, listPtr, 1, true);
-}
-int wxCALLBACK listCompareCol2Asc(long itemL, long itemR, long listPtr)
-{
-    return listDoCompare(itemL, itemR, listPtr, 2, true);
-}
-int wxCALLBACK listCompareCol3Asc(long itemL, long itemR, long listPtr)
-{
-    return listDoCompare(itemL, itemR, listPtr, 3, true);
-}
-int wxCALLBACK listCompareCol0Desc(long itemL, long itemR, long listPtr)
-{
-    return listDoCompare(itemL, itemR, listPtr, 0, false);
-}
-int wxCALLBACK listCompareCol1Desc(long itemL, long itemR, long listPtr)
-{
-    return listDoCompare(itemL, itemR, listPtr, 1, false);
-}
-int wxCALLBACK listCompareCol2Desc(long itemL, long itemR, long listPtr)
-{
-    return listDoCompare(itemL, itemR, listPtr, 2, false);
-}
-int wxCALLBACK listCompareCol3Desc(long itemL, long itemR, long listPtr)
-{
-    return listDoCompare(itemL, itemR, listPtr, 3, false);
-}
-//
-
-void CometFrame::OnDebugHeaderClick(wxListEvent &tEvent)
-{
-    wxListCtrl *pList = NULL;
-    int iSorted = CometFrame::LIST_SORTDIRECTION::ASC;
-    if ((tEvent.GetId() == IDL_DEBUG_WATCH) && m_pListWatch) {
-        pList = m_pListWatch;
-        if (m_iListWatchSorted == CometFrame::LIST_SORTDIRECTION::ASC) {
-            m_iListWatchSorted = CometFrame::LIST_SORTDIRECTION::DESC;
-        }
-        else {
-            m_iListWatchSorted = CometFrame::LIST_SORTDIRECTION::ASC;
-        }
-        iSorted = m_iListWatchSorted;
-    }
-    else if ((tEvent.GetId() == IDL_DEBUG_STACK) && m_pListStack) {
-        pList = m_pListStack;
-        if (m_iListStackSorted == CometFrame::LIST_SORTDIRECTION::ASC) {
-            m_iListStackSorted = CometFrame::LIST_SORTDIRECTION::DESC;
-        }
-        else {
-            m_iListStackSorted = CometFrame::LIST_SORTDIRECTION::ASC;
-        }
-        iSorted = m_iListStackSorted;
-    }
-    if (pList == NULL) {
-        return;
-    }
-
-    long itemT = -1;
-    bool bFlag = false;
-    for (int ii = 0; ii < 128; ii++) {
-        itemT = pList->GetNextItem(itemT);
-        if (itemT == -1) {
-            bFlag = true;
-            break;
-        }
-        pList->SetItemData(itemT, itemT);
-    }
-    if (bFlag == false) {
-        return;
-    }
-
-    int iCol = tEvent.GetColumn();
-    if (iCol == 0) {
-        pList->SortItems((iSorted == CometFrame::LIST_SORTDIRECTION::ASC) ? listCompareCol0Asc : listCompareCol0Desc, (long)pList);
-    }
-    else if (iCol == 1) {
-        pList->SortItems((iSorted == CometFrame::LIST_SORTDIRECTION::ASC) ? listCompareCol1Asc : listCompareCol1Desc, (long)pList);
-    }
-    else if (iCol == 2) {
-        pList->SortItems((iSorted == CometFrame::LIST_SORTDIRECTION::ASC) ? listCompareCol2Asc : listCompareCol2Desc, (long)pList);
-    }
-    else if (iCol == 3) {
-        pList->SortItems((iSorted == CometFrame::LIST_SORTDIRECTION::ASC) ? listCompareCol3Asc : listCompareCol3Desc, (long)pList);
-    }
-}
-
 void CometFrame::OnDebugClose(wxAuiNotebookEvent &tEvent)
 {
     tEvent.Veto();
@@ -444,6 +444,13 @@ void CometFrame::DoAnalyzerChange(void)
 
     size_t iLen = strFind.Length();
 
+    // Workspace symbol: @name
+    if ((iLen > 1) && strFind.StartsWith(uT("@"))) {
+        DoSymbolGoto(strFind.Mid(1), true);
+        return;
+    }
+    //
+
     // Go To Line
     long iT;
     if ((iLen > 0) && (iLen <= 6) && strFind.ToLong(&iT)) {
@@ -521,6 +528,40 @@ void CometFrame::OnAnalyzerChange(wxCommandEvent &tEvent)
     DoAnalyzerChange();
 }
 
+bool CometFrame::DoSymbolGoto(const wxString &strName, bool bPrefix /* = false*/)
+{
+    if ((m_pSymbolIndex == NULL) || strName.IsEmpty()) {
+        return false;
+    }
+
+    std::vector<SymbolMatch> vecMatch;
+    const int iCount = m_pSymbolIndex->find(strName, vecMatch, bPrefix);
+    if (iCount < 1) {
+        wxString strT = m_pSymbolIndex->isRunning() ? uT("' not found (workspace indexing in progress)") : uT("' not found in the workspace");
+        OutputStatusbar(uT("'") + strName + strT, SIGMAFRAME_TIMER_SHORT);
+        return false;
+    }
+
+    int iSel = 0;
+    if (iCount > 1) {
+        wxArrayString arrChoices;
+        for (int ii = 0; ii < iCount; ii++) {
+            arrChoices.Add(wxString::Format(uT("%s    %s:%d"), LM_CSTR(vecMatch[ii].name), LM_CSTR(getLabelFromPath(vecMatch[ii].path, false)), vecMatch[ii].line + 1));
+        }
+        iSel = wxGetSingleChoiceIndex(uT("Definitions of '") + strName + uT("':"), uT("Go To Definition"), arrChoices, this);
+        if ((iSel < 0) || (iSel >= iCount)) {
+            return false;
+        }
+    }
+
+    ScriptEdit *pEdit = fileOpen(vecMatch[iSel].path, false, static_cast<long>(vecMatch[iSel].line));
+    if (pEdit == NULL) {
+        return false;
+    }
+    pEdit->DoGotoLine(vecMatch[iSel].line, true);
+    return true;
+}
+
 BEGIN_EVENT_TABLE(CodeInfobar, wxWindow)
     EVT_RIGHT_DOWN(CodeInfobar::OnRightContext)
     EVT_LEFT_DOWN(CodeInfobar::OnMouseDown)
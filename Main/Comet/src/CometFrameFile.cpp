@@ -637,7 +637,7 @@ void CometFrame::OnScriptClose(wxAuiNotebookEvent &tEvent)
         pEdit->DoHighlightSyntax(m_ScintillaPrefs.common.syntaxEnable);
         DoAnalyzerUpdateList(pEdit, true);
         updateCodeSample();
-        UpdateDebugNotebook(wxEmptyString, wxEmptyString);
+        UpdateDebugNotebook(wxEmptyString, NULL);
 
         tEvent.Veto();
         return;
@@ -1193,7 +1193,7 @@ wxString CometFrame::explorerGetCurrentDir(void)
     return wxEmptyString;
 }
 
-void CometFrame::DoUpdateExplorer(void)
+void CometFrame::DoUpdateExplorer(bool bSilent /* = false*/)
 {
     if (m_pNotebookFilesys == NULL) {
         return;
@@ -1201,7 +1201,7 @@ void CometFrame::DoUpdateExplorer(void)
 
     wxAuiPaneInfo &paneT = m_auiManager.GetPane(m_pFilesysPanel);
     if (paneT.IsShown() && m_pExplorerTree && (m_pExplorerTree->IsShown())) {
-        m_pExplorerTree->doRefreshDir();
+        m_pExplorerTree->doRefreshDir(bSilent);
     }
 }
 
@@ -1222,6 +1222,190 @@ void CometFrame::OnFileUpdate(wxCommandEvent &WXUNUSED(tEvent))
     }
 }
 
+void CometFrame::updateSymbolIndex(void)
+{
+    if (m_bClosed || (m_pExplorerTree == NULL)) {
+        return;
+    }
+
+    wxString strRoot = m_pExplorerTree->doGetDir();
+    if (strRoot.IsEmpty() || (::wxDirExists(strRoot) == false)) {
+        if (m_pSymbolIndex) {
+            m_pSymbolIndex->setRoot(wxEmptyString);
+        }
+        return;
+    }
+
+    if (m_pSymbolIndex == NULL) {
+        m_pSymbolIndex = new (std::nothrow) SymbolIndex(this);
+        if (m_pSymbolIndex == NULL) {
+            return;
+        }
+    }
+
+    m_pSymbolIndex->setRoot(strRoot);
+}
+
+void CometFrame::stopSymbolIndex(void)
+{
+    if (m_pSymbolIndex == NULL) {
+        return;
+    }
+
+    // Saved (if modified) by the destructor
+    delete m_pSymbolIndex;
+    m_pSymbolIndex = NULL;
+}
+
+void CometFrame::OnSymbolIndex(wxCommandEvent &tEvent)
+{
+    if (m_bClosed || (m_pSymbolIndex == NULL)) {
+        return;
+    }
+
+    m_pSymbolIndex->finish(tEvent.GetInt());
+}
+
+void CometFrame::OnActivate(wxActivateEvent &tEvent)
+{
+    // Files may have been changed outside, where the file watcher does not look (subdirectories)
+    if (tEvent.GetActive() && (m_bClosed == false) && m_pSymbolIndex) {
+        m_pSymbolIndex->rescan();
+    }
+    tEvent.Skip();
+}
+
+void CometFrame::updateFileWatch(void)
+{
+    // Files changed outside are indexed again when notified, otherwise at the next start
+    updateSymbolIndex();
+
+    if (m_bClosed || m_bFileWatchDisabled || (m_pNotebookMain == NULL)) {
+        return;
+    }
+
+    if (m_pFileWatcher == NULL) {
+        FileWatcher *pWatcher = new (std::nothrow) FileWatcher();
+        if (pWatcher == NULL) {
+            return;
+        }
+        if ((pWatcher->Create(this) != wxTHREAD_NO_ERROR) || (pWatcher->Run() != wxTHREAD_NO_ERROR)) {
+            // Not available (e.g. on Windows): changes are detected with the modification time only
+            delete pWatcher;
+            m_bFileWatchDisabled = true;
+            return;
+        }
+        m_pFileWatcher = pWatcher;
+    }
+
+    wxArrayString arrDirs;
+
+    const int iPageCount = (const int)(m_pNotebookMain->GetPageCount());
+    for (int ii = 0; ii < iPageCount; ii++) {
+        ScriptEdit *pEdit = getEditor(ii);
+        if (pEdit == NULL) {
+            break;
+        }
+        if (pEdit->GetFilename().IsEmpty() == false) {
+            wxFileName fname = pEdit->GetFilename();
+            arrDirs.Add(fname.GetPath());
+        }
+    }
+
+    if (m_pExplorerTree) {
+        wxString strRoot = m_pExplorerTree->doGetDir();
+        if ((strRoot.IsEmpty() == false) && ::wxDirExists(strRoot)) {
+            arrDirs.Add(strRoot);
+        }
+    }
+
+    m_pFileWatcher->setDirs(arrDirs);
+}
+
+void CometFrame::stopFileWatch(void)
+{
+    if (m_pFileWatcher == NULL) {
+        return;
+    }
+
+    m_pFileWatcher->stop();
+    m_pFileWatcher->Wait();
+    delete m_pFileWatcher;
+    m_pFileWatcher = NULL;
+}
+
+void CometFrame::OnFileWatch(wxCommandEvent &tEvent)
+{
+    if (m_bClosed || (m_pNotebookMain == NULL)) {
+        return;
+    }
+
+    // Changes received while a reload is asked to the user are handled just after
+    if (m_bFileWatchBusy) {
+        m_strFileWatchPending += tEvent.GetString();
+        return;
+    }
+
+    m_bFileWatchBusy = true;
+
+    wxString strPaths = tEvent.GetString();
+
+    while (strPaths.IsEmpty() == false) {
+
+        bool bRefreshExplorer = false;
+        wxFileName fnameRoot;
+        if (m_pExplorerTree && (m_pExplorerTree->doGetDir().IsEmpty() == false)) {
+            fnameRoot.AssignDir(m_pExplorerTree->doGetDir());
+        }
+
+        wxStringTokenizer tokenT(strPaths, uT("\n"), wxTOKEN_STRTOK);
+        while (tokenT.HasMoreTokens()) {
+
+            wxString strPath = tokenT.GetNextToken();
+            wxFileName fnameT = strPath;
+
+            if (m_pSymbolIndex) {
+                m_pSymbolIndex->changed(strPath);
+            }
+
+            if (fnameRoot.IsOk()) {
+                wxFileName fnameDir;
+                fnameDir.AssignDir(fnameT.GetPath());
+                if (fnameDir.SameAs(fnameRoot) || fnameT.SameAs(fnameRoot)) {
+                    bRefreshExplorer = true;
+                }
+            }
+
+            if (false == detectChangeOutside()) {
+                continue;
+            }
+
+            const int iPageCount = (const int)(m_pNotebookMain->GetPageCount());
+            for (int ii = 0; ii < iPageCount; ii++) {
+                ScriptEdit *pEdit = getEditor(ii);
+                if (pEdit == NULL) {
+                    break;
+                }
+                if (pEdit->GetFilename().IsEmpty() || (fnameT.SameAs(pEdit->GetFilename()) == false)) {
+                    continue;
+                }
+                // Reloaded only if the content changed
+                pEdit->DoReload(pEdit->autoReload(), false);
+                break;
+            }
+        }
+
+        if (bRefreshExplorer) {
+            DoUpdateExplorer(true);
+        }
+
+        strPaths = m_strFileWatchPending;
+        m_strFileWatchPending.Empty();
+    }
+
+    m_bFileWatchBusy = false;
+}
+
 void CometFrame::OnFileSaveAll(wxCommandEvent &WXUNUSED(tEvent))
 {
     const int iPageCount = (const int)(m_pNotebookMain->GetPageCount());
@@ -1682,6 +1866,16 @@ void CometFrame::OnScriptFileReadOnly(wxCommandEvent &WXUNUSED(tEvent))
     updateEditorStatus(pEdit);
 }
 
+void CometFrame::OnScriptFileSaveMode(wxCommandEvent &tEvent)
+{
+    ScriptEdit *pEdit = getActiveEditor();
+    if (pEdit == NULL) {
+        return;
+    }
+
+    pEdit->setSaveDurability(tEvent.GetId() - ID_FILE_SAVEMODE_FIRST);
+}
+
 void CometFrame::OnScriptChange(wxAuiNotebookEvent &tEvent)
 {
     tEvent.Skip();
@@ -2068,6 +2262,12 @@ void CometFrame::updateCurrentFileMenu(wxMenu *pMenu, int iSel)
     pMenu->Append(ID_FILE_FILESTATS, uT("File Statistics..."), uT("View File Statistics"), wxITEM_NORMAL);
     pMenu->Append(ID_FILE_READONLY, uT("Read Only"), uT("Set As Read Only"), wxITEM_CHECK);
 
+    wxMenu *menuFileSaveMode = new wxMenu();
+    menuFileSaveMode->Append(ID_FILE_SAVEMODE_DIRECT, uT("Overwrite In Place"), uT("Overwrite the file in place"), wxITEM_CHECK);
+    menuFileSaveMode->Append(ID_FILE_SAVEMODE_ATOMIC, uT("Atomic Replace"), uT("Write a temporary file, then replace the file"), wxITEM_CHECK);
+    menuFileSaveMode->Append(ID_FILE_SAVEMODE_SYNC, uT("Atomic Replace And Sync"), uT("Write a temporary file, flush it to disk, then replace the file"), wxITEM_CHECK);
+    pMenu->AppendSubMenu(menuFileSaveMode, uT("Save Mode"), uT("Save Mode"));
+
     pMenu->AppendSeparator();
     pMenu->Append(ID_FILE_RELOAD, uT("Reload From Disk"), uT("Reload the active file from disk"), wxITEM_NORMAL);
 }
@@ -2446,6 +2646,9 @@ bool CometFrame::fileExit(void)
         wxTheClipboard->Close();
     }
 
+    stopFileWatch();
+    stopSymbolIndex();
+
     m_bClosed = true;
     return true;
 }
@@ -177,7 +177,13 @@ void CometFrame::DoFindPrevNext(int idT)
                     if (iColumn < 0) {
                         iColumn = 0;
                     }
-                    strT += wxString::Format(uT(" found in line %d (column %d)."), iLine + 1, iColumn + 1);
+                    const int iMatchCount = pEdit->getFindMatchCount();
+                    if (iMatchCount > 1) {
+                        strT += wxString::Format(uT(" found in line %d (column %d), %d matches in the document."), iLine + 1, iColumn + 1, iMatchCount);
+                    }
+                    else {
+                        strT += wxString::Format(uT(" found in line %d (column %d)."), iLine + 1, iColumn + 1);
+                    }
                     updateStatusbarPos(iLine, iColumn);
                 }
                 OutputStatusbar(strT, SIGMAFRAME_TIMER_SHORT);
@@ -458,10 +458,34 @@ wxAuiNotebook *CometFrame::CreateDebugNotebook(void)
     return m_pNotebookDebug;
 }
 
-wxListCtrl *CometFrame::CreateStackWindow(void)
+wxTreeCtrl *CometFrame::CreateDebugTree(wxWindowID idT, const wxString &strRoot)
 {
-    if (m_pListStack) {
-        return m_pListStack;
+    // Items created when expanded: the tables are listed on demand, page by page
+    wxTreeCtrl *pTree = new (std::nothrow) wxTreeCtrl(m_pNotebookDebug, idT, wxDefaultPosition, m_DebugNotebookSize, wxTR_HAS_BUTTONS | wxTR_HIDE_ROOT | wxTR_LINES_AT_ROOT | wxTR_SINGLE | wxNO_BORDER);
+    if (pTree == NULL) {
+        return NULL;
+    }
+
+    pTree->SetHelpText(strRoot);
+    pTree->SetMinSize(NOTEBOOK_MINSIZE);
+    pTree->AddRoot(strRoot);
+
+    long iB = m_ScintillaPrefs.style[wxSTC_LUA_DEFAULT].background;
+    long iF = m_ScintillaPrefs.style[wxSTC_LUA_DEFAULT].foreground;
+    iB = CodeEdit::normalizeColor(iB, (iB > iF) ? -8L : 8L);
+    pTree->SetBackgroundColour(wxColour(iB));
+    pTree->SetForegroundColour(wxColour(iF));
+    pTree->Refresh();
+
+    m_pNotebookDebug->AddPage(pTree, strRoot);
+
+    return pTree;
+}
+
+wxTreeCtrl *CometFrame::CreateStackWindow(void)
+{
+    if (m_pTreeStack) {
+        return m_pTreeStack;
     }
 
     if (m_pNotebookDebug == NULL) {
@@ -473,54 +497,19 @@ wxListCtrl *CometFrame::CreateStackWindow(void)
         return NULL;
     }
 
-    m_pListStack = new (std::nothrow) wxListCtrl(m_pNotebookDebug, IDL_DEBUG_STACK, wxDefaultPosition, m_DebugNotebookSize, wxLC_REPORT | wxLC_SINGLE_SEL | wxLC_SORT_ASCENDING | wxLC_SORT_DESCENDING | wxNO_BORDER);
-    if (m_pListStack) {
-        m_pListStack->SetHelpText(uT("Stack"));
-        m_pListStack->SetMinSize(NOTEBOOK_MINSIZE);
-
-        wxSize sizeColumn = CometApp::getTextExtent(this, uT("> Watch Column <"));
-        int widthColumn = sizeColumn.GetWidth();
-
-        wxListItem itemA;
-        itemA.SetId(0);
-        itemA.SetText(uT("Lev"));
-        itemA.SetWidth(widthColumn / 2);
-        m_pListStack->InsertColumn(0, itemA);
-        wxListItem itemB;
-        itemB.SetId(1);
-        itemB.SetText(uT("Ln"));
-        itemB.SetWidth(widthColumn / 2);
-        m_pListStack->InsertColumn(1, itemB);
-        wxListItem itemC;
-        itemC.SetId(2);
-        itemC.SetText(uT("Name"));
-        itemC.SetWidth(widthColumn + (widthColumn / 2));
-        m_pListStack->InsertColumn(2, itemC);
-        wxListItem itemD;
-        itemD.SetId(3);
-        itemD.SetText(uT("What"));
-        itemD.SetWidth(widthColumn);
-        m_pListStack->InsertColumn(3, itemD);
-
-        long iB = m_ScintillaPrefs.style[wxSTC_LUA_DEFAULT].background;
-        long iF = m_ScintillaPrefs.style[wxSTC_LUA_DEFAULT].foreground;
-        iB = CodeEdit::normalizeColor(iB, (iB > iF) ? -8L : 8L);
-        m_pListStack->SetBackgroundColour(wxColour(iB));
-        m_pListStack->SetForegroundColour(wxColour(iF));
-        m_pListStack->Refresh();
-
-        m_pNotebookDebug->AddPage(m_pListStack, uT("Stack"));
-        int iStackIndex = m_pNotebookDebug->GetPageIndex(m_pListStack);
+    m_pTreeStack = CreateDebugTree(IDL_DEBUG_STACK, uT("Stack"));
+    if (m_pTreeStack) {
+        int iStackIndex = m_pNotebookDebug->GetPageIndex(m_pTreeStack);
         m_pNotebookDebug->SetPageBitmap(iStackIndex, wxBitmap(stack_small_xpm));
     }
 
-    return m_pListStack;
+    return m_pTreeStack;
 }
 
-wxListCtrl *CometFrame::CreateWatchWindow(void)
+wxTreeCtrl *CometFrame::CreateWatchWindow(void)
 {
-    if (m_pListWatch) {
-        return m_pListWatch;
+    if (m_pTreeWatch) {
+        return m_pTreeWatch;
     }
 
     if (m_pNotebookDebug == NULL) {
@@ -532,54 +521,24 @@ wxListCtrl *CometFrame::CreateWatchWindow(void)
         return NULL;
     }
 
-    m_pListWatch = new (std::nothrow) wxListCtrl(m_pNotebookDebug, IDL_DEBUG_WATCH, wxDefaultPosition, m_DebugNotebookSize, wxLC_REPORT | wxLC_SINGLE_SEL | wxLC_SORT_ASCENDING | wxLC_SORT_DESCENDING | wxNO_BORDER);
-    if (m_pListWatch) {
-        m_pListWatch->SetHelpText(uT("Watch"));
-        m_pListWatch->SetMinSize(NOTEBOOK_MINSIZE);
-
-        wxSize sizeColumn = CometApp::getTextExtent(this, uT("> Watch Column <"));
-        int widthColumn = sizeColumn.GetWidth();
-
-        wxListItem itemAt;
-        itemAt.SetId(0);
-        itemAt.SetText(uT("Name"));
-        itemAt.SetWidth(widthColumn);
-        m_pListWatch->InsertColumn(0, itemAt);
-        wxListItem itemBt;
-        itemBt.SetId(1);
-        itemBt.SetText(uT("Value"));
-        itemBt.SetWidth(widthColumn + (widthColumn / 2));
-        m_pListWatch->InsertColumn(1, itemBt);
-        wxListItem itemCt;
-        itemCt.SetId(2);
-        itemCt.SetText(uT("Type"));
-        itemCt.SetWidth(widthColumn);
-        m_pListWatch->InsertColumn(2, itemCt);
-
-        long iB = m_ScintillaPrefs.style[wxSTC_LUA_DEFAULT].background;
-        long iF = m_ScintillaPrefs.style[wxSTC_LUA_DEFAULT].foreground;
-        iB = CodeEdit::normalizeColor(iB, (iB > iF) ? -8L : 8L);
-        m_pListWatch->SetBackgroundColour(wxColour(iB));
-        m_pListWatch->SetForegroundColour(wxColour(iF));
-        m_pListWatch->Refresh();
-
-        m_pNotebookDebug->AddPage(m_pListWatch, uT("Watch"));
-        int iWatchIndex = m_pNotebookDebug->GetPageIndex(m_pListWatch);
+    m_pTreeWatch = CreateDebugTree(IDL_DEBUG_WATCH, uT("Watch"));
+    if (m_pTreeWatch) {
+        int iWatchIndex = m_pNotebookDebug->GetPageIndex(m_pTreeWatch);
         m_pNotebookDebug->SetPageBitmap(iWatchIndex, wxBitmap(debug_small_xpm));
     }
 
-    return m_pListWatch;
+    return m_pTreeWatch;
 }
 
 void CometFrame::UpdateDebugNotebook(const wxString &strFilename)
 {
-    if ((m_pNotebookDebug == NULL) || (m_pListWatch == NULL) || (m_pListStack == NULL)) {
+    if ((m_pNotebookDebug == NULL) || (m_pTreeWatch == NULL) || (m_pTreeStack == NULL)) {
         CreateStackWindow();
         CreateWatchWindow();
     }
 
-    if (m_pNotebookDebug && m_pListWatch && m_pListStack) {
-        int iWatchIndex = m_pNotebookDebug->GetPageIndex(m_pListWatch);
+    if (m_pNotebookDebug && m_pTreeWatch && m_pTreeStack) {
+        int iWatchIndex = m_pNotebookDebug->GetPageIndex(m_pTreeWatch);
         m_pNotebookDebug->SetSelection(iWatchIndex);
     }
 }
@@ -648,6 +607,8 @@ void CometFrame::initInterface(void)
 
     m_bInitialized = true;
 
+    updateFileWatch();
+
     // initMenu/initToolbar/initStatusbar should be called afer all m_auiManager initializations
     // and before m_auiManager.Update()
     initMenu();
@@ -1118,6 +1079,8 @@ void CometFrame::initMenu(void)
 #endif
     menuRun->Append(pItem);
 
+    menuRun->Append(ID_SCRIPT_BREAKPOINT_EDIT, uT("Edit Breakpoint..."), uT("Set the breakpoint condition, hit count or log message"));
+
     menuRun->Append(ID_SCRIPT_BREAKPOINT_DELALL, uT("Reset Breakpoints"), uT("Remove all breakpoints"));
 
     menuRun->Append(ID_SCRIPT_STEPINTO, uT("Step Into"), uT("Step into or Step over"), wxITEM_CHECK);
@@ -1335,16 +1298,16 @@ void CometFrame::initToolPrefs(ScintillaPrefs &tScintillaPrefs)
         m_pNotebookDebug->Refresh();
     }
 
-    if (m_pListWatch) {
-        m_pListWatch->SetBackgroundColour(wxColour(iB));
-        m_pListWatch->SetForegroundColour(wxColour(iF));
-        m_pListWatch->Refresh();
+    if (m_pTreeWatch) {
+        m_pTreeWatch->SetBackgroundColour(wxColour(iB));
+        m_pTreeWatch->SetForegroundColour(wxColour(iF));
+        m_pTreeWatch->Refresh();
     }
 
-    if (m_pListStack) {
-        m_pListStack->SetBackgroundColour(wxColour(iB));
-        m_pListStack->SetForegroundColour(wxColour(iF));
-        m_pListStack->Refresh();
+    if (m_pTreeStack) {
+        m_pTreeStack->SetBackgroundColour(wxColour(iB));
+        m_pTreeStack->SetForegroundColour(wxColour(iF));
+        m_pTreeStack->Refresh();
     }
 
     if (m_pNotebookToolbox) {
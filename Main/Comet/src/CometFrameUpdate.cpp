@@ -1075,6 +1075,9 @@ void CometFrame::OnUpdateScriptPath(wxUpdateUIEvent &tEvent)
         if (idT == ID_FILE_READONLY) {
             tEvent.Check(pEdit->GetReadOnly());
         }
+        else if ((idT >= ID_FILE_SAVEMODE_FIRST) && (idT <= ID_FILE_SAVEMODE_LAST)) {
+            tEvent.Check(pEdit->getSaveDurability() == (idT - ID_FILE_SAVEMODE_FIRST));
+        }
         CometFrame::enableUIitem(tEvent, pEdit->GetFilename().IsEmpty() == false);
     }
 }
@@ -0,0 +1,458 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#include "Identifiers.h"
+
+#include "CometApp.h"
+#include "CometServer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#endif
+
+#define SERVER_REQUESTSIZE (LM_STRSIZEW * 8)
+
+#ifndef WIN32
+
+static volatile sig_atomic_t s_iServerStop = 0;
+
+static void serverSignal(int iSignal)
+{
+    UNUSED(iSignal);
+    s_iServerStop = 1;
+}
+
+static bool serverAddress(const char *pszSocket, struct sockaddr_un *pAddress)
+{
+    memset(pAddress, 0, sizeof(struct sockaddr_un));
+    pAddress->sun_family = AF_UNIX;
+    if ((pszSocket == NULL) || (*pszSocket == '\0') || (strlen(pszSocket) >= sizeof(pAddress->sun_path))) {
+        return false;
+    }
+    strcpy(pAddress->sun_path, pszSocket);
+    return true;
+}
+
+static bool serverWrite(int iFd, const char *pszT, size_t iLen)
+{
+    while (iLen > 0) {
+        ssize_t iWritten = write(iFd, pszT, iLen);
+        if (iWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        pszT += iWritten;
+        iLen -= (size_t)iWritten;
+    }
+    return true;
+}
+
+static void serverEnd(int iFd, bool bOK)
+{
+    char szTrailer[SERVER_TRAILER_SIZE];
+    memcpy(szTrailer, SERVER_TRAILER, SERVER_TRAILER_SIZE - 2);
+    szTrailer[SERVER_TRAILER_SIZE - 2] = bOK ? '0' : '1';
+    szTrailer[SERVER_TRAILER_SIZE - 1] = '\n';
+    serverWrite(iFd, szTrailer, SERVER_TRAILER_SIZE);
+}
+
+#endif
+
+CometServer::CometServer(const luaL_Reg *pFunctions, const char *pszSocket)
+{
+    m_pFunctions = pFunctions;
+    m_strSocket = (pszSocket != NULL) ? pszSocket : "";
+    m_iWorkers = SERVER_WORKERS;
+    m_iListen = -1;
+    m_pEngine = NULL;
+}
+
+CometServer::~CometServer()
+{
+    if (m_pEngine) {
+        delete m_pEngine;
+        m_pEngine = NULL;
+    }
+}
+
+void CometServer::setWorkers(int iWorkers)
+{
+    m_iWorkers = (iWorkers < 1) ? 1 : ((iWorkers > SERVER_MAXWORKERS) ? SERVER_MAXWORKERS : iWorkers);
+}
+
+#ifndef WIN32
+
+bool CometServer::spawn(void)
+{
+    pid_t iPid = fork();
+    if (iPid < 0) {
+        return false;
+    }
+    if (iPid == 0) {
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+        signal(SIGPIPE, SIG_DFL);
+        serve();
+        _exit(0);
+    }
+    m_Workers.push_back((long)iPid);
+    return true;
+}
+
+// Worker: one script, then exit (the process state is not reused)
+void CometServer::serve(void)
+{
+    int iConn = -1;
+    for (;;) {
+        iConn = accept(m_iListen, NULL, NULL);
+        if (iConn >= 0) {
+            break;
+        }
+        if ((errno != EINTR) && (errno != ECONNABORTED)) {
+            _exit(2);
+        }
+    }
+
+    // A client not sending its request would hold the worker
+    struct timeval tvTimeout;
+    tvTimeout.tv_sec = SERVER_TIMEOUT;
+    tvTimeout.tv_usec = 0;
+    setsockopt(iConn, SOL_SOCKET, SO_RCVTIMEO, &tvTimeout, sizeof(tvTimeout));
+
+    // magic, working directory and script path, one per line
+    char szRequest[SERVER_REQUESTSIZE];
+    size_t iLen = 0;
+    int iLines = 0;
+    while ((iLines < 3) && (iLen < (SERVER_REQUESTSIZE - 1))) {
+        ssize_t iRead = read(iConn, szRequest + iLen, SERVER_REQUESTSIZE - 1 - iLen);
+        if (iRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if ((errno == EAGAIN) || (errno == EWOULDBLOCK)) {
+                // timeout: the connection is dropped
+                close(iConn);
+                _exit(0);
+            }
+            break;
+        }
+        if (iRead == 0) {
+            break;
+        }
+        for (ssize_t ii = 0; ii < iRead; ii++) {
+            if (szRequest[iLen + ii] == '\n') {
+                iLines += 1;
+            }
+        }
+        iLen += (size_t)iRead;
+    }
+    szRequest[iLen] = '\0';
+
+    char *pszLines[3] = { NULL, NULL, NULL };
+    char *pszT = szRequest;
+    for (int ii = 0; (ii < 3) && (pszT != NULL); ii++) {
+        pszLines[ii] = pszT;
+        pszT = strchr(pszT, '\n');
+        if (pszT != NULL) {
+            *pszT = '\0';
+            if ((pszT > pszLines[ii]) && (*(pszT - 1) == '\r')) {
+                *(pszT - 1) = '\0';
+            }
+            pszT += 1;
+        }
+    }
+
+    if ((iLines < 3) || (strcmp(pszLines[0], SERVER_MAGIC) != 0) || (chdir(pszLines[1]) != 0)) {
+        const char *pszError = "! Invalid request\n";
+        serverWrite(iConn, pszError, strlen(pszError));
+        serverEnd(iConn, false);
+        close(iConn);
+        _exit(0);
+    }
+
+    // The script output goes to the client, written unbuffered (see CometApp::OnInit)
+    fflush(stdout);
+    fflush(stderr);
+    dup2(iConn, STDOUT_FILENO);
+    dup2(iConn, STDERR_FILENO);
+
+    bool bRet = false;
+
+    char szCurDir[PATH_MAX];
+    szCurDir[0] = szCurDir[PATH_MAX - 1] = '\0';
+    strncpy(szCurDir, pszLines[1], PATH_MAX - 2);
+    size_t iLenDir = strlen(szCurDir);
+    if ((iLenDir > 0) && (szCurDir[iLenDir - 1] != '/')) {
+        szCurDir[iLenDir] = '/';
+        szCurDir[iLenDir + 1] = '\0';
+    }
+
+    char *pszFilename = lf_realpath(pszLines[2], NULL);
+    if ((pszFilename == NULL) || (lf_fileExists(pszFilename) == false)) {
+        printf("! Cannot run script: invalid file\n");
+    }
+    else {
+        bRet = m_pEngine->runScriptFile(pszFilename, -1, static_cast<const char *>(szCurDir), LUA_ENGINE_RUN, NULL);
+    }
+    if (pszFilename) {
+        free(pszFilename);
+        pszFilename = NULL;
+    }
+
+    fflush(stdout);
+    fflush(stderr);
+    serverEnd(iConn, bRet);
+    close(iConn);
+    _exit(0);
+}
+
+bool CometServer::run(void)
+{
+    struct sockaddr_un tAddress;
+    if (serverAddress(m_strSocket.c_str(), &tAddress) == false) {
+        printf("! Invalid socket path %s\n", m_strSocket.c_str());
+        return false;
+    }
+
+    m_iListen = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_iListen < 0) {
+        printf("! Cannot create the socket\n");
+        return false;
+    }
+
+    // A socket file left by a server no longer running is replaced
+    if (connect(m_iListen, (struct sockaddr *)&tAddress, sizeof(tAddress)) == 0) {
+        printf("! A server is already running on %s\n", m_strSocket.c_str());
+        close(m_iListen);
+        m_iListen = -1;
+        return false;
+    }
+    close(m_iListen);
+    unlink(m_strSocket.c_str());
+
+    m_iListen = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((m_iListen < 0) || (bind(m_iListen, (struct sockaddr *)&tAddress, sizeof(tAddress)) != 0)) {
+        printf("! Cannot bind the socket %s\n", m_strSocket.c_str());
+        if (m_iListen >= 0) {
+            close(m_iListen);
+            m_iListen = -1;
+        }
+        return false;
+    }
+    chmod(m_strSocket.c_str(), S_IRUSR | S_IWUSR);
+    if (listen(m_iListen, SERVER_BACKLOG) != 0) {
+        printf("! Cannot listen on the socket %s\n", m_strSocket.c_str());
+        close(m_iListen);
+        m_iListen = -1;
+        unlink(m_strSocket.c_str());
+        return false;
+    }
+
+    // Warm engine, shared by the workers
+    m_pEngine = new (std::nothrow) LuaEngine(LUA_ENGINE_CONSOLE, m_pFunctions, true);
+    bool bRet = (m_pEngine != NULL);
+    if (bRet == false) {
+        printf("! Cannot create Lua state: insufficient memory\n");
+    }
+    else if (m_strPreload.empty() == false) {
+        char *pszPreload = lf_realpath(m_strPreload.c_str(), NULL);
+        char szCurDir[PATH_MAX];
+        szCurDir[0] = szCurDir[PATH_MAX - 1] = '\0';
+        if ((pszPreload == NULL) || (getcwd(szCurDir, PATH_MAX - 2) == NULL)) {
+            printf("! Cannot run the preload script %s\n", m_strPreload.c_str());
+            bRet = false;
+        }
+        else {
+            strcat(szCurDir, "/");
+            bRet = m_pEngine->runScriptFile(pszPreload, -1, static_cast<const char *>(szCurDir), LUA_ENGINE_RUN, NULL);
+        }
+        if (pszPreload) {
+            free(pszPreload);
+            pszPreload = NULL;
+        }
+    }
+
+    if (bRet) {
+        s_iServerStop = 0;
+        struct sigaction tAction;
+        memset(&tAction, 0, sizeof(tAction));
+        tAction.sa_handler = serverSignal;
+        sigemptyset(&tAction.sa_mask);
+        sigaction(SIGINT, &tAction, NULL);
+        sigaction(SIGTERM, &tAction, NULL);
+        signal(SIGPIPE, SIG_IGN);
+
+        for (int ii = 0; ii < m_iWorkers; ii++) {
+            if (spawn() == false) {
+                break;
+            }
+        }
+        bRet = (m_Workers.empty() == false);
+        if (bRet == false) {
+            printf("! Cannot start the workers\n");
+        }
+        else {
+            printf("Serving on %s (%d workers)\n", m_strSocket.c_str(), (int)(m_Workers.size()));
+        }
+
+        // A worker exits after each script: replaced by a new fork
+        while (bRet && (s_iServerStop == 0)) {
+            int iStatus = 0;
+            pid_t iPid = waitpid(-1, &iStatus, 0);
+            if (iPid < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            for (size_t ii = 0; ii < m_Workers.size(); ii++) {
+                if (m_Workers[ii] == (long)iPid) {
+                    m_Workers.erase(m_Workers.begin() + ii);
+                    break;
+                }
+            }
+            if (WIFEXITED(iStatus) && (WEXITSTATUS(iStatus) == 2)) {
+                printf("! Cannot accept connections on %s\n", m_strSocket.c_str());
+                break;
+            }
+            if ((s_iServerStop == 0) && (spawn() == false) && m_Workers.empty()) {
+                printf("! Cannot start the workers\n");
+                break;
+            }
+        }
+
+        for (size_t ii = 0; ii < m_Workers.size(); ii++) {
+            kill((pid_t)(m_Workers[ii]), SIGTERM);
+        }
+        for (size_t ii = 0; ii < m_Workers.size(); ii++) {
+            waitpid((pid_t)(m_Workers[ii]), NULL, 0);
+        }
+        m_Workers.clear();
+
+        signal(SIGINT, SIG_DFL);
+        signal(SIGTERM, SIG_DFL);
+    }
+
+    close(m_iListen);
+    m_iListen = -1;
+    unlink(m_strSocket.c_str());
+
+    return bRet;
+}
+
+bool CometServer::runClient(const char *pszSocket, const char *pszFilename)
+{
+    struct sockaddr_un tAddress;
+    if (serverAddress(pszSocket, &tAddress) == false) {
+        printf("! Invalid socket path %s\n", (pszSocket != NULL) ? pszSocket : "");
+        return false;
+    }
+
+    char szCurDir[PATH_MAX];
+    szCurDir[0] = szCurDir[PATH_MAX - 1] = '\0';
+    if (getcwd(szCurDir, PATH_MAX - 1) == NULL) {
+        printf("! Cannot run script: invalid working directory\n");
+        return false;
+    }
+
+    int iConn = socket(AF_UNIX, SOCK_STREAM, 0);
+    if ((iConn < 0) || (connect(iConn, (struct sockaddr *)&tAddress, sizeof(tAddress)) != 0)) {
+        printf("! Cannot connect to the server %s\n", pszSocket);
+        if (iConn >= 0) {
+            close(iConn);
+        }
+        return false;
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+
+    std::string strRequest = std::string(SERVER_MAGIC) + "\n" + szCurDir + "\n" + pszFilename + "\n";
+    if (serverWrite(iConn, strRequest.c_str(), strRequest.size()) == false) {
+        printf("! Cannot send the request to the server %s\n", pszSocket);
+        close(iConn);
+        return false;
+    }
+
+    // The output is written as received, except the last bytes that may be the trailer
+    char szBuffer[LM_STRSIZEW + SERVER_TRAILER_SIZE];
+    size_t iHeld = 0;
+    for (;;) {
+        ssize_t iRead = read(iConn, szBuffer + iHeld, LM_STRSIZEW);
+        if (iRead < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (iRead == 0) {
+            break;
+        }
+        iHeld += (size_t)iRead;
+        if (iHeld > SERVER_TRAILER_SIZE) {
+            const size_t iOut = iHeld - SERVER_TRAILER_SIZE;
+            fwrite(szBuffer, 1, iOut, stdout);
+            memmove(szBuffer, szBuffer + iOut, SERVER_TRAILER_SIZE);
+            iHeld = SERVER_TRAILER_SIZE;
+        }
+    }
+    close(iConn);
+
+    if ((iHeld == SERVER_TRAILER_SIZE) && (memcmp(szBuffer, SERVER_TRAILER, SERVER_TRAILER_SIZE - 2) == 0)) {
+        return (szBuffer[SERVER_TRAILER_SIZE - 2] == '0');
+    }
+
+    fwrite(szBuffer, 1, iHeld, stdout);
+    printf("\n! Connection to the server lost\n");
+    return false;
+}
+
+#else
+
+bool CometServer::spawn(void)
+{
+    return false;
+}
+
+void CometServer::serve(void)
+{
+}
+
+bool CometServer::run(void)
+{
+    printf("! The server mode is not available under Windows\n");
+    return false;
+}
+
+bool CometServer::runClient(const char *pszSocket, const char *pszFilename)
+{
+    UNUSED(pszSocket);
+    UNUSED(pszFilename);
+    printf("! The server mode is not available under Windows\n");
+    return false;
+}
+
+#endif
@@ -104,16 +104,15 @@ ConsoleEdit::ConsoleEdit(wxWindow *parentT, wxWindowID idT,
     m_pThread = NULL;
     m_pLuaEngine = NULL;
 
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_iPlotCreatedId = 0L;
-        m_bReadDone = false;
-        m_bAskDone = false;
-        m_strRead = uT("");
-        m_iAnswer = -1;
-        m_iRunningLine = -1;
-        m_bGuierrSet = false;
-        m_pMutex->Unlock();
-    }
+    m_pMutex->Lock();
+    m_iPlotCreatedId = 0L;
+    m_bReadDone = false;
+    m_bAskDone = false;
+    m_strRead = uT("");
+    m_iAnswer = -1;
+    m_iRunningLine = -1;
+    m_bGuierrSet = false;
+    m_pMutex->Unlock();
 
     m_bRunning = false;
 
@@ -245,6 +244,10 @@ void ConsoleEdit::saveHistory(void)
 
 ConsoleEdit::~ConsoleEdit()
 {
+    if (m_pCondition) {
+        delete m_pCondition;
+        m_pCondition = NULL;
+    }
     if (m_pMutex) {
         delete m_pMutex;
         m_pMutex = NULL;
@@ -777,13 +780,12 @@ void ConsoleEdit::luaRunScript(void)
     }
     //
 
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bReadDone = false;
-        m_bAskDone = false;
-        m_strRead = uT("");
-        m_iAnswer = -1;
-        m_pMutex->Unlock();
-    }
+    m_pMutex->Lock();
+    m_bReadDone = false;
+    m_bAskDone = false;
+    m_strRead = uT("");
+    m_iAnswer = -1;
+    m_pMutex->Unlock();
 
     ConsoleThread *pThread = NULL;
     try {
@@ -81,74 +81,28 @@ wxString ConsoleThread::readStr(void)
 {
     ConsoleEdit *pEdit = static_cast<ConsoleEdit *>(m_pEdit);
 
-    bool bReadDone = false;
-
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        bReadDone = pEdit->m_bReadDone;
-        pEdit->m_pMutex->Unlock();
-    }
-
     // Wait until the end of the Read function
-    if (bReadDone == false) {
-        while (true) {
-            // Pause 50 ms and try again
-            Tsleep(50);
-            if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-                bReadDone = pEdit->m_bReadDone;
-                pEdit->m_pMutex->Unlock();
-            }
-            if (bReadDone) {
-                break;
-            }
-        }
+    wxMutexLocker lockT(*(pEdit->m_pMutex));
+    while (pEdit->m_bReadDone == false) {
+        pEdit->m_pCondition->Wait();
     }
+    pEdit->m_bReadDone = false;
 
-    wxString strT = uT("");
-
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        strT = pEdit->m_strRead;
-        pEdit->m_pMutex->Unlock();
-    }
-
-    return strT;
+    return pEdit->m_strRead;
 }
 
 int ConsoleThread::getAnswer(void)
 {
     ConsoleEdit *pEdit = static_cast<ConsoleEdit *>(m_pEdit);
 
-    bool bAskDone = false;
-
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        bAskDone = pEdit->m_bAskDone;
-        pEdit->m_pMutex->Unlock();
-    }
-
-    // Wait until the end of the Read function
-    if (bAskDone == false) {
-        while (true) {
-            // Pause 50 ms and try again
-            Tsleep(50);
-
-            if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-                bAskDone = pEdit->m_bAskDone;
-                pEdit->m_pMutex->Unlock();
-            }
-
-            if (bAskDone) {
-                break;
-            }
-        }
-    }
-
-    int iAnswer = -1;
-
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        iAnswer = pEdit->m_iAnswer;
-        pEdit->m_pMutex->Unlock();
+    // Wait until the end of the Ask function
+    wxMutexLocker lockT(*(pEdit->m_pMutex));
+    while (pEdit->m_bAskDone == false) {
+        pEdit->m_pCondition->Wait();
     }
+    pEdit->m_bAskDone = false;
 
-    return iAnswer;
+    return pEdit->m_iAnswer;
 }
 
 void ConsoleThread::OnExit()
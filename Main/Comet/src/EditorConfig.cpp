@@ -15,13 +15,14 @@
 
 #include "ScriptEdit.h"
 #include "EditorConfig.h"
+#include "SaveThread.h"
 #include "CometApp.h"
 
 #define CONFIG_MAXLINES 2048
 
 int EditorConfig::SECTIONCOUNT = 13;
 int EditorConfig::SECTIONSIZE[] = {
-    21,
+    23,
     6,
     6,
     6,
@@ -72,7 +73,8 @@ char_t const *const EditorConfig::KEYCOMMON[] = {
     uT("EnableLongLine"), uT("LongLine"),
     uT("MarkerColorModified"), uT("MarkerColorSaved"),
     uT("MarkerColorFind"), uT("MarkerColorError"),
-    uT("ReloadDelay"),
+    uT("ReloadDelay"), uT("SaveDurability"),
+    uT("UndoMemory"), uT("UndoSpill"),
     NULL
 };
 
@@ -116,6 +118,9 @@ void EditorConfig::copy(ScintillaPrefs &tScintillaPrefsDest, const ScintillaPref
     tScintillaPrefsDest.common.marckerColorError = tScintillaPrefsSrc.common.marckerColorError;
 
     tScintillaPrefsDest.common.reloadDelay = tScintillaPrefsSrc.common.reloadDelay;
+    tScintillaPrefsDest.common.saveDurability = tScintillaPrefsSrc.common.saveDurability;
+    tScintillaPrefsDest.common.undoMemory = tScintillaPrefsSrc.common.undoMemory;
+    tScintillaPrefsDest.common.undoSpill = tScintillaPrefsSrc.common.undoSpill;
 
     int ii;
 
@@ -481,6 +486,29 @@ bool EditorConfig::load(const char_t *pszFilename, ScintillaPrefs &tScintillaPre
         }
     }
 
+    if (getValue(uT("Common"), uT("SaveDurability"), szTmp)) {
+        iT = (int)wxStrtol((const char_t *)szTmp, (char_t **)NULL, 10);
+        if ((iT >= SAVE_DURABILITY_DIRECT) && (iT <= SAVE_DURABILITY_LAST)) {
+            tScintillaPrefs.common.saveDurability = iT;
+        }
+    }
+
+    if (getValue(uT("Common"), uT("UndoMemory"), szTmp)) {
+        iT = (int)wxStrtol((const char_t *)szTmp, (char_t **)NULL, 10);
+        if ((iT >= 0) && (iT <= UNDO_MEMORY_MAX)) {
+            tScintillaPrefs.common.undoMemory = iT;
+        }
+    }
+
+    if (getValue(uT("Common"), uT("UndoSpill"), szTmp)) {
+        if (wxStrcmp(uT("0"), (const char_t *)szTmp) == 0) {
+            tScintillaPrefs.common.undoSpill = false;
+        }
+        else if (wxStrcmp(uT("1"), (const char_t *)szTmp) == 0) {
+            tScintillaPrefs.common.undoSpill = true;
+        }
+    }
+
     if (getValue(uT("Common"), uT("MarkerColorModified"), szTmp)) {
         iT = (int)wxStrtoul((const char_t *)szTmp, (char_t **)NULL, 16);
         tScintillaPrefs.common.marckerColorModified = iT;
@@ -660,6 +688,14 @@ bool EditorConfig::save(const char_t *pszFilename, const ScintillaPrefs &tScinti
     Tsnprintf(szValue, LM_STRSIZEN - 1, uT("%d"), tScintillaPrefs.common.reloadDelay);
     setValue(uT("Common"), uT("ReloadDelay"), (const char_t *)szValue);
 
+    Tsnprintf(szValue, LM_STRSIZEN - 1, uT("%d"), tScintillaPrefs.common.saveDurability);
+    setValue(uT("Common"), uT("SaveDurability"), (const char_t *)szValue);
+
+    Tsnprintf(szValue, LM_STRSIZEN - 1, uT("%d"), tScintillaPrefs.common.undoMemory);
+    setValue(uT("Common"), uT("UndoMemory"), (const char_t *)szValue);
+
+    setValue(uT("Common"), uT("UndoSpill"), tScintillaPrefs.common.undoSpill ? uT("1") : uT("0"));
+
     setValue(uT("Common"), uT("EnableLongLine"), tScintillaPrefs.common.longLineOnEnable ? uT("1") : uT("0"));
     Tsnprintf(szValue, LM_STRSIZEN - 1, uT("%d"), tScintillaPrefs.common.longLine);
     setValue(uT("Common"), uT("LongLine"), (const char_t *)szValue);
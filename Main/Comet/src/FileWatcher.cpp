@@ -0,0 +1,449 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#include "Identifiers.h"
+
+#include "CometApp.h"
+#include "CometFrame.h"
+#include "FileWatcher.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/inotify.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <poll.h>
+#endif
+
+// xxHash64 primes
+static const uint64_t XXH_PRIME64_1 = 11400714785074694791ULL;
+static const uint64_t XXH_PRIME64_2 = 14029467366897019727ULL;
+static const uint64_t XXH_PRIME64_3 = 1609587929392839161ULL;
+static const uint64_t XXH_PRIME64_4 = 9650029242287828579ULL;
+static const uint64_t XXH_PRIME64_5 = 2870177450012600261ULL;
+
+static inline uint64_t xxhRotl(uint64_t xx, int rr)
+{
+    return (xx << rr) | (xx >> (64 - rr));
+}
+
+// The hash is only compared within the same session: the native byte order is used
+static inline uint64_t xxhRead64(const unsigned char *pp)
+{
+    uint64_t vv;
+    memcpy(&vv, pp, sizeof(uint64_t));
+    return vv;
+}
+
+static inline uint32_t xxhRead32(const unsigned char *pp)
+{
+    uint32_t vv;
+    memcpy(&vv, pp, sizeof(uint32_t));
+    return vv;
+}
+
+static inline uint64_t xxhRound(uint64_t acc, uint64_t input)
+{
+    acc += input * XXH_PRIME64_2;
+    acc = xxhRotl(acc, 31);
+    acc *= XXH_PRIME64_1;
+    return acc;
+}
+
+static inline uint64_t xxhMergeRound(uint64_t acc, uint64_t val)
+{
+    val = xxhRound(0, val);
+    acc ^= val;
+    acc = (acc * XXH_PRIME64_1) + XXH_PRIME64_4;
+    return acc;
+}
+
+uint64_t FileWatcher::hashBuffer(const void *pBuffer, size_t iSize)
+{
+    const unsigned char *pp = (const unsigned char *)pBuffer;
+    const unsigned char *const pEnd = pp + iSize;
+    uint64_t h64;
+
+    if (iSize >= 32) {
+        const unsigned char *const pLimit = pEnd - 32;
+        uint64_t v1 = XXH_PRIME64_1 + XXH_PRIME64_2;
+        uint64_t v2 = XXH_PRIME64_2;
+        uint64_t v3 = 0;
+        uint64_t v4 = 0 - XXH_PRIME64_1;
+        do {
+            v1 = xxhRound(v1, xxhRead64(pp));
+            pp += 8;
+            v2 = xxhRound(v2, xxhRead64(pp));
+            pp += 8;
+            v3 = xxhRound(v3, xxhRead64(pp));
+            pp += 8;
+            v4 = xxhRound(v4, xxhRead64(pp));
+            pp += 8;
+        } while (pp <= pLimit);
+
+        h64 = xxhRotl(v1, 1) + xxhRotl(v2, 7) + xxhRotl(v3, 12) + xxhRotl(v4, 18);
+        h64 = xxhMergeRound(h64, v1);
+        h64 = xxhMergeRound(h64, v2);
+        h64 = xxhMergeRound(h64, v3);
+        h64 = xxhMergeRound(h64, v4);
+    }
+    else {
+        h64 = XXH_PRIME64_5;
+    }
+
+    h64 += (uint64_t)iSize;
+
+    while ((pp + 8) <= pEnd) {
+        h64 ^= xxhRound(0, xxhRead64(pp));
+        h64 = (xxhRotl(h64, 27) * XXH_PRIME64_1) + XXH_PRIME64_4;
+        pp += 8;
+    }
+    if ((pp + 4) <= pEnd) {
+        h64 ^= (uint64_t)(xxhRead32(pp)) * XXH_PRIME64_1;
+        h64 = (xxhRotl(h64, 23) * XXH_PRIME64_2) + XXH_PRIME64_3;
+        pp += 4;
+    }
+    while (pp < pEnd) {
+        h64 ^= (*pp) * XXH_PRIME64_5;
+        h64 = xxhRotl(h64, 11) * XXH_PRIME64_1;
+        pp++;
+    }
+
+    h64 ^= h64 >> 33;
+    h64 *= XXH_PRIME64_2;
+    h64 ^= h64 >> 29;
+    h64 *= XXH_PRIME64_3;
+    h64 ^= h64 >> 32;
+
+    return h64;
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifndef WIN32
+    if (m_iFd >= 0) {
+        close(m_iFd);
+        m_iFd = -1;
+    }
+    for (int ii = 0; ii < 2; ii++) {
+        if (m_iStopFd[ii] >= 0) {
+            close(m_iStopFd[ii]);
+            m_iStopFd[ii] = -1;
+        }
+    }
+#endif
+
+    if (m_pMutex) {
+        delete m_pMutex;
+        m_pMutex = NULL;
+    }
+}
+
+wxThreadError FileWatcher::Create(void *pFrame)
+{
+#ifdef WIN32
+
+    (void)pFrame;
+    return wxTHREAD_NO_RESOURCE;
+
+#else
+
+    if (pFrame == NULL) {
+        return wxTHREAD_MISC_ERROR;
+    }
+
+    m_pFrame = pFrame;
+
+    m_pMutex = new (std::nothrow) wxMutex();
+    if (m_pMutex == NULL) {
+        return wxTHREAD_NO_RESOURCE;
+    }
+
+    m_iFd = inotify_init();
+    if (m_iFd < 0) {
+        return wxTHREAD_NO_RESOURCE;
+    }
+
+    if (pipe(m_iStopFd) != 0) {
+        m_iStopFd[0] = -1;
+        m_iStopFd[1] = -1;
+        return wxTHREAD_NO_RESOURCE;
+    }
+
+    return wxThread::Create();
+
+#endif
+}
+
+void FileWatcher::stop(void)
+{
+    m_bStop = true;
+
+#ifndef WIN32
+    if (m_iStopFd[1] >= 0) {
+        const char cT = 0;
+        while ((write(m_iStopFd[1], &cT, 1) < 0) && (errno == EINTR)) {
+        }
+    }
+#endif
+}
+
+#ifndef WIN32
+// Temporary file written by SaveThread: ".comet" and the six characters of mkstemp
+static bool isSaveTemp(const char *pszNameA)
+{
+    if ((strncmp(pszNameA, ".comet", 6) != 0) || (strlen(pszNameA) != 12)) {
+        return false;
+    }
+    for (int ii = 6; ii < 12; ii++) {
+        const char cT = pszNameA[ii];
+        if (((cT < 'a') || (cT > 'z')) && ((cT < 'A') || (cT > 'Z')) && ((cT < '0') || (cT > '9'))) {
+            return false;
+        }
+    }
+    return true;
+}
+#endif
+
+void FileWatcher::setDirs(const wxArrayString &arrDirs)
+{
+#ifndef WIN32
+
+    if ((m_iFd < 0) || (m_pMutex == NULL)) {
+        return;
+    }
+
+    wxMutexLocker lockT(*m_pMutex);
+
+    char szDirA[FILEWATCH_MAXDIRS][LM_STRSIZEW];
+    int iCount = 0;
+    const int iDirs = (const int)(arrDirs.GetCount());
+    for (int ii = 0; (ii < iDirs) && (iCount < FILEWATCH_MAXDIRS); ii++) {
+        // ::ANSI::    NOT::UNICODE::
+        memset(szDirA[iCount], 0, LM_STRSIZEW * sizeof(char));
+        strncpy(szDirA[iCount], LM_U8STR(arrDirs[ii]), LM_STRSIZEW - 1);
+        size_t iLen = strlen(szDirA[iCount]);
+        while ((iLen > 1) && (szDirA[iCount][iLen - 1] == '/')) {
+            szDirA[iCount][--iLen] = '\0';
+        }
+        if (iLen < 1) {
+            continue;
+        }
+        bool bFound = false;
+        for (int jj = 0; jj < iCount; jj++) {
+            if (strcmp(szDirA[jj], szDirA[iCount]) == 0) {
+                bFound = true;
+                break;
+            }
+        }
+        if (false == bFound) {
+            ++iCount;
+        }
+    }
+
+    // Remove the directories no longer needed...
+    int jj = 0;
+    for (int ii = 0; ii < m_iDirCount; ii++) {
+        bool bKeep = false;
+        for (int kk = 0; kk < iCount; kk++) {
+            if (strcmp(m_szDirA[ii], szDirA[kk]) == 0) {
+                bKeep = true;
+                break;
+            }
+        }
+        if (false == bKeep) {
+            inotify_rm_watch(m_iFd, m_iWatch[ii]);
+            continue;
+        }
+        if (jj != ii) {
+            m_iWatch[jj] = m_iWatch[ii];
+            strcpy(m_szDirA[jj], m_szDirA[ii]);
+        }
+        ++jj;
+    }
+    m_iDirCount = jj;
+
+    // ... and add the new ones
+    for (int kk = 0; (kk < iCount) && (m_iDirCount < FILEWATCH_MAXDIRS); kk++) {
+        bool bFound = false;
+        for (int ii = 0; ii < m_iDirCount; ii++) {
+            if (strcmp(m_szDirA[ii], szDirA[kk]) == 0) {
+                bFound = true;
+                break;
+            }
+        }
+        if (bFound) {
+            continue;
+        }
+        int iWatch = inotify_add_watch(m_iFd, szDirA[kk], IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_CREATE | IN_DELETE | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+        if (iWatch < 0) {
+            continue;
+        }
+        m_iWatch[m_iDirCount] = iWatch;
+        strcpy(m_szDirA[m_iDirCount], szDirA[kk]);
+        ++m_iDirCount;
+    }
+
+#else
+
+    (void)arrDirs;
+
+#endif
+}
+
+// Internal function (no error check)
+void FileWatcher::addPending(const char *pszPathA)
+{
+    size_t iLen = strlen(pszPathA);
+    if ((iLen < 1) || ((m_iPendingLen + iLen + 2) >= FILEWATCH_BUFFERSIZE)) {
+        return;
+    }
+
+    // Same path changed several times: sent once
+    const char *pszT = m_szPendingA;
+    while ((pszT = strstr(pszT, pszPathA)) != NULL) {
+        if (((pszT == m_szPendingA) || (*(pszT - 1) == '\n')) && (pszT[iLen] == '\n')) {
+            return;
+        }
+        pszT += iLen;
+    }
+
+    memcpy(m_szPendingA + m_iPendingLen, pszPathA, iLen * sizeof(char));
+    m_iPendingLen += iLen;
+    m_szPendingA[m_iPendingLen++] = '\n';
+    m_szPendingA[m_iPendingLen] = '\0';
+}
+
+// Internal function (no error check)
+void FileWatcher::sendPending(void)
+{
+    if (m_iPendingLen < 1) {
+        return;
+    }
+
+    CometFrame *pFrame = (CometFrame *)m_pFrame;
+    wxCommandEvent eventT(wxEVT_COMMAND_TEXT_UPDATED, ID_THREAD_FILEWATCH);
+    eventT.SetString(wxString(m_szPendingA, wxConvUTF8));
+    pFrame->GetEventHandler()->AddPendingEvent(eventT);
+
+    m_iPendingLen = 0;
+    m_szPendingA[0] = '\0';
+}
+
+wxThread::ExitCode FileWatcher::Entry()
+{
+#ifndef WIN32
+
+    if ((m_pFrame == NULL) || (m_iFd < 0) || (m_iStopFd[0] < 0) || (m_pMutex == NULL)) {
+        return 0;
+    }
+
+    // inotify events are aligned on struct inotify_event
+    char szEventA[LM_STRSIZEW * 4] __attribute__((aligned(__alignof__(struct inotify_event))));
+    char szPathA[LM_STRSIZEW * 2];
+
+    struct timeval tvFirst, tvLast, tvNow;
+    memset(&tvFirst, 0, sizeof(struct timeval));
+    memset(&tvLast, 0, sizeof(struct timeval));
+
+    while ((false == m_bStop) && (false == TestDestroy())) {
+
+        // Blocking until an event or stop, or until the pending changes are to be sent
+        int iTimeout = -1;
+        if (m_iPendingLen > 0) {
+            gettimeofday(&tvNow, NULL);
+            long iSinceLast = (long)((tvNow.tv_sec - tvLast.tv_sec) * 1000L + (tvNow.tv_usec - tvLast.tv_usec) / 1000L);
+            long iSinceFirst = (long)((tvNow.tv_sec - tvFirst.tv_sec) * 1000L + (tvNow.tv_usec - tvFirst.tv_usec) / 1000L);
+            long iWait = FILEWATCH_DELAY - iSinceLast;
+            if ((FILEWATCH_DELAYMAX - iSinceFirst) < iWait) {
+                iWait = FILEWATCH_DELAYMAX - iSinceFirst;
+            }
+            iTimeout = (iWait > 0) ? (int)iWait : 0;
+        }
+
+        struct pollfd pfd[2];
+        pfd[0].fd = m_iFd;
+        pfd[0].events = POLLIN;
+        pfd[0].revents = 0;
+        pfd[1].fd = m_iStopFd[0];
+        pfd[1].events = POLLIN;
+        pfd[1].revents = 0;
+        int iret = poll(pfd, 2, iTimeout);
+        if ((iret < 0) && (errno != EINTR)) {
+            break;
+        }
+        if ((iret > 0) && ((pfd[1].revents & POLLIN) != 0)) {
+            break;
+        }
+
+        if ((iret > 0) && ((pfd[0].revents & POLLIN) != 0)) {
+            ssize_t iRead = read(m_iFd, szEventA, sizeof(szEventA));
+            if (iRead > 0) {
+                bool bPendingBefore = (m_iPendingLen > 0);
+                m_pMutex->Lock();
+                for (char *pszT = szEventA; pszT < (szEventA + iRead);) {
+                    const struct inotify_event *pEvent = (const struct inotify_event *)pszT;
+                    pszT += sizeof(struct inotify_event) + pEvent->len;
+                    if ((pEvent->mask & IN_IGNORED) != 0) {
+                        continue;
+                    }
+                    int iDir = -1;
+                    for (int ii = 0; ii < m_iDirCount; ii++) {
+                        if (m_iWatch[ii] == pEvent->wd) {
+                            iDir = ii;
+                            break;
+                        }
+                    }
+                    if (iDir < 0) {
+                        continue;
+                    }
+                    if ((pEvent->len > 0) && (pEvent->name[0] != '\0')) {
+                        // Temporary files written by SaveThread: only the final rename matters
+                        if (isSaveTemp(pEvent->name)) {
+                            continue;
+                        }
+                        snprintf(szPathA, LM_STRSIZEW * 2 - 1, "%s/%s", m_szDirA[iDir], pEvent->name);
+                        addPending(szPathA);
+                    }
+                    else {
+                        addPending(m_szDirA[iDir]);
+                    }
+                }
+                m_pMutex->Unlock();
+                gettimeofday(&tvLast, NULL);
+                if ((false == bPendingBefore) && (m_iPendingLen > 0)) {
+                    tvFirst = tvLast;
+                }
+            }
+        }
+
+        if (m_iPendingLen > 0) {
+            gettimeofday(&tvNow, NULL);
+            long iSinceLast = (long)((tvNow.tv_sec - tvLast.tv_sec) * 1000L + (tvNow.tv_usec - tvLast.tv_usec) / 1000L);
+            long iSinceFirst = (long)((tvNow.tv_sec - tvFirst.tv_sec) * 1000L + (tvNow.tv_usec - tvFirst.tv_usec) / 1000L);
+            if ((iSinceLast >= FILEWATCH_DELAY) || (iSinceFirst >= FILEWATCH_DELAYMAX)) {
+                sendPending();
+            }
+        }
+    }
+
+#endif
+
+    return 0;
+}
@@ -0,0 +1,250 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#include "Identifiers.h"
+
+#include "FindEngine.h"
+
+#include <wx/stc/stc.h>
+
+#include <string.h>
+#include <ctype.h>
+
+// Scintilla default character classes (UTF-8: bytes >= 0x80 are word characters)
+#define FINDENGINE_CCSPACE   0
+#define FINDENGINE_CCNEWLINE 1
+#define FINDENGINE_CCWORD    2
+#define FINDENGINE_CCPUNCT   3
+
+static inline int findCharClass(unsigned char ch)
+{
+    if ((ch == '\r') || (ch == '\n')) {
+        return FINDENGINE_CCNEWLINE;
+    }
+    if ((ch < 0x20) || (ch == ' ')) {
+        return FINDENGINE_CCSPACE;
+    }
+    if ((ch >= 0x80) || isalnum(ch) || (ch == '_')) {
+        return FINDENGINE_CCWORD;
+    }
+    return FINDENGINE_CCPUNCT;
+}
+
+static bool findSetItemPart(const wxString &strC, char *pszOut, int *piLen)
+{
+    const wxWX2MBbuf bufC = wx2stc(strC);
+    const char *pszC = (const char *)bufC;
+    if (pszC == NULL) {
+        return false;
+    }
+    const int iLen = (int)strlen(pszC);
+    if ((iLen < 1) || (iLen >= FINDENGINE_ITEMSIZE)) {
+        return false;
+    }
+    memcpy(pszOut, pszC, (size_t)iLen);
+    pszOut[iLen] = '\0';
+    *piLen = iLen;
+    return true;
+}
+
+bool FindEngine::compile(const wxString &strFind, int iStyle)
+{
+    reset();
+
+    if (strFind.IsEmpty() || ((iStyle & wxSTC_FIND_REGEXP) != 0)) {
+        return false;
+    }
+
+    const wxWX2MBbuf bufFind = wx2stc(strFind);
+    const char *pszFind = (const char *)bufFind;
+    if ((pszFind == NULL) || (*pszFind == '\0')) {
+        return false;
+    }
+    m_strFindA = pszFind;
+    m_iMinLen = (int)(m_strFindA.length());
+
+    if ((iStyle & wxSTC_FIND_MATCHCASE) == 0) {
+        // Case fold the pattern, character by character
+        const size_t iLen = strFind.Length();
+        int iMinLen = 0;
+        for (size_t ii = 0; ii < iLen; ii++) {
+            size_t nn = 1;
+            const unsigned int iChar = (unsigned int)(strFind[ii]);
+            if ((sizeof(wxChar) == 2) && (iChar >= 0xD800) && (iChar < 0xDC00) && ((ii + 1) < iLen)) {
+                // UTF-16 surrogate pair
+                nn = 2;
+            }
+            const wxString strC = strFind.Mid(ii, nn);
+            ii += nn - 1;
+
+            FindEngineItem item;
+            if ((findSetItemPart(strC.Lower(), item.lower, &(item.lowerLen)) == false) ||
+                (findSetItemPart(strC.Upper(), item.upper, &(item.upperLen)) == false)) {
+                if (findSetItemPart(strC, item.lower, &(item.lowerLen)) == false) {
+                    reset();
+                    return false;
+                }
+                memcpy(item.upper, item.lower, sizeof(item.lower));
+                item.upperLen = item.lowerLen;
+            }
+            iMinLen += (item.lowerLen < item.upperLen) ? item.lowerLen : item.upperLen;
+            m_arItem.push_back(item);
+        }
+        if (m_arItem.empty()) {
+            reset();
+            return false;
+        }
+        m_iMinLen = iMinLen;
+    }
+
+    m_strFind = strFind;
+    m_iStyle = iStyle;
+    m_bCompiled = true;
+    return true;
+}
+
+bool FindEngine::matchAt(const char *pszBuf, int iBufStart, int iPos, int iTo, int *piEnd) const
+{
+    if ((m_iStyle & wxSTC_FIND_MATCHCASE) != 0) {
+        const int iLen = (int)(m_strFindA.length());
+        if ((iPos + iLen) > iTo) {
+            return false;
+        }
+        if (memcmp(pszBuf + (iPos - iBufStart), m_strFindA.data(), (size_t)iLen) != 0) {
+            return false;
+        }
+        *piEnd = iPos + iLen;
+        return true;
+    }
+
+    int iEnd = iPos;
+    const size_t iCount = m_arItem.size();
+    for (size_t ii = 0; ii < iCount; ii++) {
+        const FindEngineItem &item = m_arItem[ii];
+        const char *pch = pszBuf + (iEnd - iBufStart);
+        if (((iEnd + item.lowerLen) <= iTo) && (memcmp(pch, item.lower, (size_t)(item.lowerLen)) == 0)) {
+            iEnd += item.lowerLen;
+        }
+        else if (((iEnd + item.upperLen) <= iTo) && (memcmp(pch, item.upper, (size_t)(item.upperLen)) == 0)) {
+            iEnd += item.upperLen;
+        }
+        else {
+            return false;
+        }
+    }
+    *piEnd = iEnd;
+    return true;
+}
+
+bool FindEngine::isWordStart(const char *pszBuf, int iBufStart, int iPos) const
+{
+    if ((iPos <= 0) || (iPos <= iBufStart)) {
+        return true;
+    }
+    const int cc = findCharClass((unsigned char)(pszBuf[iPos - iBufStart]));
+    return ((cc == FINDENGINE_CCWORD) || (cc == FINDENGINE_CCPUNCT)) &&
+           (cc != findCharClass((unsigned char)(pszBuf[iPos - 1 - iBufStart])));
+}
+
+bool FindEngine::isWordEnd(const char *pszBuf, int iBufStart, int iBufEnd, int iDocLen, int iPos) const
+{
+    if ((iPos >= iDocLen) || (iPos >= iBufEnd)) {
+        return true;
+    }
+    const int cc = findCharClass((unsigned char)(pszBuf[iPos - 1 - iBufStart]));
+    return ((cc == FINDENGINE_CCWORD) || (cc == FINDENGINE_CCPUNCT)) &&
+           (cc != findCharClass((unsigned char)(pszBuf[iPos - iBufStart])));
+}
+
+int FindEngine::find(const char *pszBuf, int iBufStart, int iBufEnd, int iDocLen,
+                     int iFrom, int iTo, bool bBackward, int *piEnd) const
+{
+    if ((m_bCompiled == false) || (pszBuf == NULL)) {
+        return -1;
+    }
+    if (iFrom < iBufStart) {
+        iFrom = iBufStart;
+    }
+    if (iTo > iBufEnd) {
+        iTo = iBufEnd;
+    }
+    const int iLast = iTo - m_iMinLen;
+    if (iLast < iFrom) {
+        return -1;
+    }
+
+    const bool bMatchCase = ((m_iStyle & wxSTC_FIND_MATCHCASE) != 0);
+    const bool bWholeWord = ((m_iStyle & wxSTC_FIND_WHOLEWORD) != 0);
+    const bool bWordStart = ((m_iStyle & wxSTC_FIND_WORDSTART) != 0);
+
+    // First byte of the pattern, to skip quickly
+    const char cFirst = bMatchCase ? m_strFindA[0] : m_arItem[0].lower[0];
+    const char cFirstU = bMatchCase ? cFirst : m_arItem[0].upper[0];
+
+    int iPos = bBackward ? iLast : iFrom;
+    while (bBackward ? (iPos >= iFrom) : (iPos <= iLast)) {
+
+        const char *pch = pszBuf + (iPos - iBufStart);
+        if ((bBackward == false) && bMatchCase) {
+            pch = (const char *)memchr(pch, cFirst, (size_t)(iLast - iPos + 1));
+            if (pch == NULL) {
+                break;
+            }
+            iPos = iBufStart + (int)(pch - pszBuf);
+        }
+
+        int iEnd = iPos;
+        if (((*pch == cFirst) || (*pch == cFirstU)) && matchAt(pszBuf, iBufStart, iPos, iTo, &iEnd)) {
+            bool bMatch = true;
+            if (bWholeWord || bWordStart) {
+                const bool bStart = isWordStart(pszBuf, iBufStart, iPos);
+                bMatch = (bWholeWord && bStart && isWordEnd(pszBuf, iBufStart, iBufEnd, iDocLen, iEnd)) || (bWordStart && bStart);
+            }
+            if (bMatch) {
+                if (piEnd) {
+                    *piEnd = iEnd;
+                }
+                return iPos;
+            }
+        }
+
+        iPos += bBackward ? -1 : 1;
+    }
+
+    return -1;
+}
+
+int FindEngine::findAll(const char *pszBuf, int iBufStart, int iBufEnd, int iDocLen,
+                        int iFrom, int iTo, std::vector<int> *parStart, std::vector<int> *parEnd, int iMax /* = 0*/) const
+{
+    int iCount = 0;
+    int iPos = iFrom, iEnd = iFrom;
+    while (true) {
+        iPos = find(pszBuf, iBufStart, iBufEnd, iDocLen, iPos, iTo, false, &iEnd);
+        if (iPos < 0) {
+            break;
+        }
+        if (parStart) {
+            parStart->push_back(iPos);
+        }
+        if (parEnd) {
+            parEnd->push_back(iEnd);
+        }
+        iCount += 1;
+        if ((iMax > 0) && (iCount >= iMax)) {
+            break;
+        }
+        iPos = (iEnd > iPos) ? iEnd : (iPos + 1);
+    }
+    return iCount;
+}
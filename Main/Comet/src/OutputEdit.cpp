@@ -90,6 +90,10 @@ OutputEdit::OutputEdit(wxWindow *parentT, wxWindowID idT,
 
 OutputEdit::~OutputEdit()
 {
+    if (m_pCondition) {
+        delete m_pCondition;
+        m_pCondition = NULL;
+    }
     if (m_pMutex) {
         delete m_pMutex;
         m_pMutex = NULL;
@@ -0,0 +1,260 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#include "Identifiers.h"
+
+#include "CometApp.h"
+#include "SaveThread.h"
+#include "FileWatcher.h"
+#include "ScriptEdit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef WIN32
+#include <windows.h>
+#include <io.h>
+#include <wx/msw/winundef.h>
+#else
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <libgen.h>
+#endif
+
+#ifdef WIN32
+
+// Internal function (no error check)
+static bool writeChunks(FILE *fp, const char *pszBufferA, size_t iBufferSize)
+{
+    size_t iDone = 0;
+    while (iDone < iBufferSize) {
+        size_t iChunk = iBufferSize - iDone;
+        if (iChunk > SAVE_CHUNKSIZE) {
+            iChunk = SAVE_CHUNKSIZE;
+        }
+        if (fwrite(pszBufferA + iDone, sizeof(char), iChunk, fp) != iChunk) {
+            return false;
+        }
+        iDone += iChunk;
+    }
+    return true;
+}
+
+#else
+
+// Internal function (no error check)
+static bool writeChunks(int fd, const char *pszBufferA, size_t iBufferSize)
+{
+    size_t iDone = 0;
+    while (iDone < iBufferSize) {
+        size_t iChunk = iBufferSize - iDone;
+        if (iChunk > SAVE_CHUNKSIZE) {
+            iChunk = SAVE_CHUNKSIZE;
+        }
+        ssize_t iWritten = write(fd, pszBufferA + iDone, iChunk);
+        if (iWritten < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        iDone += (size_t)iWritten;
+    }
+    return true;
+}
+
+#endif
+
+bool SaveThread::saveBuffer(const wxString &strFilename, const char *pszBufferA, size_t iBufferSize, int iDurability)
+{
+    if (strFilename.IsEmpty() || ((pszBufferA == NULL) && (iBufferSize > 0))) {
+        return false;
+    }
+
+#ifdef WIN32
+
+    const char_t *pszFilename = LM_CSTR(strFilename);
+
+    if (SAVE_DURABILITY_DIRECT == iDurability) {
+        FILE *fpRaw = Tfopen(pszFilename, uT("wb"));
+        if (fpRaw == NULL) {
+            return false;
+        }
+        bool bSaved = writeChunks(fpRaw, pszBufferA, iBufferSize);
+        bSaved = (fclose(fpRaw) == 0) && bSaved;
+        return bSaved;
+    }
+
+    // temporary file in the same directory, so that MoveFileEx does not copy across volumes
+    wxString strTemp = strFilename;
+    strTemp += uT(".cometw~");
+    const char_t *pszTemp = LM_CSTR(strTemp);
+
+    FILE *fpRaw = Tfopen(pszTemp, uT("wb"));
+    if (fpRaw == NULL) {
+        return false;
+    }
+    bool bSaved = writeChunks(fpRaw, pszBufferA, iBufferSize);
+    if (bSaved && (SAVE_DURABILITY_SYNC == iDurability)) {
+        bSaved = (fflush(fpRaw) == 0) && (_commit(_fileno(fpRaw)) == 0);
+    }
+    bSaved = (fclose(fpRaw) == 0) && bSaved;
+
+    if (bSaved) {
+        DWORD dwFlags = MOVEFILE_REPLACE_EXISTING;
+        if (SAVE_DURABILITY_SYNC == iDurability) {
+            dwFlags |= MOVEFILE_WRITE_THROUGH;
+        }
+        bSaved = (MoveFileExW(pszTemp, pszFilename, dwFlags) != FALSE);
+    }
+    if (bSaved == false) {
+        _wunlink(pszTemp);
+    }
+    return bSaved;
+
+#else
+
+    // ::ANSI::    NOT::UNICODE::
+    char szFilenameA[PATH_MAX + 1];
+    memset(szFilenameA, 0, (PATH_MAX + 1) * sizeof(char));
+    strncpy(szFilenameA, LM_U8STR(strFilename), PATH_MAX);
+
+    struct stat stbuf;
+    bool bExists = (stat(szFilenameA, &stbuf) == 0);
+    if (bExists && (!S_ISREG(stbuf.st_mode))) {
+        return false;
+    }
+
+    if (SAVE_DURABILITY_DIRECT == iDurability) {
+        int fd = open(szFilenameA, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (fd < 0) {
+            return false;
+        }
+        bool bSaved = writeChunks(fd, pszBufferA, iBufferSize);
+        bSaved = (close(fd) == 0) && bSaved;
+        return bSaved;
+    }
+
+    // Replace the target of a symbolic link, not the link itself
+    char szTargetA[PATH_MAX + 1];
+    memset(szTargetA, 0, (PATH_MAX + 1) * sizeof(char));
+    if ((bExists == false) || (realpath(szFilenameA, szTargetA) == NULL)) {
+        strcpy(szTargetA, szFilenameA);
+    }
+
+    // Read-only files are not silently replaced by rename
+    if (bExists && (access(szTargetA, W_OK) != 0)) {
+        return false;
+    }
+
+    char szDirA[PATH_MAX + 1];
+    strcpy(szDirA, szTargetA);
+    const char *pszDirA = dirname(szDirA);
+
+    char szTempA[PATH_MAX + 1];
+    memset(szTempA, 0, (PATH_MAX + 1) * sizeof(char));
+    if (snprintf(szTempA, PATH_MAX, "%s/.cometXXXXXX", pszDirA) >= PATH_MAX) {
+        return false;
+    }
+
+    int fd = mkstemp(szTempA);
+    if (fd < 0) {
+        return false;
+    }
+
+    // mkstemp creates the file with 0600: keep the original permissions (or the umask default)
+    if (bExists) {
+        fchmod(fd, stbuf.st_mode & 07777);
+        if (fchown(fd, stbuf.st_uid, stbuf.st_gid) != 0) {
+            // not owner: the file is saved with the current user as owner
+        }
+    }
+    else {
+        mode_t iMask = umask(0);
+        umask(iMask);
+        fchmod(fd, 0666 & ~iMask);
+    }
+
+    bool bSaved = writeChunks(fd, pszBufferA, iBufferSize);
+    if (bSaved && (SAVE_DURABILITY_SYNC == iDurability)) {
+        bSaved = (fsync(fd) == 0);
+    }
+    bSaved = (close(fd) == 0) && bSaved;
+
+    if (bSaved) {
+        bSaved = (rename(szTempA, szTargetA) == 0);
+    }
+    if (bSaved == false) {
+        unlink(szTempA);
+        return false;
+    }
+
+    if (SAVE_DURABILITY_SYNC == iDurability) {
+        // Make the rename itself durable
+        int fdDir = open(pszDirA, O_RDONLY);
+        if (fdDir >= 0) {
+            fsync(fdDir);
+            close(fdDir);
+        }
+    }
+
+    return true;
+
+#endif
+}
+
+wxThreadError SaveThread::Create(void *pEdit, char *pszBufferA, size_t iBufferSize, const wxString &strFilename, int iDurability, int iGeneration)
+{
+    if ((pEdit == NULL) || (pszBufferA == NULL)) {
+        return wxTHREAD_MISC_ERROR;
+    }
+
+    m_pEdit = pEdit;
+    m_pszBufferA = pszBufferA;
+    m_iBufferSize = iBufferSize;
+    // Deep copy: wxString is not thread-safe
+    m_strFilename = wxString(LM_CSTR(strFilename));
+    m_iDurability = iDurability;
+    m_iGeneration = iGeneration;
+    m_bSaved = false;
+
+    return wxThread::Create();
+}
+
+wxThread::ExitCode SaveThread::Entry()
+{
+    if ((m_pEdit == NULL) || (m_pszBufferA == NULL)) {
+        return 0;
+    }
+
+    m_bSaved = SaveThread::saveBuffer(m_strFilename, m_pszBufferA, m_iBufferSize, m_iDurability);
+    if (m_bSaved) {
+        m_iHash = FileWatcher::hashBuffer(m_pszBufferA, m_iBufferSize);
+    }
+
+    free(m_pszBufferA);
+    m_pszBufferA = NULL;
+
+    ScriptEdit *pEdit = (ScriptEdit *)m_pEdit;
+    wxCommandEvent eventT(wxEVT_COMMAND_TEXT_UPDATED, ID_THREAD_SAVE);
+    eventT.SetInt(m_bSaved ? 1 : 0);
+    eventT.SetExtraLong((long)m_iGeneration);
+    pEdit->GetEventHandler()->AddPendingEvent(eventT);
+
+    return 0;
+}
@@ -16,6 +16,7 @@
 #include "CometApp.h"
 #include "CometFrame.h"
 #include "ScriptEdit.h"
+#include "FileWatcher.h"
 #include "ScriptPrint.h"
 #include "ScriptThread.h"
 
@@ -54,6 +55,7 @@ BEGIN_EVENT_TABLE(ScriptEdit, CodeEdit)
     EVT_MENU(ID_SCRIPT_REDO, ScriptEdit::OnEditAction)
 
     EVT_MENU(ID_ANALYZE_GOTO, ScriptEdit::OnEditAction)
+    EVT_MENU(ID_SYMBOL_GOTO, ScriptEdit::OnEditAction)
     EVT_MENU(ID_INCLUDE_GOTO, ScriptEdit::OnEditAction)
 
     EVT_MENU(ID_SCRIPT_INSERT_DATE, ScriptEdit::OnEditAction)
@@ -66,6 +68,7 @@ BEGIN_EVENT_TABLE(ScriptEdit, CodeEdit)
     EVT_STC_MARGINCLICK(wxID_ANY, ScriptEdit::OnMarginClick)
     EVT_STC_CHARADDED(wxID_ANY, ScriptEdit::OnCharAdded)
     EVT_STC_MODIFIED(wxID_ANY, ScriptEdit::OnModified)
+    EVT_STC_PAINTED(wxID_ANY, ScriptEdit::OnPainted)
 
     EVT_STC_DWELLSTART(wxID_ANY, ScriptEdit::OnDwellStart)
     EVT_STC_DWELLEND(wxID_ANY, ScriptEdit::OnDwellEnd)
@@ -96,11 +99,16 @@ BEGIN_EVENT_TABLE(ScriptEdit, CodeEdit)
     EVT_COMMAND(ID_THREAD_CURLINE, wxEVT_COMMAND_TEXT_UPDATED, ScriptEdit::OnThreadUpdated)
     EVT_COMMAND(ID_THREAD_BREAKPOINT, wxEVT_COMMAND_TEXT_UPDATED, ScriptEdit::OnThreadUpdated)
     EVT_COMMAND(ID_THREAD_STACK, wxEVT_COMMAND_TEXT_UPDATED, ScriptEdit::OnThreadUpdated)
+    EVT_COMMAND(ID_THREAD_INSPECT, wxEVT_COMMAND_TEXT_UPDATED, ScriptEdit::OnThreadUpdated)
     EVT_COMMAND(ID_THREAD_FINISH, wxEVT_COMMAND_TEXT_UPDATED, ScriptEdit::OnThreadUpdated)
+    EVT_COMMAND(ID_THREAD_SAVE, wxEVT_COMMAND_TEXT_UPDATED, ScriptEdit::OnThreadUpdated)
+    EVT_COMMAND(ID_THREAD_ANALYZE, wxEVT_COMMAND_TEXT_UPDATED, ScriptEdit::OnThreadUpdated)
 
     EVT_TIMER(TIMER_ID_SCRIPTEDIT, ScriptEdit::OnTimer)
 
     EVT_TIMER(TIMER_ID_SCRIPTEDIT_RELOAD, ScriptEdit::OnTimerReload)
+    EVT_TIMER(TIMER_ID_SCRIPTEDIT_FINDCOUNT, ScriptEdit::OnTimerFindCount)
+    EVT_TIMER(TIMER_ID_SCRIPTEDIT_ANALYZER, ScriptEdit::OnTimerAnalyzer)
 
     EVT_MOUSEWHEEL(ScriptEdit::OnMouseWheel)
 
@@ -123,15 +131,24 @@ ScriptEdit::ScriptEdit(wxWindow *parentT, wxWindowID idT,
     m_bAutoReload = false;
     m_pReloadTimer = NULL;
 
+    m_pSaveThread = NULL;
+    m_iSaveGeneration = 0;
+    m_iSaveDurability = SAVE_DURABILITY_DEFAULT;
+    m_bSaveFailed = false;
+
+    m_iFileHash = 0;
+    m_bFileHash = false;
+
     m_bLinePrev = false;
     m_iLinePrev = -1;
 
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bDebugging = false;
-        m_bDebugIt = false;
-        m_bStopIt = false;
-        m_pMutex->Unlock();
-    }
+    m_pMutex->Lock();
+    m_bDebugging = false;
+    m_bDebugIt = false;
+    m_bStopIt = false;
+    m_iBreakpointGeneration = 0;
+    m_iDebugState = 0;
+    m_pMutex->Unlock();
 
     m_MarkerMargin = 14;
     m_FoldingMargin = 12;
@@ -142,13 +159,23 @@ ScriptEdit::ScriptEdit(wxWindow *parentT, wxWindowID idT,
     m_iBookmarkCount = 0;
     m_iBreakpointCount = 0;
 
-    m_strDebugTrace = wxEmptyString;
+    m_pDebugPause = NULL;
+    m_iDebugRequest = 0;
 
     m_strErrMsg = wxEmptyString;
 
     m_iFindMarkerCount = 0;
     m_iFindIndicCount = 0;
 
+    m_iFindViewStart = m_iFindViewEnd = -1;
+    m_iFindIndicStart = m_iFindIndicEnd = -1;
+
+    m_pFindCountTimer = NULL;
+    m_iFindCount = -1;
+    m_iFindCountRun = 0;
+    m_iFindCountPos = 0;
+    m_bFindCountVerbose = false;
+
     m_bLexerEnforced = false;
 
     m_pProcess = NULL;
@@ -167,7 +194,12 @@ ScriptEdit::ScriptEdit(wxWindow *parentT, wxWindowID idT,
 
     m_pCodeAnalyzer = new (std::nothrow) CodeAnalyzer();
     m_bEnableCodeAnalyzer = true;
+    m_pAnalyzerTimer = NULL;
+    m_bAnalyzerGotoMain = false;
+    m_iAutoCompGeneration = -1;
+    m_AutoComp.enableDocument(true);
     m_strSelectedFunc = wxEmptyString;
+    m_strSelectedSymbol = wxEmptyString;
     m_strFileToOpen = wxEmptyString;
 
     // Accelerators
@@ -212,6 +244,15 @@ ScriptEdit::ScriptEdit(wxWindow *parentT, wxWindowID idT,
 
 ScriptEdit::~ScriptEdit()
 {
+    // the background save owns its snapshot: let it complete
+    waitSave();
+
+    luaDebugClear();
+
+    if (m_pCondition) {
+        delete m_pCondition;
+        m_pCondition = NULL;
+    }
     if (m_pMutex) {
         delete m_pMutex;
         m_pMutex = NULL;
@@ -219,8 +260,20 @@ ScriptEdit::~ScriptEdit()
 
     resetTimerReload();
 
+    if (m_pFindCountTimer) {
+        m_pFindCountTimer->Stop();
+        delete m_pFindCountTimer;
+        m_pFindCountTimer = NULL;
+    }
+
     processKill();
 
+    if (m_pAnalyzerTimer) {
+        m_pAnalyzerTimer->Stop();
+        delete m_pAnalyzerTimer;
+        m_pAnalyzerTimer = NULL;
+    }
+
     if (m_pCodeAnalyzer) {
         delete m_pCodeAnalyzer;
         m_pCodeAnalyzer = NULL;
@@ -245,6 +298,8 @@ bool ScriptEdit::setPrefs(const ScintillaPrefs &tPrefs, bool bInit, bool bInitIn
 
         CodeEdit::initPrefs();
 
+        m_iSaveDurability = m_ScintillaPrefs.common.saveDurability;
+
         SetMarginLeft(6);
         SetMarginRight(6);
 
@@ -300,6 +355,7 @@ void ScriptEdit::OnMouseWheel(wxMouseEvent &tEvent)
 void ScriptEdit::enableStepInto(bool bStepInto)
 {
     m_bStepInto = bStepInto;
+    m_iDebugState += 1;
 
     CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
     if (NULL == pFrame) {
@@ -337,6 +393,14 @@ void ScriptEdit::OnThreadUpdated(wxCommandEvent &tEvent)
         pFrame->Output(tEvent.GetString());
     }
 
+    else if (idT == ID_THREAD_SAVE) {
+        DoSaveFinished((int)(tEvent.GetExtraLong()));
+    }
+
+    else if (idT == ID_THREAD_ANALYZE) {
+        CodeAnalyzerFinished((int)(tEvent.GetExtraLong()));
+    }
+
     else if (idT == ID_THREAD_PRINTERR) {
         int iErrLine = tEvent.GetInt();
         if (pFrame->isOutputLineEmpty()) {
@@ -403,8 +467,11 @@ void ScriptEdit::OnThreadUpdated(wxCommandEvent &tEvent)
 #endif
             pFrame->OutputStatusbar(strT, SIGMAFRAME_TIMER_NONE);
         }
-        m_strDebugTrace = tEvent.GetString();
-        pFrame->UpdateDebugNotebook(this->GetFilename(), m_strDebugTrace);
+        luaDebugPages();
+    }
+
+    else if (idT == ID_THREAD_INSPECT) {
+        luaDebugPages();
     }
 
     else if (idT == ID_THREAD_FINISH) {
@@ -452,6 +519,11 @@ bool ScriptEdit::DoReload(bool bSilent, bool bUserAction)
         return false;
     }
 
+    // Our own save in progress: the new modification time is set when it completes
+    if (isSaving()) {
+        return false;
+    }
+
     wxFileName fname = this->GetFilename();
     if (false == fname.FileExists()) {
         return false;
@@ -468,6 +540,26 @@ bool ScriptEdit::DoReload(bool bSilent, bool bUserAction)
 
     if (changeTime.IsLaterThan(m_ChangeTime)) {
 
+        size_t iFileSize = 0;
+        unsigned char *pszBufferA = ScriptEdit::readFile(fname.GetFullPath(), &iFileSize);
+
+        // Same content (touched, or rewritten without change): nothing to reload
+        if (pszBufferA && m_bFileHash && (FileWatcher::hashBuffer(pszBufferA, iFileSize) == m_iFileHash)) {
+            free(pszBufferA);
+            pszBufferA = NULL;
+            m_ChangeTime = changeTime;
+            if (bUserAction) {
+                wxString strT = uT("'");
+                strT += CometFrame::getLabelFromPath(this->GetFilename());
+                strT += uT("' not modified.");
+                pFrame->OutputStatusbar(strT, SIGMAFRAME_TIMER_SHORT);
+            }
+            if (autoReload() && m_pReloadTimer) {
+                m_pReloadTimer->Start(reloadDelay * 1000);
+            }
+            return false;
+        }
+
         int iret = (autoReload() || bSilent) ? wxYES : wxNO;
         if (wxNO == iret) {
             wxString strLabel1 = uT("Reload");
@@ -506,22 +598,30 @@ bool ScriptEdit::DoReload(bool bSilent, bool bUserAction)
             }
         }
 
+        bool bReloaded = false;
+        time_t prevT = time(NULL);
         if (iret == wxYES) {
-            time_t prevT = time(NULL);
-            if (DoLoadFile(fname.GetFullPath(), false, true, false, false == autoReload())) {
-                if (autoReload()) {
-                    this->DoGotoLine(this->GetLineCount() - 1, false);
-                    if (m_pReloadTimer) {
-                        m_pReloadTimer->Start(m_ScintillaPrefs.common.reloadDelay * 1000);
-                    }
-                }
-                int deltaT = (int)floor(difftime(time(NULL), prevT));
-                if (reloadDelay < (deltaT * 2)) {
-                    reloadDelay = deltaT * 2;
+            // Only the changed lines are replaced (undo history and markers kept), otherwise the whole file is reloaded
+            bReloaded = DoReloadChanges(pszBufferA, iFileSize) || DoLoadFile(fname.GetFullPath(), false, true, false, false == autoReload());
+        }
+        if (pszBufferA) {
+            free(pszBufferA);
+            pszBufferA = NULL;
+        }
+
+        if (bReloaded) {
+            if (autoReload()) {
+                this->DoGotoLine(this->GetLineCount() - 1, false);
+                if (m_pReloadTimer) {
+                    m_pReloadTimer->Start(m_ScintillaPrefs.common.reloadDelay * 1000);
                 }
-                pFrame->OutputStatusbar(fname.GetFullName() + uT(" reloaded"), SIGMAFRAME_TIMER_SHORT);
-                return true;
             }
+            int deltaT = (int)floor(difftime(time(NULL), prevT));
+            if (reloadDelay < (deltaT * 2)) {
+                reloadDelay = deltaT * 2;
+            }
+            pFrame->OutputStatusbar(fname.GetFullName() + uT(" reloaded"), SIGMAFRAME_TIMER_SHORT);
+            return true;
         }
     }
     else {
@@ -576,7 +676,7 @@ void ScriptEdit::OnSetFocus(wxFocusEvent &tEvent)
 
     CodeEdit::OnSetFocus(tEvent);
 
-    pFrame->UpdateDebugNotebook(this->GetFilename(), m_strDebugTrace);
+    pFrame->UpdateDebugNotebook(this->GetFilename(), m_pDebugPause);
 }
 
 void ScriptEdit::updatePage(const wxString &strTitle)
@@ -843,23 +943,26 @@ int ScriptEdit::CodeAnalyzerUpdate(wxComboBox *pCombo, bool bRecreate)
         return 0;
     }
 
-    if (bRecreate) {
-        if (this->isModified()) {
-            wxString strFilename = this->GetFilename();
-            if (this->DoSaveFile(strFilename) == false) {
+    // Only the lines changed since the last analysis are read again, from the buffer
+    // (the results are kept per document, so that switching documents costs nothing)
+    if (bRecreate || m_pCodeAnalyzer->isDirty()) {
+        m_pCodeAnalyzer->setFilename(this->GetFilename());
+        if ((bRecreate == false) && (this->GetLineCount() > ANALYZER_ASYNC_MINLINES) && m_pCodeAnalyzer->analyzeAsync(this)) {
+            // The current list is shown until the analysis is done (see CodeAnalyzerFinished)
+            if (m_pCodeAnalyzer->isFailed()) {
                 updateFindList(pCombo, 0);
                 return 0;
             }
         }
-
-        SigmaBusyCursor waitC;
-        if (this->GetLineCount() > 2048) {
-            waitC.start();
-        }
-        m_pCodeAnalyzer->setFilename(this->GetFilename());
-        if (m_pCodeAnalyzer->analyze() == false) {
-            updateFindList(pCombo, 0);
-            return 0;
+        else {
+            SigmaBusyCursor waitC;
+            if ((m_pCodeAnalyzer->getCount() == 0) && (this->GetLineCount() > ANALYZER_ASYNC_MINLINES)) {
+                waitC.start();
+            }
+            if (m_pCodeAnalyzer->analyze(this) == false) {
+                updateFindList(pCombo, 0);
+                return 0;
+            }
         }
     }
 
@@ -885,9 +988,7 @@ int ScriptEdit::CodeAnalyzerUpdate(wxComboBox *pCombo, bool bRecreate)
         }
 
         arrT.Sort(false);
-        for (int ii = 0; ii < nn; ii++) {
-            pCombo->AppendString(arrT[ii]);
-        }
+        pCombo->Append(arrT);
     }
 
     updateFindList(pCombo, nn);
@@ -895,6 +996,113 @@ int ScriptEdit::CodeAnalyzerUpdate(wxComboBox *pCombo, bool bRecreate)
     return nn;
 }
 
+void ScriptEdit::updateAutoComp(void)
+{
+    CodeEdit::updateAutoComp();
+
+    // Functions: listed by the analyzer (not analyzed here, the timer keeps the list up to date)
+    if ((m_pCodeAnalyzer == NULL) || (m_pCodeAnalyzer->getGeneration() == m_iAutoCompGeneration)) {
+        return;
+    }
+    m_iAutoCompGeneration = m_pCodeAnalyzer->getGeneration();
+
+    std::vector<wxString> vecSymbols;
+    const int iCount = m_pCodeAnalyzer->getCount();
+    for (int ii = 0; ii < iCount; ii++) {
+        wxString strKey = CodeAnalyzer::getKey(wxString(m_pCodeAnalyzer->getName(ii)));
+        if (strKey.Length() >= AUTOCOMP_MINCHARS) {
+            vecSymbols.push_back(strKey);
+        }
+    }
+    m_AutoComp.setSymbols(vecSymbols);
+}
+
+void ScriptEdit::CodeAnalyzerModified(int iPos, int iLinesAdded)
+{
+    if ((m_bEnableCodeAnalyzer == false) || (m_pCodeAnalyzer == NULL)) {
+        return;
+    }
+
+    m_pCodeAnalyzer->modified(LineFromPosition(iPos), iLinesAdded);
+
+    if (m_pAnalyzerTimer == NULL) {
+        try {
+            m_pAnalyzerTimer = new wxTimer(this, TIMER_ID_SCRIPTEDIT_ANALYZER);
+        }
+        catch (...) {
+            m_pAnalyzerTimer = NULL;
+        }
+        if (m_pAnalyzerTimer == NULL) {
+            return;
+        }
+    }
+    m_pAnalyzerTimer->Start(ANALYZER_DELAY, wxTIMER_ONE_SHOT);
+}
+
+void ScriptEdit::OnTimerAnalyzer(wxTimerEvent &tEvent)
+{
+    if (tEvent.GetId() != TIMER_ID_SCRIPTEDIT_ANALYZER) {
+        tEvent.Skip();
+        return;
+    }
+
+    if ((m_bEnableCodeAnalyzer == false) || (m_pCodeAnalyzer == NULL) || (m_pCodeAnalyzer->isDirty() == false)) {
+        return;
+    }
+
+    // The other documents are analyzed when they are activated
+    CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
+    if ((pFrame == NULL) || (pFrame->getActiveEditor() != this)) {
+        return;
+    }
+
+    bool bChanged = false;
+    if (this->GetLineCount() > ANALYZER_ASYNC_MINLINES) {
+        if (m_pCodeAnalyzer->analyzeAsync(this, &bChanged)) {
+            // the list is updated by CodeAnalyzerFinished
+            return;
+        }
+    }
+    else {
+        m_pCodeAnalyzer->analyze(this, &bChanged);
+    }
+    if (bChanged) {
+        pFrame->DoAnalyzerUpdateList(this, false);
+    }
+}
+
+void ScriptEdit::CodeAnalyzerFinished(int iRun)
+{
+    if (m_pCodeAnalyzer == NULL) {
+        return;
+    }
+
+    bool bChanged = false;
+    if (m_pCodeAnalyzer->finish(iRun, &bChanged) == false) {
+        // Already completed by wait
+        return;
+    }
+
+    if (m_bAnalyzerGotoMain) {
+        m_bAnalyzerGotoMain = false;
+        int iMainLine = m_pCodeAnalyzer->getMainLine();
+        // Unless the user moved meanwhile
+        if ((iMainLine >= 0) && (this->GetCurrentPos() == 0)) {
+            DoGotoLine(iMainLine, true);
+        }
+    }
+
+    // Modified while analyzing
+    if (m_pCodeAnalyzer->isDirty() && (m_pAnalyzerTimer != NULL)) {
+        m_pAnalyzerTimer->Start(ANALYZER_DELAY, wxTIMER_ONE_SHOT);
+    }
+
+    CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
+    if (bChanged && (pFrame != NULL) && (pFrame->getActiveEditor() == this)) {
+        pFrame->DoAnalyzerUpdateList(this, false);
+    }
+}
+
 void ScriptEdit::DoEditSelectAll(void)
 {
     SetSelection(0, GetTextLength());
@@ -939,6 +1147,11 @@ void ScriptEdit::DoFoldEnable(bool bEnable)
     m_ScintillaPrefs.common.foldEnable = bEnable;
 
     ShowLines(0, GetLineCount() - 1);
+    SetProperty(uT("fold"), m_ScintillaPrefs.common.foldEnable ? uT("1") : uT("0"));
+    if (m_ScintillaPrefs.common.foldEnable) {
+        // Fold levels were not computed while folding was disabled
+        DoColouriseAsync();
+    }
     SetFoldFlags(m_ScintillaPrefs.common.foldEnable ? wxSTC_FOLDFLAG_LINEAFTER_CONTRACTED : 0);
     SetMarginWidth(m_FoldingID, (m_ScintillaPrefs.common.foldEnable) ? m_FoldingMargin : 0);
     SetMarginSensitive(m_FoldingID, m_ScintillaPrefs.common.foldEnable);
@@ -1233,6 +1446,9 @@ void ScriptEdit::DoScriptAction(int idT)
         case ID_SCRIPT_BREAKPOINT_MOD:
             DoModifyMarker(SCRIPT_MASK_BREAKPOINTBIT);
             break;
+        case ID_SCRIPT_BREAKPOINT_EDIT:
+            DoEditBreakpoint();
+            break;
         case ID_SCRIPT_BREAKPOINT_DELALL:
             DoDeleteAllBreakpoints();
             break;
@@ -1304,6 +1520,8 @@ void ScriptEdit::DoDeleteAllBreakpoints(void)
     MarkerDeleteAll(SCRIPT_MASK_BREAKPOINTBIT);
 
     m_iBreakpointCount = 0;
+
+    luaBreakpoints();
 }
 
 void ScriptEdit::DoShowStats(void)
@@ -1729,6 +1947,8 @@ void ScriptEdit::OnContextMenu(wxContextMenuEvent &tEvent)
 #endif
             popMenu.Append(pItem);
 
+            popMenu.Append(ID_SCRIPT_BREAKPOINT_EDIT, uT("Edit Breakpoint..."), uT("Set the breakpoint condition, hit count or log message"));
+
             if (getBreakpointCount() > 0) {
                 popMenu.Append(ID_SCRIPT_BREAKPOINT_DELALL, uT("Reset Breakpoints"), uT("Remove all breakpoints"));
             }
@@ -1787,8 +2007,9 @@ void ScriptEdit::OnContextMenu(wxContextMenuEvent &tEvent)
     // >> 'goto definition'
 
     int iFuncCount = this->CodeAnalyzerGetCount();
-    if ((strWord.IsEmpty() == false) && (iFuncCount > 0) && ((iLexer == wxSTC_LEX_LUA) || (iLexer == wxSTC_LEX_PYTHON))) {
+    if ((strWord.IsEmpty() == false) && ((iLexer == wxSTC_LEX_LUA) || (iLexer == wxSTC_LEX_PYTHON) || ((iLexer == wxSTC_LEX_CPP) && (LEXERTYPE_FIRST == getLexerType())))) {
         wxString strT = wxString(LM_CSTR(strWord));
+        wxString strName = strT;
         wxString strNx = uT("Go To '");
         if (iWordEnd > (iWordStart + LM_STRSIZET)) {
             strNx += strT.Mid(0, LM_STRSIZET);
@@ -1799,24 +2020,36 @@ void ScriptEdit::OnContextMenu(wxContextMenuEvent &tEvent)
         }
         strNx += uT("' Definition");
         strT += uT("(");
-        int indexT = this->CodeAnalyzerGetIndex(LM_CSTR(strT), false);
+        int indexT = (iFuncCount > 0) ? this->CodeAnalyzerGetIndex(LM_CSTR(strT), false) : -1;
+        int idMenu = 0;
         if ((indexT >= 0) && (indexT < iFuncCount)) {
             int iLine = this->CodeAnalyzerGetLine(indexT);
             if (iLine != iLineCurrent) {
                 m_strSelectedFunc = this->CodeAnalyzerGetName(indexT);
-                SetSelection(iWordStart, iWordEnd);
-                popMenu.Append(ID_ANALYZE_GOTO, strNx, uT("Go to function definition"));
-                popMenu.AppendSeparator();
-                int idd = (this->TextHeight(GetCurrentLine()) / 4);
-                if (idd < 2) {
-                    idd = 2;
-                }
-                else if (idd > 16) {
-                    idd = 16;
-                }
-                ptMousePosition.y += idd;
-                bOpenIncluded = false;
+                idMenu = ID_ANALYZE_GOTO;
+            }
+        }
+        else {
+            // Defined in another file of the workspace?
+            CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
+            if (pFrame && pFrame->getSymbolIndex() && pFrame->getSymbolIndex()->contains(strName)) {
+                m_strSelectedSymbol = strName;
+                idMenu = ID_SYMBOL_GOTO;
+            }
+        }
+        if (idMenu != 0) {
+            SetSelection(iWordStart, iWordEnd);
+            popMenu.Append(idMenu, strNx, uT("Go to function definition"));
+            popMenu.AppendSeparator();
+            int idd = (this->TextHeight(GetCurrentLine()) / 4);
+            if (idd < 2) {
+                idd = 2;
             }
+            else if (idd > 16) {
+                idd = 16;
+            }
+            ptMousePosition.y += idd;
+            bOpenIncluded = false;
         }
     }
 
@@ -2562,6 +2795,15 @@ void ScriptEdit::OnEditAction(wxCommandEvent &tEvent)
                 m_strSelectedFunc = wxEmptyString;
             }
             break;
+        case ID_SYMBOL_GOTO:
+            if (m_strSelectedSymbol.IsEmpty() == false) {
+                CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
+                if (pFrame != NULL) {
+                    pFrame->DoSymbolGoto(m_strSelectedSymbol);
+                }
+                m_strSelectedSymbol = wxEmptyString;
+            }
+            break;
         case ID_INCLUDE_GOTO:
             if (m_strFileToOpen.IsEmpty() == false) {
                 CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
@@ -16,11 +16,13 @@
 #include "CometApp.h"
 #include "CometFrame.h"
 #include "ScriptEdit.h"
+#include "FileWatcher.h"
 #include "ScriptPrint.h"
 
 #define FILE_HEADER_COMETM    0x96
 #define FILE_HEADER_MARKERS   0x10
 #define FILE_HEADER_SELECTION 0x20
+#define FILE_HEADER_SAVEMODE  0x40
 
 bool ScriptEdit::updateFilename(const wxString &filenameT, bool bSelect /* = true*/, bool bFocus /* = true*/)
 {
@@ -47,6 +49,7 @@ bool ScriptEdit::updateFilename(const wxString &filenameT, bool bSelect /* = tru
     CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
     if (pFrame) {
         pFrame->addToRecent(this->GetFilename());
+        pFrame->updateFileWatch();
     }
 
     return true;
@@ -60,10 +63,11 @@ bool ScriptEdit::DoNewFile(ScintillaPrefs &tScintillaPrefs, const wxString &strT
         return false;
     }
 
-    m_strDebugTrace.Empty();
+    luaDebugClear();
 
     m_strFilename.Empty();
     m_ChangeTime.ResetTime();
+    m_bFileHash = false;
 
     setModeScriptConsole(false);
 
@@ -425,11 +429,7 @@ bool ScriptEdit::FileLoaded(const wxString &filenameT, int maxLineIndex /* = -1*
 
         if (m_bEnableCodeAnalyzer && m_pCodeAnalyzer) {
 
-            SigmaBusyCursor waitC;
-            if (this->GetLineCount() > 2048) {
-                waitC.start();
-            }
-
+            m_bAnalyzerGotoMain = false;
             m_pCodeAnalyzer->reset();
             m_pCodeAnalyzer->setFilename(this->GetFilename());
             switch (iLexer) {
@@ -457,10 +457,16 @@ bool ScriptEdit::FileLoaded(const wxString &filenameT, int maxLineIndex /* = -1*
             }
 
             if (bConverted == false) {
-                m_pCodeAnalyzer->analyze();
-                int iMainLine = m_pCodeAnalyzer->getMainLine();
-                if (iMainLine >= 0) {
-                    DoGotoLine(iMainLine, bSelect);
+                // Large documents are analyzed in the background (main is reached when done)
+                if ((this->GetLineCount() > ANALYZER_ASYNC_MINLINES) && m_pCodeAnalyzer->analyzeAsync(this)) {
+                    m_bAnalyzerGotoMain = bSelect;
+                }
+                else {
+                    m_pCodeAnalyzer->analyze(this);
+                    int iMainLine = m_pCodeAnalyzer->getMainLine();
+                    if (iMainLine >= 0) {
+                        DoGotoLine(iMainLine, bSelect);
+                    }
                 }
             }
         }
@@ -506,6 +512,8 @@ bool ScriptEdit::DoLoadFile(const wxString &filenameT /* = wxEmptyString*/, bool
     }
 
     if (iFileSize < 1L) { // Load empty file
+        m_iFileHash = FileWatcher::hashBuffer("", 0);
+        m_bFileHash = true;
         return FileLoaded(filenameT, -1, bReload, 0, 0, false, bSelect, bFocus);
     }
 
@@ -560,6 +568,10 @@ bool ScriptEdit::DoLoadFile(const wxString &filenameT /* = wxEmptyString*/, bool
         fclose(fpScript);
         fpScript = NULL;
 
+        // Raw file content, before any conversion (compared with the file content when reloading)
+        m_iFileHash = FileWatcher::hashBuffer(pszBufferA, (size_t)iFileSize);
+        m_bFileHash = true;
+
         // Check for Unicode Encoding
         bool bBigEndian = false;
         bool bUTF8 = false, bUTF32 = false, bUTF16 = false;
@@ -803,9 +815,11 @@ bool ScriptEdit::DoLoadFile(const wxString &filenameT /* = wxEmptyString*/, bool
 
                     if (bHeader == FILE_HEADER_COMETM) {
 
-                        for (int rr = 0; rr < 2; rr++) {
+                        for (int rr = 0; rr < 3; rr++) {
 
-                            fread(&bHeader, sizeof(lmByte), 1, fpMarker);
+                            if (fread(&bHeader, sizeof(lmByte), 1, fpMarker) != 1) {
+                                break;
+                            }
 
                             if (bHeader == FILE_HEADER_MARKERS) {
                                 fread(&bB, sizeof(lmByte), 1, fpMarker);
@@ -860,6 +874,12 @@ bool ScriptEdit::DoLoadFile(const wxString &filenameT /* = wxEmptyString*/, bool
                                     iSelEnd = iSelStart;
                                 }
                             }
+
+                            else if (bHeader == FILE_HEADER_SAVEMODE) {
+                                if (fread(&bB, sizeof(lmByte), 1, fpMarker) == 1) {
+                                    setSaveDurability((int)bB);
+                                }
+                            }
                         }
                     }
 
@@ -953,6 +973,314 @@ bool ScriptEdit::DoLoadFile(const wxString &filenameT /* = wxEmptyString*/, bool
     return true;
 }
 
+unsigned char *ScriptEdit::readFile(const wxString &strFilename, size_t *piFileSize)
+{
+    *piFileSize = 0;
+
+    wxFile fileT(strFilename);
+    if (fileT.IsOpened() == false) {
+        return NULL;
+    }
+    const wxFileOffset iFileSize = (const wxFileOffset)(fileT.Length());
+    fileT.Close();
+    if ((iFileSize < 0L) || (iFileSize > LF_SCRIPT_MAXCHARS)) {
+        return NULL;
+    }
+
+    FILE *fpScript = Tfopen(LM_CSTR(strFilename), uT("rb"));
+    if (fpScript == NULL) {
+        return NULL;
+    }
+
+    unsigned char *pszBufferA = (unsigned char *)malloc(((size_t)(iFileSize) + 1) * sizeof(unsigned char));
+    if (pszBufferA == NULL) {
+        fclose(fpScript);
+        return NULL;
+    }
+    pszBufferA[iFileSize] = 0;
+
+    if ((iFileSize > 0L) && (fread(pszBufferA, iFileSize, 1, fpScript) != 1)) {
+        free(pszBufferA);
+        fclose(fpScript);
+        return NULL;
+    }
+    fclose(fpScript);
+
+    *piFileSize = (size_t)iFileSize;
+    return pszBufferA;
+}
+
+// Internal function (no error check): true if the text line-endings are all of the iEOL type
+static bool checkLineEndings(const char *pszTextA, size_t iLen, int iEOL)
+{
+    for (size_t ii = 0; ii < iLen; ii++) {
+        if (pszTextA[ii] == '\r') {
+            bool bCRLF = ((ii + 1) < iLen) && (pszTextA[ii + 1] == '\n');
+            if ((bCRLF && (iEOL != wxSTC_EOL_CRLF)) || ((false == bCRLF) && (iEOL != wxSTC_EOL_CR))) {
+                return false;
+            }
+            if (bCRLF) {
+                ++ii;
+            }
+        }
+        else if ((pszTextA[ii] == '\n') && (iEOL != wxSTC_EOL_LF)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#define RELOAD_MAXEDITS 512 // beyond this many inserted or removed lines, the changed part is replaced as one range
+
+// Line of a reloaded buffer part (newline included)
+struct ReloadLine
+{
+    size_t pos;
+    size_t len;
+    uint64_t hash;
+};
+
+// Changed range between two lines lists: old lines [oldFirst, oldLast) replaced by new lines [newFirst, newLast)
+struct ReloadRange
+{
+    int oldFirst, oldLast;
+    int newFirst, newLast;
+};
+
+// Internal function (no error check): split the text into lines
+static void splitLines(const char *pszTextA, size_t iLen, std::vector<ReloadLine> &vecLines)
+{
+    size_t iPos = 0;
+    while (iPos < iLen) {
+        const char *pszEndA = (const char *)memchr(pszTextA + iPos, '\n', iLen - iPos);
+        const size_t iNext = (pszEndA != NULL) ? ((size_t)(pszEndA - pszTextA) + 1) : iLen;
+        ReloadLine tLine;
+        tLine.pos = iPos;
+        tLine.len = iNext - iPos;
+        tLine.hash = FileWatcher::hashBuffer(pszTextA + iPos, tLine.len);
+        vecLines.push_back(tLine);
+        iPos = iNext;
+    }
+}
+
+// Internal function (no error check): changed line ranges, in order (Myers shortest edit script)
+// false if more than RELOAD_MAXEDITS lines are inserted or removed
+static bool diffLines(const char *pszOldA, const std::vector<ReloadLine> &vecOld,
+                      const char *pszNewA, const std::vector<ReloadLine> &vecNew, std::vector<ReloadRange> &vecRanges)
+{
+    const int iN = (int)(vecOld.size());
+    const int iM = (int)(vecNew.size());
+    const int iMax = ((iN + iM) < RELOAD_MAXEDITS) ? (iN + iM) : RELOAD_MAXEDITS;
+    const int iOffset = iMax + 1;
+
+    // V[k]: furthest old line reached on diagonal k; one copy per edit count for the backtrack
+    std::vector<int> vecV((size_t)(2 * iMax + 3), 0);
+    std::vector<std::vector<int> > vecTrace;
+
+    int iD = -1;
+    for (int dd = 0; (dd <= iMax) && (iD < 0); dd++) {
+        vecTrace.push_back(vecV);
+        for (int kk = -dd; kk <= dd; kk += 2) {
+            int xx = ((kk == -dd) || ((kk != dd) && (vecV[iOffset + kk - 1] < vecV[iOffset + kk + 1]))) ? vecV[iOffset + kk + 1] : (vecV[iOffset + kk - 1] + 1);
+            int yy = xx - kk;
+            while ((xx < iN) && (yy < iM) && (vecOld[xx].hash == vecNew[yy].hash) && (vecOld[xx].len == vecNew[yy].len) &&
+                   (memcmp(pszOldA + vecOld[xx].pos, pszNewA + vecNew[yy].pos, vecOld[xx].len) == 0)) {
+                ++xx;
+                ++yy;
+            }
+            vecV[iOffset + kk] = xx;
+            if ((xx >= iN) && (yy >= iM)) {
+                iD = dd;
+                break;
+            }
+        }
+    }
+    if (iD < 0) {
+        return false;
+    }
+
+    // Backtrack: mark the removed old lines and the inserted new lines
+    std::vector<char> vecRemoved((size_t)iN + 1, 0), vecInserted((size_t)iM + 1, 0);
+    int xx = iN, yy = iM;
+    for (int dd = iD; dd > 0; dd--) {
+        const std::vector<int> &vecPrev = vecTrace[(size_t)dd];
+        const int kk = xx - yy;
+        const int kprev = ((kk == -dd) || ((kk != dd) && (vecPrev[iOffset + kk - 1] < vecPrev[iOffset + kk + 1]))) ? (kk + 1) : (kk - 1);
+        const int xprev = vecPrev[iOffset + kprev];
+        const int yprev = xprev - kprev;
+        while ((xx > xprev) && (yy > yprev)) {
+            --xx;
+            --yy;
+        }
+        if (kprev == (kk + 1)) {
+            vecInserted[(size_t)yprev] = 1;
+        }
+        else {
+            vecRemoved[(size_t)xprev] = 1;
+        }
+        xx = xprev;
+        yy = yprev;
+    }
+
+    // Group the consecutive changes
+    xx = 0;
+    yy = 0;
+    while ((xx < iN) || (yy < iM)) {
+        if ((xx < iN) && (yy < iM) && (vecRemoved[(size_t)xx] == 0) && (vecInserted[(size_t)yy] == 0)) {
+            ++xx;
+            ++yy;
+            continue;
+        }
+        ReloadRange tRange;
+        tRange.oldFirst = xx;
+        tRange.newFirst = yy;
+        while (((xx < iN) && vecRemoved[(size_t)xx]) || ((yy < iM) && vecInserted[(size_t)yy])) {
+            if ((xx < iN) && vecRemoved[(size_t)xx]) {
+                ++xx;
+            }
+            else {
+                ++yy;
+            }
+        }
+        tRange.oldLast = xx;
+        tRange.newLast = yy;
+        vecRanges.push_back(tRange);
+    }
+
+    return true;
+}
+
+bool ScriptEdit::DoReloadChanges(const unsigned char *pszBufferA, size_t iFileSize)
+{
+    // Not handled here (the whole file is reloaded): empty or non UTF-8 files, embedded null characters
+    if ((pszBufferA == NULL) || (iFileSize < 1) || (iFileSize > LF_SCRIPT_MAXCHARS) || (this->GetLength() < 1)) {
+        return false;
+    }
+
+    bool bBOM = false;
+    if (false == ScriptEdit::isUTF8((uint8_t *)pszBufferA, iFileSize, &bBOM)) {
+        return false;
+    }
+
+    const char *pszNewA = (const char *)(bBOM ? (pszBufferA + 3) : pszBufferA);
+    const size_t iNewLen = bBOM ? (iFileSize - 3) : iFileSize;
+    if (memchr(pszNewA, 0, iNewLen) != NULL) {
+        return false;
+    }
+
+    const size_t iOldLen = (size_t)(this->GetTextLength());
+    wxCharBuffer strBuffer = this->GetTextRaw();
+    const char *pszOldA = (const char *)(strBuffer.data());
+    if (pszOldA == NULL) {
+        return false;
+    }
+
+    const size_t iMinLen = (iOldLen < iNewLen) ? iOldLen : iNewLen;
+
+    // Common first lines
+    size_t iStart = 0;
+    while ((iStart < iMinLen) && (pszOldA[iStart] == pszNewA[iStart])) {
+        ++iStart;
+    }
+    while ((iStart > 0) && (pszOldA[iStart - 1] != '\n')) {
+        --iStart;
+    }
+
+    // Common last lines: they start just after a newline which is itself common
+    size_t iSuffix = 0;
+    while ((iSuffix < (iMinLen - iStart)) && (pszOldA[iOldLen - 1 - iSuffix] == pszNewA[iNewLen - 1 - iSuffix])) {
+        ++iSuffix;
+    }
+    size_t iEnd = iOldLen;
+    for (size_t ii = iOldLen - iSuffix; ii < iOldLen; ii++) {
+        if (pszOldA[ii] == '\n') {
+            iEnd = ii + 1;
+            break;
+        }
+    }
+    iSuffix = iOldLen - iEnd;
+
+    const char *pszChangedA = pszNewA + iStart;
+    const size_t iChangedLen = iNewLen - iSuffix - iStart;
+
+    // Keep the document line-endings consistent, as done when loading
+    if (false == checkLineEndings(pszChangedA, iChangedLen, this->GetEOLMode())) {
+        return false;
+    }
+
+    // Document already identical to the file (e.g. same change done in both)
+    const bool bSame = (iOldLen == iNewLen) && (memcmp(pszOldA + iStart, pszChangedA, iChangedLen) == 0);
+
+    // Changed line ranges between the common first and last lines (one range if too many changes)
+    std::vector<ReloadLine> vecOld, vecNew;
+    std::vector<ReloadRange> vecRanges;
+    if (false == bSame) {
+        splitLines(pszOldA + iStart, iEnd - iStart, vecOld);
+        splitLines(pszChangedA, iChangedLen, vecNew);
+        if (false == diffLines(pszOldA + iStart, vecOld, pszChangedA, vecNew, vecRanges)) {
+            vecRanges.clear();
+            ReloadRange tRange;
+            tRange.oldFirst = 0;
+            tRange.oldLast = (int)(vecOld.size());
+            tRange.newFirst = 0;
+            tRange.newLast = (int)(vecNew.size());
+            vecRanges.push_back(tRange);
+        }
+    }
+
+    const bool bReadOnly = this->GetReadOnly();
+    if (bReadOnly) {
+        this->SetReadOnly(false);
+    }
+
+    m_bLoading = true;
+
+    // One undo step
+    // One undo step, the ranges applied from the last one so that the previous positions remain valid
+    this->BeginUndoAction();
+    std::string strInsert;
+    for (size_t ii = vecRanges.size(); ii > 0; ii--) {
+        const ReloadRange &tRange = vecRanges[ii - 1];
+        const size_t iOldFirst = iStart + ((tRange.oldFirst < (int)(vecOld.size())) ? vecOld[(size_t)(tRange.oldFirst)].pos : (iEnd - iStart));
+        const size_t iOldLast = iStart + ((tRange.oldLast < (int)(vecOld.size())) ? vecOld[(size_t)(tRange.oldLast)].pos : (iEnd - iStart));
+        const size_t iNewFirst = (tRange.newFirst < (int)(vecNew.size())) ? vecNew[(size_t)(tRange.newFirst)].pos : iChangedLen;
+        const size_t iNewLast = (tRange.newLast < (int)(vecNew.size())) ? vecNew[(size_t)(tRange.newLast)].pos : iChangedLen;
+        if (iOldLast > iOldFirst) {
+            this->SetTargetStart((int)iOldFirst);
+            this->SetTargetEnd((int)iOldLast);
+            this->ReplaceTarget(wxEmptyString);
+        }
+        if (iNewLast > iNewFirst) {
+            strInsert.assign(pszChangedA + iNewFirst, iNewLast - iNewFirst);
+            this->InsertTextRaw((int)iOldFirst, strInsert.c_str());
+        }
+    }
+    this->EndUndoAction();
+
+    m_bLoading = false;
+
+    if (bReadOnly) {
+        this->SetReadOnly(true);
+    }
+
+    this->SetSavePoint();
+    m_bSaveFailed = false;
+
+    m_iFileHash = FileWatcher::hashBuffer(pszBufferA, iFileSize);
+    m_bFileHash = true;
+    wxFileName fname = this->GetFilename();
+    fname.GetTimes(NULL, &m_ChangeTime, NULL);
+
+    DoSetModified(this->LineFromPosition((int)iStart));
+
+    CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
+    if (pFrame) {
+        pFrame->DoAnalyzerUpdate(true, false);
+    }
+
+    return true;
+}
+
 bool ScriptEdit::DoSaveFile(const wxString &filenameT /* = wxEmptyString*/, bool bSelect /* = true*/)
 {
     CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
@@ -1208,18 +1536,7 @@ bool ScriptEdit::DoSaveFile(const wxString &filenameT /* = wxEmptyString*/, bool
         wxBusyCursor waitC;
 
         // Save as raw binary (not-supported characters (e.g. arabic) cause the standard Save routine failure)
-        bool bSaved = false;
-        FILE *fpRaw = Tfopen(LM_CSTR(strFilename), uT("wb"));
-        if (fpRaw != NULL) {
-            wxCharBuffer strBuffer = this->GetTextRaw();
-            // GetLength and GetTextLength give the same value i.e. the number of bytes
-            long iBufferSize = (long)(this->GetTextLength());
-
-            bSaved = (fwrite((const char *)(strBuffer.data()), iBufferSize * sizeof(char), 1, fpRaw) == 1);
-
-            fclose(fpRaw);
-            fpRaw = NULL;
-        }
+        bool bSaved = DoSaveBuffer(strFilename);
 
         if (bSaved == false) {
             strT = uT("Cannot save '");
@@ -1236,6 +1553,7 @@ bool ScriptEdit::DoSaveFile(const wxString &filenameT /* = wxEmptyString*/, bool
             return false;
         }
 
+        m_bSaveFailed = false;
         SetSavePoint();
         //
 
@@ -1296,6 +1614,12 @@ bool ScriptEdit::DoSaveFile(const wxString &filenameT /* = wxEmptyString*/, bool
 
         int iMarkerCount = 0;
 
+        // Per-file save mode, kept only if not the default one
+        const bool bSaveMode = (m_iSaveDurability != m_ScintillaPrefs.common.saveDurability);
+        if (bSaveMode) {
+            iMarkerCount += 1;
+        }
+
         for (ii = 0; ii < nLinesMin; ii++) {
 
             DoAddStatus(ii, SCRIPT_MASK_SAVEDBIT);
@@ -1376,6 +1700,13 @@ bool ScriptEdit::DoSaveFile(const wxString &filenameT /* = wxEmptyString*/, bool
                     fwrite(&bG, sizeof(lmByte), 1, fpMarker);
                     fwrite(&bR, sizeof(lmByte), 1, fpMarker);
 
+                    if (bSaveMode) {
+                        bHeader = FILE_HEADER_SAVEMODE;
+                        fwrite(&bHeader, sizeof(lmByte), 1, fpMarker);
+                        bB = (lmByte)m_iSaveDurability;
+                        fwrite(&bB, sizeof(lmByte), 1, fpMarker);
+                    }
+
                     fclose(fpMarker);
                     fpMarker = NULL;
                 }
@@ -1472,8 +1803,8 @@ bool ScriptEdit::DoSaveFile(const wxString &filenameT /* = wxEmptyString*/, bool
             pFrame->updateTitle(this->GetFilename());
             strT = uT("'");
             strT += fname.GetFullName();
-            strT += uT("' saved");
-            pFrame->OutputStatusbar(strT, SIGMAFRAME_TIMER_SHORT);
+            strT += isSaving() ? uT("' saving...") : uT("' saved");
+            pFrame->OutputStatusbar(strT, isSaving() ? SIGMAFRAME_TIMER_NONE : SIGMAFRAME_TIMER_SHORT);
         }
 
         wxString strCurrentDir = pFrame->explorerGetCurrentDir();
@@ -1505,9 +1836,102 @@ bool ScriptEdit::DoSaveFile(const wxString &filenameT /* = wxEmptyString*/, bool
     return true;
 }
 
+bool ScriptEdit::DoSaveBuffer(const wxString &strFilename)
+{
+    // One save at a time per document
+    waitSave();
+
+    // Snapshot of the document (raw UTF-8 bytes, no conversion): editing can go on while it is written
+    // GetLength and GetTextLength give the same value i.e. the number of bytes
+    size_t iBufferSize = (size_t)(this->GetTextLength());
+    wxCharBuffer strBuffer = this->GetTextRaw();
+
+    const char *pszBufferA = (const char *)(strBuffer.data());
+
+    SaveThread *pThread = NULL;
+    if (iBufferSize >= SAVE_ASYNC_MINSIZE) {
+        pThread = new (std::nothrow) SaveThread();
+    }
+
+    if (pThread) {
+        // the thread owns the snapshot from now on
+        char *pszSnapshotA = strBuffer.release();
+        pszBufferA = (const char *)pszSnapshotA;
+        m_iSaveGeneration += 1;
+        if ((pThread->Create(this, pszSnapshotA, iBufferSize, strFilename, m_iSaveDurability, m_iSaveGeneration) == wxTHREAD_NO_ERROR) && (pThread->Run() == wxTHREAD_NO_ERROR)) {
+            m_pSaveThread = pThread;
+            return true;
+        }
+    }
+
+    bool bSaved = SaveThread::saveBuffer(strFilename, pszBufferA, iBufferSize, m_iSaveDurability);
+    if (bSaved) {
+        m_iFileHash = FileWatcher::hashBuffer(pszBufferA, iBufferSize);
+        m_bFileHash = true;
+    }
+
+    if (pThread) {
+        // also frees the snapshot
+        delete pThread;
+        pThread = NULL;
+    }
+
+    return bSaved;
+}
+
+void ScriptEdit::waitSave(void)
+{
+    if (m_pSaveThread == NULL) {
+        return;
+    }
+
+    m_pSaveThread->Wait();
+
+    m_bSaveFailed = (m_pSaveThread->isSaved() == false);
+    if (false == m_bSaveFailed) {
+        wxFileName fname = m_pSaveThread->getFilename();
+        fname.GetTimes(NULL, &m_ChangeTime, NULL);
+        m_iFileHash = m_pSaveThread->getHash();
+        m_bFileHash = true;
+    }
+
+    delete m_pSaveThread;
+    m_pSaveThread = NULL;
+}
+
+void ScriptEdit::DoSaveFinished(int iGeneration)
+{
+    // Already completed by waitSave (and maybe followed by another save)
+    if ((m_pSaveThread == NULL) || (iGeneration != m_iSaveGeneration)) {
+        return;
+    }
+
+    CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
+    if (NULL == pFrame) {
+        // should never happen
+        return;
+    }
+
+    wxString strFilename = m_pSaveThread->getFilename();
+    waitSave();
+
+    wxString strT = uT("'");
+    strT += CometFrame::getLabelFromPath(strFilename);
+    if (m_bSaveFailed) {
+        DoSetModified();
+        strT += uT("' not saved.\nCheck file content or permissions.");
+        pFrame->OutputStatusbar(strT, SIGMAFRAME_TIMER_SHORT);
+        SigmaMessageBox(strT, uT("Comet"), wxICON_ERROR | wxOK, this);
+        return;
+    }
+
+    strT += uT("' saved");
+    pFrame->OutputStatusbar(strT, SIGMAFRAME_TIMER_SHORT);
+}
+
 bool ScriptEdit::isModified(void)
 {
-    return (GetModify() && !GetReadOnly() && (GetLength() > 1));
+    return ((GetModify() || m_bSaveFailed) && !GetReadOnly() && (GetLength() > 1));
 }
 
 void ScriptEdit::DoSetModified(int iLine /* = -1*/)
@@ -1603,10 +2027,23 @@ void ScriptEdit::DoSetModifiedLean(int iLine)
 
 void ScriptEdit::OnModified(wxStyledTextEvent &tEvent)
 {
+    // Also handled by CodeEdit::OnModified (styling)
+    tEvent.Skip();
+
     if (m_bLoading) {
+        if (m_pCodeAnalyzer) {
+            m_pCodeAnalyzer->invalidate();
+        }
+        m_AutoComp.invalidate();
         return;
     }
 
+    updateFindOnModified(tEvent.GetModificationType(), tEvent.GetPosition(), tEvent.GetLength());
+
+    m_AutoComp.modified(LineFromPosition(tEvent.GetPosition()), tEvent.GetLinesAdded());
+
+    CodeAnalyzerModified(tEvent.GetPosition(), tEvent.GetLinesAdded());
+
     DoSetModified(LineFromPosition(tEvent.GetPosition()));
 }
 
@@ -17,6 +17,8 @@
 #include "CometFrame.h"
 #include "ScriptEdit.h"
 
+#include <vector>
+
 bool ScriptEdit::canSearch(wxString &strFind, wxString strReplace, bool bReplace, int *iFindLen, int *iLineCount, int *iCurLine)
 {
     CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
@@ -51,14 +53,157 @@ bool ScriptEdit::canSearch(wxString &strFind, wxString strReplace, bool bReplace
 
 void ScriptEdit::DoFindReset(void)
 {
+    stopFindCount();
+    m_FindEngine.reset();
+    m_iFindViewStart = m_iFindViewEnd = -1;
+
     if (m_ScintillaPrefs.common.syntaxEnable == false) {
         return;
     }
 
-    StartStyling(0, wxSTC_INDIC2_MASK);
-    SetStyling(this->GetTextLength(), 0);
+    // Clear only the range where the find indicator was set
+    if (m_iFindIndicStart >= 0) {
+        const int iTextLen = GetTextLength();
+        const int iEnd = (m_iFindIndicEnd < iTextLen) ? m_iFindIndicEnd : iTextLen;
+        if (m_iFindIndicStart < iEnd) {
+            const int iEndStyled = GetEndStyled();
+            StartStyling(m_iFindIndicStart, wxSTC_INDIC2_MASK);
+            SetStyling(iEnd - m_iFindIndicStart, 0);
+            StartStyling(iEndStyled, wxSTC_INDIC2_MASK);
+        }
+    }
+    m_iFindIndicStart = m_iFindIndicEnd = -1;
     m_iFindIndicCount = 0;
 }
+
+void ScriptEdit::addFindIndicRange(int iStartPos, int iEndPos)
+{
+    if ((m_iFindIndicStart < 0) || (iStartPos < m_iFindIndicStart)) {
+        m_iFindIndicStart = iStartPos;
+    }
+    if (iEndPos > m_iFindIndicEnd) {
+        m_iFindIndicEnd = iEndPos;
+    }
+}
+
+// Keep the find indicator range and the match count in line with the document changes
+void ScriptEdit::updateFindOnModified(int iModType, int iPos, int iLength)
+{
+    // The matches of the visible lines are highlighted again on the next paint
+    m_iFindViewStart = m_iFindViewEnd = -1;
+
+    if (m_iFindIndicStart >= 0) {
+        if ((iModType & wxSTC_MOD_INSERTTEXT) != 0) {
+            if (iPos < m_iFindIndicStart) {
+                m_iFindIndicStart += iLength;
+            }
+            if (iPos <= m_iFindIndicEnd) {
+                m_iFindIndicEnd += iLength;
+            }
+        }
+        else if ((iModType & wxSTC_MOD_DELETETEXT) != 0) {
+            if (iPos < m_iFindIndicStart) {
+                m_iFindIndicStart = iPos;
+            }
+        }
+    }
+
+    // Count again, silently
+    if (m_FindEngine.isCompiled() && ((m_iFindCount >= 0) || isFindCounting())) {
+        startFindCount(false);
+    }
+}
+
+// Count the matches of the current find pattern in the whole document, one chunk per timer event,
+// so that a search in a large document never waits for the total
+void ScriptEdit::startFindCount(bool bVerbose)
+{
+    m_iFindCount = -1;
+    m_iFindCountRun = 0;
+    m_iFindCountPos = 0;
+    m_bFindCountVerbose = bVerbose;
+
+    if (m_FindEngine.isCompiled() == false) {
+        return;
+    }
+
+    if (m_pFindCountTimer == NULL) {
+        try {
+            m_pFindCountTimer = new wxTimer(this, TIMER_ID_SCRIPTEDIT_FINDCOUNT);
+        }
+        catch (...) {
+            m_pFindCountTimer = NULL;
+        }
+        if (m_pFindCountTimer == NULL) {
+            return;
+        }
+    }
+    m_pFindCountTimer->Start(FIND_COUNTDELAY);
+}
+
+void ScriptEdit::stopFindCount(void)
+{
+    if (m_pFindCountTimer) {
+        m_pFindCountTimer->Stop();
+    }
+    m_iFindCount = -1;
+    m_iFindCountRun = 0;
+    m_iFindCountPos = 0;
+}
+
+bool ScriptEdit::isFindCounting(void)
+{
+    return (m_pFindCountTimer != NULL) && m_pFindCountTimer->IsRunning();
+}
+
+void ScriptEdit::OnTimerFindCount(wxTimerEvent &tEvent)
+{
+    if (tEvent.GetId() != TIMER_ID_SCRIPTEDIT_FINDCOUNT) {
+        tEvent.Skip();
+        return;
+    }
+
+    if (m_FindEngine.isCompiled() == false) {
+        stopFindCount();
+        return;
+    }
+
+    // Next chunk, ending at a line end
+    const int iTextLen = GetTextLength();
+    const int iFrom = m_iFindCountPos;
+    int iTo = iFrom + FIND_COUNTCHUNK;
+    if (iTo >= iTextLen) {
+        iTo = iTextLen;
+    }
+    else {
+        iTo = GetLineEndPosition(LineFromPosition(iTo));
+    }
+    if (iFrom < iTo) {
+        const int iBufStart = (iFrom > 0) ? (iFrom - 1) : 0;
+        const int iBufEnd = (iTo < iTextLen) ? (iTo + 1) : iTextLen;
+        const char *pszBuf = GetRangePointer(iBufStart, iBufEnd - iBufStart);
+        m_iFindCountRun += m_FindEngine.findAll(pszBuf, iBufStart, iBufEnd, iTextLen, iFrom, iTo, NULL, NULL);
+    }
+    m_iFindCountPos = iTo;
+    if (iTo < iTextLen) {
+        return;
+    }
+
+    m_pFindCountTimer->Stop();
+    m_iFindCount = m_iFindCountRun;
+
+    CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
+    if (m_bFindCountVerbose && pFrame && (pFrame->getActiveEditor() == this)) {
+        wxString strT = uT("\'");
+        strT += m_FindEngine.getFind();
+        strT += uT("\'");
+        strT += wxString::Format((m_iFindCount > 1) ? uT(" found %d times in ") : uT(" found %d time in "), m_iFindCount);
+        strT += GetFilename();
+        strT += uT(".");
+        pFrame->OutputStatusbar(strT, SIGMAFRAME_TIMER_SHORT);
+    }
+    m_bFindCountVerbose = false;
+}
 void ScriptEdit::DoFindHighlight(int iStartPos, int iEndPos)
 {
     if ((m_ScintillaPrefs.common.syntaxEnable == false) || (iStartPos >= iEndPos)) {
@@ -68,9 +213,15 @@ void ScriptEdit::DoFindHighlight(int iStartPos, int iEndPos)
     if ((this->GetStyleAt(iStartPos) & wxSTC_INDIC2_MASK) == 0) {
         StartStyling(iStartPos, wxSTC_INDIC2_MASK);
         SetStyling(iEndPos - iStartPos, wxSTC_INDIC2_MASK);
+        addFindIndicRange(iStartPos, iEndPos);
         m_iFindIndicCount += 1;
     }
     SetSelection(iStartPos, iEndPos);
+
+    // Total number of matches, computed in the background
+    if (m_FindEngine.isCompiled() && (m_iFindCount < 0) && (isFindCounting() == false)) {
+        startFindCount(true);
+    }
 }
 
 int ScriptEdit::DoFindPrev(wxString &strFind, bool bVerbose /* = false*/, int iStyle /* = 0*/, bool bSel /* = false*/, int *iFindEnd /* = NULL*/, bool bAddMarker /* = true*/)
@@ -154,10 +305,33 @@ int ScriptEdit::DoFindPrev(wxString &strFind, bool bVerbose /* = false*/, int iS
         return FIND_LIMITREACHED;
     }
 
-    strline = GetLine(iLine);
-    iLineLen = (int)(strline.Length());
+    // Plain text: search backward in the raw document bytes, from the selection start
+    bool bRaw = false;
+    if (m_FindEngine.isCompiled(strFind, iStyle) || m_FindEngine.compile(strFind, iStyle)) {
+        bRaw = true;
+        int iLimit = GetSelectionStart();
+        if (iFindEnd && (*iFindEnd > GetSelectionEnd())) {
+            iLimit = *iFindEnd;
+        }
+        iPos = findRaw(0, iLimit, true, &findMaxPos);
+        if (iPos >= 0) {
+            if (bAddMarker) {
+                DoAddStatus(LineFromPosition(iPos), SCRIPT_MASK_FINDBIT);
+            }
+            this->setFindin(true);
+            pFrame->updateEditorStatus(this);
+            DoFindHighlight(iPos, findMaxPos);
+            pFrame->addFindItem(strFind);
+            return FIND_ITEMFOUND;
+        }
+    }
 
-    if (iLineLen >= iFindLen) {
+    if (bRaw == false) {
+        strline = GetLine(iLine);
+        iLineLen = (int)(strline.Length());
+    }
+
+    if ((bRaw == false) && (iLineLen >= iFindLen)) {
         iLineStart = GetLineEndPosition(iLine) - iLineLen;
         if (iFindEnd) {
             iLineEnd = *iFindEnd;
@@ -178,7 +352,7 @@ int ScriptEdit::DoFindPrev(wxString &strFind, bool bVerbose /* = false*/, int iS
         }
     }
 
-    if (iCurLine <= 0) {
+    if (bRaw || (iCurLine <= 0)) {
         pFrame->updateEditorStatus(this);
         if (bFindSelected) {
             if (bVerbose) {
@@ -263,6 +437,284 @@ int ScriptEdit::DoFindPrev(wxString &strFind, bool bVerbose /* = false*/, int iS
     return FIND_ITEMFOUND;
 }
 
+// Search the raw document bytes in [iFrom, iTo] with the compiled find pattern
+int ScriptEdit::findRaw(int iFrom, int iTo, bool bBackward, int *piEnd)
+{
+    const int iTextLen = GetTextLength();
+    if (iFrom < 0) {
+        iFrom = 0;
+    }
+    if (iTo > iTextLen) {
+        iTo = iTextLen;
+    }
+    if ((iTo - iFrom) < m_FindEngine.getMinLength()) {
+        return -1;
+    }
+
+    // One more byte on each side, for the word boundaries
+    const int iBufStart = (iFrom > 0) ? (iFrom - 1) : 0;
+    const int iBufEnd = (iTo < iTextLen) ? (iTo + 1) : iTextLen;
+    const char *pszBuf = GetRangePointer(iBufStart, iBufEnd - iBufStart);
+    return m_FindEngine.find(pszBuf, iBufStart, iBufEnd, iTextLen, iFrom, iTo, bBackward, piEnd);
+}
+
+// Highlight the matches in [iFrom, iTo] (previous highlights in the range are cleared)
+void ScriptEdit::highlightRange(int iFrom, int iTo)
+{
+    const int iTextLen = GetTextLength();
+    if (iTo > iTextLen) {
+        iTo = iTextLen;
+    }
+    if (iFrom >= iTo) {
+        return;
+    }
+
+    const int iBufStart = (iFrom > 0) ? (iFrom - 1) : 0;
+    const int iBufEnd = (iTo < iTextLen) ? (iTo + 1) : iTextLen;
+    const char *pszBuf = GetRangePointer(iBufStart, iBufEnd - iBufStart);
+    std::vector<int> arStart, arEnd;
+    const int iCount = m_FindEngine.findAll(pszBuf, iBufStart, iBufEnd, iTextLen, iFrom, iTo, &arStart, &arEnd);
+
+    // StartStyling moves the lexer end styled position: restore it
+    const int iEndStyled = GetEndStyled();
+    StartStyling(iFrom, wxSTC_INDIC2_MASK);
+    SetStyling(iTo - iFrom, 0);
+    for (int ii = 0; ii < iCount; ii++) {
+        StartStyling(arStart[ii], wxSTC_INDIC2_MASK);
+        SetStyling(arEnd[ii] - arStart[ii], wxSTC_INDIC2_MASK);
+    }
+    StartStyling(iEndStyled, wxSTC_INDIC2_MASK);
+    if (iCount > 0) {
+        addFindIndicRange(arStart[0], arEnd[iCount - 1]);
+    }
+    m_iFindIndicCount += iCount;
+}
+
+// Highlight the matches of the current find pattern in the visible lines (plus a margin).
+// Called on paint: the highlighted range is extended as the view scrolls.
+void ScriptEdit::DoFindHighlightVisible(void)
+{
+    if ((m_ScintillaPrefs.common.syntaxEnable == false) || (m_FindEngine.isCompiled() == false)) {
+        return;
+    }
+
+    const int iLineCount = GetLineCount();
+    const int iFirstVisible = GetFirstVisibleLine();
+    int iFirstLine = DocLineFromVisible(iFirstVisible) - FIND_VIEWMARGIN;
+    int iLastLine = DocLineFromVisible(iFirstVisible + LinesOnScreen()) + FIND_VIEWMARGIN;
+    if (iFirstLine < 0) {
+        iFirstLine = 0;
+    }
+    if (iLastLine >= iLineCount) {
+        iLastLine = iLineCount - 1;
+    }
+    const int iStartPos = PositionFromLine(iFirstLine);
+    const int iEndPos = GetLineEndPosition(iLastLine);
+
+    const bool bView = (m_iFindViewStart >= 0) && (m_iFindViewEnd >= m_iFindViewStart);
+    if (bView && (iStartPos >= m_iFindViewStart) && (iEndPos <= m_iFindViewEnd)) {
+        return;
+    }
+
+    int iFrom = iStartPos, iTo = iEndPos;
+    if (bView && (iEndPos >= m_iFindViewStart) && (iStartPos <= m_iFindViewEnd)) {
+        // Scrolled: only the lines not yet highlighted
+        if (iStartPos >= m_iFindViewStart) {
+            iFrom = m_iFindViewEnd;
+        }
+        else if (iEndPos <= m_iFindViewEnd) {
+            iTo = m_iFindViewStart;
+        }
+        m_iFindViewStart = (iStartPos < m_iFindViewStart) ? iStartPos : m_iFindViewStart;
+        m_iFindViewEnd = (iEndPos > m_iFindViewEnd) ? iEndPos : m_iFindViewEnd;
+    }
+    else {
+        m_iFindViewStart = iStartPos;
+        m_iFindViewEnd = iEndPos;
+    }
+
+    highlightRange(iFrom, iTo);
+}
+
+void ScriptEdit::OnPainted(wxStyledTextEvent &tEvent)
+{
+    DoFindHighlightVisible();
+
+    tEvent.Skip();
+}
+
+// Find all occurrences of strFind in [iStartPos, iEndPos] in one pass over the raw text.
+// Only the lines are marked: the matches are highlighted when visible (DoFindHighlightVisible).
+// Returns the number of matches, or -1 if the caller should use the line by line loop (regex...)
+int ScriptEdit::DoFindAll(const wxString &strFind, int iStyle, int iStartPos, int iEndPos, bool bAddMarker)
+{
+    if ((strFind.Find(uT('\n')) != wxNOT_FOUND) || (strFind.Find(uT('\r')) != wxNOT_FOUND)) {
+        return -1;
+    }
+    if ((m_FindEngine.isCompiled(strFind, iStyle) == false) && (m_FindEngine.compile(strFind, iStyle) == false)) {
+        return -1;
+    }
+
+    const int iTextLen = GetTextLength();
+    if (iStartPos < 0) {
+        iStartPos = 0;
+    }
+    if (iEndPos > iTextLen) {
+        iEndPos = iTextLen;
+    }
+    if ((iEndPos - iStartPos) < m_FindEngine.getMinLength()) {
+        return 0;
+    }
+
+    const int iBufStart = (iStartPos > 0) ? (iStartPos - 1) : 0;
+    const int iBufEnd = (iEndPos < iTextLen) ? (iEndPos + 1) : iTextLen;
+    const char *pszBuf = GetRangePointer(iBufStart, iBufEnd - iBufStart);
+    std::vector<int> arStart, arEnd;
+    const int iCount = m_FindEngine.findAll(pszBuf, iBufStart, iBufEnd, iTextLen, iStartPos, iEndPos, &arStart, &arEnd);
+
+    if (bAddMarker) {
+        int iLinePrev = -1;
+        for (int ii = 0; ii < iCount; ii++) {
+            const int iLine = LineFromPosition(arStart[ii]);
+            if (iLine != iLinePrev) {
+                DoAddStatus(iLine, SCRIPT_MASK_FINDBIT);
+                iLinePrev = iLine;
+            }
+        }
+    }
+
+    m_iFindViewStart = m_iFindViewEnd = -1;
+    if (iCount > 0) {
+        SetSelection(arStart[iCount - 1], arEnd[iCount - 1]);
+    }
+
+    if ((iStartPos == 0) && (iEndPos == iTextLen)) {
+        stopFindCount();
+        m_iFindCount = iCount;
+    }
+
+    return iCount;
+}
+
+// Replace all occurrences of strFind in [iStartPos, iEndPos] in one pass:
+// the matches are found by scanning the raw document text, the new text is built
+// in one buffer and applied as a single target replacement (two undo steps).
+// Markers on the replaced lines are remapped to their new line.
+// Returns the number of replacements, or -1 if the caller should use the line by line loop (regex...)
+int ScriptEdit::DoReplaceAll(const wxString &strFind, const wxString &strReplace, int iStyle,
+                             int iStartPos, int iEndPos, int *piDelta)
+{
+    *piDelta = 0;
+
+    if ((strFind.Find(uT('\n')) != wxNOT_FOUND) || (strFind.Find(uT('\r')) != wxNOT_FOUND)) {
+        // the line by line search never matches across lines
+        return -1;
+    }
+    if ((m_FindEngine.isCompiled(strFind, iStyle) == false) && (m_FindEngine.compile(strFind, iStyle) == false)) {
+        return -1;
+    }
+
+    const wxWX2MBbuf bufReplace = wx2stc(strReplace);
+    const char *pszReplace = (const char *)bufReplace;
+    if (pszReplace == NULL) {
+        return -1;
+    }
+    const int iReplaceLen = (int)strlen(pszReplace);
+
+    const int iTextLen = GetTextLength();
+    if (iStartPos < 0) {
+        iStartPos = 0;
+    }
+    if (iEndPos > iTextLen) {
+        iEndPos = iTextLen;
+    }
+    if ((iEndPos - iStartPos) < m_FindEngine.getMinLength()) {
+        return 0;
+    }
+
+    const char *pszText = GetCharacterPointer();
+    if (pszText == NULL) {
+        return -1;
+    }
+
+    // Find all the (non overlapping) matches
+    std::vector<int> arMatch, arMatchEnd;
+    const int iCount = m_FindEngine.findAll(pszText, 0, iTextLen, iTextLen, iStartPos, iEndPos, &arMatch, &arMatchEnd);
+    if (iCount < 1) {
+        return 0;
+    }
+
+    // Build the replaced span in one buffer
+    const int iSpanStart = arMatch[0];
+    const int iSpanEnd = arMatchEnd[iCount - 1];
+    int iDelta = 0;
+    for (int ii = 0; ii < iCount; ii++) {
+        iDelta += iReplaceLen - (arMatchEnd[ii] - arMatch[ii]);
+    }
+    const int iNewLen = (iSpanEnd - iSpanStart) + iDelta;
+    char *pszNew = (char *)malloc((size_t)iNewLen + 1);
+    if (pszNew == NULL) {
+        return -1;
+    }
+    char *pszOut = pszNew;
+    int iPrev = iSpanStart;
+    for (int ii = 0; ii < iCount; ii++) {
+        memcpy(pszOut, pszText + iPrev, (size_t)(arMatch[ii] - iPrev));
+        pszOut += arMatch[ii] - iPrev;
+        memcpy(pszOut, pszReplace, (size_t)iReplaceLen);
+        pszOut += iReplaceLen;
+        iPrev = arMatchEnd[ii];
+    }
+    *pszOut = '\0';
+
+    // Save the markers of the lines inside the span (they would be merged into the first line)
+    std::vector<int> arMarkerPos, arMarkerMask;
+    const int iLineFirst = LineFromPosition(iSpanStart);
+    const int iLineLast = LineFromPosition(iSpanEnd);
+    for (int iLine = iLineFirst + 1; iLine <= iLineLast; iLine++) {
+        const int iMask = MarkerGet(iLine);
+        if (iMask != 0) {
+            arMarkerPos.push_back(PositionFromLine(iLine));
+            arMarkerMask.push_back(iMask);
+            MarkerDelete(iLine, -1);
+        }
+    }
+
+    SetTargetStart(iSpanStart);
+    SetTargetEnd(iSpanEnd);
+    ReplaceTargetRaw(pszNew, iNewLen);
+    free(pszNew);
+    pszNew = NULL;
+
+    // Restore the markers at the new position of their line start
+    int iMatch = 0, iShift = 0;
+    for (size_t ii = 0; ii < arMarkerPos.size(); ii++) {
+        const int iLinePos = arMarkerPos[ii];
+        while ((iMatch < iCount) && (arMatchEnd[iMatch] <= iLinePos)) {
+            iShift += iReplaceLen - (arMatchEnd[iMatch] - arMatch[iMatch]);
+            iMatch += 1;
+        }
+        MarkerAddSet(LineFromPosition(iLinePos + iShift), arMarkerMask[ii]);
+    }
+
+    // Modified status of the replaced lines
+    if (m_ScintillaPrefs.common.statusEnable && (GetMarginWidth(m_StatusID) > 0)) {
+        int iLinePrev = -1;
+        iShift = 0;
+        for (int ii = 0; ii < iCount; ii++) {
+            const int iLine = LineFromPosition(arMatch[ii] + iShift);
+            if (iLine != iLinePrev) {
+                DoSetModifiedLean(iLine);
+                iLinePrev = iLine;
+            }
+            iShift += iReplaceLen - (arMatchEnd[ii] - arMatch[ii]);
+        }
+    }
+
+    *piDelta = iDelta;
+    return iCount;
+}
+
 int ScriptEdit::DoFindReplace(wxString &strFind, bool bVerbose /* = false*/, int iStyle /* = 0*/,
                               wxString strReplace /* = wxEmptyString*/, bool bReplace /* = false*/, bool bAll /* = false*/,
                               int *iCount /* = NULL*/, bool bSel /* = false*/, int *iFindStart /* = NULL*/, bool bAddMarker /* = true*/)
@@ -433,7 +885,15 @@ int ScriptEdit::DoFindReplace(wxString &strFind, bool bVerbose /* = false*/, int
     }
 
     if ((bAll == false) && (bSel == false)) {
-        iPos = FindText(iFindStartPos, iFindEndPos, strFind, iStyle, &findMinPos, &findMaxPos);
+        if (m_FindEngine.isCompiled(strFind, iStyle) || m_FindEngine.compile(strFind, iStyle)) {
+            // Plain text: search forward in the raw document bytes
+            findMaxPos = 0;
+            iPos = findRaw(iFindStartPos, iFindEndPos, false, &findMaxPos);
+            findMinPos = iPos;
+        }
+        else {
+            iPos = FindText(iFindStartPos, iFindEndPos, strFind, iStyle, &findMinPos, &findMaxPos);
+        }
         if ((iPos >= 0) && (iPos >= iFindStartPos) && (findMinPos < findMaxPos)) {
             if (bAddMarker) {
                 DoAddStatus(LineFromPosition(iPos), SCRIPT_MASK_FINDBIT);
@@ -477,7 +937,34 @@ int ScriptEdit::DoFindReplace(wxString &strFind, bool bVerbose /* = false*/, int
     m_bLinePrev = true;
     int iFound = 0, iFoundByLine = 0, iLineStartPos, iLineEndPos;
 
-    for (int iLine = iFindStartLine; iLine <= iFindEndLine; iLine++) {
+    // Find or replace all: one pass over the raw text, if the search options allow it
+    bool bDoneAll = false;
+    if (bAll && bReplace) {
+        int iDelta = 0;
+        const int iReplaced = DoReplaceAll(strFind, strReplace, iStyle, bSel ? iFindStartPos : 0, iFindEndPos + iSelDelta, &iDelta);
+        if (iReplaced >= 0) {
+            iFound = iReplaced;
+            if (iCount) {
+                *iCount += iReplaced;
+            }
+            iSelDelta += iDelta;
+            this->setFindin(iReplaced > 0);
+            bDoneAll = true;
+        }
+    }
+    else if (bAll) {
+        const int iFoundAll = DoFindAll(strFind, iStyle, bSel ? iFindStartPos : 0, iFindEndPos, bAddMarker);
+        if (iFoundAll >= 0) {
+            iFound = iFoundAll;
+            if (iCount) {
+                *iCount += iFoundAll;
+            }
+            this->setFindin(iFoundAll > 0);
+            bDoneAll = true;
+        }
+    }
+
+    for (int iLine = iFindStartLine; (iLine <= iFindEndLine) && (bDoneAll == false); iLine++) {
 
         strline = GetLine(iLine);
         iLineLen = (int)(strline.Length());
@@ -272,6 +272,109 @@ void ScriptEdit::DoModifyMarker(int iMarkerBit, int nPos /* = -1*/)
 
         *piMarkerCount += 1;
     }
+
+    if (iMarkerBit == SCRIPT_MASK_BREAKPOINTBIT) {
+        luaBreakpoints();
+    }
+}
+
+// Condition, hit count and log message of the breakpoint of the current line (set if needed), entered as
+// [#N] [condition] [=> message]
+void ScriptEdit::DoEditBreakpoint(void)
+{
+    if (this->GetLexer() != wxSTC_LEX_LUA) {
+        return;
+    }
+
+    const int iLine = GetCurrentLine();
+    if ((iLine < 0) || (iLine >= GetLineCount())) {
+        return;
+    }
+
+    DebugBreakpoint tOptions;
+    std::map<int, DebugBreakpoint>::iterator itO;
+    if ((MarkerGet(iLine) & SCRIPT_MASK_BREAKPOINT) != 0) {
+        for (itO = m_BreakpointOptions.begin(); itO != m_BreakpointOptions.end(); ++itO) {
+            if (MarkerLineFromHandle(itO->first) == iLine) {
+                tOptions = itO->second;
+                break;
+            }
+        }
+    }
+
+    wxString strT = uT("");
+    if (tOptions.hits > 0) {
+        strT += wxString::Format(uT("#%d "), tOptions.hits);
+    }
+    strT += LM_U8TOWC(tOptions.condition.c_str());
+    if (tOptions.message.empty() == false) {
+        strT += uT(" => ");
+        strT += LM_U8TOWC(tOptions.message.c_str());
+    }
+
+    wxString strL = wxString::Format(uT("Breakpoint at line %d (empty: always break)\n")
+                                         uT("#N : break from the N-th time the condition is true\n")
+                                         uT("Lua expression : break if true (locals and upvalues of the line can be used)\n")
+                                         uT("=> message : printed instead of breaking, {expression} replaced by its value"),
+                                     iLine + 1);
+    wxTextEntryDialog *pDlg = new (std::nothrow) wxTextEntryDialog(this, strL, uT("Comet"), strT, wxOK | wxCANCEL, wxDefaultPosition, wxSize(400, wxDefaultCoord));
+    if (pDlg == NULL) {
+        return;
+    }
+    long iRet = pDlg->ShowModal();
+    strT = pDlg->GetValue();
+    pDlg->Destroy();
+
+    if (iRet != wxID_OK) {
+        return;
+    }
+
+    tOptions = DebugBreakpoint();
+    strT.Trim(false);
+    strT.Trim(true);
+    if (strT.StartsWith(uT("#"))) {
+        size_t ii = 1;
+        while ((ii < strT.Length()) && (strT.GetChar(ii) >= uT('0')) && (strT.GetChar(ii) <= uT('9'))) {
+            ii += 1;
+        }
+        long iHits = 0;
+        if (strT.Mid(1, ii - 1).ToLong(&iHits) && (iHits > 0)) {
+            tOptions.hits = (int)iHits;
+        }
+        strT = strT.Mid(ii);
+        strT.Trim(false);
+    }
+    int iArrow = strT.Find(uT("=>"));
+    if (iArrow != wxNOT_FOUND) {
+        wxString strM = strT.Mid(iArrow + 2);
+        strM.Trim(false);
+        tOptions.message = LM_U8STR(strM);
+        strT = strT.Mid(0, iArrow);
+        strT.Trim(true);
+    }
+    tOptions.condition = LM_U8STR(strT);
+
+    // The breakpoint is set again to get its handle
+    for (itO = m_BreakpointOptions.begin(); itO != m_BreakpointOptions.end();) {
+        if (MarkerLineFromHandle(itO->first) == iLine) {
+            m_BreakpointOptions.erase(itO++);
+        }
+        else {
+            ++itO;
+        }
+    }
+    if ((MarkerGet(iLine) & SCRIPT_MASK_BREAKPOINT) != 0) {
+        MarkerDelete(iLine, SCRIPT_MASK_BREAKPOINTBIT);
+    }
+    else {
+        m_iBreakpointCount += 1;
+    }
+    int iHandle = MarkerAdd(iLine, SCRIPT_MASK_BREAKPOINTBIT);
+    if ((iHandle >= 0) && (tOptions.isPlain() == false)) {
+        m_BreakpointOptions[iHandle] = tOptions;
+    }
+
+    luaBreakpoints();
 }
 
 // DoDeleteBookmark only called by CometFrame::deleteBookmark
@@ -18,6 +18,8 @@
 #include "ScriptEdit.h"
 #include "ScriptThread.h"
 
+#include <algorithm>
+
 bool ScriptEdit::processStart(void)
 {
     m_bCanSetFocus = true;
@@ -33,6 +35,9 @@ bool ScriptEdit::processStart(void)
 
     processKill();
 
+    // the external tool reads the file from disk
+    waitSave();
+
     // Remove previous error and debugging markers
     MarkerDeleteAll(SCRIPT_MASK_ERRORBIT);
     MarkerDeleteAll(SCRIPT_MASK_DEBUGBIT);
@@ -517,29 +522,24 @@ bool ScriptEdit::luaRunScript(void)
 
     pFrame->setRunningLexer(wxSTC_LEX_NULL);
 
-    // Set script read-only during buffering
-    bool bReadWriteStatus = this->GetReadOnly();
-    this->SetReadOnly(true);
-
     m_strErrMsg = wxEmptyString;
 
     if (isRunning()) {
         if (isDebugging()) {
-            if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-                m_bDebugging = false;
-                m_bDebugIt = true;
-                m_pMutex->Unlock();
-            }
-            this->SetReadOnly(bReadWriteStatus);
+            // Resume the paused script (see ScriptThread::waitResume)
+            m_pMutex->Lock();
+            m_bDebugging = false;
+            m_bDebugIt = true;
+            m_iDebugState += 1;
+            m_pCondition->Broadcast();
+            m_pMutex->Unlock();
             return true;
         }
-        this->SetReadOnly(bReadWriteStatus);
         return false;
     }
 
     if (m_strFilename.IsEmpty()) {
         if (DoSaveFile() == false) {
-            this->SetReadOnly(bReadWriteStatus);
             return false;
         }
     }
@@ -552,15 +552,13 @@ bool ScriptEdit::luaRunScript(void)
     int iLineCount = GetLineCount();
     if (iLineCount < 1) {
         setRunning(false);
-        this->SetReadOnly(bReadWriteStatus);
         return false;
     }
     if (iLineCount > LF_SCRIPT_MAXLINES) {
-        strT = uT("Cannot run script: maximum lines count reached (maximum = 32768)");
+        strT = wxString::Format(uT("Cannot run script: maximum lines count reached (maximum = %d)"), LF_SCRIPT_MAXLINES);
         pFrame->OutputStatusbar(strT, SIGMAFRAME_TIMER_SHORT);
         SigmaMessageBox(strT, uT("Comet"), wxOK | wxICON_EXCLAMATION, this);
         setRunning(false);
-        this->SetReadOnly(bReadWriteStatus);
         return false;
     }
 
@@ -572,7 +570,6 @@ bool ScriptEdit::luaRunScript(void)
             if (strT.CmpNoCase(uT("author")) == 0) {
                 pFrame->Output(uT("Pr. Sidi HAMADY"));
                 setRunning(false);
-                this->SetReadOnly(bReadWriteStatus);
                 return true;
             }
             if (strT.CmpNoCase(uT("version")) == 0) {
@@ -582,149 +579,43 @@ bool ScriptEdit::luaRunScript(void)
                 strT += COMET_BUILD_STRING;
                 pFrame->Output(strT);
                 setRunning(false);
-                this->SetReadOnly(bReadWriteStatus);
                 return true;
             }
             if (strT.CmpNoCase(uT("release")) == 0) {
                 pFrame->Output(__TDATE__);
                 setRunning(false);
-                this->SetReadOnly(bReadWriteStatus);
                 return true;
             }
         }
     }
 
-    const size_t iLineMaxLen = LM_STRSIZEW;
-    size_t iBufferSize = (size_t)(iLineCount * iLineMaxLen);
-    char *pszBufferA = (char *)malloc(iBufferSize * sizeof(char));
-    if (pszBufferA == NULL) {
+    // One copy of the raw UTF-8 document, owned by the script thread
+    const int iLength = GetLength();
+    char *pszScriptA = (char *)malloc((iLength + 2) * sizeof(char));
+    if (pszScriptA == NULL) {
         pFrame->OutputStatusbar(uT("Cannot run script: insufficient memory"), SIGMAFRAME_TIMER_SHORT);
         SigmaMessageBox(uT("Cannot run script: insufficient memory"), uT("Comet"), wxOK | wxICON_EXCLAMATION, this);
         setRunning(false);
-        this->SetReadOnly(bReadWriteStatus);
         return false;
     }
-
-    pszBufferA[0] = pszBufferA[iBufferSize - 1] = 0;
-
-    size_t nLenLineA, nLengthA = 0, nLengthW;
-    wxString strBufferW;
-    strBufferW.Empty();
+    if (iLength > 0) {
+        memcpy(pszScriptA, GetRangePointer(0, iLength), iLength * sizeof(char));
+    }
+    pszScriptA[iLength] = LM_NEWLINE_CHARA;
+    pszScriptA[iLength + 1] = '\0';
 
     // set decimal point to... point!
     wxSetlocale(LC_NUMERIC, uT("C"));
 
-    SigmaBusyCursor waitC;
-    if (iLineCount > 2048) {
-        waitC.start();
-    }
-
-    if (m_bEnableCodeAnalyzer && (m_pCodeAnalyzer != NULL)) {
-        m_pCodeAnalyzer->reset();
-        m_pCodeAnalyzer->setLanguage(CodeAnalyzer::LANGUAGE_LUA);
-        m_pCodeAnalyzer->setFilename(this->GetFilename());
-    }
-
-    char_t szLine[LM_STRSIZEL];
-    Tmemset(szLine, 0, LM_STRSIZEL);
-
-    int iLine = 0, iId = 0, iBalanceFunc = 0, iBalanceLoop = 0, iBalanceComment = 0, iLen;
-
-    nLengthA = 0;
-
     // Remove previous error and debugging markers
     MarkerDeleteAll(SCRIPT_MASK_ERRORBIT);
     MarkerDeleteAll(SCRIPT_MASK_DEBUGBIT);
     //
 
-    for (int ii = 0; ii < iLineCount; ii++) {
-
-        strBufferW = GetLine(ii);
-        nLengthW = strBufferW.Length();
-        if (nLengthW < 1) {
-            // Empty line (keep all lines to make the link with breakpoints)
-            pszBufferA[nLengthA] = LM_NEWLINE_CHARA;
-            pszBufferA[nLengthA + 1] = '\0';
-            nLengthA += 1;
-            continue;
-        }
-
-        // Too long line?
-        if (nLengthW >= (iLineMaxLen - 2)) {
-            free(pszBufferA);
-            pszBufferA = NULL;
-
-            setRunning(false);
-            this->SetReadOnly(bReadWriteStatus);
-
-            wxString strT = wxString::Format(uT("Cannot run script: line %d too long (maximum: %d characters)."), ii + 1, iLineMaxLen - 2);
-            pFrame->OutputStatusbar(strT, SIGMAFRAME_TIMER_SHORT);
-            SigmaMessageBox(strT, uT("Comet"), wxOK | wxICON_EXCLAMATION, this);
-
-            return false;
-        }
-        //
-
-        // Convert from Unicode to ANSI
-        nLenLineA = strlen(LM_U8STR(strBufferW));
-        strcat(pszBufferA, LM_U8STR(strBufferW));
-        nLengthA += nLenLineA;
-        //
-
-        // Add newline if necessary
-        if (pszBufferA[nLengthA - 1] != LM_NEWLINE_CHARA) {
-            pszBufferA[nLengthA] = LM_NEWLINE_CHARA;
-            pszBufferA[nLengthA + 1] = '\0';
-            nLengthA += 1;
-        }
-        //
-
-        // Analyse every line of the code
-        if (m_bEnableCodeAnalyzer && (m_pCodeAnalyzer != NULL) && (m_pCodeAnalyzer->getCount() < CodeAnalyzer::MAXCOUNT)) {
-
-            Tstrncpy(szLine, LM_CSTR(strBufferW), LM_STRSIZEL - 1);
-
-            iLen = lm_trim(szLine);
-
-            if (iLen >= 4) {
-                // Comment block?
-                if ((szLine[0] == uT('-')) && (szLine[1] == uT('-')) && (szLine[2] == uT('[')) && (szLine[3] == uT('['))) {
-                    iBalanceComment += 1;
-                    iLine += 1;
-                    continue;
-                }
-                else if ((szLine[0] == uT('-')) && (szLine[1] == uT('-')) && (szLine[2] == uT(']')) && (szLine[3] == uT(']'))) {
-                    iBalanceComment -= 1;
-                    iLine += 1;
-                    continue;
-                }
-                else if ((szLine[iLen - 2] == uT(']')) && (szLine[iLen - 1] == uT(']'))) {
-                    iBalanceComment -= 1;
-                    iLine += 1;
-                    continue;
-                }
-            }
-            else if (iLen >= 2) {
-                // Comment block?
-                if ((szLine[iLen - 2] == uT(']')) && (szLine[iLen - 1] == uT(']'))) {
-                    iBalanceComment -= 1;
-                    iLine += 1;
-                    continue;
-                }
-            }
-
-            if (iBalanceComment > 0) {
-                iLine += 1;
-                continue;
-            }
-
-            m_pCodeAnalyzer->analyzeLine(szLine, iLen, &iId, &iLine, &iBalanceFunc, &iBalanceLoop);
-        }
-        //
-    }
-
-    // Update the multifunction toolbar combobox, if necessary
+    // Update the function list (only the lines modified since the last analysis are read again,
+    // in the background for large scripts)
     if (m_bEnableCodeAnalyzer && (m_pCodeAnalyzer != NULL)) {
+        m_pCodeAnalyzer->setLanguage(CodeAnalyzer::LANGUAGE_LUA);
         pFrame->DoAnalyzerUpdate(false, false);
     }
     //
@@ -739,11 +630,10 @@ bool ScriptEdit::luaRunScript(void)
         pThread = NULL;
     }
     if (pThread == NULL) {
-        free(pszBufferA);
-        pszBufferA = NULL;
+        free(pszScriptA);
+        pszScriptA = NULL;
 
         setRunning(false);
-        this->SetReadOnly(bReadWriteStatus);
 
         pFrame->OutputStatusbar(uT("Cannot start the working thread: insufficient memory"), SIGMAFRAME_TIMER_SHORT);
         SigmaMessageBox(uT("Cannot start the working thread: insufficient memory"), uT("Comet"), wxOK | wxICON_EXCLAMATION, this);
@@ -763,13 +653,11 @@ bool ScriptEdit::luaRunScript(void)
         //
     }
 
-    wxThreadError errT = pThread->Create((void *)this, pszBufferA, iBufferSize, iLineCount);
-
-    free(pszBufferA);
-    pszBufferA = NULL;
+    luaBreakpoints();
 
-    // Restore script read-write status
-    this->SetReadOnly(bReadWriteStatus);
+    // The thread takes the script buffer
+    wxThreadError errT = pThread->Create((void *)this, pszScriptA, iLineCount);
+    pszScriptA = NULL;
 
     if (errT != wxTHREAD_NO_ERROR) {
         setRunning(false);
@@ -812,14 +700,14 @@ bool ScriptEdit::luaReset(void)
         return false;
     }
 
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bStopIt = false;
-        m_bReadDone = false;
-        m_strRead = uT("");
-        m_bAskDone = false;
-        m_iAnswer = -1;
-        m_pMutex->Unlock();
-    }
+    m_pMutex->Lock();
+    m_bStopIt = false;
+    m_bReadDone = false;
+    m_strRead = uT("");
+    m_bAskDone = false;
+    m_iAnswer = -1;
+    m_iDebugState += 1;
+    m_pMutex->Unlock();
 
     return true;
 }
@@ -831,13 +719,13 @@ bool ScriptEdit::luaStopScript(void)
         return false;
     }
 
-    bool bRet = false;
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bDebugIt = false;
-        m_bStopIt = true;
-        bRet = m_bStopIt;
-        m_pMutex->Unlock();
-    }
+    m_pMutex->Lock();
+    m_bDebugIt = false;
+    m_bStopIt = true;
+    m_iDebugState += 1;
+    bool bRet = m_bStopIt;
+    m_pCondition->Broadcast();
+    m_pMutex->Unlock();
 
     return bRet;
 }
@@ -849,15 +737,124 @@ bool ScriptEdit::luaDebugScript(void)
         return false;
     }
 
-    bool bRet = false;
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bDebugIt = true;
-        m_bStopIt = false;
-        bRet = m_bDebugIt;
+    m_pMutex->Lock();
+    m_bDebugIt = true;
+    m_bStopIt = false;
+    m_iDebugState += 1;
+    bool bRet = m_bDebugIt;
+    m_pCondition->Broadcast();
+    m_pMutex->Unlock();
+
+    return bRet;
+}
+
+int ScriptEdit::luaInspect(int iHandle, int iLevel, int iFirst)
+{
+    if ((NULL == m_pMutex) || (NULL == m_pDebugPause) || (isDebugging() == false)) {
+        return 0;
+    }
+
+    m_iDebugRequest += 1;
+
+    DebugRequest tRequest;
+    tRequest.id = m_iDebugRequest;
+    tRequest.pause = m_pDebugPause->request.pause;
+    tRequest.handle = iHandle;
+    tRequest.level = iLevel;
+    tRequest.first = iFirst;
+
+    // Served by the script thread while paused (see ScriptThread::waitResume)
+    m_pMutex->Lock();
+    m_DebugRequests.push_back(tRequest);
+    m_pCondition->Broadcast();
+    m_pMutex->Unlock();
+
+    return tRequest.id;
+}
+
+void ScriptEdit::luaDebugPages(void)
+{
+    CometFrame *pFrame = static_cast<CometFrame *>(wxGetApp().getMainFrame());
+
+    std::vector<DebugPage *> vecPages;
+    m_pMutex->Lock();
+    vecPages.swap(m_DebugPages);
+    m_pMutex->Unlock();
+
+    for (size_t ii = 0; ii < vecPages.size(); ii++) {
+        DebugPage *pPage = vecPages[ii];
+        if (pPage->request.id == 0) {
+            // New pause
+            static int s_iDebugSerial = 0;
+            s_iDebugSerial += 1;
+            pPage->serial = s_iDebugSerial;
+            if (m_pDebugPause) {
+                delete m_pDebugPause;
+            }
+            m_pDebugPause = pPage;
+            if (pFrame) {
+                pFrame->UpdateDebugNotebook(this->GetFilename(), m_pDebugPause);
+            }
+            continue;
+        }
+        if (pFrame && m_pDebugPause && (pPage->request.pause == m_pDebugPause->request.pause)) {
+            pFrame->UpdateDebugItems(m_pDebugPause, pPage);
+        }
+        delete pPage;
+    }
+}
+
+void ScriptEdit::luaBreakpoints(void)
+{
+    if (NULL == m_pMutex) {
+        // should never happen
+        return;
+    }
+
+    std::vector<int> vecLines;
+    if (m_iLexer == wxSTC_LEX_LUA) {
+        for (int iLine = MarkerNext(0, SCRIPT_MASK_BREAKPOINT); iLine >= 0; iLine = MarkerNext(iLine + 1, SCRIPT_MASK_BREAKPOINT)) {
+            vecLines.push_back(iLine);
+        }
+    }
+
+    // Options at the current line of their marker (those of the removed breakpoints are dropped)
+    std::vector<DebugBreakpoint> vecOptions;
+    std::map<int, DebugBreakpoint>::iterator itO = m_BreakpointOptions.begin();
+    while (itO != m_BreakpointOptions.end()) {
+        int iLine = MarkerLineFromHandle(itO->first);
+        if (vecLines.empty() || (iLine < 0) || (std::binary_search(vecLines.begin(), vecLines.end(), iLine) == false)) {
+            m_BreakpointOptions.erase(itO++);
+            continue;
+        }
+        itO->second.line = iLine;
+        vecOptions.push_back(itO->second);
+        ++itO;
+    }
+
+    wxMutexLocker lockT(*m_pMutex);
+    m_DebugBreakpoints.swap(vecLines);
+    m_DebugConditions.swap(vecOptions);
+    m_iBreakpointGeneration += 1;
+    m_iDebugState += 1;
+}
+
+void ScriptEdit::luaDebugClear(void)
+{
+    if (m_pMutex) {
+        m_pMutex->Lock();
+        for (size_t ii = 0; ii < m_DebugPages.size(); ii++) {
+            delete m_DebugPages[ii];
+        }
+        m_DebugPages.clear();
+        m_DebugRequests.clear();
         m_pMutex->Unlock();
     }
 
-    return bRet;
+    if (m_pDebugPause) {
+        delete m_pDebugPause;
+        m_pDebugPause = NULL;
+    }
 }
 
 bool ScriptEdit::isRunning(bool *pbProcess /* = NULL*/)
@@ -899,27 +896,27 @@ void ScriptEdit::setRunning(bool bRunning)
     m_bRunning = bRunning;
 
     // >> Lock
-    if (m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        m_bStopIt = false;
-        if (m_bRunning == false) {
-            m_bDebugIt = false;
-        }
-        m_bReadDone = false;
-        m_bAskDone = false;
-        m_strRead = uT("");
-        m_iAnswer = -1;
-        m_pLuaEngine = NULL; // allocated in ScriptThread
-        m_iRunningLine = -1;
-        m_bGuierrSet = false;
-        m_pMutex->Unlock();
+    m_pMutex->Lock();
+    m_bStopIt = false;
+    if (m_bRunning == false) {
+        m_bDebugIt = false;
     }
+    m_bReadDone = false;
+    m_bAskDone = false;
+    m_strRead = uT("");
+    m_iAnswer = -1;
+    m_pLuaEngine = NULL; // allocated in ScriptThread
+    m_iRunningLine = -1;
+    m_bGuierrSet = false;
+    m_pMutex->Unlock();
 
     m_bDebugging = m_bDebugIt;
+    m_iDebugState += 1;
 
     SetReadOnly(m_bDebugging);
 
     if (bRunning) {
-        m_strDebugTrace.Empty();
+        luaDebugClear();
         struct timeval timevalNow;
         gettimeofday(&timevalNow, NULL);
         m_fStartTime = (((double)(timevalNow.tv_sec)) * 1000.0) + (((double)(timevalNow.tv_usec)) / 1000.0);
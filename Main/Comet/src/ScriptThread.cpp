@@ -21,6 +21,8 @@
 #include <wx/file.h>     // raw file io support
 #include <wx/filename.h> // filename support
 
+#include <algorithm>
+
 extern void luaHook(lua_State *pLua, lua_Debug *pDebug); // Hook to force Lua to stop the current script
 
 // IO
@@ -45,7 +47,7 @@ static const luaL_Reg CFUNCTION_IO[] = {
     { NULL, NULL }
 };
 
-wxThreadError ScriptThread::Create(void *pEdit, char *pszBufferA, size_t iBufferSize, int iLineCount)
+wxThreadError ScriptThread::Create(void *pEdit, char *pszBufferA, int iLineCount)
 {
     // Should never happen, since Create in called once, after constructor
     if (m_pLuaEngine) {
@@ -56,34 +58,20 @@ wxThreadError ScriptThread::Create(void *pEdit, char *pszBufferA, size_t iBuffer
         free(m_pszBufferA);
         m_pszBufferA = NULL;
     }
-    if (m_pszBufferStack) {
-        free(m_pszBufferStack);
-        m_pszBufferStack = NULL;
-    }
     //
 
-    m_pLuaEngine = new (std::nothrow) LuaEngine(LUA_ENGINE_GUI, CFUNCTION_IO, true);
-    if (m_pLuaEngine == NULL) {
-        return wxTHREAD_NO_RESOURCE;
-    }
-    m_pszBufferA = (char *)malloc((iBufferSize + 1) * sizeof(char));
+    // No copy: the script is run from the editor snapshot
+    m_pszBufferA = pszBufferA;
     if (m_pszBufferA == NULL) {
-        delete m_pLuaEngine;
-        m_pLuaEngine = NULL;
         return wxTHREAD_NO_RESOURCE;
     }
-    memcpy(m_pszBufferA, pszBufferA, iBufferSize * sizeof(char));
-    m_pszBufferA[iBufferSize] = '\0';
 
-    m_pszBufferStack = (char *)malloc(iLineCount * LM_STRSIZE * sizeof(char));
-    if (m_pszBufferStack == NULL) {
-        delete m_pLuaEngine;
-        m_pLuaEngine = NULL;
+    m_pLuaEngine = new (std::nothrow) LuaEngine(LUA_ENGINE_GUI, CFUNCTION_IO, true);
+    if (m_pLuaEngine == NULL) {
         free(m_pszBufferA);
         m_pszBufferA = NULL;
         return wxTHREAD_NO_RESOURCE;
     }
-    memset(m_pszBufferStack, 0, iLineCount * LM_STRSIZE * sizeof(char));
 
     m_pEdit = pEdit;
     m_pMainFrame = NULL;
@@ -109,18 +97,34 @@ wxThreadError ScriptThread::Create(void *pEdit, char *pszBufferA, size_t iBuffer
     lua_settable(pLuaState, LUA_REGISTRYINDEX);
 
     // Possibility to debug the running script
+    // (the line events are then enabled only where needed, see updateHook)
     if (debugIt()) {
-        lua_sethook(pLuaState, &luaHook, LUA_MASKLINE | LUA_MASKCALL | LUA_MASKRET, 0);
+        // An error caught by pcall or xpcall unwinds the stack without return events, and
+        // pcall itself sends none: its caller would run with the line events set for the
+        // called function. The wrappers end with a Lua function return, which updates them.
+        static const char szProtected[] = "local pcall, xpcall = pcall, xpcall\n"
+                                          "local function resumed(...) return ... end\n"
+                                          "_G.pcall = function(...) return resumed(pcall(...)) end\n"
+                                          "_G.xpcall = function(...) return resumed(xpcall(...)) end\n";
+        if ((luaL_loadbuffer(pLuaState, szProtected, sizeof(szProtected) - 1, "=debugger") != 0) || (lua_pcall(pLuaState, 0, 0, 0) != 0)) {
+            lua_pop(pLuaState, 1);
+        }
+        m_iHookMask = LUA_MASKLINE | LUA_MASKCALL | LUA_MASKRET;
+        lua_sethook(pLuaState, &luaHook, m_iHookMask, 0);
         m_pLuaEngine->setDebugging(true);
     }
 
     ScriptEdit *pScriptEdit = (ScriptEdit *)m_pEdit;
-    if (pScriptEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        pScriptEdit->m_pLuaEngine = m_pLuaEngine;
-        pScriptEdit->m_pMutex->Unlock();
-    }
+    pScriptEdit->m_pMutex->Lock();
+    pScriptEdit->m_pLuaEngine = m_pLuaEngine;
+    pScriptEdit->m_pMutex->Unlock();
 
-    return wxThread::Create();
+    wxThreadError errT = wxThread::Create();
+    if (errT != wxTHREAD_NO_ERROR) {
+        free(m_pszBufferA);
+        m_pszBufferA = NULL;
+    }
+    return errT;
 }
 
 wxThread::ExitCode ScriptThread::Entry()
@@ -173,32 +177,547 @@ void ScriptThread::highlightLine(int iLine)
     }
 }
 
-bool ScriptThread::breakpointIn(int iLine)
+// Function defined in the script itself (not in a loaded module or string).
+// The script is run with luaL_dostring: its chunk name is the script text.
+bool ScriptThread::isScript(const char *pszSource)
 {
+    if (pszSource == NULL) {
+        return false;
+    }
+    if (pszSource == m_pszHookSource) {
+        return true;
+    }
+    if ((m_pszHookSource == NULL) && (strcmp(pszSource, m_pszBufferA) == 0)) {
+        // Interned by Lua: the next ones are compared by address
+        m_pszHookSource = pszSource;
+        return true;
+    }
+    return false;
+}
+
+// bPlain: breakpoints with options excluded (they do not break in the called functions)
+bool ScriptThread::breakpointIn(const char *pszSource, int iLine, bool bPlain /* = false*/)
+{
+    if (m_Breakpoints.empty() || (isScript(pszSource) == false)) {
+        return false;
+    }
+    if (std::binary_search(m_Breakpoints.begin(), m_Breakpoints.end(), iLine) == false) {
+        return false;
+    }
+    return (bPlain == false) || (m_Conditions.find(iLine) == m_Conditions.end());
+}
+
+// Breakpoint with options (see checkBreakpoint) at iLine
+bool ScriptThread::conditionIn(const char *pszSource, int iLine)
+{
+    return (m_Conditions.find(iLine) != m_Conditions.end()) && breakpointIn(pszSource, iLine);
+}
+
+// Names used by a condition or by the {expressions} of a message: keywords and fields
+// (t.name, t:name) excluded. A name found twice is kept once.
+static void conditionNames(const std::string &strText, bool bMessage, std::vector<std::string> &vecNames)
+{
+    static const char *KEYWORDS[] = { "and", "break", "do", "else", "elseif", "end", "false", "for", "function", "goto", "if", "in",
+        "local", "nil", "not", "or", "repeat", "return", "then", "true", "until", "while", NULL };
+
+    int iDepth = bMessage ? 0 : 1;
+    size_t iPos = 0;
+    while (iPos < strText.size()) {
+        char cT = strText[iPos];
+        if (bMessage && ((cT == '{') || (cT == '}'))) {
+            iDepth = (cT == '{') ? 1 : 0;
+            iPos += 1;
+            continue;
+        }
+        if ((iDepth == 0) || ((isalpha((unsigned char)cT) == 0) && (cT != '_'))) {
+            // numbers (1e5, 0xff) skipped as a whole
+            iPos += 1;
+            while (isalnum((unsigned char)cT) && (iPos < strText.size()) && (isalnum((unsigned char)(strText[iPos])) || (strText[iPos] == '_'))) {
+                iPos += 1;
+            }
+            continue;
+        }
+        size_t iStart = iPos;
+        while ((iPos < strText.size()) && (isalnum((unsigned char)(strText[iPos])) || (strText[iPos] == '_'))) {
+            iPos += 1;
+        }
+        size_t iPrev = iStart;
+        while ((iPrev > 0) && isspace((unsigned char)(strText[iPrev - 1]))) {
+            iPrev -= 1;
+        }
+        if ((iPrev > 0) && (strText[iPrev - 1] == ':')) {
+            continue;
+        }
+        if ((iPrev > 0) && (strText[iPrev - 1] == '.') && ((iPrev < 2) || (strText[iPrev - 2] != '.'))) {
+            continue;
+        }
+        std::string strName = strText.substr(iStart, iPos - iStart);
+        bool bKeyword = false;
+        for (int ii = 0; KEYWORDS[ii] != NULL; ii++) {
+            if (strName == KEYWORDS[ii]) {
+                bKeyword = true;
+                break;
+            }
+        }
+        if ((bKeyword == false) && (std::find(vecNames.begin(), vecNames.end(), strName) == vecNames.end())) {
+            vecNames.push_back(strName);
+        }
+    }
+}
+
+// Breakpoint options taken from the editor: the counts and the compiled functions
+// of the unchanged breakpoints are kept
+void ScriptThread::setConditions(const std::vector<DebugBreakpoint> &vecOptions)
+{
+    lua_State *pLua = m_pLuaEngine->getLuaState();
+
+    std::map<int, DebugCondition> mapConditions;
+    for (std::vector<DebugBreakpoint>::const_iterator itO = vecOptions.begin(); itO != vecOptions.end(); ++itO) {
+        DebugCondition &tCondition = mapConditions[itO->line];
+        std::map<int, DebugCondition>::iterator itC = m_Conditions.find(itO->line);
+        if ((itC != m_Conditions.end()) && itC->second.options.isSame(*itO)) {
+            tCondition = itC->second;
+            itC->second.condition = LUA_NOREF;
+            itC->second.message = LUA_NOREF;
+            itC->second.bind = LUA_NOREF;
+        }
+        else {
+            conditionNames(itO->condition, false, tCondition.names);
+            conditionNames(itO->message, true, tCondition.names);
+        }
+        tCondition.options = *itO;
+    }
+
+    for (std::map<int, DebugCondition>::iterator itC = m_Conditions.begin(); itC != m_Conditions.end(); ++itC) {
+        luaL_unref(pLua, LUA_REGISTRYINDEX, itC->second.condition);
+        luaL_unref(pLua, LUA_REGISTRYINDEX, itC->second.message);
+        luaL_unref(pLua, LUA_REGISTRYINDEX, itC->second.bind);
+    }
+    m_Conditions.swap(mapConditions);
+}
+
+void ScriptThread::reportCondition(DebugCondition &tCondition, int iLine, const char *pszError)
+{
+    if (tCondition.reported) {
+        return;
+    }
+    tCondition.reported = true;
+
     ScriptEdit *pEdit = (ScriptEdit *)m_pEdit;
 
-    bool bBreakpoint = false;
+    wxString strT = wxString::Format(uT("! Breakpoint at line %d: "), iLine + 1);
+    strT += LM_U8TOWC((pszError != NULL) ? pszError : "error");
+    strT += uT("\n");
 
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        bBreakpoint = pEdit->breakpointIn(iLine);
-        pEdit->m_pMutex->Unlock();
+    wxCommandEvent eventT(wxEVT_COMMAND_TEXT_UPDATED, ID_THREAD_PRINT);
+    eventT.SetString(strT);
+    pEdit->GetEventHandler()->AddPendingEvent(eventT);
+}
+
+// The condition and the message are compiled into functions with the bound names (the locals
+// and upvalues of the line that they use) as upvalues, set before each evaluation:
+//      local a, b
+//      return function() return (condition) end, function() return message end, function(...) a, b = ... end
+// so that they are evaluated as written in the script. The other names are globals.
+bool ScriptThread::compileCondition(lua_State *pLua, DebugCondition &tCondition, int iLine)
+{
+    luaL_unref(pLua, LUA_REGISTRYINDEX, tCondition.condition);
+    luaL_unref(pLua, LUA_REGISTRYINDEX, tCondition.message);
+    luaL_unref(pLua, LUA_REGISTRYINDEX, tCondition.bind);
+    tCondition.condition = LUA_NOREF;
+    tCondition.message = LUA_NOREF;
+    tCondition.bind = LUA_NOREF;
+    tCondition.compiled = true;
+
+    std::string strNames;
+    for (size_t ii = 0; ii < tCondition.bound.size(); ii++) {
+        if (ii > 0) {
+            strNames += ", ";
+        }
+        strNames += tCondition.bound[ii];
+    }
+
+    std::string strCode;
+    if (strNames.empty() == false) {
+        strCode = "local " + strNames + "\n";
+    }
+    strCode += "return ";
+
+    for (int ii = 0; ii < 2; ii++) {
+        std::string strBody;
+        if (ii == 0) {
+            if (tCondition.options.condition.empty()) {
+                strCode += "nil, ";
+                continue;
+            }
+            strBody = "(" + tCondition.options.condition + "\n)";
+        }
+        else {
+            if (tCondition.options.message.empty()) {
+                strCode += "nil, ";
+                continue;
+            }
+            // "x = {x}" -> "x = " .. tostring(x)
+            const std::string &strMessage = tCondition.options.message;
+            std::string strText;
+            size_t iPos = 0;
+            while (iPos <= strMessage.size()) {
+                size_t iOpen = strMessage.find('{', iPos);
+                size_t iClose = (iOpen == std::string::npos) ? std::string::npos : strMessage.find('}', iOpen + 1);
+                if (iClose == std::string::npos) {
+                    iOpen = strMessage.size();
+                }
+                strText = "\"";
+                for (size_t jj = iPos; jj < iOpen; jj++) {
+                    char cT = strMessage[jj];
+                    if ((cT == '\\') || (cT == '"')) {
+                        strText += '\\';
+                        strText += cT;
+                    }
+                    else if ((cT == '\r') || (cT == '\n')) {
+                        strText += ' ';
+                    }
+                    else {
+                        strText += cT;
+                    }
+                }
+                strText += "\"";
+                strBody += strBody.empty() ? strText : (" .. " + strText);
+                if (iClose == std::string::npos) {
+                    break;
+                }
+                strBody += " .. tostring(" + strMessage.substr(iOpen + 1, iClose - iOpen - 1) + ")";
+                iPos = iClose + 1;
+            }
+        }
+        // new lines: the condition may end with a comment
+        strCode += "function() return " + strBody + "\nend, ";
+    }
+
+    if (strNames.empty()) {
+        strCode += "nil";
+    }
+    else {
+        strCode += "function(...) " + strNames + " = ... end";
+    }
+
+    if ((luaL_loadbuffer(pLua, strCode.c_str(), strCode.size(), "=breakpoint") != 0) || (lua_pcall(pLua, 0, 3, 0) != 0)) {
+        reportCondition(tCondition, iLine, lua_tostring(pLua, -1));
+        lua_pop(pLua, 1);
+        return false;
+    }
+    tCondition.bind = luaL_ref(pLua, LUA_REGISTRYINDEX);
+    tCondition.message = luaL_ref(pLua, LUA_REGISTRYINDEX);
+    tCondition.condition = luaL_ref(pLua, LUA_REGISTRYINDEX);
+
+    return true;
+}
+
+// Values of the bound names, from the slots found by findSlots. Returns false if the slots
+// are no longer valid: another function, or another local at the index (the names given
+// by Lua point into the debug information of the function and are compared by address).
+bool ScriptThread::pushSlots(lua_State *pLua, lua_Debug *pDebug, DebugCondition &tCondition, int iFunction)
+{
+    if (lua_topointer(pLua, iFunction) != tCondition.function) {
+        return false;
+    }
+    for (size_t ii = 0; ii < tCondition.slots.size(); ii++) {
+        const int iSlot = tCondition.slots[ii];
+        const char *pszName = (iSlot > 0) ? lua_getlocal(pLua, pDebug, iSlot) : lua_getupvalue(pLua, iFunction, -iSlot);
+        if (pszName != tCondition.slotnames[ii]) {
+            if (pszName != NULL) {
+                lua_pop(pLua, 1);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+// Locals (the last one of a name hides the others) and upvalues of the function at iFunction
+// for the names used by the condition and the message. Compiled again if the bound names change.
+void ScriptThread::findSlots(lua_State *pLua, lua_Debug *pDebug, DebugCondition &tCondition, int iFunction, int iLine)
+{
+    std::vector<std::string> vecBound;
+
+    tCondition.function = lua_topointer(pLua, iFunction);
+    tCondition.slots.clear();
+    tCondition.slotnames.clear();
+
+    for (std::vector<std::string>::const_iterator itN = tCondition.names.begin(); itN != tCondition.names.end(); ++itN) {
+        int iSlot = 0;
+        const char *pszSlot = NULL;
+        for (int ii = 1;; ii++) {
+            const char *pszName = lua_getlocal(pLua, pDebug, ii);
+            if (pszName == NULL) {
+                break;
+            }
+            lua_pop(pLua, 1);
+            if (*itN == pszName) {
+                iSlot = ii;
+                pszSlot = pszName;
+            }
+        }
+        for (int ii = 1; iSlot == 0; ii++) {
+            const char *pszName = lua_getupvalue(pLua, iFunction, ii);
+            if (pszName == NULL) {
+                break;
+            }
+            lua_pop(pLua, 1);
+            if (*itN == pszName) {
+                iSlot = -ii;
+                pszSlot = pszName;
+            }
+        }
+        if (iSlot != 0) {
+            vecBound.push_back(*itN);
+            tCondition.slots.push_back(iSlot);
+            tCondition.slotnames.push_back(pszSlot);
+        }
+    }
+
+    if ((tCondition.compiled == false) || (tCondition.bound != vecBound)) {
+        tCondition.bound.swap(vecBound);
+        compileCondition(pLua, tCondition, iLine);
+    }
+}
+
+// Conditional breakpoint, hit count or logpoint reached at iLine (active level), evaluated
+// in the script state without waiting for the editor. Returns true to break.
+bool ScriptThread::checkBreakpoint(lua_State *pLua, lua_Debug *pDebug, int iLine)
+{
+    std::map<int, DebugCondition>::iterator itC = m_Conditions.find(iLine);
+    if (itC == m_Conditions.end()) {
+        return true;
+    }
+    DebugCondition &tCondition = itC->second;
+
+    const int iTop = lua_gettop(pLua);
+
+    // Bound names set to their values at the line, then to nil after the evaluation
+    bool bBound = false;
+    if ((tCondition.options.condition.empty() == false) || (tCondition.options.message.empty() == false)) {
+        lua_getinfo(pLua, "f", pDebug);
+        if ((tCondition.compiled == false) || (pushSlots(pLua, pDebug, tCondition, iTop + 1) == false)) {
+            lua_settop(pLua, iTop + 1);
+            findSlots(pLua, pDebug, tCondition, iTop + 1, iLine);
+            pushSlots(pLua, pDebug, tCondition, iTop + 1);
+        }
+        if (tCondition.bind != LUA_NOREF) {
+            lua_rawgeti(pLua, LUA_REGISTRYINDEX, tCondition.bind);
+            lua_insert(pLua, iTop + 2);
+            bBound = (lua_pcall(pLua, (int)(tCondition.slots.size()), 0, 0) == 0);
+        }
+        lua_settop(pLua, iTop);
+    }
+
+    bool bBreak = true;
+
+    if ((tCondition.options.condition.empty() == false) && (tCondition.condition != LUA_NOREF)) {
+        lua_rawgeti(pLua, LUA_REGISTRYINDEX, tCondition.condition);
+        if (lua_pcall(pLua, 0, 1, 0) != 0) {
+            // Breaks: the error is shown in the output
+            reportCondition(tCondition, iLine, lua_tostring(pLua, -1));
+        }
+        else {
+            bBreak = (lua_toboolean(pLua, -1) != 0);
+        }
+        lua_pop(pLua, 1);
+    }
+
+    if (bBreak) {
+        tCondition.count += 1;
+        bBreak = (tCondition.count >= tCondition.options.hits);
+    }
+
+    if (bBreak && (tCondition.options.message.empty() == false) && (tCondition.message != LUA_NOREF)) {
+        // Logpoint: printed without breaking
+        lua_rawgeti(pLua, LUA_REGISTRYINDEX, tCondition.message);
+        if (lua_pcall(pLua, 0, 1, 0) != 0) {
+            reportCondition(tCondition, iLine, lua_tostring(pLua, -1));
+        }
+        else {
+            const char *pszMessage = lua_tostring(pLua, -1);
+            ScriptEdit *pEdit = (ScriptEdit *)m_pEdit;
+            wxString strT = LM_U8TOWC((pszMessage != NULL) ? pszMessage : "");
+            strT += uT("\n");
+            wxCommandEvent eventT(wxEVT_COMMAND_TEXT_UPDATED, ID_THREAD_PRINT);
+            eventT.SetString(strT);
+            pEdit->GetEventHandler()->AddPendingEvent(eventT);
+        }
+        bBreak = false;
     }
 
-    return bBreakpoint;
+    if (bBound) {
+        // the values are not kept alive by the breakpoint
+        lua_rawgeti(pLua, LUA_REGISTRYINDEX, tCondition.bind);
+        if (lua_pcall(pLua, 0, 0, 0) != 0) {
+            lua_pop(pLua, 1);
+        }
+    }
+
+    lua_settop(pLua, iTop);
+    return bBreak;
 }
 
-bool ScriptThread::stepInto(void)
+// Breakpoint on one of the lines with code of the function (its nested functions excluded),
+// found once per function from its active lines. The results are kept in a registry table
+// with weak keys, by function: a collected function cannot be taken for a new one.
+bool ScriptThread::hasBreakpoint(lua_State *pLua, lua_Debug *pDebug)
+{
+    if (m_Breakpoints.empty() || (isScript(pDebug->source) == false)) {
+        return false;
+    }
+
+    lua_pushliteral(pLua, "___SigmaHookFunctions___");
+    lua_rawget(pLua, LUA_REGISTRYINDEX);
+    if ((m_bHookFunctions == false) || (lua_istable(pLua, -1) == 0)) {
+        // Created again when the breakpoints change
+        lua_pop(pLua, 1);
+        lua_newtable(pLua);
+        lua_newtable(pLua);
+        lua_pushliteral(pLua, "k");
+        lua_setfield(pLua, -2, "__mode");
+        lua_setmetatable(pLua, -2);
+        lua_pushliteral(pLua, "___SigmaHookFunctions___");
+        lua_pushvalue(pLua, -2);
+        lua_rawset(pLua, LUA_REGISTRYINDEX);
+        m_bHookFunctions = true;
+    }
+    const int iFunctions = lua_gettop(pLua);
+
+    lua_getinfo(pLua, "f", pDebug);
+    lua_pushvalue(pLua, -1);
+    lua_rawget(pLua, iFunctions);
+    if (lua_isboolean(pLua, -1)) {
+        const bool bCached = (lua_toboolean(pLua, -1) != 0);
+        lua_settop(pLua, iFunctions - 1);
+        return bCached;
+    }
+    lua_pop(pLua, 1);
+
+    bool bFound = false;
+
+    lua_getinfo(pLua, "L", pDebug);
+    if (lua_istable(pLua, -1)) {
+        // Lines counted from 1 by Lua, from 0 in the editor; main chunk: linedefined is 0
+        std::vector<int>::const_iterator itB = std::lower_bound(m_Breakpoints.begin(), m_Breakpoints.end(), pDebug->linedefined - 1);
+        for (; (itB != m_Breakpoints.end()) && ((pDebug->linedefined == 0) || (*itB < pDebug->lastlinedefined)); ++itB) {
+            lua_rawgeti(pLua, -1, *itB + 1);
+            bFound = (lua_isnil(pLua, -1) == 0);
+            lua_pop(pLua, 1);
+            if (bFound) {
+                break;
+            }
+        }
+    }
+    lua_pop(pLua, 1);
+
+    // functions[f] = bFound
+    lua_pushboolean(pLua, bFound ? 1 : 0);
+    lua_rawset(pLua, iFunctions);
+    lua_settop(pLua, iFunctions - 1);
+
+    return bFound;
+}
+
+// Debugging state read with one lock, only if it changed since the last call: otherwise
+// the state read then is returned (the breakpoints are copied if they changed).
+// Returns false if the script is stopped by the user.
+bool ScriptThread::syncDebug(bool *pbDebugIt, bool *pbStepInto)
 {
     ScriptEdit *pEdit = (ScriptEdit *)m_pEdit;
 
-    bool bStepInto = false;
+    const int iDebugState = pEdit->m_iDebugState.load();
+    if (iDebugState == m_iDebugState) {
+        *pbDebugIt = m_bSyncDebugIt;
+        *pbStepInto = m_bSyncStepInto;
+        return (m_bSyncStop == false);
+    }
 
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        bStepInto = pEdit->stepInto();
-        pEdit->m_pMutex->Unlock();
+    bool bStop = false;
+    bool bDebugging = false;
+    bool bChanged = false;
+    std::vector<DebugBreakpoint> vecOptions;
+
+    pEdit->m_pMutex->Lock();
+    m_iDebugState = pEdit->m_iDebugState.load();
+    bStop = pEdit->m_bStopIt;
+    bDebugging = pEdit->m_bDebugging;
+    *pbDebugIt = pEdit->m_bDebugIt;
+    *pbStepInto = pEdit->stepInto();
+    if (pEdit->m_iBreakpointGeneration != m_iBreakpointGeneration) {
+        m_Breakpoints = pEdit->m_DebugBreakpoints;
+        m_iBreakpointGeneration = pEdit->m_iBreakpointGeneration;
+        m_bHookFunctions = false;
+        vecOptions = pEdit->m_DebugConditions;
+        bChanged = true;
     }
+    pEdit->m_pMutex->Unlock();
+
+    m_bSyncStop = bStop;
+    m_bSyncDebugIt = *pbDebugIt;
+    m_bSyncStepInto = *pbStepInto;
 
-    return bStepInto;
+    if (bChanged) {
+        setConditions(vecOptions);
+    }
+
+    if (bDebugging == false) {
+        m_iHookMask = 0;
+        lua_sethook(m_pLuaEngine->getLuaState(), &luaHook, 0, 0);
+        m_pLuaEngine->setDebugging(false);
+    }
+
+    return (bStop == false);
+}
+
+// Line events enabled only while a break can occur: in the script functions containing
+// a breakpoint and, when stepping into, in the functions called from a breakpoint line.
+// The function that runs next is the first Lua function from iLevel
+// (0 when called or while running, 1 when returning).
+// Otherwise, the instruction count events keep the stop and the breakpoints changes checked.
+void ScriptThread::updateHook(lua_State *pLua, int iLevel, bool bStepInto)
+{
+    if (m_iHookMask == 0) {
+        // Not debugging anymore
+        return;
+    }
+
+    bool bLine = false;
+
+    lua_Debug ldT;
+    int iDepth = iLevel;
+    for (; iDepth < SCRIPT_HOOKDEPTH; iDepth++) {
+        if (lua_getstack(pLua, iDepth, &ldT) == 0) {
+            iDepth = SCRIPT_HOOKDEPTH;
+            break;
+        }
+        lua_getinfo(pLua, "Sl", &ldT);
+        if (*(ldT.what) != 'C') {
+            bLine = hasBreakpoint(pLua, &ldT);
+            break;
+        }
+    }
+
+    if ((bLine == false) && bStepInto) {
+        for (iDepth += 1; iDepth < SCRIPT_HOOKDEPTH; iDepth++) {
+            if (lua_getstack(pLua, iDepth, &ldT) == 0) {
+                break;
+            }
+            lua_getinfo(pLua, "Sl", &ldT);
+            if (breakpointIn(ldT.source, ldT.currentline - 1, true)) {
+                bLine = true;
+                break;
+            }
+        }
+    }
+
+    const int iMask = LUA_MASKCALL | LUA_MASKRET | (bLine ? LUA_MASKLINE : LUA_MASKCOUNT);
+    if (iMask != m_iHookMask) {
+        m_iHookMask = iMask;
+        lua_sethook(pLua, &luaHook, iMask, bLine ? 0 : SCRIPT_HOOKCOUNT);
+    }
 }
 
 bool ScriptThread::debugIt(void)
@@ -208,11 +727,10 @@ bool ScriptThread::debugIt(void)
     bool bDebug = false;
     bool bDebugging = false;
 
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        bDebug = pEdit->m_bDebugIt;
-        bDebugging = pEdit->m_bDebugging;
-        pEdit->m_pMutex->Unlock();
-    }
+    pEdit->m_pMutex->Lock();
+    bDebug = pEdit->m_bDebugIt;
+    bDebugging = pEdit->m_bDebugging;
+    pEdit->m_pMutex->Unlock();
 
     if (bDebugging == false) {
         lua_sethook(m_pLuaEngine->getLuaState(), &luaHook, 0, 0);
@@ -228,72 +746,112 @@ bool ScriptThread::breakIt(lua_Debug *pDebug)
 
     bool bDebug = false;
 
-    if (m_pLuaEngine->debugStackTrace(m_pszBufferStack, (m_iLineCount * LM_STRSIZE) - 1, pDebug)) {
-        wxCommandEvent eventT(wxEVT_COMMAND_TEXT_UPDATED, ID_THREAD_STACK);
-
-        eventT.SetInt(pDebug->currentline);
-        wxString strStack = LM_U8TOWC(m_pszBufferStack);
-        eventT.SetString(strStack);
-        pEdit->GetEventHandler()->AddPendingEvent(eventT);
+    m_iPause += 1;
+
+    // Summary of the pause: the table fields are listed later, on demand (see inspect)
+    DebugPage *pPage = new (std::nothrow) DebugPage();
+    if (pPage != NULL) {
+        pPage->request.pause = m_iPause;
+        m_pLuaEngine->debugGetLocals(0, pPage->items);
+        std::vector<LuaDebugItem> vecGlobals;
+        m_pLuaEngine->debugGetGlobals(vecGlobals);
+        pPage->items.insert(pPage->items.end(), vecGlobals.begin(), vecGlobals.end());
+        m_pLuaEngine->debugGetStack(pPage->frames);
     }
 
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        pEdit->m_bDebugIt = false;
-        pEdit->m_pMutex->Unlock();
+    pEdit->m_pMutex->Lock();
+    pEdit->m_bDebugIt = false;
+    pEdit->m_iDebugState += 1;
+    if (pPage != NULL) {
+        pEdit->m_DebugPages.push_back(pPage);
     }
+    pEdit->m_pMutex->Unlock();
+
+    wxCommandEvent eventT(wxEVT_COMMAND_TEXT_UPDATED, ID_THREAD_STACK);
+    eventT.SetInt(pDebug->currentline);
+    pEdit->GetEventHandler()->AddPendingEvent(eventT);
 
     return bDebug;
 }
 
-bool ScriptThread::stopIt(void)
+void ScriptThread::inspect(const DebugRequest &tRequest)
 {
     ScriptEdit *pEdit = (ScriptEdit *)m_pEdit;
 
-    bool bStop = false;
+    if (tRequest.pause != m_iPause) {
+        // Handles of a previous pause
+        return;
+    }
 
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        bStop = pEdit->m_bStopIt;
-        pEdit->m_pMutex->Unlock();
+    DebugPage *pPage = new (std::nothrow) DebugPage();
+    if (pPage == NULL) {
+        return;
+    }
+    pPage->request = tRequest;
+    if (tRequest.handle > 0) {
+        m_pLuaEngine->debugGetChildren(tRequest.handle, tRequest.first, DEBUG_PAGESIZE, pPage->items, &(pPage->next));
+    }
+    else {
+        m_pLuaEngine->debugGetLocals(tRequest.level, pPage->items);
     }
 
-    return bStop;
+    pEdit->m_pMutex->Lock();
+    pEdit->m_DebugPages.push_back(pPage);
+    pEdit->m_pMutex->Unlock();
+
+    wxCommandEvent eventT(wxEVT_COMMAND_TEXT_UPDATED, ID_THREAD_INSPECT);
+    pEdit->GetEventHandler()->AddPendingEvent(eventT);
 }
 
-wxString ScriptThread::readStr(void)
+void ScriptThread::waitResume(void)
 {
     ScriptEdit *pEdit = (ScriptEdit *)m_pEdit;
 
-    bool bReadDone = false;
-
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        bReadDone = pEdit->m_bReadDone;
+    // Woken up by luaDebugScript (continue, step), luaStopScript or luaInspect
+    pEdit->m_pMutex->Lock();
+    while ((pEdit->m_bDebugIt == false) && (pEdit->m_bStopIt == false)) {
+        if (pEdit->m_DebugRequests.empty()) {
+            pEdit->m_pCondition->Wait();
+            continue;
+        }
+        DebugRequest tRequest = pEdit->m_DebugRequests.front();
+        pEdit->m_DebugRequests.erase(pEdit->m_DebugRequests.begin());
         pEdit->m_pMutex->Unlock();
+
+        inspect(tRequest);
+
+        pEdit->m_pMutex->Lock();
     }
+    pEdit->m_DebugRequests.clear();
+    pEdit->m_pMutex->Unlock();
 
-    // Wait until the end of the Read function
-    if (bReadDone == false) {
-        while (true) {
-            // Pause 50 ms and try again
-            Tsleep(50);
+    // The handles are not valid anymore
+    m_pLuaEngine->debugRelease();
+}
 
-            if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-                bReadDone = pEdit->m_bReadDone;
-                pEdit->m_pMutex->Unlock();
-            }
+bool ScriptThread::stopIt(void)
+{
+    ScriptEdit *pEdit = (ScriptEdit *)m_pEdit;
 
-            if (bReadDone) {
-                break;
-            }
-        }
-    }
+    wxMutexLocker lockT(*(pEdit->m_pMutex));
+    return pEdit->m_bStopIt;
+}
+
+wxString ScriptThread::readStr(void)
+{
+    ScriptEdit *pEdit = (ScriptEdit *)m_pEdit;
 
     wxString strT = uT("");
 
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
+    // Wait until the end of the Read function (or until the script is stopped)
+    wxMutexLocker lockT(*(pEdit->m_pMutex));
+    while ((pEdit->m_bReadDone == false) && (pEdit->m_bStopIt == false)) {
+        pEdit->m_pCondition->Wait();
+    }
+    if (pEdit->m_bReadDone) {
         strT = pEdit->m_strRead;
-        pEdit->m_bReadDone = false;
-        pEdit->m_pMutex->Unlock();
     }
+    pEdit->m_bReadDone = false;
 
     return strT;
 }
@@ -302,36 +860,17 @@ int ScriptThread::getAnswer(void)
 {
     ScriptEdit *pEdit = (ScriptEdit *)m_pEdit;
 
-    bool bAskDone = false;
-
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-        bAskDone = pEdit->m_bAskDone;
-        pEdit->m_pMutex->Unlock();
-    }
-
-    // Wait until the end of the Ask function
-    if (bAskDone == false) {
-        while (true) {
-            // Pause 50 ms and try again
-            Tsleep(50);
-
-            if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
-                bAskDone = pEdit->m_bAskDone;
-                pEdit->m_pMutex->Unlock();
-            }
-
-            if (bAskDone) {
-                break;
-            }
-        }
-    }
-
     int iAnswer = -1;
 
-    if (pEdit->m_pMutex->TryLock() == wxMUTEX_NO_ERROR) {
+    // Wait until the end of the Ask function (or until the script is stopped)
+    wxMutexLocker lockT(*(pEdit->m_pMutex));
+    while ((pEdit->m_bAskDone == false) && (pEdit->m_bStopIt == false)) {
+        pEdit->m_pCondition->Wait();
+    }
+    if (pEdit->m_bAskDone) {
         iAnswer = pEdit->m_iAnswer;
-        pEdit->m_pMutex->Unlock();
     }
+    pEdit->m_bAskDone = false;
 
     return iAnswer;
 }
@@ -346,10 +885,6 @@ void ScriptThread::OnExit()
         free(m_pszBufferA);
         m_pszBufferA = NULL;
     }
-    if (m_pszBufferStack) {
-        free(m_pszBufferStack);
-        m_pszBufferStack = NULL;
-    }
 
     m_pMainFrame = (void *)(wxGetApp().getMainFrame());
 
@@ -0,0 +1,762 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+
+#include "Identifiers.h"
+
+#include "CometApp.h"
+#include "CodeAnalyzer.h"
+#include "SymbolIndex.h"
+#include "SaveThread.h"
+#include "FileWatcher.h"
+
+#include <wx/dir.h>
+#include <wx/file.h>
+#include <wx/filename.h>
+
+#include <string.h>
+
+#include <algorithm>
+
+static const char SYMINDEX_MAGIC[8] = { 'C', 'M', 'T', 'S', 'Y', 'M', 'I', 'X' };
+
+// Files of the workspace under strDir, hidden directories excluded. Not with wxDir::Traverse,
+// which disables the logging of the whole process (wxLogNull) to open the subdirectories:
+// the directories that cannot be opened are skipped here.
+static void listFiles(const wxString &strDir, wxArrayString &arrFiles, volatile bool *pbStop, int iDepth)
+{
+    if (iDepth > SYMINDEX_MAXDEPTH) {
+        return;
+    }
+
+    wxString strPrefix = strDir;
+    if (strPrefix.IsEmpty() || (strPrefix.Last() != wxFILE_SEP_PATH)) {
+        strPrefix += wxFILE_SEP_PATH;
+    }
+
+    // The subdirectories are listed once this one is closed
+    wxArrayString arrDirs;
+    {
+        wxDir dirT;
+        if (dirT.Open(strDir) == false) {
+            return;
+        }
+
+        wxString strName;
+        for (bool bFound = dirT.GetFirst(&strName, wxEmptyString, wxDIR_FILES); bFound; bFound = dirT.GetNext(&strName)) {
+            if (*pbStop || (arrFiles.GetCount() >= SYMINDEX_MAXFILES)) {
+                return;
+            }
+            if (SymbolIndex::getLanguage(strName) >= 0) {
+                arrFiles.Add(strPrefix + strName);
+            }
+        }
+
+        for (bool bFound = dirT.GetFirst(&strName, wxEmptyString, wxDIR_DIRS); bFound; bFound = dirT.GetNext(&strName)) {
+            arrDirs.Add(strPrefix + strName);
+        }
+    }
+
+    for (size_t ii = 0; (ii < arrDirs.GetCount()) && (*pbStop == false); ii++) {
+        listFiles(arrDirs[ii], arrFiles, pbStop, iDepth + 1);
+    }
+}
+
+wxThread::ExitCode SymbolIndexThread::Entry()
+{
+    if (m_pIndex) {
+        m_pIndex->work(m_bScan);
+    }
+    return 0;
+}
+
+SymbolIndex::SymbolIndex(void *pFrame) : m_Condition(m_Mutex)
+{
+    m_pFrame = pFrame;
+    m_strRoot = wxEmptyString;
+    m_strIndexFile = wxEmptyString;
+    m_iRunning = 0;
+    m_iGeneration = 0;
+    m_bScanning = false;
+    m_bRescan = false;
+    m_bLoaded = false;
+    m_tScan = 0;
+    m_bModified = false;
+    m_bStop = false;
+}
+
+SymbolIndex::~SymbolIndex()
+{
+    stop();
+    if (m_bModified) {
+        save();
+    }
+    clear();
+}
+
+void SymbolIndex::clear(void)
+{
+    for (size_t ii = 0; ii < m_Files.size(); ii++) {
+        if (m_Files[ii]) {
+            delete m_Files[ii];
+        }
+    }
+    m_Files.clear();
+    m_FileIds.clear();
+    m_Symbols.clear();
+    m_Queue.clear();
+    m_bRescan = false;
+    m_bLoaded = false;
+    m_bModified = false;
+}
+
+int SymbolIndex::getLanguage(const wxString &strPath)
+{
+    wxString strExt = strPath.AfterLast(uT('.'));
+    if (strExt.IsSameAs(strPath)) {
+        return -1;
+    }
+
+    if (strExt.IsSameAs(uT("lua")) || strExt.IsSameAs(uT("comet"))) {
+        return CodeAnalyzer::LANGUAGE_LUA;
+    }
+    // As in the editor: the analyzer handles C files only (not C++)
+    if (strExt.IsSameAs(uT("c"))) {
+        return CodeAnalyzer::LANGUAGE_C;
+    }
+    if (strExt.IsSameAs(uT("py")) || strExt.IsSameAs(uT("pyw"))) {
+        return CodeAnalyzer::LANGUAGE_PYTHON;
+    }
+    if (strExt.IsSameAs(uT("tex"))) {
+        return CodeAnalyzer::LANGUAGE_LATEX;
+    }
+    if (strExt.IsSameAs(uT("solis"))) {
+        return CodeAnalyzer::LANGUAGE_SOLIS;
+    }
+    return -1;
+}
+
+std::string SymbolIndex::getKey(const wxString &strName)
+{
+    return std::string((const char *)(CodeAnalyzer::getKey(strName).ToUTF8()));
+}
+
+bool SymbolIndex::getFileInfo(const wxString &strPath, int64_t *piMtime, int64_t *piSize)
+{
+    wxStructStat stT;
+    if (wxStat(strPath, &stT) != 0) {
+        return false;
+    }
+    *piMtime = (int64_t)(stT.st_mtime);
+    *piSize = (int64_t)(stT.st_size);
+    return true;
+}
+
+void SymbolIndex::setRoot(const wxString &strRoot)
+{
+    if (strRoot.IsSameAs(m_strRoot)) {
+        return;
+    }
+
+    stop();
+    if (m_bModified) {
+        save();
+    }
+    clear();
+
+    m_strRoot = strRoot;
+    m_strRootA = std::string((const char *)(strRoot.ToUTF8()));
+    m_strIndexFile = wxEmptyString;
+    if (m_strRoot.IsEmpty() || (::wxDirExists(m_strRoot) == false)) {
+        m_strRoot = wxEmptyString;
+        m_strRootA.clear();
+        return;
+    }
+
+    // One index file per workspace root
+    uint64_t iHash = FileWatcher::hashBuffer(m_strRootA.c_str(), m_strRootA.length());
+    m_strIndexFile = CometApp::USRDIR;
+    m_strIndexFile += wxString::Format(uT("symbols-%08x%08x.idx"), (unsigned int)(iHash >> 32), (unsigned int)(iHash & 0xFFFFFFFF));
+
+    start(true);
+}
+
+void SymbolIndex::changed(const wxString &strPath)
+{
+    if (m_strRoot.IsEmpty() || (getLanguage(strPath) < 0)) {
+        return;
+    }
+
+    std::string strPathA((const char *)(strPath.ToUTF8()));
+    if ((strPathA.length() <= m_strRootA.length()) || (strPathA.compare(0, m_strRootA.length(), m_strRootA) != 0)) {
+        return;
+    }
+
+    {
+        wxMutexLocker lockT(m_Mutex);
+        if (std::find(m_Queue.begin(), m_Queue.end(), strPathA) == m_Queue.end()) {
+            m_Queue.push_back(strPathA);
+            m_Condition.Signal();
+        }
+    }
+
+    // Otherwise, the queue is handled when the running workers are done (finish)
+    if (m_Threads.empty()) {
+        start(false);
+    }
+}
+
+void SymbolIndex::start(bool bScan)
+{
+    if (m_strRoot.IsEmpty() || (m_Threads.empty() == false)) {
+        return;
+    }
+
+    int iCount = wxThread::GetCPUCount();
+    if (iCount < 1) {
+        iCount = 1;
+    }
+    else if (iCount > SYMINDEX_MAXTHREADS) {
+        iCount = SYMINDEX_MAXTHREADS;
+    }
+    if (bScan == false) {
+        wxMutexLocker lockT(m_Mutex);
+        if ((int)(m_Queue.size()) < iCount) {
+            iCount = (int)(m_Queue.size());
+        }
+    }
+    if (iCount < 1) {
+        return;
+    }
+
+    m_bStop = false;
+    m_iGeneration += 1;
+    if (bScan) {
+        m_tScan = wxGetLocalTimeMillis();
+    }
+
+    {
+        wxMutexLocker lockT(m_Mutex);
+        m_bScanning = bScan;
+        m_iRunning = iCount;
+    }
+
+    for (int ii = 0; ii < iCount; ii++) {
+        SymbolIndexThread *pThread = new (std::nothrow) SymbolIndexThread(this, bScan && (ii == 0));
+        if ((pThread != NULL) && (pThread->Create() == wxTHREAD_NO_ERROR) && (pThread->Run() == wxTHREAD_NO_ERROR)) {
+            m_Threads.push_back(pThread);
+            continue;
+        }
+        if (pThread) {
+            delete pThread;
+        }
+        wxMutexLocker lockT(m_Mutex);
+        m_iRunning -= 1;
+        if (bScan && (ii == 0)) {
+            // No scan without the first worker
+            m_bScanning = false;
+            m_Condition.Broadcast();
+        }
+    }
+}
+
+void SymbolIndex::join(void)
+{
+    for (size_t ii = 0; ii < m_Threads.size(); ii++) {
+        m_Threads[ii]->Wait();
+        delete m_Threads[ii];
+    }
+    m_Threads.clear();
+    m_iRunning = 0;
+}
+
+void SymbolIndex::stop(void)
+{
+    {
+        wxMutexLocker lockT(m_Mutex);
+        m_bStop = true;
+        m_Condition.Broadcast();
+    }
+    join();
+}
+
+// Files changed under the workspace root but not notified (in the subdirectories, which are not
+// watched): all listed again and compared by modification time and size (see scan).
+// Called when the frame is activated, at most once per SYMINDEX_RESCAN.
+void SymbolIndex::rescan(void)
+{
+    if (m_strRoot.IsEmpty() || ((wxGetLocalTimeMillis() - m_tScan) < SYMINDEX_RESCAN)) {
+        return;
+    }
+    if (m_Threads.empty() == false) {
+        // when the running workers are done (finish)
+        m_bRescan = true;
+        return;
+    }
+    start(true);
+}
+
+void SymbolIndex::finish(int iGeneration)
+{
+    // Sent by the workers of a previous root (already joined by stop)
+    if ((iGeneration != m_iGeneration) || m_Threads.empty()) {
+        return;
+    }
+
+    join();
+
+    if (m_bModified) {
+        save();
+    }
+
+    if (m_bStop) {
+        return;
+    }
+    if (m_bRescan) {
+        m_bRescan = false;
+        start(true);
+        return;
+    }
+    bool bPending = false;
+    {
+        wxMutexLocker lockT(m_Mutex);
+        bPending = (m_Queue.empty() == false);
+    }
+    if (bPending) {
+        start(false);
+    }
+}
+
+void SymbolIndex::work(bool bScan)
+{
+    if (bScan) {
+        // The index file is read once per root: then the index is newer
+        if (m_bLoaded == false) {
+            load();
+            m_bLoaded = true;
+        }
+        scan();
+        wxMutexLocker lockT(m_Mutex);
+        m_bScanning = false;
+        m_Condition.Broadcast();
+    }
+
+    for (;;) {
+        std::string strPathA;
+        {
+            wxMutexLocker lockT(m_Mutex);
+            // The queue is filled by the scan, in progress
+            while (m_Queue.empty() && m_bScanning && (m_bStop == false)) {
+                m_Condition.Wait();
+            }
+            if (m_bStop || m_Queue.empty()) {
+                break;
+            }
+            strPathA = m_Queue.back();
+            m_Queue.pop_back();
+        }
+
+        parseFile(strPathA);
+    }
+
+    bool bLast = false;
+    {
+        wxMutexLocker lockT(m_Mutex);
+        m_iRunning -= 1;
+        bLast = (m_iRunning == 0);
+    }
+
+    if (bLast && (m_bStop == false) && (m_pFrame != NULL)) {
+        wxWindow *pFrame = (wxWindow *)m_pFrame;
+        wxCommandEvent eventT(wxEVT_COMMAND_TEXT_UPDATED, ID_THREAD_SYMBOLS);
+        eventT.SetInt(m_iGeneration);
+        pFrame->GetEventHandler()->AddPendingEvent(eventT);
+    }
+}
+
+void SymbolIndex::scan(void)
+{
+    wxArrayString arrFiles;
+    listFiles(m_strRoot, arrFiles, &m_bStop, 0);
+
+    if (m_bStop) {
+        return;
+    }
+
+    {
+        wxMutexLocker lockT(m_Mutex);
+        for (size_t ii = 0; ii < m_Files.size(); ii++) {
+            if (m_Files[ii]) {
+                m_Files[ii]->present = false;
+            }
+        }
+    }
+
+    int64_t iMtime = 0, iSize = 0;
+    const size_t iCount = arrFiles.GetCount();
+    for (size_t ii = 0; (ii < iCount) && (m_bStop == false); ii++) {
+        if (getFileInfo(arrFiles[ii], &iMtime, &iSize) == false) {
+            continue;
+        }
+        std::string strPathA((const char *)(arrFiles[ii].ToUTF8()));
+
+        wxMutexLocker lockT(m_Mutex);
+        std::map<std::string, int>::const_iterator itT = m_FileIds.find(strPathA);
+        if (itT != m_FileIds.end()) {
+            File *pFile = m_Files[itT->second];
+            pFile->present = true;
+            if ((pFile->mtime == iMtime) && (pFile->size == iSize)) {
+                continue;
+            }
+        }
+        m_Queue.push_back(strPathA);
+        m_Condition.Signal();
+    }
+
+    if (m_bStop) {
+        return;
+    }
+
+    // Removed since the last session
+    wxMutexLocker lockT(m_Mutex);
+    std::vector<std::string> vecRemoved;
+    for (size_t ii = 0; ii < m_Files.size(); ii++) {
+        if (m_Files[ii] && (m_Files[ii]->present == false)) {
+            vecRemoved.push_back(m_Files[ii]->path);
+        }
+    }
+    for (size_t ii = 0; ii < vecRemoved.size(); ii++) {
+        removeFile(vecRemoved[ii]);
+    }
+}
+
+void SymbolIndex::parseFile(const std::string &strPathA)
+{
+    wxString strPath = wxString::FromUTF8(strPathA.c_str());
+
+    int64_t iMtime = 0, iSize = 0;
+    const int iLang = getLanguage(strPath);
+    if ((iLang < 0) || (getFileInfo(strPath, &iMtime, &iSize) == false) || (iSize > (int64_t)SYMINDEX_MAXFILESIZE)) {
+        wxMutexLocker lockT(m_Mutex);
+        removeFile(strPathA);
+        return;
+    }
+
+    AnalyzerJob tJob;
+    tJob.lang = iLang;
+    tJob.dirtyAll = true;
+
+    if (iSize > 0) {
+        // Not with wxFile, which logs its errors
+        FILE *fpT = wxFopen(strPath.c_str(), uT("rb"));
+        if (fpT == NULL) {
+            return;
+        }
+        tJob.owned = (char *)malloc((size_t)iSize + 1);
+        if (tJob.owned == NULL) {
+            fclose(fpT);
+            return;
+        }
+        size_t iRead = fread(tJob.owned, 1, (size_t)iSize, fpT);
+        const bool bError = (ferror(fpT) != 0);
+        fclose(fpT);
+        if (bError) {
+            return;
+        }
+        tJob.owned[iRead] = '\0';
+        tJob.text = (const char *)(tJob.owned);
+        tJob.length = (size_t)iRead;
+        // UTF-8 BOM
+        if ((tJob.length >= 3) && ((unsigned char)(tJob.text[0]) == 0xEF) && ((unsigned char)(tJob.text[1]) == 0xBB) && ((unsigned char)(tJob.text[2]) == 0xBF)) {
+            tJob.text += 3;
+            tJob.length -= 3;
+        }
+    }
+
+    tJob.run();
+
+    std::vector<Symbol> vecSymbols;
+    if (tJob.symbols) {
+        const int iCount = tJob.symbols->getCount();
+        vecSymbols.resize(iCount);
+        for (int ii = 0; ii < iCount; ii++) {
+            wxString strName(tJob.symbols->getName(ii));
+            vecSymbols[ii].name = std::string((const char *)(strName.ToUTF8()));
+            vecSymbols[ii].line = tJob.symbols->getElement(ii).line;
+        }
+    }
+
+    wxMutexLocker lockT(m_Mutex);
+    setFile(strPathA, iMtime, iSize, vecSymbols);
+}
+
+void SymbolIndex::removeSymbols(int iFile)
+{
+    File *pFile = m_Files[iFile];
+    for (size_t ii = 0; ii < pFile->symbols.size(); ii++) {
+        std::string strKey = getKey(wxString::FromUTF8(pFile->symbols[ii].name.c_str()));
+        std::map<std::string, std::vector<Location> >::iterator itT = m_Symbols.find(strKey);
+        if (itT == m_Symbols.end()) {
+            continue;
+        }
+        std::vector<Location> &vecLoc = itT->second;
+        for (size_t jj = 0; jj < vecLoc.size();) {
+            if (vecLoc[jj].file == iFile) {
+                vecLoc.erase(vecLoc.begin() + jj);
+            }
+            else {
+                jj += 1;
+            }
+        }
+        if (vecLoc.empty()) {
+            m_Symbols.erase(itT);
+        }
+    }
+    pFile->symbols.clear();
+}
+
+void SymbolIndex::setFile(const std::string &strPathA, int64_t iMtime, int64_t iSize, std::vector<Symbol> &vecSymbols)
+{
+    int iFile = -1;
+    std::map<std::string, int>::const_iterator itT = m_FileIds.find(strPathA);
+    if (itT != m_FileIds.end()) {
+        iFile = itT->second;
+        removeSymbols(iFile);
+    }
+    else {
+        File *pFile = new (std::nothrow) File();
+        if (pFile == NULL) {
+            return;
+        }
+        pFile->path = strPathA;
+        iFile = (int)(m_Files.size());
+        m_Files.push_back(pFile);
+        m_FileIds[strPathA] = iFile;
+    }
+
+    File *pFile = m_Files[iFile];
+    pFile->mtime = iMtime;
+    pFile->size = iSize;
+    pFile->present = true;
+    pFile->symbols.swap(vecSymbols);
+
+    for (size_t ii = 0; ii < pFile->symbols.size(); ii++) {
+        std::string strKey = getKey(wxString::FromUTF8(pFile->symbols[ii].name.c_str()));
+        if (strKey.empty()) {
+            continue;
+        }
+        Location tLoc;
+        tLoc.file = iFile;
+        tLoc.symbol = (int)ii;
+        m_Symbols[strKey].push_back(tLoc);
+    }
+
+    m_bModified = true;
+}
+
+void SymbolIndex::removeFile(const std::string &strPathA)
+{
+    std::map<std::string, int>::iterator itT = m_FileIds.find(strPathA);
+    if (itT == m_FileIds.end()) {
+        return;
+    }
+    const int iFile = itT->second;
+    removeSymbols(iFile);
+    delete m_Files[iFile];
+    m_Files[iFile] = NULL;
+    m_FileIds.erase(itT);
+    m_bModified = true;
+}
+
+int SymbolIndex::find(const wxString &strName, std::vector<SymbolMatch> &vecMatch, bool bPrefix /* = false*/)
+{
+    vecMatch.clear();
+
+    std::string strKey = getKey(strName);
+    if (strKey.empty()) {
+        return 0;
+    }
+
+    wxMutexLocker lockT(m_Mutex);
+
+    std::map<std::string, std::vector<Location> >::const_iterator itT = bPrefix ? m_Symbols.lower_bound(strKey) : m_Symbols.find(strKey);
+    for (; itT != m_Symbols.end(); ++itT) {
+        if (bPrefix && (itT->first.compare(0, strKey.length(), strKey) != 0)) {
+            break;
+        }
+        const std::vector<Location> &vecLoc = itT->second;
+        for (size_t ii = 0; ii < vecLoc.size(); ii++) {
+            const File *pFile = m_Files[vecLoc[ii].file];
+            SymbolMatch tMatch;
+            tMatch.path = wxString::FromUTF8(pFile->path.c_str());
+            tMatch.name = wxString::FromUTF8(pFile->symbols[vecLoc[ii].symbol].name.c_str());
+            tMatch.line = pFile->symbols[vecLoc[ii].symbol].line;
+            vecMatch.push_back(tMatch);
+            if (vecMatch.size() >= SYMINDEX_MAXMATCHES) {
+                return (int)(vecMatch.size());
+            }
+        }
+        if (bPrefix == false) {
+            break;
+        }
+    }
+
+    return (int)(vecMatch.size());
+}
+
+bool SymbolIndex::contains(const wxString &strName)
+{
+    std::string strKey = getKey(strName);
+    if (strKey.empty()) {
+        return false;
+    }
+
+    wxMutexLocker lockT(m_Mutex);
+    return (m_Symbols.find(strKey) != m_Symbols.end());
+}
+
+int SymbolIndex::getFileCount(void)
+{
+    wxMutexLocker lockT(m_Mutex);
+    return (int)(m_FileIds.size());
+}
+
+// Index file: magic, version, root, then per file: path, mtime, size, symbols (name, line).
+// Written in the native byte order (the file is local to the user).
+
+static void putInt(std::string &strBuffer, int64_t iValue)
+{
+    strBuffer.append((const char *)(&iValue), sizeof(int64_t));
+}
+
+static void putString(std::string &strBuffer, const std::string &strValue)
+{
+    putInt(strBuffer, (int64_t)(strValue.length()));
+    strBuffer.append(strValue);
+}
+
+static bool getInt(const char *&pszBuffer, const char *pszEnd, int64_t *piValue)
+{
+    if ((size_t)(pszEnd - pszBuffer) < sizeof(int64_t)) {
+        return false;
+    }
+    memcpy(piValue, pszBuffer, sizeof(int64_t));
+    pszBuffer += sizeof(int64_t);
+    return true;
+}
+
+static bool getString(const char *&pszBuffer, const char *pszEnd, std::string &strValue)
+{
+    int64_t iLen = 0;
+    if ((getInt(pszBuffer, pszEnd, &iLen) == false) || (iLen < 0) || (iLen > (int64_t)(pszEnd - pszBuffer))) {
+        return false;
+    }
+    strValue.assign(pszBuffer, (size_t)iLen);
+    pszBuffer += iLen;
+    return true;
+}
+
+bool SymbolIndex::save(void)
+{
+    if (m_strIndexFile.IsEmpty()) {
+        return false;
+    }
+
+    std::string strBuffer;
+    {
+        wxMutexLocker lockT(m_Mutex);
+
+        strBuffer.append(SYMINDEX_MAGIC, sizeof(SYMINDEX_MAGIC));
+        putInt(strBuffer, SYMINDEX_VERSION);
+        putString(strBuffer, m_strRootA);
+        putInt(strBuffer, (int64_t)(m_FileIds.size()));
+        for (size_t ii = 0; ii < m_Files.size(); ii++) {
+            const File *pFile = m_Files[ii];
+            if (pFile == NULL) {
+                continue;
+            }
+            putString(strBuffer, pFile->path);
+            putInt(strBuffer, pFile->mtime);
+            putInt(strBuffer, pFile->size);
+            putInt(strBuffer, (int64_t)(pFile->symbols.size()));
+            for (size_t jj = 0; jj < pFile->symbols.size(); jj++) {
+                putString(strBuffer, pFile->symbols[jj].name);
+                putInt(strBuffer, pFile->symbols[jj].line);
+            }
+        }
+        m_bModified = false;
+    }
+
+    return SaveThread::saveBuffer(m_strIndexFile, strBuffer.data(), strBuffer.length(), SAVE_DURABILITY_ATOMIC);
+}
+
+bool SymbolIndex::load(void)
+{
+    if (m_strIndexFile.IsEmpty() || (::wxFileExists(m_strIndexFile) == false)) {
+        return false;
+    }
+
+    std::string strBuffer;
+    {
+        int64_t iMtime = 0, iLength = 0;
+        if ((getFileInfo(m_strIndexFile, &iMtime, &iLength) == false) || (iLength <= (int64_t)sizeof(SYMINDEX_MAGIC))) {
+            return false;
+        }
+        FILE *fpT = wxFopen(m_strIndexFile.c_str(), uT("rb"));
+        if (fpT == NULL) {
+            return false;
+        }
+        strBuffer.resize((size_t)iLength);
+        const size_t iRead = fread(&strBuffer[0], 1, (size_t)iLength, fpT);
+        fclose(fpT);
+        if (iRead != (size_t)iLength) {
+            return false;
+        }
+    }
+
+    const char *pszBuffer = strBuffer.data();
+    const char *pszEnd = pszBuffer + strBuffer.length();
+    if (memcmp(pszBuffer, SYMINDEX_MAGIC, sizeof(SYMINDEX_MAGIC)) != 0) {
+        return false;
+    }
+    pszBuffer += sizeof(SYMINDEX_MAGIC);
+
+    int64_t iVersion = 0, iCount = 0;
+    std::string strRootA;
+    if ((getInt(pszBuffer, pszEnd, &iVersion) == false) || (iVersion != SYMINDEX_VERSION) || (getString(pszBuffer, pszEnd, strRootA) == false) || (strRootA != m_strRootA) || (getInt(pszBuffer, pszEnd, &iCount) == false)) {
+        return false;
+    }
+
+    for (int64_t ii = 0; (ii < iCount) && (m_bStop == false); ii++) {
+        std::string strPathA;
+        int64_t iMtime = 0, iSize = 0, iSymbols = 0;
+        if ((getString(pszBuffer, pszEnd, strPathA) == false) || (getInt(pszBuffer, pszEnd, &iMtime) == false) || (getInt(pszBuffer, pszEnd, &iSize) == false) || (getInt(pszBuffer, pszEnd, &iSymbols) == false) || (iSymbols < 0)) {
+            return false;
+        }
+        std::vector<Symbol> vecSymbols;
+        for (int64_t jj = 0; jj < iSymbols; jj++) {
+            Symbol tSymbol;
+            int64_t iLine = 0;
+            if ((getString(pszBuffer, pszEnd, tSymbol.name) == false) || (getInt(pszBuffer, pszEnd, &iLine) == false)) {
+                return false;
+            }
+            tSymbol.line = (int)iLine;
+            vecSymbols.push_back(tSymbol);
+        }
+        wxMutexLocker lockT(m_Mutex);
+        setFile(strPathA, iMtime, iSize, vecSymbols);
+    }
+
+    wxMutexLocker lockT(m_Mutex);
+    m_bModified = false;
+    return true;
+}
@@ -27,73 +27,89 @@ void luaHook(lua_State *pLua, lua_Debug *pDebug)
         return;
     }
 
-    if (pDebug->event == LUA_HOOKLINE) {
+    lua_pushliteral(pLua, "___SigmaThread___");
+    lua_gettable(pLua, LUA_REGISTRYINDEX);
+    ScriptThread *pThread = (ScriptThread *)lua_touserdata(pLua, -1);
 
-        lua_pushliteral(pLua, "___SigmaThread___");
-        lua_gettable(pLua, LUA_REGISTRYINDEX);
-        ScriptThread *pThread = (ScriptThread *)lua_touserdata(pLua, -1);
+    if (pThread == NULL) {
+        return;
+    }
 
-        if (pThread == NULL) {
-            return;
-        }
+    bool bDebug = false, bStepInto = false;
+    if (pThread->syncDebug(&bDebug, &bStepInto) == false) {
+        luaL_error(pLua, STOPPED_BY_USERA);
+        return;
+    }
 
-        bool bStop = pThread->stopIt();
-        if (bStop) {
-            luaL_error(pLua, STOPPED_BY_USERA);
-            return;
-        }
+    if (pDebug->event != LUA_HOOKLINE) {
+        // Function called or returned, or instruction count reached
+        pThread->updateHook(pLua, ((pDebug->event == LUA_HOOKRET) || (pDebug->event == LUA_HOOKTAILRET)) ? 1 : 0, bStepInto);
+        return;
+    }
 
-        bool bDebug = pThread->debugIt();
-        if (bDebug == false) {
+    if (bDebug == false) {
+        return;
+    }
+
+    // Condition, hit count or logpoint of the active line: evaluated first,
+    // so that a false condition only costs its call
+    bool bChecked = false;
+    lua_getinfo(pLua, "S", pDebug);
+    if (pThread->conditionIn(pDebug->source, pDebug->currentline - 1)) {
+        if (pThread->checkBreakpoint(pLua, pDebug, pDebug->currentline - 1) == false) {
             return;
         }
+        bChecked = true;
+    }
 
-        bool bBreak = false;
-
-        lua_Debug ldT;
-        int iDepth = 0, iLine = -1, ii = 0;
-        char cT = '\0';
+    bool bBreak = false;
 
-        bool bStepInto = pThread->stepInto();
+    lua_Debug ldT;
+    int iDepth = 0, iLine = -1, ii = 0;
+    char cT = '\0';
 
-        int iDepthbreak = -1;
+    int iDepthbreak = -1;
 
-        for (iDepth = 0; iDepth < 64; iDepth++) {
+    for (iDepth = 0; iDepth < SCRIPT_HOOKDEPTH; iDepth++) {
 
-            if (lua_getstack(pLua, iDepth, &ldT) == 0) {
-                if ((iLine >= 0) && (cT != '\0') && (cT != 'C')) {
-                    bBreak = true;
-                }
-                break;
+        if (lua_getstack(pLua, iDepth, &ldT) == 0) {
+            if ((iLine >= 0) && (cT != '\0') && (cT != 'C')) {
+                bBreak = true;
             }
+            break;
+        }
 
-            lua_getinfo(pLua, "nSl", &ldT);
-            cT = *(ldT.what);
-            ii = ldT.currentline - 1;
+        lua_getinfo(pLua, "Sl", &ldT);
+        cT = *(ldT.what);
+        ii = ldT.currentline - 1;
 
-            if (pThread->breakpointIn(ii)) {
-                iLine = ii;
-                iDepthbreak = iDepth;
-            }
+        // Calling levels: only the breakpoints without options break in the called functions
+        if (pThread->breakpointIn(ldT.source, ii, iDepth > 0)) {
+            iLine = ii;
+            iDepthbreak = iDepth;
         }
+    }
 
-        // Breakpoint set in the depth 0 (active level)?
-        if ((bBreak == false) || ((bStepInto == false) && (iDepthbreak > 0))) {
-            return;
-        }
+    // Breakpoint set in the depth 0 (active level)?
+    if ((bBreak == false) || ((bStepInto == false) && (iDepthbreak > 0))) {
+        return;
+    }
 
-        pThread->highlightLine(iLine);
-        pThread->breakIt(pDebug);
-        while (true) {
-            Tsleep(100);
-            if (pThread->stopIt()) {
-                luaL_error(pLua, STOPPED_BY_USERA);
-                return;
-            }
-            if (pThread->debugIt()) {
-                return;
-            }
-        }
+    // Condition, hit count or logpoint, if not evaluated above
+    if ((iDepthbreak == 0) && (bChecked == false) && (pThread->checkBreakpoint(pLua, pDebug, iLine) == false)) {
+        return;
+    }
+
+    pThread->highlightLine(iLine);
+    pThread->breakIt(pDebug);
+
+    // Paused until continued, stepped or stopped by the user
+    pThread->waitResume();
+    if (pThread->syncDebug(&bDebug, &bStepInto) == false) {
+        luaL_error(pLua, STOPPED_BY_USERA);
+        return;
     }
+    // Step into may have been changed during the pause
+    pThread->updateHook(pLua, 0, bStepInto);
 }
 //
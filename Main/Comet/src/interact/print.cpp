@@ -27,8 +27,22 @@
 #define LUA_PRINT_MAXCOUNT 64
 
 // IO
+// Output of the engine running the script (standard output unless redirected, see LuaEngine::setOutput)
+static FILE *consoleOutput(lua_State *pLua)
+{
+    lua_pushliteral(pLua, "___LuaEngine___");
+    lua_gettable(pLua, LUA_REGISTRYINDEX);
+    LuaEngine *pEngine = (LuaEngine *)lua_touserdata(pLua, -1);
+    lua_pop(pLua, 1);
+    return (pEngine != NULL) ? pEngine->getOutput() : stdout;
+}
+
 int consoleDoClear(lua_State *pLua)
 {
+    if (consoleOutput(pLua) != stdout) {
+        return 0;
+    }
+
     if (system(NULL)) {
 #ifdef __WXMSW__
         win32ClearConsole();
@@ -87,6 +101,8 @@ static int consoleDoWrite(lua_State *pLua, bool bFunc = LUA_FUNC_IOWRITE)
 {
     const char *pszNil = "nil";
 
+    FILE *fpOutput = consoleOutput(pLua);
+
     int nArgCount = lua_gettop(pLua);
     if ((nArgCount < 0) || (nArgCount > LUA_PRINT_MAXCOUNT)) {
         lua_pushstring(pLua, "");
@@ -95,7 +111,7 @@ static int consoleDoWrite(lua_State *pLua, bool bFunc = LUA_FUNC_IOWRITE)
     if (0 == nArgCount) {
         // conformance to the common behavior of print()
         if (bFunc == LUA_FUNC_PRINT) {
-            printf("\n");
+            fprintf(fpOutput, "\n");
         }
         return 0;
     }
@@ -107,23 +123,23 @@ static int consoleDoWrite(lua_State *pLua, bool bFunc = LUA_FUNC_IOWRITE)
             nn = (int)(luaL_len(pLua, ii));
             ne = (nn < 10) ? nn : 10;
             if (ne > 0) {
-                printf("{ ");
+                fprintf(fpOutput, "{ ");
                 for (jj = 1; jj <= ne; jj++) {
                     lua_rawgeti(pLua, ii, jj);
                     itop = lua_gettop(pLua);
                     pszArg = (char *)luaX_tolstring(pLua, itop, NULL);
                     if (pszArg != NULL) {
-                        printf("%s", (const char *)pszArg);
+                        fprintf(fpOutput, "%s", (const char *)pszArg);
                         if (jj < ne) {
-                            printf(", ");
+                            fprintf(fpOutput, ", ");
                         }
                     }
                     lua_pop(pLua, 1);
                 }
                 if (nn > 10) {
-                    printf(" ...");
+                    fprintf(fpOutput, " ...");
                 }
-                printf(" }");
+                fprintf(fpOutput, " }");
             }
         }
         else {
@@ -135,39 +151,39 @@ static int consoleDoWrite(lua_State *pLua, bool bFunc = LUA_FUNC_IOWRITE)
             }
             if (pszArg == NULL) {
                 if (lua_isboolean(pLua, ii)) {
-                    printf(lua_toboolean(pLua, ii) ? ("true") : ("false"));
+                    fprintf(fpOutput, "%s", lua_toboolean(pLua, ii) ? ("true") : ("false"));
                 }
                 else {
                     const void *ptrT = lua_topointer(pLua, ii);
                     if (ptrT == NULL) {
                         const void *ptrU = lua_touserdata(pLua, ii);
                         if (ptrU == NULL) {
-                            printf("nil");
+                            fprintf(fpOutput, "nil");
                         }
                         else {
-                            printf(("%p"), ptrT);
+                            fprintf(fpOutput, ("%p"), ptrT);
                         }
                     }
                     else {
-                        printf(("%p"), (ptrT));
+                        fprintf(fpOutput, ("%p"), (ptrT));
                     }
                 }
             }
             else {
-                printf("%s", (const char *)pszArg);
+                fprintf(fpOutput, "%s", (const char *)pszArg);
             }
         }
 
         if (bFunc == LUA_FUNC_PRINT) {
             if (ii < nArgCount) {
-                printf("   ");
+                fprintf(fpOutput, "   ");
             }
         }
     }
 
     // conformance to the common behavior of print()
     if (bFunc == LUA_FUNC_PRINT) {
-        printf("\n");
+        fprintf(fpOutput, "\n");
     }
 
     return 0;
@@ -399,9 +415,7 @@ int luaRead(lua_State *pLua)
         pConsoleEdit->GetEventHandler()->AddPendingEvent(eventT);
     }
 
-    // Pause 50 ms to let text entry dialog to be shown
-    Tsleep(50);
-
+    // Wait for the text entry dialog to be closed
     strT = uT("");
     if (iSigmaCaller == SIGMACALLER_EDITOR) {
         strT = pScriptThread->readStr();
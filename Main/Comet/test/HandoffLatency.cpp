@@ -0,0 +1,196 @@
+// -----------------------------------------------------------------------------------
+// Comet <Programming Environment for Lua>
+//      Copyright(C) 2010-2022 Pr. Sidi HAMADY
+//      http://www.hamady.org
+//      sidi@hamady.org
+//
+//      :STABLE:VERSION180:BUILD2104:
+//
+//      Released under the MIT licence (https://opensource.org/licenses/MIT)
+//      See Copyright Notice in COPYRIGHT
+// -----------------------------------------------------------------------------------
+
+// Headless driver of the script thread / editor hand-off (see ScriptThread::readStr,
+// ScriptThread::waitResume, CodeEdit::luaDoRead and ScriptEdit::luaDebugScript):
+// a worker thread plays the script, alternately waiting for an io.read answer and paused
+// at a breakpoint, and the main thread plays the editor, answering or stepping as soon as
+// asked. The latency is the time from the editor broadcast to the script thread running again.
+//
+// Build (wxBase only):
+//     g++ -O2 HandoffLatency.cpp `wx-config --cxxflags --libs base` -o HandoffLatency
+// Run:
+//     ./HandoffLatency [cycles]
+// Exits with 1 if the median latency exceeds HANDOFF_MAXMEDIAN.
+
+#include <wx/wx.h>
+#include <wx/init.h>
+#include <wx/thread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <algorithm>
+#include <vector>
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#define HANDOFF_CYCLES    10000 // step and read cycles (two hand-offs each)
+#define HANDOFF_MAXMEDIAN 1000  // us
+
+static double handoffClock(void)
+{
+#ifdef WIN32
+    static LARGE_INTEGER liFrequency = { 0 };
+    if (liFrequency.QuadPart == 0) {
+        QueryPerformanceFrequency(&liFrequency);
+    }
+    LARGE_INTEGER liNow;
+    QueryPerformanceCounter(&liNow);
+    return (double)(liNow.QuadPart) * (1000000.0 / (double)(liFrequency.QuadPart));
+#else
+    struct timespec tsNow;
+    clock_gettime(CLOCK_MONOTONIC, &tsNow);
+    return ((double)(tsNow.tv_sec) * 1000000.0) + ((double)(tsNow.tv_nsec) / 1000.0);
+#endif
+}
+
+// The editor state shared with the script thread (same fields as CodeEdit and ScriptEdit)
+struct HandoffEdit
+{
+    wxMutex mutex;
+    wxCondition condition; // signaled by the editor: answer given, script resumed or stopped
+    bool readDone;
+    bool debugIt;
+    bool stopIt;
+    wxString read;
+
+    // Requests of the script thread, as the events posted to the editor
+    wxCondition request;
+    int requested; // 0: none, 1: read, 2: paused
+    double answered;
+
+    HandoffEdit() : condition(mutex), request(mutex)
+    {
+        readDone = false;
+        debugIt = true;
+        stopIt = false;
+        requested = 0;
+        answered = 0.0;
+    }
+};
+
+class HandoffThread : public wxThread
+{
+private:
+    HandoffEdit *m_pEdit;
+    int m_iCycles;
+
+    void post(int iRequest)
+    {
+        m_pEdit->requested = iRequest;
+        m_pEdit->request.Signal();
+    }
+
+public:
+    std::vector<double> latencies;
+
+    HandoffThread(HandoffEdit *pEdit, int iCycles) : wxThread(wxTHREAD_JOINABLE)
+    {
+        m_pEdit = pEdit;
+        m_iCycles = iCycles;
+        latencies.reserve(2 * iCycles);
+    }
+
+protected:
+    virtual ExitCode Entry()
+    {
+        for (int ii = 0; ii < m_iCycles; ii++) {
+            // io.read (ScriptThread::readStr)
+            m_pEdit->mutex.Lock();
+            post(1);
+            while ((m_pEdit->readDone == false) && (m_pEdit->stopIt == false)) {
+                m_pEdit->condition.Wait();
+            }
+            latencies.push_back(handoffClock() - m_pEdit->answered);
+            m_pEdit->readDone = false;
+            m_pEdit->mutex.Unlock();
+
+            // breakpoint (ScriptThread::breakIt then waitResume)
+            m_pEdit->mutex.Lock();
+            m_pEdit->debugIt = false;
+            post(2);
+            while ((m_pEdit->debugIt == false) && (m_pEdit->stopIt == false)) {
+                m_pEdit->condition.Wait();
+            }
+            latencies.push_back(handoffClock() - m_pEdit->answered);
+            m_pEdit->mutex.Unlock();
+        }
+
+        m_pEdit->mutex.Lock();
+        post(-1);
+        m_pEdit->mutex.Unlock();
+
+        return 0;
+    }
+};
+
+int main(int argc, char **argv)
+{
+    wxInitializer initT;
+    if (initT.IsOk() == false) {
+        printf("! Cannot initialize wxWidgets\n");
+        return EXIT_FAILURE;
+    }
+
+    int iCycles = (argc > 1) ? atoi(argv[1]) : HANDOFF_CYCLES;
+    if (iCycles < 1) {
+        iCycles = HANDOFF_CYCLES;
+    }
+
+    HandoffEdit tEdit;
+    HandoffThread *pThread = new (std::nothrow) HandoffThread(&tEdit, iCycles);
+    if ((pThread == NULL) || (pThread->Create() != wxTHREAD_NO_ERROR) || (pThread->Run() != wxTHREAD_NO_ERROR)) {
+        printf("! Cannot start the script thread\n");
+        return EXIT_FAILURE;
+    }
+
+    // The editor: answers each request as soon as it arrives (CodeEdit::luaDoRead, ScriptEdit::luaDebugScript)
+    tEdit.mutex.Lock();
+    for (;;) {
+        while (tEdit.requested == 0) {
+            tEdit.request.Wait();
+        }
+        const int iRequest = tEdit.requested;
+        tEdit.requested = 0;
+        if (iRequest < 0) {
+            break;
+        }
+        if (iRequest == 1) {
+            tEdit.readDone = true;
+            tEdit.read = wxT("input");
+        }
+        else {
+            tEdit.debugIt = true;
+        }
+        tEdit.answered = handoffClock();
+        tEdit.condition.Broadcast();
+    }
+    tEdit.mutex.Unlock();
+
+    pThread->Wait();
+
+    std::vector<double> vecT = pThread->latencies;
+    delete pThread;
+
+    std::sort(vecT.begin(), vecT.end());
+    const double fMedian = vecT[vecT.size() / 2];
+    printf("%d step/read cycles, %d hand-offs\n", iCycles, (int)(vecT.size()));
+    printf("latency (us): min %.1f, median %.1f, p99 %.1f, max %.1f\n", vecT.front(), fMedian,
+           vecT[(vecT.size() * 99) / 100], vecT.back());
+
+    return (fMedian <= (double)HANDOFF_MAXMEDIAN) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -70,6 +70,8 @@ extern "C" {
 
 #include <map>
 #include <set>
+#include <string>
+#include <vector>
 
 #ifndef USE_LUAJIT
 LUAEXT_API int luaCompile(lua_State *pLua, int argc, char **argv);
@@ -356,6 +358,32 @@ private:
     char m_szError[256];
 };
 
+// DEBUG
+#define DEBUG_NAMESIZE  LM_STRSIZEN         // variable name or table key, as shown
+#define DEBUG_VALUESIZE (LM_STRSIZE >> 1)   // value, as shown
+#define DEBUG_TYPESIZE  16
+#define DEBUG_PAGESIZE  100                 // table fields listed by request
+
+// Variable (or table field) of the paused script.
+// handle is given to tables: it identifies the table until the script resumes (see debugGetChildren)
+struct LuaDebugItem
+{
+    char name[DEBUG_NAMESIZE];
+    char value[DEBUG_VALUESIZE];
+    char type[DEBUG_TYPESIZE];
+    int handle;
+};
+
+// Function in the call stack of the paused script
+struct LuaDebugFrame
+{
+    int level;
+    int line;
+    char name[DEBUG_NAMESIZE];
+    char what[DEBUG_TYPESIZE];
+};
+//
+
 class LuaEngine
 {
 
@@ -371,6 +399,9 @@ private:
 
     int m_iErrLine;
 
+    FILE *m_pOutput; // console output of the script (see setOutput)
+    FILE *m_pDump;   // bytecode output of LUA_ENGINE_COMPILE (one per engine, so that engines compile in parallel)
+
     double m_fTic;
     double m_fToc;
 
@@ -386,9 +417,12 @@ private:
     bool m_bDebugging;
     std::set<unsigned int> m_GlobalSet;
 
-    LUAEXT_API bool debugGetVariable(const char *pszN, char *pszV, char *pszT);
+    int m_iDebugHandle;                  // last handle given while paused
+    std::map<int, int> m_DebugCursors;   // handle -> position following the saved key
+
+    bool debugGetItem(const char *pszN, LuaDebugItem &tItem);
+    void debugGetKey(int iIndex, char *pszN);
 
-    static FILE *LUADUMPFIlE;
     static int LUADUMP(lua_State *pLua, const void *pSource, size_t iSize, void *pTarget)
     {
         if (pTarget && pSource && (iSize > 0)) {
@@ -397,6 +431,14 @@ private:
         }
         return 1;
     }
+    static int LUADUMPSTRING(lua_State *pLua, const void *pSource, size_t iSize, void *pTarget)
+    {
+        if (pTarget && pSource && (iSize > 0)) {
+            ((std::string *)pTarget)->append((const char *)pSource, iSize);
+            return 0;
+        }
+        return 1;
+    }
 
 public:
     LUAEXT_API LuaEngine();
@@ -410,7 +452,19 @@ public:
 
     LUAEXT_API void setInteract(const luaL_Reg *pFuncInteract);
 
-    LUAEXT_API bool debugStackTrace(char *pszBuffer, int iLen, lua_Debug *pDebug);
+    // Structured inspection, from the hook while the script is paused.
+    // Nothing is formatted in advance: the debugger lists the locals of a stack level and
+    // the user globals, then the fields of a table (by handle) one page at a time.
+    LUAEXT_API int debugGetLocals(int iLevel, std::vector<LuaDebugItem> &vecItems);
+    LUAEXT_API int debugGetGlobals(std::vector<LuaDebugItem> &vecItems);
+    LUAEXT_API int debugGetStack(std::vector<LuaDebugFrame> &vecFrames);
+
+    // At most iCount fields of the table iHandle, from the position iFirst (array part first).
+    // piNext is set to the position of the next page, or -1 if all the fields were listed.
+    LUAEXT_API int debugGetChildren(int iHandle, int iFirst, int iCount, std::vector<LuaDebugItem> &vecItems, int *piNext);
+
+    // The script resumes: the handles are released
+    LUAEXT_API void debugRelease(void);
 
     LUAEXT_API void releaseResources(void);
 
@@ -480,9 +534,25 @@ public:
     {
         return static_cast<const char *>(m_szMessageA);
     }
+    // Console mode: print, io.write and the engine messages written to fpOutput instead of
+    // the standard output (NULL), so that several engines can run in parallel (not owned)
+    LUAEXT_API void setOutput(FILE *fpOutput)
+    {
+        m_pOutput = fpOutput;
+    }
+    LUAEXT_API FILE *getOutput(void)
+    {
+        return (m_pOutput != NULL) ? m_pOutput : stdout;
+    }
+
     LUAEXT_API void showMessage(const char_t *pszMessage, bool bOK = false)
     {
         Tstrcpy(m_szMessage, pszMessage);
+        if (m_pOutput != NULL) {
+            fprintf(m_pOutput, "\n%ls\n", pszMessage);
+            m_bOK = bOK;
+            return;
+        }
 #ifdef __WXMSW__
         Tprintf(uT("\n%s\n"), pszMessage);
 #else
@@ -496,6 +566,12 @@ public:
         strncpy(m_szMessageA, pszMessage, LM_STRSIZE - 1);
         mbstowcs(static_cast<char_t *>(m_szMessage), pszMessage, LM_STRSIZE - 1);
 
+        if (m_pOutput != NULL) {
+            fprintf(m_pOutput, "\n%s\n", pszMessage);
+            m_bOK = bOK;
+            return;
+        }
+
 #ifdef __WXMSW__
         Tprintf(uT("\n%s\n"), static_cast<const char_t *>(m_szMessage));
 #else
@@ -556,6 +632,11 @@ public:
 
     LUAEXT_API bool runScriptString(const char *pszBufferA, bool bAction);
 
+    // Bytecode of a script (not run), appended to strBytecode.
+    // pszChunkname as given to luaL_loadbuffer ("@file.lua" to name the file in the messages).
+    LUAEXT_API bool compileBuffer(const char *pszBufferA, size_t iLen, const char *pszChunkname, std::string &strBytecode, bool bStrip = true);
+    LUAEXT_API bool compileFile(const char *pszFilename, const char *pszChunkname, std::string &strBytecode, bool bStrip = true);
+
     LUAEXT_API int getErrLine(void) const
     {
         return m_iErrLine;
@@ -197,8 +197,6 @@ const luaL_Reg LuaEngine::CFUNCTION[] =
     { NULL, NULL }
 };
 
-FILE* LuaEngine::LUADUMPFIlE = NULL;
-
 extern "C"
 {
 
@@ -255,6 +253,9 @@ void LuaEngine::create()
 
     m_iErrLine = -1;
 
+    m_pOutput = NULL;
+    m_pDump = NULL;
+
     m_fTic = 0.0;
     m_fToc = 0.0;
 
@@ -264,6 +265,7 @@ void LuaEngine::create()
     m_iSocketId = 1L;
 
     m_bDebugging = false;
+    m_iDebugHandle = 0;
 }
 
 LuaEngine::LuaEngine()
@@ -325,7 +327,7 @@ void LuaEngine::assignResources(bool bOpenLibs/* = true*/)
         openLibs();
     }
 
-    LuaEngine::LUADUMPFIlE = NULL;
+    m_pDump = NULL;
 
     return;
 }
@@ -381,292 +383,312 @@ void LuaEngine::releaseResources(void)
     return;
 }
 
-#define DEBUG_VARSIZE        (LM_STRSIZE >> 1)
 #define DEBUG_MAXCOUNT        64
+#define DEBUG_HANDLES         "___SigmaDebug___"
 
-LUAEXT_API bool LuaEngine::debugGetVariable(const char *pszN, char *pszV, char *pszT)
+// Copy of at most iSize - 1 bytes, cut on a UTF-8 character boundary
+static void debugCopy(char *pszTarget, const char *pszSource, size_t iLen, size_t iSize)
 {
-    int nn, ne, ilen, jj, itop;
-    char *pszArg = NULL, *pszType = NULL;
+    if (iLen >= iSize) {
+        iLen = iSize - 1;
+        while ((iLen > 0) && ((static_cast<unsigned char>(pszSource[iLen]) & 0xC0) == 0x80)) {
+            iLen -= 1;
+        }
+    }
+    memcpy(pszTarget, pszSource, iLen);
+    pszTarget[iLen] = '\0';
+}
+
+bool LuaEngine::debugGetItem(const char *pszN, LuaDebugItem &tItem)
+{
+    const char *pszT = NULL;
+    size_t iLen = 0;
 
     int iType = lua_type(m_pLuaState, -1);
-    pszType = const_cast<char*>(lua_typename(m_pLuaState, iType));
-    bool bFlag = (pszType && (*pszType != '\0'));
-    if (bFlag == false) {
+    if ((iType == LUA_TNIL) || (iType == LUA_TNONE)) {
         return false;
     }
 
+    debugCopy(tItem.name, pszN, strlen(pszN), DEBUG_NAMESIZE);
+    strncpy(tItem.type, lua_typename(m_pLuaState, iType), DEBUG_TYPESIZE - 1);
+    tItem.type[DEBUG_TYPESIZE - 1] = '\0';
+    tItem.value[0] = '\0';
+    tItem.handle = 0;
+
     switch (iType) {
         case LUA_TSTRING:
-            strncpy(pszV, (const char*) lua_tostring(m_pLuaState, -1), DEBUG_VARSIZE - 1);
-            snprintf(pszT, LM_STRSIZE - 1, "%s \t%s \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszV), static_cast<const char*>(pszType));
+            pszT = lua_tolstring(m_pLuaState, -1, &iLen);
+            debugCopy(tItem.value, pszT, iLen, DEBUG_VALUESIZE);
             break;
         case LUA_TBOOLEAN:
-            strcpy(pszV, lua_toboolean(m_pLuaState, -1) ? "true" : "false");
-            snprintf(pszT, LM_STRSIZE - 1, "%s \t%s \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszV), static_cast<const char*>(pszType));
+            strcpy(tItem.value, lua_toboolean(m_pLuaState, -1) ? "true" : "false");
             break;
         case LUA_TNUMBER:
-            if (strcmp(static_cast<const char*>(pszN), "*") == 0) {
-                double ft = lua_tonumber(m_pLuaState, -1);
-                if (ft < DBL_EPSILON) {
-                    snprintf(pszT, LM_STRSIZE - 1, "%s \t0 \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszType));
-                }
-                else {
-                    snprintf(pszV, LM_STRSIZEN - 1, "%g", ft);
-                    snprintf(pszT, LM_STRSIZE - 1, "%s \t%s \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszV), static_cast<const char*>(pszType));
-                }
-            }
-            else {
-                snprintf(pszV, LM_STRSIZEN - 1, "%g", lua_tonumber(m_pLuaState, -1));
-                snprintf(pszT, LM_STRSIZE - 1, "%s \t%s \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszV), static_cast<const char*>(pszType));
-            }
+            snprintf(tItem.value, DEBUG_VALUESIZE - 1, "%.14g", lua_tonumber(m_pLuaState, -1));
             break;
         case LUA_TTABLE:
-            nn = (int) luaL_len(m_pLuaState, -1);
-            ne = (nn < 10) ? nn : 10;
-            if (ne > 0) {
-                strcpy(pszV, "{ ");
-                for (jj = 1; jj <= ne; jj++) {
-                    ilen = (int) strlen((const char*) pszV);
-                    if (ilen >= (DEBUG_VARSIZE - 12)) {
-                        strcat(pszV, " ...");
-                        break;
-                    }
-                    lua_rawgeti(m_pLuaState, -1, jj);
-                    itop = lua_gettop(m_pLuaState);
-                    if (itop == 0) {
-                        // Empty stack
-                        break;
-                    }
-                    pszArg = (char*) lua_tostring(m_pLuaState, itop);
-                    if (pszArg != NULL) {
-                        strncat(pszV, (const char*) pszArg, (DEBUG_VARSIZE - 12) - ilen);
-                        if (jj < ne) {
-                            strcat(pszV, ", ");
-                        }
-                    }
-                    lua_pop(m_pLuaState, 1);
-                }
-                if ((nn > 10) && (jj >= ne)) {
-                    strcat(pszV, " ...");
-                }
-                strcat(pszV, " }");
-            }
-            else {
-                snprintf(pszV, LM_STRSIZEN - 1, "%lX", reinterpret_cast<unsigned long>(lua_topointer(m_pLuaState, -1)));
+            // Only the length (raw, no metamethod) is read: the fields are listed on demand
+            snprintf(tItem.value, DEBUG_VALUESIZE - 1, "{#%d} %p", (int) lua_objlen(m_pLuaState, -1), lua_topointer(m_pLuaState, -1));
+            lua_pushliteral(m_pLuaState, DEBUG_HANDLES);
+            lua_rawget(m_pLuaState, LUA_REGISTRYINDEX);
+            if (lua_istable(m_pLuaState, -1) == 0) {
+                lua_pop(m_pLuaState, 1);
+                lua_newtable(m_pLuaState);
+                lua_pushliteral(m_pLuaState, DEBUG_HANDLES);
+                lua_pushvalue(m_pLuaState, -2);
+                lua_rawset(m_pLuaState, LUA_REGISTRYINDEX);
             }
-            snprintf(pszT, LM_STRSIZE - 1, "%s \t%s \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszV), static_cast<const char*>(pszType));
-            break;
-        case LUA_TFUNCTION:
-            snprintf(pszV, LM_STRSIZEN - 1, "%lX", reinterpret_cast<unsigned long>(lua_topointer(m_pLuaState, -1)));
-            snprintf(pszT, LM_STRSIZE - 1, "%s \t%s \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszV), static_cast<const char*>(pszType));
-            break;
-        case LUA_TLIGHTUSERDATA:
-            snprintf(pszV, LM_STRSIZEN - 1, "%lX", reinterpret_cast<unsigned long>(lua_topointer(m_pLuaState, -1)));
-            snprintf(pszT, LM_STRSIZE - 1, "%s \t%s \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszV), static_cast<const char*>(pszType));
-            break;
-        case LUA_TUSERDATA:
-            snprintf(pszV, LM_STRSIZEN - 1, "%lX", reinterpret_cast<unsigned long>(lua_topointer(m_pLuaState, -1)));
-            snprintf(pszT, LM_STRSIZE - 1, "%s \t%s \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszV), static_cast<const char*>(pszType));
-            break;
-        case LUA_TTHREAD:
-            snprintf(pszV, LM_STRSIZEN - 1, "%lX", reinterpret_cast<unsigned long>(lua_topointer(m_pLuaState, -1)));
-            snprintf(pszT, LM_STRSIZE - 1, "%s \t%s \t%s \n", static_cast<const char*>(pszN), static_cast<const char*>(pszV), static_cast<const char*>(pszType));
-            break;
-        case LUA_TNIL:
-            bFlag = false;
-            break;
-        case LUA_TNONE:
-            bFlag = false;
+            m_iDebugHandle += 1;
+            lua_pushvalue(m_pLuaState, -2);
+            lua_rawseti(m_pLuaState, -2, m_iDebugHandle);
+            lua_pop(m_pLuaState, 1);                    // remove handles table
+            tItem.handle = m_iDebugHandle;
             break;
         default:
-            bFlag = false;
+            snprintf(tItem.value, DEBUG_VALUESIZE - 1, "%p", lua_topointer(m_pLuaState, -1));
             break;
     }
 
-    return bFlag;
+    return true;
 }
 
-LUAEXT_API bool LuaEngine::debugStackTrace(char *pszBuffer, int iLen, lua_Debug *pDebug)
+void LuaEngine::debugGetKey(int iIndex, char *pszN)
 {
-    if (iLen < LM_STRSIZE) {
-        return false;
+    // Never converted in place: the key is used by lua_next
+    int iType = lua_type(m_pLuaState, iIndex);
+    if (iType == LUA_TSTRING) {
+        size_t iLen = 0;
+        const char *pszT = lua_tolstring(m_pLuaState, iIndex, &iLen);
+        debugCopy(pszN, pszT, iLen, DEBUG_NAMESIZE);
     }
+    else if (iType == LUA_TNUMBER) {
+        snprintf(pszN, DEBUG_NAMESIZE - 1, "[%.14g]", lua_tonumber(m_pLuaState, iIndex));
+    }
+    else if (iType == LUA_TBOOLEAN) {
+        strcpy(pszN, lua_toboolean(m_pLuaState, iIndex) ? "[true]" : "[false]");
+    }
+    else {
+        snprintf(pszN, DEBUG_NAMESIZE - 1, "[%s: %p]", lua_typename(m_pLuaState, iType), lua_topointer(m_pLuaState, iIndex));
+    }
+}
 
-    int ii = 0, iLenT = 0;
-    char szN[LM_STRSIZEN];
-    char szT[LM_STRSIZE], szV[LM_STRSIZE >> 1];
-    char szPrev[LM_STRSIZE];
-    memset(szN, 0, LM_STRSIZEN * sizeof(char));
-    memset(szT, 0, LM_STRSIZE * sizeof(char));
-    memset(szV, 0, DEBUG_VARSIZE * sizeof(char));
-    memset(szPrev, 0, LM_STRSIZE * sizeof(char));
-    memset(pszBuffer, 0, iLen * sizeof(char));
-    char *pszName = NULL, *pszT = NULL;
-    bool bFlag = false;
+LUAEXT_API int LuaEngine::debugGetLocals(int iLevel, std::vector<LuaDebugItem> &vecItems)
+{
+    vecItems.clear();
 
-    ii = 0;
+    lua_Debug ldT;
+    if (lua_getstack(m_pLuaState, iLevel, &ldT) != 1) {
+        return 0;
+    }
 
-    while (ii < DEBUG_MAXCOUNT) {
+    LuaDebugItem tItem;
+    const char *pszName = NULL;
+    for (int ii = 1; (pszName = lua_getlocal(m_pLuaState, &ldT, ii)) != NULL; ii++) {
+        // Temporaries and internal variables such as (*vararg) are not listed
+        if ((pszName[0] != '(') || (pszName[1] != '*')) {
+            if (debugGetItem(pszName, tItem)) {
+                vecItems.push_back(tItem);
+            }
+        }
+        lua_pop(m_pLuaState, 1);    // remove variable value
+    }
 
-        if ((pszName = const_cast<char*>(lua_getlocal(m_pLuaState, pDebug, ii))) != NULL) {
+    return static_cast<int>(vecItems.size());
+}
 
-            if (strcmp(static_cast<const char*>(pszName), "(*temporary)") == 0) {
-                strcpy(szN, "*");
-            }
-            else {
-                strcpy(szN, static_cast<const char*>(pszName));
-            }
+LUAEXT_API int LuaEngine::debugGetGlobals(std::vector<LuaDebugItem> &vecItems)
+{
+    vecItems.clear();
 
-            bFlag = debugGetVariable(static_cast<const char*>(szN), static_cast<char*>(szV), static_cast<char*>(szT));
+    LuaDebugItem tItem;
+    char szN[DEBUG_NAMESIZE];
 
-#ifdef WIN32
-            if (bFlag && (stricmp(static_cast<const char*>(szPrev), static_cast<const char*>(szT)) != 0)) {
-#else
-            if (bFlag && (strcasecmp(static_cast<const char*>(szPrev), static_cast<const char*>(szT)) != 0)) {
-#endif
-                pszT = static_cast<char*>(szT);
-                while (*pszT) {
-                    if ((*pszT != '\n') && (*pszT != '\t') && (*pszT != ' ') && (*pszT != '*')) {
-                        break;
-                    }
-                    pszT += 1;
-                }
-                if (*pszT) {
-                    iLenT += static_cast<int>(strlen(static_cast<const char*>(szT)));
-                    if (iLenT >= iLen) {
-                        lua_pop(m_pLuaState, 1);    // remove variable value
-                        return false;
-                    }
-                    strcat(pszBuffer, static_cast<const char*>(szT));
-                    strcpy(szPrev, static_cast<const char*>(szT));
+    lua_pushglobaltable(m_pLuaState);
+    int iGlobals = lua_gettop(m_pLuaState);
+    lua_pushnil(m_pLuaState);
+
+    // Only the globals defined by the script (the ones found before it started are not listed)
+    while (lua_next(m_pLuaState, iGlobals) != 0) {            // pop key, push key,value
+        if (lua_type(m_pLuaState, -2) == LUA_TSTRING) {
+            if (m_GlobalSet.find(lm_hash((const char*) lua_tostring(m_pLuaState, -2))) == m_GlobalSet.end()) {
+                debugGetKey(-2, szN);
+                if (debugGetItem(szN, tItem)) {
+                    vecItems.push_back(tItem);
                 }
             }
-            lua_pop(m_pLuaState, 1);    // remove variable value
         }
+        lua_pop(m_pLuaState, 1);                               // remove value
 
-        if (ii++ >= DEBUG_MAXCOUNT) {
+        if (static_cast<int>(vecItems.size()) >= DEBUG_MAXCOUNT) {
+            lua_pop(m_pLuaState, 1);                           // remove key
             break;
         }
     }
 
-    iLenT += 20;
-    if (iLenT >= iLen) {
-        return false;
-    }
+    lua_pop(m_pLuaState, 1);                                   // remove global table
 
-    // Globals
-    ii = 0;
+    return static_cast<int>(vecItems.size());
+}
 
-    lua_pushglobaltable(m_pLuaState);
-    lua_pushnil(m_pLuaState);
+LUAEXT_API int LuaEngine::debugGetChildren(int iHandle, int iFirst, int iCount, std::vector<LuaDebugItem> &vecItems, int *piNext)
+{
+    vecItems.clear();
+    *piNext = -1;
 
-    while (lua_next(m_pLuaState, -2) != 0) {            // pop nil, push name,value
+    if ((iHandle < 1) || (iHandle > m_iDebugHandle) || (iFirst < 0) || (iCount < 1)) {
+        return 0;
+    }
 
-        if (m_GlobalSet.find(lm_hash((const char*) lua_tostring(m_pLuaState, -2))) == m_GlobalSet.end()) {
+    lua_pushliteral(m_pLuaState, DEBUG_HANDLES);
+    lua_rawget(m_pLuaState, LUA_REGISTRYINDEX);
+    if (lua_istable(m_pLuaState, -1) == 0) {
+        lua_pop(m_pLuaState, 1);
+        return 0;
+    }
+    int iHandles = lua_gettop(m_pLuaState);
+    lua_rawgeti(m_pLuaState, iHandles, iHandle);
+    if (lua_istable(m_pLuaState, -1) == 0) {
+        lua_pop(m_pLuaState, 2);
+        return 0;
+    }
+    int iTable = lua_gettop(m_pLuaState);
 
-            pszName = const_cast<char*>(lua_tostring(m_pLuaState, -2));
-            if (strcmp(static_cast<const char*>(pszName), "(*temporary)") == 0) {
-                strcpy(szN, "*");
-            }
-            else {
-                strcpy(szN, static_cast<const char*>(pszName));
-            }
+    LuaDebugItem tItem;
+    char szN[DEBUG_NAMESIZE];
 
-            bFlag = debugGetVariable(static_cast<const char*>(szN), static_cast<char*>(szV), static_cast<char*>(szT));
+    // Array part: positions 0 to iLen - 1, read by index
+    const int iLen = static_cast<int>(lua_objlen(m_pLuaState, iTable));
+    int iPos = iFirst;
+    for (; (iPos < iLen) && (static_cast<int>(vecItems.size()) < iCount); iPos++) {
+        lua_rawgeti(m_pLuaState, iTable, iPos + 1);
+        snprintf(szN, DEBUG_NAMESIZE - 1, "[%d]", iPos + 1);
+        if (debugGetItem(szN, tItem)) {
+            vecItems.push_back(tItem);
+        }
+        lua_pop(m_pLuaState, 1);
+    }
 
-#ifdef WIN32
-            if (bFlag && (stricmp(static_cast<const char*>(szPrev), static_cast<const char*>(szT)) != 0)) {
-#else
-            if (bFlag && (strcasecmp(static_cast<const char*>(szPrev), static_cast<const char*>(szT)) != 0)) {
-#endif
-                pszT = static_cast<char*>(szT);
-                while (*pszT) {
-                    if ((*pszT != '\n') && (*pszT != '\t') && (*pszT != ' ') && (*pszT != '*')) {
-                        break;
-                    }
-                    pszT += 1;
-                }
-                if (*pszT) {
-                    iLenT += static_cast<int>(strlen(static_cast<const char*>(szT)));
-                    if (iLenT >= iLen) {
-                        lua_pop(m_pLuaState, 1);                                // remove value
-                        lua_pop(m_pLuaState, 1);                                // remove global table
-                        return false;
-                    }
-                    strcat(pszBuffer, static_cast<const char*>(szT));
-                    strcpy(szPrev, static_cast<const char*>(szT));
-                }
-            }
+    if (static_cast<int>(vecItems.size()) >= iCount) {
+        *piNext = iPos;
+        lua_pop(m_pLuaState, 2);
+        return static_cast<int>(vecItems.size());
+    }
 
+    // Other fields: positions from iLen, listed with lua_next.
+    // The key following the last page is kept so that the pages are read in sequence;
+    // any other position is reached by skipping the fields before it.
+    std::map<int, int>::iterator itC = m_DebugCursors.find(iHandle);
+    if ((iPos > iLen) && (itC != m_DebugCursors.end()) && (itC->second == iPos)) {
+        lua_rawgeti(m_pLuaState, iHandles, -iHandle);
+    }
+    else {
+        lua_pushnil(m_pLuaState);
+        int iSkip = iLen;
+        while ((iSkip < iPos) && (lua_next(m_pLuaState, iTable) != 0)) {
+            lua_pop(m_pLuaState, 1);
+            if ((lua_type(m_pLuaState, -1) == LUA_TNUMBER) && (lua_tonumber(m_pLuaState, -1) >= 1.0) && (lua_tonumber(m_pLuaState, -1) <= static_cast<double>(iLen))) {
+                continue;
             }
+            iSkip += 1;
+        }
+        if (iSkip < iPos) {
+            // Fewer fields than expected: table modified
+            lua_pop(m_pLuaState, 2);
+            return static_cast<int>(vecItems.size());
+        }
+    }
 
-        lua_pop(m_pLuaState, 1);                                                // remove value
-
-        if (ii++ >= DEBUG_MAXCOUNT) {
+    bool bMore = false;
+    while (lua_next(m_pLuaState, iTable) != 0) {                // pop key, push key,value
+        if ((lua_type(m_pLuaState, -2) == LUA_TNUMBER) && (lua_tonumber(m_pLuaState, -2) >= 1.0) && (lua_tonumber(m_pLuaState, -2) <= static_cast<double>(iLen))) {
+            // Already listed with the array part
+            lua_pop(m_pLuaState, 1);
+            continue;
+        }
+        if (static_cast<int>(vecItems.size()) >= iCount) {
+            bMore = true;
+            lua_pop(m_pLuaState, 2);                            // remove key,value
             break;
         }
+        debugGetKey(-2, szN);
+        if (debugGetItem(szN, tItem)) {
+            vecItems.push_back(tItem);
+        }
+        iPos += 1;
+        lua_pop(m_pLuaState, 1);                                // remove value
+        if (static_cast<int>(vecItems.size()) >= iCount) {
+            // Save the key (one more lua_next tells if the table has more fields)
+            lua_pushvalue(m_pLuaState, -1);
+            lua_rawseti(m_pLuaState, iHandles, -iHandle);
+            m_DebugCursors[iHandle] = iPos;
+        }
     }
 
-    lua_pop(m_pLuaState, 1);                                                    // remove global table
-    //
-
-    iLenT += 20;
-    if (iLenT >= iLen) {
-        return false;
+    if (bMore) {
+        *piNext = iPos;
     }
 
-    strcat(pszBuffer, "\nSTACKTRACE\n");
+    lua_pop(m_pLuaState, 2);                                    // remove table and handles table
+
+    return static_cast<int>(vecItems.size());
+}
+
+LUAEXT_API int LuaEngine::debugGetStack(std::vector<LuaDebugFrame> &vecFrames)
+{
+    vecFrames.clear();
 
     lua_Debug ldT;
-    int iDepth = 0;
+    LuaDebugFrame tFrame;
+    const char *pszName = NULL;
 
-    while (iDepth <= DEBUG_MAXCOUNT) {
+    for (int iDepth = 0; iDepth <= DEBUG_MAXCOUNT; iDepth++) {
         if (lua_getstack(m_pLuaState, iDepth, &ldT) != 1) {
             break;
         }
         lua_getinfo(m_pLuaState, "nSl", &ldT);
-        if (ldT.currentline < 0) {
-            ldT.currentline = 0;
-        }
 
         if (ldT.name && (*(ldT.name) != '\0')) {
-            strncpy(szV, ldT.name, (LM_STRSIZE >> 1) - 1);
+            pszName = ldT.name;
         }
         else if (ldT.namewhat && (*(ldT.namewhat) != '\0')) {
-            strncpy(szV, ldT.namewhat, (LM_STRSIZE >> 1) - 1);
+            pszName = ldT.namewhat;
         }
-        else if (ldT.what) {
-            if (*(ldT.what) == 'm') {
-                strcpy(szV, "main");
-            }
-            else if (*(ldT.what) == 'C') {
-                strcpy(szV, "C");
-            }
-            else if (*(ldT.what) == 't') {
-                strcpy(szV, "tail");
-            }
-            else if (ldT.short_src && (*(ldT.short_src) != '\0')) {
-                strncpy(szV, ldT.short_src, LM_STRSIZES - 1);
-            }
-            else {
-                strcpy(szV, "?");
-            }
+        else if (ldT.what && (*(ldT.what) == 'm')) {
+            pszName = "main";
+        }
+        else if (ldT.what && (*(ldT.what) == 'C')) {
+            pszName = "C";
+        }
+        else if (ldT.what && (*(ldT.what) == 't')) {
+            pszName = "tail";
+        }
+        else if (ldT.short_src[0] != '\0') {
+            pszName = ldT.short_src;
         }
         else {
-            strcpy(szV, "?");
+            pszName = "?";
         }
 
-        snprintf(szT, LM_STRSIZE - 1, "%d \t%d \t%s \t%s \n", iDepth, ldT.currentline, static_cast<const char*>(szV), ldT.what);
-        iLenT += static_cast<int>(strlen(static_cast<const char*>(szT)));
-        if (iLenT >= iLen) {
-            break;
-        }
-        strcat(pszBuffer, static_cast<const char*>(szT));
-        iDepth += 1;
+        tFrame.level = iDepth;
+        tFrame.line = (ldT.currentline < 0) ? 0 : ldT.currentline;
+        debugCopy(tFrame.name, pszName, strlen(pszName), DEBUG_NAMESIZE);
+        strncpy(tFrame.what, ldT.what ? ldT.what : "?", DEBUG_TYPESIZE - 1);
+        tFrame.what[DEBUG_TYPESIZE - 1] = '\0';
+        vecFrames.push_back(tFrame);
     }
 
-    return true;
+    return static_cast<int>(vecFrames.size());
+}
+
+LUAEXT_API void LuaEngine::debugRelease(void)
+{
+    if ((m_iDebugHandle > 0) && m_pLuaState) {
+        lua_pushliteral(m_pLuaState, DEBUG_HANDLES);
+        lua_pushnil(m_pLuaState);
+        lua_rawset(m_pLuaState, LUA_REGISTRYINDEX);
+    }
+    m_iDebugHandle = 0;
+    m_DebugCursors.clear();
 }
 
 LUAEXT_API long LuaEngine::socketNew(long iId, int iFamily/* = AF_INET*/, int iType/* = SOCK_STREAM*/,
@@ -1419,9 +1441,9 @@ LUAEXT_API bool LuaEngine::runScriptFile(char* pszFilename, int iLen, const char
         szOutputFilenameA[0] = szOutputFilenameA[LM_STRSIZE - 1] = '\0';
 
         if (LUA_ENGINE_COMPILE == bAction) {
-            if (LuaEngine::LUADUMPFIlE) {
-                fclose(LuaEngine::LUADUMPFIlE);
-                LuaEngine::LUADUMPFIlE = NULL;
+            if (m_pDump) {
+                fclose(m_pDump);
+                m_pDump = NULL;
             }
             char szDumpFilename[LM_STRSIZE];
             szDumpFilename[0] = szDumpFilename[LM_STRSIZE - 1] = '\0';
@@ -1443,15 +1465,15 @@ LUAEXT_API bool LuaEngine::runScriptFile(char* pszFilename, int iLen, const char
                 }
                 strcat(szDumpFilename, (".luac"));
             }
-            LuaEngine::LUADUMPFIlE = fopen(static_cast<const char*>(szDumpFilename), ("wb"));
+            m_pDump = fopen(static_cast<const char*>(szDumpFilename), ("wb"));
         }
 
         bRet = runScriptString(static_cast<const char*>(pszBufferA), bAction);
 
         if (LUA_ENGINE_COMPILE == bAction) {
-            if (LuaEngine::LUADUMPFIlE) {
-                fclose(LuaEngine::LUADUMPFIlE);
-                LuaEngine::LUADUMPFIlE = NULL;
+            if (m_pDump) {
+                fclose(m_pDump);
+                m_pDump = NULL;
             }
         }
     }
@@ -1509,7 +1531,7 @@ LUAEXT_API bool LuaEngine::runScriptString(const char *pszBufferA, bool bAction)
             // LUA_ENGINE_COMPILE
             iRet = luaL_loadstring(m_pLuaState, pszBufferA);
             if (0 == iRet) {
-                iRet = lua_dump(m_pLuaState, LuaEngine::LUADUMP, LuaEngine::LUADUMPFIlE, 1);
+                iRet = lua_dump(m_pLuaState, LuaEngine::LUADUMP, m_pDump, 1);
             }
         }
 
@@ -1570,6 +1592,92 @@ LUAEXT_API bool LuaEngine::runScriptString(const char *pszBufferA, bool bAction)
     return (iRet == LUA_OK);
 }
 
+LUAEXT_API bool LuaEngine::compileBuffer(const char *pszBufferA, size_t iLen, const char *pszChunkname, std::string &strBytecode, bool bStrip/* = true*/)
+{
+    if (m_pLuaState == NULL) {
+        assignResources(false);
+        if (m_pLuaState == NULL) {
+            showMessage(uT("Cannot compile script: insufficient memory"));
+            return false;
+        }
+    }
+
+    m_iErrLine = -1;
+
+    const int iTop = lua_gettop(m_pLuaState);
+
+    int iRet = luaL_loadbuffer(m_pLuaState, pszBufferA, iLen, pszChunkname);
+    if (0 == iRet) {
+        iRet = lua_dump(m_pLuaState, LuaEngine::LUADUMPSTRING, static_cast<void*>(&strBytecode), bStrip ? 1 : 0);
+        if (iRet != 0) {
+            lua_settop(m_pLuaState, iTop);
+            showMessage(uT("Cannot compile script: insufficient memory"));
+            return false;
+        }
+    }
+    else {
+        char szMsg[LM_STRSIZE];
+        szMsg[0] = szMsg[LM_STRSIZE - 1] = '\0';
+        const char* pszRet = lua_tostring(m_pLuaState, -1);
+        int iErrLine = lineNumber((pszRet != NULL) ? pszRet : "! unrecoverable error", szMsg);
+        if (iErrLine >= 0) {
+            m_iErrLine = iErrLine;
+        }
+        lua_settop(m_pLuaState, iTop);
+        showMessageA((szMsg[0] != '\0') ? static_cast<const char*>(szMsg) : "! unrecoverable error");
+        return false;
+    }
+
+    lua_settop(m_pLuaState, iTop);
+    return true;
+}
+
+LUAEXT_API bool LuaEngine::compileFile(const char *pszFilename, const char *pszChunkname, std::string &strBytecode, bool bStrip/* = true*/)
+{
+    // read in binary mode --> "rb" (by default windows api read in text mode)
+    FILE *fpScript = fopen(pszFilename, "rb");
+    if (fpScript == NULL) {
+        showMessage(uT("Cannot compile script: invalid file"));
+        return false;
+    }
+
+    fseek(fpScript, 0L, SEEK_END);
+    long fileSize = ftell(fpScript);
+    fseek(fpScript, 0L, SEEK_SET);
+    if ((fileSize < 1L) || (fileSize > LF_SCRIPT_MAXCHARS)) {
+        fclose(fpScript);
+        fpScript = NULL;
+        showMessage((fileSize < 1L) ? uT("Cannot compile script: empty file") : uT("Cannot compile script: file size > 256 MB"));
+        return false;
+    }
+
+    char *pszBufferA = (char*) malloc((fileSize + 1) * sizeof(char));
+    if (pszBufferA == NULL) {
+        fclose(fpScript);
+        fpScript = NULL;
+        showMessage(uT("Cannot compile script: insufficient memory"));
+        return false;
+    }
+
+    size_t iret = fread(pszBufferA, sizeof(char), fileSize, fpScript);
+    fclose(fpScript);
+    fpScript = NULL;
+
+    bool bRet = false;
+    if ((iret * sizeof(char)) == static_cast<size_t>(fileSize)) {
+        pszBufferA[iret] = '\0';
+        bRet = compileBuffer(static_cast<const char*>(pszBufferA), iret, pszChunkname, strBytecode, bStrip);
+    }
+    else {
+        showMessage(uT("Cannot compile script: invalid file content"));
+    }
+
+    free(pszBufferA);
+    pszBufferA = NULL;
+
+    return bRet;
+}
+
 LUAEXT_API int LuaEngine::lineNumber(const char* pszMessageA, char *pszT)
 {
     int iLine = -1;
@@ -2511,6 +2511,10 @@ public:
      void SetExtraDescent(int iDescent);
      // <<
 
+     // >> [:COMET:]: wxEVT_STC_STYLENEEDED sent before lexing, the handler colourises
+     void SetStyleNeededNotify(bool bNotify);
+     // <<
+
     // Sets the position that starts the target which is used for updating the
     // document without affecting the scroll position.
     void SetTargetStart(int pos);
@@ -3210,6 +3214,29 @@ public:
     // Get the background alpha of the caret line.
     int GetCaretLineBackAlpha();
 
+    // Compact the document buffer and return a read-only pointer to the
+    // characters in the document, valid until the next modification.
+    const char* GetCharacterPointer();
+
+    // Return a read-only pointer to a range of characters in the document.
+    // May move the gap so that the range is contiguous, avoiding a copy
+    // of the whole document. Valid until the next modification.
+    const char* GetRangePointer(int position, int rangeLength);
+
+    // Set the memory budget in bytes for the undo data (0 for no limit).
+    // When exceeded, old undo data is spilled or the oldest operations are dropped.
+    void SetUndoMemoryLimit(int bytes);
+
+    // Get the memory budget for the undo data.
+    int GetUndoMemoryLimit();
+
+    // Set whether undo data over the memory budget is kept compressed in a temporary file
+    // instead of dropping the oldest operations.
+    void SetUndoSpill(bool spill);
+
+    // Is undo data over the memory budget kept in a temporary file?
+    bool GetUndoSpill();
+
     // Start notifying the container of all key presses and commands.
     void StartRecord();
 
@@ -3398,6 +3425,9 @@ public:
     // Append a string to the end of the document without changing the selection.
     void AppendTextRaw(const char* text);
 
+    // Replace the target text with length bytes of text (may contain NULs).
+    int ReplaceTargetRaw(const char* text, int length);
+
 #ifdef SWIG
     %pythoncode "_stc_utf8_methods.py"
 #endif
@@ -623,6 +623,12 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SC_ALPHA_NOALPHA 256
 #define SCI_SETCARETLINEBACKALPHA 2470
 #define SCI_GETCARETLINEBACKALPHA 2471
+#define SCI_GETCHARACTERPOINTER 2520
+#define SCI_GETRANGEPOINTER 2643
+#define SCI_SETUNDOMEMORYLIMIT 2644
+#define SCI_GETUNDOMEMORYLIMIT 2645
+#define SCI_SETUNDOSPILL 2646
+#define SCI_GETUNDOSPILL 2647
 #define SCI_STARTRECORD 3001
 #define SCI_STOPRECORD 3002
 #define SCI_SETLEXER 4001
@@ -647,6 +653,10 @@ typedef sptr_t (*SciFnDirect)(sptr_t ptr, unsigned int iMessage, uptr_t wParam,
 #define SCI_AUTOCSELECTINDEX 2599
 // <<
 
+// >> [:COMET:]: lexer styling asked to the container first (SCN_STYLENEEDED)
+#define SCI_SETSTYLENEEDEDNOTIFY 2598
+// <<
+
 #define SC_MOD_INSERTTEXT 0x1
 #define SC_MOD_DELETETEXT 0x2
 #define SC_MOD_CHANGESTYLE 0x4
@@ -10,10 +10,14 @@
 #include <stdlib.h>
 #include <stdarg.h>
 
+#include "zlib.h"
+
 #include "Platform.h"
 
 #include "Scintilla.h"
 #include "SVector.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
 #include "CellBuffer.h"
 
 MarkerHandleSet::MarkerHandleSet() {
@@ -121,210 +125,208 @@ void MarkerHandleSet::CombineWith(MarkerHandleSet *other) {
 	other->root = 0;
 }
 
-LineVector::LineVector() {
-	linesData = 0;
-	lines = 0;
-	size = 0;
-	levels = 0;
-	sizeLevels = 0;
+LineVector::LineVector() : starts(256) {
 	handleCurrent = 1;
-	growSize = 1000;
 
 	Init();
 }
 
 LineVector::~LineVector() {
-	for (int line = 0; line < lines; line++) {
-		delete linesData[line].handleSet;
-		linesData[line].handleSet = 0;
+	starts.DeleteAll();
+	for (int line = 0; line < markers.Length(); line++) {
+		delete markers[line];
+		markers[line] = 0;
 	}
-	delete []linesData;
-	linesData = 0;
-	delete []levels;
-	levels = 0;
+	markers.DeleteAll();
+	levels.DeleteAll();
+	lineStates.DeleteAll();
 }
 
 void LineVector::Init() {
-	for (int line = 0; line < lines; line++) {
-		delete linesData[line].handleSet;
-		linesData[line].handleSet = 0;
-	}
-	delete []linesData;
-	linesData = new LineData[static_cast<int>(growSize)];
-	size = growSize;
-	lines = 1;
-	delete []levels;
-	levels = 0;
-	sizeLevels = 0;
-}
-
-void LineVector::Expand(int sizeNew) {
-	LineData *linesDataNew = new LineData[sizeNew];
-	if (linesDataNew) {
-		for (int i = 0; i < size; i++)
-			linesDataNew[i] = linesData[i];
-		// Do not delete handleSets here as they are transferred to new linesData
-		delete []linesData;
-		linesData = linesDataNew;
-		size = sizeNew;
-	} else {
-		//Platform::DebugPrintf("No memory available\n");
-		// TODO: Blow up
+	starts.DeleteAll();
+	for (int line = 0; line < markers.Length(); line++) {
+		delete markers[line];
+		markers[line] = 0;
 	}
-
+	markers.DeleteAll();
+	levels.DeleteAll();
+	lineStates.DeleteAll();
 }
 
 void LineVector::ExpandLevels(int sizeNew) {
 	if (sizeNew == -1)
-		sizeNew = size;
-	int *levelsNew = new int[sizeNew];
-	if (levelsNew) {
-		int i = 0;
-		for (; i < sizeLevels; i++)
-			levelsNew[i] = levels[i];
-		for (; i < sizeNew; i++)
-			levelsNew[i] = SC_FOLDLEVELBASE;
-		delete []levels;
-		levels = levelsNew;
-		sizeLevels = sizeNew;
-	} else {
-		//Platform::DebugPrintf("No memory available\n");
-		// TODO: Blow up
-	}
-
+		sizeNew = Lines() + 1;
+	levels.InsertValue(levels.Length(), sizeNew - levels.Length(), SC_FOLDLEVELBASE);
 }
 
 void LineVector::ClearLevels() {
-	delete []levels;
-	levels = 0;
-	sizeLevels = 0;
-}
-
-void LineVector::InsertValue(int pos, int value) {
-	//Platform::DebugPrintf("InsertValue[%d] = %d\n", pos, value);
-	if ((lines + 2) >= size) {
-		if (growSize * 6 < size)
-			growSize *= 2;
-		Expand(size + growSize);
-		if (levels) {
-			ExpandLevels(size + growSize);
+	levels.DeleteAll();
+}
+
+int LineVector::SetLevel(int line, int level) {
+	int prev = 0;
+	if ((line >= 0) && (line < Lines())) {
+		if (!levels.Length()) {
+			ExpandLevels();
+		}
+		prev = levels[line];
+		if (prev != level) {
+			levels[line] = level;
 		}
 	}
-	lines++;
-	for (int i = lines; i > pos; i--) {
-		linesData[i] = linesData[i - 1];
+	return prev;
+}
+
+int LineVector::GetLevel(int line) {
+	if (levels.Length() && (line >= 0) && (line < Lines())) {
+		return levels[line];
+	} else {
+		return SC_FOLDLEVELBASE;
 	}
-	linesData[pos].startPosition = value;
-	linesData[pos].handleSet = 0;
-	if (levels) {
-		for (int j = lines; j > pos; j--) {
-			levels[j] = levels[j - 1];
-		}
-		if (pos == 0) {
-			levels[pos] = SC_FOLDLEVELBASE;
-		} else if (pos == (lines - 1)) {	// Last line will not be a folder
-			levels[pos] = SC_FOLDLEVELBASE;
-		} else {
-			levels[pos] = levels[pos - 1];
+}
+
+int LineVector::SetLineState(int line, int state) {
+	if (line < 0)
+		return 0;
+	lineStates.EnsureLength(line + 1);
+	int stateOld = lineStates[line];
+	lineStates[line] = state;
+	return stateOld;
+}
+
+int LineVector::GetLineState(int line) {
+	if ((line < 0) || (line >= lineStates.Length()))
+		return 0;
+	return lineStates[line];
+}
+
+void LineVector::InsertText(int line, int delta) {
+	starts.InsertText(line, delta);
+}
+
+void LineVector::InsertLine(int line, int position) {
+	//Platform::DebugPrintf("InsertLine[%d] = %d\n", line, position);
+	starts.InsertPartition(line, position);
+	if (markers.Length()) {
+		markers.Insert(line, 0);
+	}
+	if (levels.Length()) {
+		int level = SC_FOLDLEVELBASE;
+		if ((line > 0) && (line < (Lines() - 1))) {	// Last line will not be a folder
+			level = levels[line - 1];
 		}
+		levels.Insert(line, level);
+	}
+	// The new line starts with the state of the line it was split from
+	if (line < lineStates.Length()) {
+		lineStates.Insert(line, lineStates[line]);
 	}
 }
 
-void LineVector::SetValue(int pos, int value) {
-	//Platform::DebugPrintf("SetValue[%d] = %d\n", pos, value);
-	if ((pos + 2) >= size) {
-		//Platform::DebugPrintf("Resize %d %d\n", size,pos);
-		Expand(pos + growSize);
-		//Platform::DebugPrintf("end Resize %d %d\n", size,pos);
-		lines = pos;
-		if (levels) {
-			ExpandLevels(pos + growSize);
-		}
+void LineVector::InsertLines(int line, const int *positions, int count) {
+	//Platform::DebugPrintf("InsertLines[%d] %d lines\n", line, count);
+	if (count <= 0)
+		return;
+	// Same levels as inserting the lines one at a time: copies of the level of the line before,
+	// except at the start of the document and at its end, where the last line will not be a folder.
+	int level = SC_FOLDLEVELBASE;
+	if (levels.Length() && (line > 0) && (line < Lines())) {
+		level = levels[line - 1];
+	}
+	starts.InsertPartitions(line, positions, count);
+	if (markers.Length()) {
+		markers.InsertValue(line, count, 0);
+	}
+	if (levels.Length()) {
+		levels.InsertValue(line, count, level);
 	}
-	linesData[pos].startPosition = value;
+	if (line < lineStates.Length()) {
+		lineStates.InsertValue(line, count, lineStates[line]);
+	}
+}
+
+void LineVector::AllocateLines(int lines) {
+	starts.AllocatePartitions(lines);
 }
 
-void LineVector::Remove(int pos) {
-	//Platform::DebugPrintf("Remove %d\n", pos);
+void LineVector::SetLineStart(int line, int position) {
+	//Platform::DebugPrintf("SetLineStart[%d] = %d\n", line, position);
+	starts.SetPartitionStartPosition(line, position);
+}
+
+void LineVector::RemoveLine(int line) {
+	//Platform::DebugPrintf("RemoveLine %d\n", line);
+	starts.RemovePartition(line);
 	// Retain the markers from the deleted line by oring them into the previous line
-	if (pos > 0) {
-		MergeMarkers(pos - 1);
-	}
-	for (int i = pos; i < lines; i++) {
-		linesData[i] = linesData[i + 1];
+	if (markers.Length()) {
+		if (line > 0) {
+			MergeMarkers(line - 1);
+		}
+		markers.Delete(line);
 	}
-	if (levels) {
+	if (levels.Length()) {
 		// Move up following lines but merge header flag from this line
 		// to line before to avoid a temporary disappearence causing expansion.
-		int firstHeader = levels[pos] & SC_FOLDLEVELHEADERFLAG;
-		for (int j = pos; j < lines; j++) {
-			levels[j] = levels[j + 1];
-		}
-		if (pos > 0)
-			levels[pos-1] |= firstHeader;
+		int firstHeader = levels[line] & SC_FOLDLEVELHEADERFLAG;
+		levels.Delete(line);
+		if (line > 0)
+			levels[line - 1] |= firstHeader;
+	}
+	if (line < lineStates.Length()) {
+		lineStates.Delete(line);
 	}
-	lines--;
 }
 
 int LineVector::LineFromPosition(int pos) {
-	//Platform::DebugPrintf("LineFromPostion %d lines=%d end = %d\n", pos, lines, linesData[lines].startPosition);
-	if (lines == 0)
-		return 0;
-	//Platform::DebugPrintf("LineFromPosition %d\n", pos);
-	if (pos >= linesData[lines].startPosition)
-		return lines - 1;
-	int lower = 0;
-	int upper = lines;
-	do {
-		int middle = (upper + lower + 1) / 2; 	// Round high
-		if (pos < linesData[middle].startPosition) {
-			upper = middle - 1;
-		} else {
-			lower = middle;
-		}
-	} while (lower < upper);
-	//Platform::DebugPrintf("LineFromPostion %d %d %d\n", pos, lower, linesData[lower].startPosition, linesData[lower > 1 ? lower - 1 : 0].startPosition);
-	return lower;
+	return starts.PartitionFromPosition(pos);
+}
+
+int LineVector::MarkValue(int line) {
+	if (markers.Length() && (line >= 0) && (line < markers.Length()) && markers[line])
+		return markers[line]->MarkValue();
+	return 0;
 }
 
 int LineVector::AddMark(int line, int markerNum) {
 	handleCurrent++;
-	if (!linesData[line].handleSet) {
+	if (!markers.Length()) {
+		// No existing markers so allocate one element per line
+		markers.InsertValue(0, Lines(), 0);
+	}
+	if (!markers[line]) {
 		// Need new structure to hold marker handle
-		linesData[line].handleSet = new MarkerHandleSet;
-		if (!linesData[line].handleSet)
+		markers[line] = new MarkerHandleSet;
+		if (!markers[line])
 			return - 1;
 	}
-	linesData[line].handleSet->InsertHandle(handleCurrent, markerNum);
+	markers[line]->InsertHandle(handleCurrent, markerNum);
 
 	return handleCurrent;
 }
 
 void LineVector::MergeMarkers(int pos) {
-	if (linesData[pos + 1].handleSet != NULL) {
-		if (linesData[pos].handleSet == NULL )
-			linesData[pos].handleSet = new MarkerHandleSet;
-		linesData[pos].handleSet->CombineWith(linesData[pos + 1].handleSet);
-		delete linesData[pos + 1].handleSet;
-		linesData[pos + 1].handleSet = NULL;
+	if (markers[pos + 1] != NULL) {
+		if (markers[pos] == NULL)
+			markers[pos] = new MarkerHandleSet;
+		markers[pos]->CombineWith(markers[pos + 1]);
+		delete markers[pos + 1];
+		markers[pos + 1] = NULL;
 	}
 }
 
 void LineVector::DeleteMark(int line, int markerNum, bool all) {
-	if (linesData[line].handleSet) {
+	if (markers.Length() && markers[line]) {
 		if (markerNum == -1) {
-			delete linesData[line].handleSet;
-			linesData[line].handleSet = 0;
+			delete markers[line];
+			markers[line] = NULL;
 		} else {
-			bool performedDeletion = 
-				linesData[line].handleSet->RemoveNumber(markerNum);
+			bool performedDeletion = markers[line]->RemoveNumber(markerNum);
 			while (all && performedDeletion) {
-				performedDeletion = 
-					linesData[line].handleSet->RemoveNumber(markerNum);
+				performedDeletion = markers[line]->RemoveNumber(markerNum);
 			}
-			if (linesData[line].handleSet->Length() == 0) {
-				delete linesData[line].handleSet;
-				linesData[line].handleSet = 0;
+			if (markers[line]->Length() == 0) {
+				delete markers[line];
+				markers[line] = NULL;
 			}
 		}
 	}
@@ -333,19 +335,21 @@ void LineVector::DeleteMark(int line, int markerNum, bool all) {
 void LineVector::DeleteMarkFromHandle(int markerHandle) {
 	int line = LineFromHandle(markerHandle);
 	if (line >= 0) {
-		linesData[line].handleSet->RemoveHandle(markerHandle);
-		if (linesData[line].handleSet->Length() == 0) {
-			delete linesData[line].handleSet;
-			linesData[line].handleSet = 0;
+		markers[line]->RemoveHandle(markerHandle);
+		if (markers[line]->Length() == 0) {
+			delete markers[line];
+			markers[line] = NULL;
 		}
 	}
 }
 
 int LineVector::LineFromHandle(int markerHandle) {
-	for (int line = 0; line < lines; line++) {
-		if (linesData[line].handleSet) {
-			if (linesData[line].handleSet->Contains(markerHandle)) {
-				return line;
+	if (markers.Length()) {
+		for (int line = 0; line < Lines(); line++) {
+			if (markers[line]) {
+				if (markers[line]->Contains(markerHandle)) {
+					return line;
+				}
 			}
 		}
 	}
@@ -357,6 +361,10 @@ Action::Action() {
 	position = 0;
 	data = 0;
 	lenData = 0;
+	lenAlloc = 0;
+	mayCoalesce = true;
+	spillPosition = -1;
+	spillLength = 0;
 }
 
 Action::~Action() {
@@ -369,12 +377,18 @@ void Action::Create(actionType at_, int position_, char *data_, int lenData_, bo
 	at = at_;
 	data = data_;
 	lenData = lenData_;
+	lenAlloc = data_ ? lenData_ : 0;
 	mayCoalesce = mayCoalesce_;
+	spillPosition = -1;
+	spillLength = 0;
 }
 
 void Action::Destroy() {
 	delete []data;
 	data = 0;
+	lenAlloc = 0;
+	spillPosition = -1;
+	spillLength = 0;
 }
 
 void Action::Grab(Action *source) {
@@ -384,14 +398,20 @@ void Action::Grab(Action *source) {
 	at = source->at;
 	data = source->data;
 	lenData = source->lenData;
+	lenAlloc = source->lenAlloc;
 	mayCoalesce = source->mayCoalesce;
+	spillPosition = source->spillPosition;
+	spillLength = source->spillLength;
 
 	// Ownership of source data transferred to this
 	source->position = 0;
 	source->at = startAction;
 	source->data = 0;
 	source->lenData = 0;
+	source->lenAlloc = 0;
 	source->mayCoalesce = true;
+	source->spillPosition = -1;
+	source->spillLength = 0;
 }
 
 // The undo history stores a sequence of user operations that represent the user's view of the
@@ -411,6 +431,12 @@ void Action::Grab(Action *source) {
 // operation. If there is no outstanding BeginUndoAction call then a new operation is started
 // unless it looks as if the new action is caused by the user typing or deleting a stream of text.
 // Sequences that look like typing or deletion are coalesced into a single user operation.
+// Within an operation, an insertion just after the previous one or a deletion just before or at
+// the previous one is merged into the previous action, so that a typed word is one action with
+// one buffer instead of one per character.
+// The memory taken by the action data may be bounded. When the limit is exceeded, the data of
+// the actions farthest from the current one is written, compressed, to a temporary file and read
+// back when needed, or, without the file, the oldest user operations are dropped.
 
 UndoHistory::UndoHistory() {
 
@@ -421,12 +447,20 @@ UndoHistory::UndoHistory() {
 	undoSequenceDepth = 0;
 	savePoint = 0;
 
+	memoryLimit = 0;
+	memoryUsed = 0;
+	spill = false;
+	spillFile = 0;
+	spillLow = 1;
+	spillHigh = 0;
+
 	actions[currentAction].Create(startAction);
 }
 
 UndoHistory::~UndoHistory() {
 	delete []actions;
 	actions = 0;
+	CloseSpill();
 }
 
 void UndoHistory::EnsureUndoRoom() {
@@ -438,7 +472,8 @@ void UndoHistory::EnsureUndoRoom() {
 		Action *actionsNew = new Action[lenActionsNew];
 		if (!actionsNew)
 			return ;
-		for (int act = 0; act <= currentAction; act++)
+		// The redo actions are kept too
+		for (int act = 0; act <= maxAction; act++)
 			actionsNew[act].Grab(&actions[act]);
 		delete []actions;
 		lenActions = lenActionsNew;
@@ -446,7 +481,173 @@ void UndoHistory::EnsureUndoRoom() {
 	}
 }
 
-void UndoHistory::AppendAction(actionType at, int position, char *data, int lengthData) {
+char *UndoHistory::GrowData(Action &action, int lengthNew) {
+	if (lengthNew > action.lenAlloc) {
+		int lenAllocNew = action.lenAlloc * 2;
+		if (lenAllocNew < lengthNew)
+			lenAllocNew = lengthNew;
+		if (lenAllocNew < 16)
+			lenAllocNew = 16;
+		char *dataNew = new char[lenAllocNew];
+		if (action.lenData > 0)
+			memcpy(dataNew, action.data, action.lenData);
+		delete []action.data;
+		action.data = dataNew;
+		memoryUsed += lenAllocNew - action.lenAlloc;
+		action.lenAlloc = lenAllocNew;
+	}
+	return action.data;
+}
+
+void UndoHistory::ReleaseData(Action &action) {
+	if (action.data)
+		memoryUsed -= action.lenAlloc;
+	action.Destroy();
+}
+
+bool UndoHistory::SpillData(Action &action) {
+	if (!action.data)
+		return true;
+	if (action.spillPosition < 0) {
+		if (!spillFile) {
+			spillFile = tmpfile();
+			if (!spillFile)
+				return false;
+		}
+		if (fseek(spillFile, 0, SEEK_END) != 0)
+			return false;
+		long pos = ftell(spillFile);
+		if (pos < 0)
+			return false;
+		uLongf lenCompressed = compressBound(action.lenData);
+		char *compressed = new char[lenCompressed];
+		const char *record = action.data;
+		int lenRecord = action.lenData;
+		if ((compress2(reinterpret_cast<Bytef *>(compressed), &lenCompressed,
+		               reinterpret_cast<const Bytef *>(action.data), action.lenData, Z_BEST_SPEED) == Z_OK) &&
+		        (lenCompressed < static_cast<uLongf>(action.lenData))) {
+			record = compressed;
+			lenRecord = static_cast<int>(lenCompressed);
+		}
+		// Data that does not compress is stored as is, recognized by its length
+		bool written = fwrite(record, 1, lenRecord, spillFile) == static_cast<size_t>(lenRecord);
+		delete []compressed;
+		if (!written)
+			return false;
+		action.spillPosition = pos;
+		action.spillLength = lenRecord;
+	}
+	// A record read back is still valid in the file since only the last action changes
+	memoryUsed -= action.lenAlloc;
+	delete []action.data;
+	action.data = 0;
+	action.lenAlloc = 0;
+	return true;
+}
+
+bool UndoHistory::LoadData(Action &action) {
+	if (action.data || (action.spillPosition < 0))
+		return true;
+	if (!spillFile || (fseek(spillFile, action.spillPosition, SEEK_SET) != 0))
+		return false;
+	char *dataNew = new char[action.lenData];
+	bool loaded;
+	if (action.spillLength == action.lenData) {
+		loaded = fread(dataNew, 1, action.lenData, spillFile) == static_cast<size_t>(action.lenData);
+	} else {
+		char *compressed = new char[action.spillLength];
+		uLongf lenUncompressed = action.lenData;
+		loaded = (fread(compressed, 1, action.spillLength, spillFile) == static_cast<size_t>(action.spillLength)) &&
+		         (uncompress(reinterpret_cast<Bytef *>(dataNew), &lenUncompressed,
+		                     reinterpret_cast<const Bytef *>(compressed), action.spillLength) == Z_OK) &&
+		         (lenUncompressed == static_cast<uLongf>(action.lenData));
+		delete []compressed;
+	}
+	if (!loaded) {
+		delete []dataNew;
+		return false;
+	}
+	action.data = dataNew;
+	action.lenAlloc = action.lenData;
+	memoryUsed += action.lenAlloc;
+	return true;
+}
+
+bool UndoHistory::LoadRange(int actFirst, int actLast) {
+	for (int act = actFirst; act <= actLast; act++) {
+		if (!LoadData(actions[act]))
+			return false;
+	}
+	if (spillLow > actFirst)
+		spillLow = actFirst;
+	if (spillHigh < actLast)
+		spillHigh = actLast;
+	return true;
+}
+
+void UndoHistory::DropOldest(int target, int actKeep) {
+	// Find the end of the oldest user operations to drop, always at a start action
+	// and only as far as it frees memory
+	int cut = 0;
+	int memoryDropped = 0;
+	int memoryDroppedCut = 0;
+	for (int act = 1; act <= actKeep; act++) {
+		if (actions[act].data)
+			memoryDropped += actions[act].lenAlloc;
+		if (actions[act].at == startAction) {
+			if (memoryDropped > memoryDroppedCut) {
+				cut = act;
+				memoryDroppedCut = memoryDropped;
+			}
+			if (memoryUsed - memoryDroppedCut <= target)
+				break;
+		}
+	}
+	if (cut == 0)
+		return;
+	for (int act = 1; act <= cut; act++)
+		ReleaseData(actions[act]);
+	for (int act = cut + 1; act <= maxAction; act++)
+		actions[act - cut].Grab(&actions[act]);
+	maxAction -= cut;
+	currentAction -= cut;
+	if (savePoint >= cut)
+		savePoint -= cut;
+	else
+		savePoint = -1;
+	spillLow = (spillLow > cut) ? (spillLow - cut) : 1;
+	spillHigh = (spillHigh > cut) ? (spillHigh - cut) : 0;
+}
+
+void UndoHistory::EnforceLimit(int actKeepFirst, int actKeepLast) {
+	if ((memoryLimit <= 0) || (memoryUsed <= memoryLimit))
+		return;
+	// Release down to three quarters of the limit so that the work is not done on every action
+	const int target = memoryLimit - memoryLimit / 4;
+	if (spill) {
+		bool spilled = true;
+		for (; spilled && (spillLow < actKeepFirst) && (memoryUsed > target); spillLow++)
+			spilled = SpillData(actions[spillLow]);
+		if (spillHigh > maxAction)
+			spillHigh = maxAction;
+		for (; spilled && (spillHigh > actKeepLast) && (memoryUsed > target); spillHigh--)
+			spilled = SpillData(actions[spillHigh]);
+		// The operations being performed may be over the limit by themselves:
+		// nothing is dropped unless the undo file can not be written
+		if (spilled)
+			return;
+	}
+	DropOldest(target, actKeepFirst);
+}
+
+void UndoHistory::CloseSpill() {
+	if (spillFile) {
+		fclose(spillFile);
+		spillFile = 0;
+	}
+}
+
+const char *UndoHistory::AppendAction(actionType at, int position, const char *data, int lengthData) {
 	EnsureUndoRoom();
 	//Platform::DebugPrintf("%% %d action %d %d %d\n", at, position, lengthData, currentAction);
 	//Platform::DebugPrintf("^ %d action %d %d\n", actions[currentAction - 1].at,
@@ -454,6 +655,10 @@ void UndoHistory::AppendAction(actionType at, int position, char *data, int leng
 	if (currentAction < savePoint) {
 		savePoint = -1;
 	}
+	// The actions that could have been redone are lost
+	for (int act = currentAction + 1; act <= maxAction; act++)
+		ReleaseData(actions[act]);
+	const int actionStart = currentAction;
 	if (currentAction >= 1) {
 		if (0 == undoSequenceDepth) {
 			// Top level actions may not always be coalesced
@@ -497,10 +702,51 @@ void UndoHistory::AppendAction(actionType at, int position, char *data, int leng
 	} else {
 		currentAction++;
 	}
-	actions[currentAction].Create(at, position, data, lengthData);
-	currentAction++;
-	actions[currentAction].Create(startAction);
+	const char *dataStored = 0;
+	if ((currentAction == actionStart) && (currentAction >= 1) && (currentAction != savePoint) &&
+	        (actions[currentAction - 1].at == at) && actions[currentAction - 1].data && (lengthData > 0)) {
+		// Same operation: merge the data into the previous action when the text is contiguous
+		Action &actPrevious = actions[currentAction - 1];
+		const int lenPrevious = actPrevious.lenData;
+		if ((at == insertAction) && (position == (actPrevious.position + lenPrevious))) {
+			char *dataPrevious = GrowData(actPrevious, lenPrevious + lengthData);
+			memcpy(dataPrevious + lenPrevious, data, lengthData);
+			dataStored = dataPrevious + lenPrevious;
+		} else if ((at == removeAction) && (position == actPrevious.position)) {
+			// Delete: the removed text follows the previous one
+			char *dataPrevious = GrowData(actPrevious, lenPrevious + lengthData);
+			memcpy(dataPrevious + lenPrevious, data, lengthData);
+			dataStored = dataPrevious + lenPrevious;
+		} else if ((at == removeAction) && ((position + lengthData) == actPrevious.position)) {
+			// Backspace: the removed text precedes the previous one
+			char *dataPrevious = GrowData(actPrevious, lenPrevious + lengthData);
+			memmove(dataPrevious + lengthData, dataPrevious, lenPrevious);
+			memcpy(dataPrevious, data, lengthData);
+			actPrevious.position = position;
+			dataStored = dataPrevious;
+		}
+		if (dataStored) {
+			actPrevious.lenData += lengthData;
+			// The record written before, if any, no longer matches
+			actPrevious.spillPosition = -1;
+		}
+	}
+	if (!dataStored) {
+		char *dataNew = new char[lengthData];
+		memcpy(dataNew, data, lengthData);
+		ReleaseData(actions[currentAction]);
+		actions[currentAction].Create(at, position, dataNew, lengthData);
+		memoryUsed += lengthData;
+		dataStored = dataNew;
+		currentAction++;
+		ReleaseData(actions[currentAction]);
+		actions[currentAction].Create(startAction);
+	}
 	maxAction = currentAction;
+	if (spillHigh < currentAction - 1)
+		spillHigh = currentAction - 1;
+	EnforceLimit(currentAction - 1, currentAction);
+	return dataStored;
 }
 
 void UndoHistory::BeginUndoAction() {
@@ -508,6 +754,7 @@ void UndoHistory::BeginUndoAction() {
 	if (undoSequenceDepth == 0) {
 		if (actions[currentAction].at != startAction) {
 			currentAction++;
+			ReleaseData(actions[currentAction]);
 			actions[currentAction].Create(startAction);
 			maxAction = currentAction;
 		}
@@ -522,6 +769,7 @@ void UndoHistory::EndUndoAction() {
 	if (0 == undoSequenceDepth) {
 		if (actions[currentAction].at != startAction) {
 			currentAction++;
+			ReleaseData(actions[currentAction]);
 			actions[currentAction].Create(startAction);
 			maxAction = currentAction;
 		}
@@ -534,12 +782,16 @@ void UndoHistory::DropUndoSequence() {
 }
 
 void UndoHistory::DeleteUndoHistory() {
-	for (int i = 1; i < maxAction; i++)
-		actions[i].Destroy();
+	for (int i = 1; i <= maxAction; i++)
+		ReleaseData(actions[i]);
 	maxAction = 0;
 	currentAction = 0;
 	actions[currentAction].Create(startAction);
 	savePoint = 0;
+	memoryUsed = 0;
+	spillLow = 1;
+	spillHigh = 0;
+	CloseSpill();
 }
 
 void UndoHistory::SetSavePoint() {
@@ -564,7 +816,15 @@ int UndoHistory::StartUndo() {
 	while (actions[act].at != startAction && act > 0) {
 		act--;
 	}
-	return currentAction - act;
+	if (!LoadRange(act, currentAction)) {
+		// The undo file can not be read: the history is lost, the document stays modified
+		DeleteUndoHistory();
+		savePoint = -1;
+		return 0;
+	}
+	const int steps = currentAction - act;
+	EnforceLimit(act, currentAction);
+	return steps;
 }
 
 const Action &UndoHistory::GetUndoStep() const {
@@ -589,7 +849,14 @@ int UndoHistory::StartRedo() {
 	while (actions[act].at != startAction && act < maxAction) {
 		act++;
 	}
-	return act - currentAction;
+	if (!LoadRange(currentAction, act)) {
+		DeleteUndoHistory();
+		savePoint = -1;
+		return 0;
+	}
+	const int steps = act - currentAction;
+	EnforceLimit(currentAction - 1, act);
+	return steps;
 }
 
 const Action &UndoHistory::GetRedoStep() const {
@@ -600,132 +867,78 @@ void UndoHistory::CompletedRedoStep() {
 	currentAction++;
 }
 
-CellBuffer::CellBuffer(int initialLength) {
-	body = new char[initialLength];
-	size = initialLength;
-	length = 0;
-	part1len = 0;
-	gaplen = initialLength;
-	part2body = body + gaplen;
-	readOnly = false;
-	collectingUndo = true;
-	growSize = 4000;
+void UndoHistory::SetMemoryLimit(int bytes) {
+	memoryLimit = (bytes > 0) ? bytes : 0;
+	EnforceLimit(currentAction, currentAction);
 }
 
-CellBuffer::~CellBuffer() {
-	delete []body;
-	body = 0;
+int UndoHistory::GetMemoryLimit() const {
+	return memoryLimit;
 }
 
-void CellBuffer::GapTo(int position) {
-	if (position == part1len)
-		return ;
-	if (position < part1len) {
-		int diff = part1len - position;
-		//Platform::DebugPrintf("Move gap backwards to %d diff = %d part1len=%d length=%d \n", position,diff, part1len, length);
-		for (int i = 0; i < diff; i++)
-			body[part1len + gaplen - i - 1] = body[part1len - i - 1];
-	} else {	// position > part1len
-		int diff = position - part1len;
-		//Platform::DebugPrintf("Move gap forwards to %d diff =%d\n", position,diff);
-		for (int i = 0; i < diff; i++)
-			body[part1len + i] = body[part1len + gaplen + i];
-	}
-	part1len = position;
-	part2body = body + gaplen;
-}
-
-void CellBuffer::RoomFor(int insertionLength) {
-	//Platform::DebugPrintf("need room %d %d\n", gaplen, insertionLength);
-	if (gaplen <= insertionLength) {
-		//Platform::DebugPrintf("need room %d %d\n", gaplen, insertionLength);
-		if (growSize * 6 < size)
-			growSize *= 2;
-		int newSize = size + insertionLength + growSize;
-		Allocate(newSize);
-	}
-}
-
-// To make it easier to write code that uses ByteAt, a position outside the range of the buffer
-// can be retrieved. All characters outside the range have the value '\0'.
-char CellBuffer::ByteAt(int position) {
-	if (position < part1len) {
-		if (position < 0) {
-			return '\0';
-		} else {
-			return body[position];
-		}
-	} else {
-		if (position >= length) {
-			return '\0';
-		} else {
-			return part2body[position];
-		}
-	}
+void UndoHistory::SetSpill(bool spill_) {
+	// Records already in the undo file stay readable until the history is deleted
+	spill = spill_;
 }
 
-void CellBuffer::SetByteAt(int position, char ch) {
+bool UndoHistory::GetSpill() const {
+	return spill;
+}
 
-	if (position < 0) {
-		//Platform::DebugPrintf("Bad position %d\n",position);
-		return ;
-	}
-	if (position >= length + 11) {
-		//Platform::DebugPrintf("Very Bad position %d of %d\n", position, length);
-		//exit(2);
-		return ;
-	}
-	if (position >= length) {
-		//Platform::DebugPrintf("Bad position %d of %d\n",position,length);
-		return ;
-	}
+CellBuffer::CellBuffer() {
+	substance.SetGrowSize(4000);
+	style.SetGrowSize(4000);
+	hasStyles = false;
+	readOnly = false;
+	collectingUndo = true;
+}
 
-	if (position < part1len) {
-		body[position] = ch;
-	} else {
-		part2body[position] = ch;
+CellBuffer::~CellBuffer() {
+}
+
+void CellBuffer::AllocateStyles() {
+	if (!hasStyles) {
+		style.InsertValue(0, substance.Length(), 0);
+		hasStyles = true;
 	}
 }
 
-char CellBuffer::CharAt(int position) {
-	return ByteAt(position*2);
+char CellBuffer::CharAt(int position) const {
+	return substance.ValueAt(position);
 }
 
-void CellBuffer::GetCharRange(char *buffer, int position, int lengthRetrieve) {
+void CellBuffer::GetCharRange(char *buffer, int position, int lengthRetrieve) const {
 	if (lengthRetrieve < 0)
 		return ;
 	if (position < 0)
 		return ;
-	int bytePos = position * 2;
-	if ((bytePos + lengthRetrieve * 2) > length) {
-		Platform::DebugPrintf("Bad GetCharRange %d for %d of %d\n", bytePos,
-		                      lengthRetrieve, length);
+	if ((position + lengthRetrieve) > substance.Length()) {
+		Platform::DebugPrintf("Bad GetCharRange %d for %d of %d\n", position,
+		                      lengthRetrieve, substance.Length());
 		return ;
 	}
-	GapTo(0); 	// Move the buffer so its easy to subscript into it
-	char *pb = part2body + bytePos;
-	while (lengthRetrieve--) {
-		*buffer++ = *pb;
-		pb += 2;
-	}
+	substance.GetRange(buffer, position, lengthRetrieve);
 }
 
-char CellBuffer::StyleAt(int position) {
-	return ByteAt(position*2 + 1);
+char CellBuffer::StyleAt(int position) const {
+	return hasStyles ? style.ValueAt(position) : 0;
 }
 
-const char *CellBuffer::InsertString(int position, char *s, int insertLength) {
-	char *data = 0;
+const char *CellBuffer::BufferPointer() {
+	return substance.BufferPointer();
+}
+
+const char *CellBuffer::RangePointer(int position, int rangeLength) {
+	return substance.RangePointer(position, rangeLength);
+}
+
+const char *CellBuffer::InsertString(int position, const char *s, int insertLength) {
+	const char *data = 0;
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	if (!readOnly) {
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
-			// This takes up about half load time
-			data = new char[insertLength / 2];
-			for (int i = 0; i < insertLength / 2; i++) {
-				data[i] = s[i * 2];
-			}
-			uh.AppendAction(insertAction, position / 2, data, insertLength / 2);
+			data = uh.AppendAction(insertAction, position, s, insertLength);
 		}
 
 		BasicInsertString(position, s, insertLength);
@@ -733,29 +946,45 @@ const char *CellBuffer::InsertString(int position, char *s, int insertLength) {
 	return data;
 }
 
-bool CellBuffer::SetStyleAt(int position, char style, char mask) {
-	style &= mask;
-	char curVal = ByteAt(position * 2 + 1);
-	if ((curVal & mask) != style) {
-		SetByteAt(position*2 + 1, static_cast<char>((curVal & ~mask) | style));
+bool CellBuffer::SetStyleAt(int position, char styleValue, char mask) {
+	styleValue &= mask;
+	if ((position < 0) || (position >= substance.Length()))
+		return false;
+	if (!hasStyles) {
+		// Every style is still 0
+		if (styleValue == 0)
+			return false;
+		AllocateStyles();
+	}
+	char curVal = style.ValueAt(position);
+	if ((curVal & mask) != styleValue) {
+		style.SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
 		return true;
 	} else {
 		return false;
 	}
 }
 
-bool CellBuffer::SetStyleFor(int position, int lengthStyle, char style, char mask) {
-	int bytePos = position * 2 + 1;
+bool CellBuffer::SetStyleFor(int position, int lengthStyle, char styleValue, char mask) {
 	bool changed = false;
 	PLATFORM_ASSERT(lengthStyle == 0 ||
-		(lengthStyle > 0 && lengthStyle + position < length));
-	while (lengthStyle--) {
-		char curVal = ByteAt(bytePos);
-		if ((curVal & mask) != style) {
-			SetByteAt(bytePos, static_cast<char>((curVal & ~mask) | style));
+		(lengthStyle > 0 && lengthStyle + position <= substance.Length()));
+	if ((position < 0) || (lengthStyle <= 0))
+		return false;
+	if ((position + lengthStyle) > substance.Length())
+		lengthStyle = substance.Length() - position;
+	if (!hasStyles) {
+		if (styleValue == 0)
+			return false;
+		AllocateStyles();
+	}
+	while (lengthStyle-- > 0) {
+		char curVal = style.ValueAt(position);
+		if ((curVal & mask) != styleValue) {
+			style.SetValueAt(position, static_cast<char>((curVal & ~mask) | styleValue));
 			changed = true;
 		}
-		bytePos += 2;
+		position++;
 	}
 	return changed;
 }
@@ -763,15 +992,11 @@ bool CellBuffer::SetStyleFor(int position, int lengthStyle, char style, char mas
 const char *CellBuffer::DeleteChars(int position, int deleteLength) {
 	// InsertString and DeleteChars are the bottleneck though which all changes occur
 	PLATFORM_ASSERT(deleteLength > 0);
-	char *data = 0;
+	const char *data = 0;
 	if (!readOnly) {
 		if (collectingUndo) {
 			// Save into the undo/redo stack, but only the characters - not the formatting
-			data = new char[deleteLength / 2];
-			for (int i = 0; i < deleteLength / 2; i++) {
-				data[i] = ByteAt(position + i * 2);
-			}
-			uh.AppendAction(removeAction, position / 2, data, deleteLength / 2);
+			data = uh.AppendAction(removeAction, position, substance.RangePointer(position, deleteLength), deleteLength);
 		}
 
 		BasicDeleteChars(position, deleteLength);
@@ -779,39 +1004,28 @@ const char *CellBuffer::DeleteChars(int position, int deleteLength) {
 	return data;
 }
 
-int CellBuffer::ByteLength() {
-	return length;
-}
-
-int CellBuffer::Length() {
-	return ByteLength() / 2;
+int CellBuffer::Length() const {
+	return substance.Length();
 }
 
 void CellBuffer::Allocate(int newSize) {
-	if (newSize > length) {
-		GapTo(length);
-		char *newBody = new char[newSize];
-		memcpy(newBody, body, length);
-		delete []body;
-		body = newBody;
-		gaplen += newSize - size;
-		part2body = body + gaplen;
-		size = newSize;
-	}
+	substance.ReAllocate(newSize);
+	if (hasStyles)
+		style.ReAllocate(newSize);
 }
 
 int CellBuffer::Lines() {
-	//Platform::DebugPrintf("Lines = %d\n", lv.lines);
-	return lv.lines;
+	//Platform::DebugPrintf("Lines = %d\n", lv.Lines());
+	return lv.Lines();
 }
 
 int CellBuffer::LineStart(int line) {
 	if (line < 0)
 		return 0;
-	else if (line > lv.lines)
+	else if (line > lv.Lines())
 		return Length();
 	else
-		return lv.linesData[line].startPosition;
+		return lv.LineStart(line);
 }
 
 bool CellBuffer::IsReadOnly() {
@@ -831,14 +1045,14 @@ bool CellBuffer::IsSavePoint() {
 }
 
 int CellBuffer::AddMark(int line, int markerNum) {
-	if ((line >= 0) && (line < lv.lines)) {
+	if ((line >= 0) && (line < lv.Lines())) {
 		return lv.AddMark(line, markerNum);
 	}
 	return - 1;
 }
 
 void CellBuffer::DeleteMark(int line, int markerNum) {
-	if ((line >= 0) && (line < lv.lines)) {
+	if ((line >= 0) && (line < lv.Lines())) {
 		lv.DeleteMark(line, markerNum, false);
 	}
 }
@@ -848,13 +1062,13 @@ void CellBuffer::DeleteMarkFromHandle(int markerHandle) {
 }
 
 int CellBuffer::GetMark(int line) {
-	if ((line >= 0) && (line < lv.lines) && (lv.linesData[line].handleSet))
-		return lv.linesData[line].handleSet->MarkValue();
+	if ((line >= 0) && (line < lv.Lines()))
+		return lv.MarkValue(line);
 	return 0;
 }
 
 void CellBuffer::DeleteAllMarks(int markerNum) {
-	for (int line = 0; line < lv.lines; line++) {
+	for (int line = 0; line < lv.Lines(); line++) {
 		lv.DeleteMark(line, markerNum, true);
 	}
 }
@@ -865,65 +1079,90 @@ int CellBuffer::LineFromHandle(int markerHandle) {
 
 // Without undo
 
-void CellBuffer::BasicInsertString(int position, char *s, int insertLength) {
+/// Return the first '\r' or '\n' in [s, end), or end if there is none.
+/// Whole machine words are tested at once and only the words flagged as possibly
+/// holding a line end are examined byte by byte.
+static inline const char *FindLineEnd(const char *s, const char *end) {
+	const size_t ones = static_cast<size_t>(-1) / 0xFF;	// 0x0101...01
+	const size_t highs = ones * 0x80;
+	const size_t crs = ones * '\r';
+	const size_t lfs = ones * '\n';
+	while ((end - s) >= static_cast<int>(sizeof(size_t))) {
+		size_t word;
+		memcpy(&word, s, sizeof(size_t));
+		size_t wordCR = word ^ crs;
+		size_t wordLF = word ^ lfs;
+		// Non zero if one of the bytes is zero (may flag a few others, which are checked below)
+		if ((((wordCR - ones) & ~wordCR) | ((wordLF - ones) & ~wordLF)) & highs)
+			break;
+		s += sizeof(size_t);
+	}
+	for (; s < end; s++) {
+		if ((*s == '\r') || (*s == '\n'))
+			return s;
+	}
+	return end;
+}
+
+void CellBuffer::BasicInsertString(int position, const char *s, int insertLength) {
 	//Platform::DebugPrintf("Inserting at %d for %d\n", position, insertLength);
 	if (insertLength == 0)
 		return ;
 	PLATFORM_ASSERT(insertLength > 0);
-	RoomFor(insertLength);
-	GapTo(position);
 
-	memcpy(body + part1len, s, insertLength);
-	length += insertLength;
-	part1len += insertLength;
-	gaplen -= insertLength;
-	part2body = body + gaplen;
+	substance.InsertFromArray(position, s, 0, insertLength);
+	if (hasStyles)
+		style.InsertValue(position, insertLength, 0);
 
-	int lineInsert = lv.LineFromPosition(position / 2) + 1;
+	int lineInsert = lv.LineFromPosition(position) + 1;
 	// Point all the lines after the insertion point further along in the buffer
-	for (int lineAfter = lineInsert; lineAfter <= lv.lines; lineAfter++) {
-		lv.linesData[lineAfter].startPosition += insertLength / 2;
-	}
-	char chPrev = ' ';
-	if ((position - 2) >= 0)
-		chPrev = ByteAt(position - 2);
-	char chAfter = ' ';
-	if ((position + insertLength) < length)
-		chAfter = ByteAt(position + insertLength);
+	lv.InsertText(lineInsert - 1, insertLength);
+	char chPrev = substance.ValueAt(position - 1);
+	char chAfter = substance.ValueAt(position + insertLength);
+	const char *end = s + insertLength;
+
+	// New line starts are collected in chunks and each chunk is inserted at once
+	const int startsSize = 1024;
+	if (insertLength > startsSize * 64) {
+		// Large block (file load, big paste): count the line ends first so that the
+		// line index is grown once instead of at every chunk
+		int countMax = 1;
+		for (const char *pch = FindLineEnd(s, end); pch < end; pch = FindLineEnd(pch + 1, end))
+			countMax++;
+		lv.AllocateLines(lv.Lines() + countMax);
+	}
+	int starts[startsSize];
+	int count = 0;
 	if (chPrev == '\r' && chAfter == '\n') {
 		//Platform::DebugPrintf("Splitting a crlf pair at %d\n", lineInsert);
 		// Splitting up a crlf pair at position
-		lv.InsertValue(lineInsert, position / 2);
-		lineInsert++;
+		starts[count++] = position;
 	}
-	char ch = ' ';
-	for (int i = 0; i < insertLength; i += 2) {
-		ch = s[i];
-		if (ch == '\r') {
-			//Platform::DebugPrintf("Inserting cr at %d\n", lineInsert);
-			lv.InsertValue(lineInsert, (position + i) / 2 + 1);
-			lineInsert++;
-		} else if (ch == '\n') {
-			if (chPrev == '\r') {
-				//Platform::DebugPrintf("Patching cr before lf at %d\n", lineInsert-1);
-				// Patch up what was end of line
-				lv.SetValue(lineInsert - 1, (position + i) / 2 + 1);
-			} else {
-				//Platform::DebugPrintf("Inserting lf at %d\n", lineInsert);
-				lv.InsertValue(lineInsert, (position + i) / 2 + 1);
-				lineInsert++;
+	for (const char *pch = FindLineEnd(s, end); pch < end; pch = FindLineEnd(pch + 1, end)) {
+		int i = static_cast<int>(pch - s);
+		if ((*pch == '\n') && (((i > 0) ? s[i - 1] : chPrev) == '\r')) {
+			//Platform::DebugPrintf("Patching cr before lf at %d\n", lineInsert + count - 1);
+			// Patch up what was end of line: the new one if any, else the one already in the buffer
+			if (count > 0)
+				starts[count - 1] = position + i + 1;
+			else
+				lv.SetLineStart(lineInsert - 1, position + i + 1);
+		} else {
+			if (count == startsSize) {
+				lv.InsertLines(lineInsert, starts, count);
+				lineInsert += count;
+				count = 0;
 			}
+			starts[count++] = position + i + 1;
 		}
-		chPrev = ch;
 	}
 	// Joining two lines where last insertion is cr and following text starts with lf
-	if (chAfter == '\n') {
-		if (ch == '\r') {
-			//Platform::DebugPrintf("Joining cr before lf at %d\n", lineInsert-1);
-			// End of line already in buffer so drop the newly created one
-			lv.Remove(lineInsert - 1);
-		}
+	if ((chAfter == '\n') && (s[insertLength - 1] == '\r')) {
+		//Platform::DebugPrintf("Joining cr before lf at %d\n", lineInsert + count - 1);
+		// End of line already in buffer so drop the newly created one
+		count--;
 	}
+	lv.InsertLines(lineInsert, starts, count);
 }
 
 void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
@@ -931,74 +1170,68 @@ void CellBuffer::BasicDeleteChars(int position, int deleteLength) {
 	if (deleteLength == 0)
 		return ;
 
-	if ((position == 0) && (deleteLength == length)) {
+	if ((position == 0) && (deleteLength == substance.Length())) {
 		// If whole buffer is being deleted, faster to reinitialise lines data
-		// than to delete each line.
+		// than to delete each line. The style buffer is released until styles are set again.
 		//printf("Whole buffer being deleted\n");
 		lv.Init();
-	} else {
-		// Have to fix up line positions before doing deletion as looking at text in buffer
-		// to work out which lines have been removed
+		substance.DeleteAll();
+		style.DeleteAll();
+		hasStyles = false;
+		return ;
+	}
 
-		int lineRemove = lv.LineFromPosition(position / 2) + 1;
-		// Point all the lines after the insertion point further along in the buffer
-		for (int lineAfter = lineRemove; lineAfter <= lv.lines; lineAfter++) {
-			lv.linesData[lineAfter].startPosition -= deleteLength / 2;
-		}
-		char chPrev = ' ';
-		if (position >= 2)
-			chPrev = ByteAt(position - 2);
-		char chBefore = chPrev;
-		char chNext = ' ';
-		if (position < length)
-			chNext = ByteAt(position);
-		bool ignoreNL = false;
-		if (chPrev == '\r' && chNext == '\n') {
-			//Platform::DebugPrintf("Deleting lf after cr, move line end to cr at %d\n", lineRemove);
-			// Move back one
-			lv.SetValue(lineRemove, position / 2);
-			lineRemove++;
-			ignoreNL = true; 	// First \n is not real deletion
-		}
+	// Have to fix up line positions before doing deletion as looking at text in buffer
+	// to work out which lines have been removed
 
-		char ch = chNext;
-		for (int i = 0; i < deleteLength; i += 2) {
-			chNext = ' ';
-			if ((position + i + 2) < length)
-				chNext = ByteAt(position + i + 2);
-			//Platform::DebugPrintf("Deleting %d %x\n", i, ch);
-			if (ch == '\r') {
-				if (chNext != '\n') {
-					//Platform::DebugPrintf("Removing cr end of line\n");
-					lv.Remove(lineRemove);
-				}
-			} else if (ch == '\n') {
-				if (ignoreNL) {
-					ignoreNL = false; 	// Further \n are real deletions
-				} else {
-					//Platform::DebugPrintf("Removing lf end of line\n");
-					lv.Remove(lineRemove);
-				}
-			}
+	int lineRemove = lv.LineFromPosition(position) + 1;
+	// Point all the lines after the insertion point further along in the buffer
+	lv.InsertText(lineRemove - 1, - deleteLength);
+	char chPrev = substance.ValueAt(position - 1);
+	char chBefore = chPrev;
+	char chNext = substance.ValueAt(position);
+	bool ignoreNL = false;
+	if (chPrev == '\r' && chNext == '\n') {
+		//Platform::DebugPrintf("Deleting lf after cr, move line end to cr at %d\n", lineRemove);
+		// Move back one
+		lv.SetLineStart(lineRemove, position);
+		lineRemove++;
+		ignoreNL = true; 	// First \n is not real deletion
+	}
 
-			ch = chNext;
-		}
-		// May have to fix up end if last deletion causes cr to be next to lf
-		// or removes one of a crlf pair
-		char chAfter = ' ';
-		if ((position + deleteLength) < length)
-			chAfter = ByteAt(position + deleteLength);
-		if (chBefore == '\r' && chAfter == '\n') {
-			//d.printf("Joining cr before lf at %d\n", lineRemove);
-			// Using lineRemove-1 as cr ended line before start of deletion
-			lv.Remove(lineRemove - 1);
-			lv.SetValue(lineRemove - 1, position / 2 + 1);
+	char ch = chNext;
+	for (int i = 0; i < deleteLength; i++) {
+		chNext = substance.ValueAt(position + i + 1);
+		//Platform::DebugPrintf("Deleting %d %x\n", i, ch);
+		if (ch == '\r') {
+			if (chNext != '\n') {
+				//Platform::DebugPrintf("Removing cr end of line\n");
+				lv.RemoveLine(lineRemove);
+			}
+		} else if (ch == '\n') {
+			if (ignoreNL) {
+				ignoreNL = false; 	// Further \n are real deletions
+			} else {
+				//Platform::DebugPrintf("Removing lf end of line\n");
+				lv.RemoveLine(lineRemove);
+			}
 		}
+
+		ch = chNext;
 	}
-	GapTo(position);
-	length -= deleteLength;
-	gaplen += deleteLength;
-	part2body = body + gaplen;
+	// May have to fix up end if last deletion causes cr to be next to lf
+	// or removes one of a crlf pair
+	char chAfter = substance.ValueAt(position + deleteLength);
+	if (chBefore == '\r' && chAfter == '\n') {
+		//d.printf("Joining cr before lf at %d\n", lineRemove);
+		// Using lineRemove-1 as cr ended line before start of deletion
+		lv.RemoveLine(lineRemove - 1);
+		lv.SetLineStart(lineRemove - 1, position + 1);
+	}
+
+	substance.DeleteRange(position, deleteLength);
+	if (hasStyles)
+		style.DeleteRange(position, deleteLength);
 }
 
 bool CellBuffer::SetUndoCollection(bool collectUndo) {
@@ -1023,6 +1256,22 @@ void CellBuffer::DeleteUndoHistory() {
 	uh.DeleteUndoHistory();
 }
 
+void CellBuffer::SetUndoMemoryLimit(int bytes) {
+	uh.SetMemoryLimit(bytes);
+}
+
+int CellBuffer::GetUndoMemoryLimit() const {
+	return uh.GetMemoryLimit();
+}
+
+void CellBuffer::SetUndoSpill(bool spill) {
+	uh.SetSpill(spill);
+}
+
+bool CellBuffer::GetUndoSpill() const {
+	return uh.GetSpill();
+}
+
 bool CellBuffer::CanUndo() {
 	return uh.CanUndo();
 }
@@ -1038,15 +1287,9 @@ const Action &CellBuffer::GetUndoStep() const {
 void CellBuffer::PerformUndoStep() {
 	const Action &actionStep = uh.GetUndoStep();
 	if (actionStep.at == insertAction) {
-		BasicDeleteChars(actionStep.position*2, actionStep.lenData*2);
+		BasicDeleteChars(actionStep.position, actionStep.lenData);
 	} else if (actionStep.at == removeAction) {
-		char *styledData = new char[actionStep.lenData * 2];
-		for (int i = 0; i < actionStep.lenData; i++) {
-			styledData[i*2] = actionStep.data[i];
-			styledData[i*2 + 1] = 0;
-		}
-		BasicInsertString(actionStep.position*2, styledData, actionStep.lenData*2);
-		delete []styledData;
+		BasicInsertString(actionStep.position, actionStep.data, actionStep.lenData);
 	}
 	uh.CompletedUndoStep();
 }
@@ -1066,53 +1309,31 @@ const Action &CellBuffer::GetRedoStep() const {
 void CellBuffer::PerformRedoStep() {
 	const Action &actionStep = uh.GetRedoStep();
 	if (actionStep.at == insertAction) {
-		char *styledData = new char[actionStep.lenData * 2];
-		for (int i = 0; i < actionStep.lenData; i++) {
-			styledData[i*2] = actionStep.data[i];
-			styledData[i*2 + 1] = 0;
-		}
-		BasicInsertString(actionStep.position*2, styledData, actionStep.lenData*2);
-		delete []styledData;
+		BasicInsertString(actionStep.position, actionStep.data, actionStep.lenData);
 	} else if (actionStep.at == removeAction) {
-		BasicDeleteChars(actionStep.position*2, actionStep.lenData*2);
+		BasicDeleteChars(actionStep.position, actionStep.lenData);
 	}
 	uh.CompletedRedoStep();
 }
 
 int CellBuffer::SetLineState(int line, int state) {
-	int stateOld = lineStates[line];
-	lineStates[line] = state;
-	return stateOld;
+	return lv.SetLineState(line, state);
 }
 
 int CellBuffer::GetLineState(int line) {
-	return lineStates[line];
+	return lv.GetLineState(line);
 }
 
 int CellBuffer::GetMaxLineState() {
-	return lineStates.Length();
+	return lv.GetMaxLineState();
 }
 
 int CellBuffer::SetLevel(int line, int level) {
-	int prev = 0;
-	if ((line >= 0) && (line < lv.lines)) {
-		if (!lv.levels) {
-			lv.ExpandLevels();
-		}
-		prev = lv.levels[line];
-		if (lv.levels[line] != level) {
-			lv.levels[line] = level;
-		}
-	}
-	return prev;
+	return lv.SetLevel(line, level);
 }
 
 int CellBuffer::GetLevel(int line) {
-	if (lv.levels && (line >= 0) && (line < lv.lines)) {
-		return lv.levels[line];
-	} else {
-		return SC_FOLDLEVELBASE;
-	}
+	return lv.GetLevel(line);
 }
 
 void CellBuffer::ClearLevels() {
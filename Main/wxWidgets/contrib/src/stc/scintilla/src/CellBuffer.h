@@ -37,44 +37,53 @@ public:
 	void CombineWith(MarkerHandleSet *other);
 };
 
-/**
- * Each line stores the starting position of the first character of the line in the cell buffer
- * and potentially a marker handle set. Often a line will not have any attached markers.
- */
-struct LineData {
-	int startPosition;
-	MarkerHandleSet *handleSet;
-	LineData() : startPosition(0), handleSet(0) {
-	}
-};
-
 /**
  * The line vector contains information about each of the lines in a cell buffer.
+ * Line starts are held in a Partitioning so that an insertion only moves a step
+ * instead of updating every following line. Markers, fold levels and line states are
+ * only allocated when first used, and are inserted and removed with the lines.
  */
 class LineVector {
-public:
-	int growSize;
-	int lines;
-	LineData *linesData;
-	int size;
-	int *levels;
-	int sizeLevels;
 
+	Partitioning starts;
+	SplitVector<MarkerHandleSet *> markers;
+	SplitVector<int> levels;
+	SplitVector<int> lineStates;
 	/// Handles are allocated sequentially and should never have to be reused as 32 bit ints are very big.
 	int handleCurrent;
 
+public:
+
 	LineVector();
 	~LineVector();
 	void Init();
 
-	void Expand(int sizeNew);
 	void ExpandLevels(int sizeNew=-1);
 	void ClearLevels();
-	void InsertValue(int pos, int value);
-	void SetValue(int pos, int value);
-	void Remove(int pos);
+	int SetLevel(int line, int level);
+	int GetLevel(int line);
+
+	int SetLineState(int line, int state);
+	int GetLineState(int line);
+	int GetMaxLineState() const {
+		return lineStates.Length();
+	}
+
+	void InsertText(int line, int delta);
+	void InsertLine(int line, int position);
+	void InsertLines(int line, const int *positions, int count);
+	void AllocateLines(int lines);
+	void SetLineStart(int line, int position);
+	void RemoveLine(int line);
+	int Lines() const {
+		return starts.Partitions();
+	}
 	int LineFromPosition(int pos);
+	int LineStart(int line) const {
+		return starts.PositionFromPartition(line);
+	}
 
+	int MarkValue(int line);
 	int AddMark(int line, int marker);
 	void MergeMarkers(int pos);
 	void DeleteMark(int line, int markerNum, bool all);
@@ -86,6 +95,8 @@ enum actionType { insertAction, removeAction, startAction };
 
 /**
  * Actions are used to store all the information required to perform one undo/redo step.
+ * The data of an old action may be spilled to the undo file: it is then released from
+ * memory and read back when the action is about to be undone or redone.
  */
 class Action {
 public:
@@ -93,7 +104,10 @@ public:
 	int position;
 	char *data;
 	int lenData;
+	int lenAlloc;	///< size of data, which may have room for coalesced typing
 	bool mayCoalesce;
+	long spillPosition;	///< offset of the record in the undo file, -1 if not spilled
+	int spillLength;	///< length of the record, equal to lenData when stored uncompressed
 
 	Action();
 	~Action();
@@ -103,7 +117,9 @@ public:
 };
 
 /**
- *
+ * The undo history is optionally bounded by a memory budget for the action data.
+ * When the budget is exceeded, the data of the actions farthest from the current one
+ * is either compressed to a temporary file (spill) or the oldest user operations are dropped.
  */
 class UndoHistory {
 	Action *actions;
@@ -113,13 +129,28 @@ class UndoHistory {
 	int undoSequenceDepth;
 	int savePoint;
 
+	int memoryLimit;	///< budget for the action data in bytes, 0 for no limit
+	int memoryUsed;
+	bool spill;
+	FILE *spillFile;
+	int spillLow;	///< no action data in memory below this index
+	int spillHigh;	///< no action data in memory above this index
+
 	void EnsureUndoRoom();
+	char *GrowData(Action &action, int lengthNew);
+	void ReleaseData(Action &action);
+	bool SpillData(Action &action);
+	bool LoadData(Action &action);
+	bool LoadRange(int actFirst, int actLast);
+	void DropOldest(int target, int actKeep);
+	void EnforceLimit(int actKeepFirst, int actKeepLast);
+	void CloseSpill();
 
 public:
 	UndoHistory();
 	~UndoHistory();
 
-	void AppendAction(actionType at, int position, char *data, int length);
+	const char *AppendAction(actionType at, int position, const char *data, int length);
 
 	void BeginUndoAction();
 	void EndUndoAction();
@@ -141,62 +172,64 @@ public:
 	int StartRedo();
 	const Action &GetRedoStep() const;
 	void CompletedRedoStep();
+
+	void SetMemoryLimit(int bytes);
+	int GetMemoryLimit() const;
+	void SetSpill(bool spill_);
+	bool GetSpill() const;
 };
 
 /**
  * Holder for an expandable array of characters that supports undo and line markers.
  * Based on article "Data Structures in a Bit-Mapped Text Editor"
  * by Wilfred J. Hansen, Byte January 1987, page 183.
+ * The text and the styles are held in two separate gap buffers. The style buffer is
+ * only allocated when a non zero style is first set, so unlexed documents do not pay for it.
  */
 class CellBuffer {
 private:
-	char *body;		///< The cell buffer itself.
-	int size;		///< Allocated size of the buffer.
-	int length;		///< Total length of the data.
-	int part1len;	///< Length of the first part.
-	int gaplen;		///< Length of the gap between the two parts.
-	char *part2body;	///< The second part of the cell buffer.
-						///< Doesn't point after the gap but set so that
-						///< part2body[position] is consistent with body[position].
+	SplitVector<char> substance;
+	SplitVector<char> style;
+	bool hasStyles;
 	bool readOnly;
-	int growSize;
 
 	bool collectingUndo;
 	UndoHistory uh;
 
 	LineVector lv;
 
-	SVector lineStates;
-
-	void GapTo(int position);
-	void RoomFor(int insertionLength);
-
-	inline char ByteAt(int position);
-	void SetByteAt(int position, char ch);
+	void AllocateStyles();
 
 public:
 
-	CellBuffer(int initialLength = 4000);
+	CellBuffer();
 	~CellBuffer();
 
 	/// Retrieving positions outside the range of the buffer works and returns 0
-	char CharAt(int position);
-	void GetCharRange(char *buffer, int position, int lengthRetrieve);
-	char StyleAt(int position);
-
-	int ByteLength();
-	int Length();
+	char CharAt(int position) const;
+	void GetCharRange(char *buffer, int position, int lengthRetrieve) const;
+	char StyleAt(int position) const;
+	/// Contiguous copy of the text, valid until the next modification.
+	const char *BufferPointer();
+	/// Contiguous range of the text, valid until the next modification.
+	const char *RangePointer(int position, int rangeLength);
+
+	int Length() const;
 	void Allocate(int newSize);
 	int Lines();
 	int LineStart(int line);
 	int LineFromPosition(int pos) { return lv.LineFromPosition(pos); }
 
-	const char *InsertString(int position, char *s, int insertLength);
+	const char *InsertString(int position, const char *s, int insertLength);
 
 	/// Setting styles for positions outside the range of the buffer is safe and has no effect.
 	/// @return true if the style of a character is changed.
-	bool SetStyleAt(int position, char style, char mask='\377');
-	bool SetStyleFor(int position, int length, char style, char mask);
+	bool SetStyleAt(int position, char styleValue, char mask='\377');
+	bool SetStyleFor(int position, int length, char styleValue, char mask);
+	/// False while no style has been set: StyleAt then returns 0 for every position.
+	bool HasStyles() const {
+		return hasStyles;
+	}
 
 	const char *DeleteChars(int position, int deleteLength);
 
@@ -217,7 +250,7 @@ public:
 	int LineFromHandle(int markerHandle);
 
 	/// Actions without undo
-	void BasicInsertString(int position, char *s, int insertLength);
+	void BasicInsertString(int position, const char *s, int insertLength);
 	void BasicDeleteChars(int position, int deleteLength);
 
 	bool SetUndoCollection(bool collectUndo);
@@ -225,6 +258,10 @@ public:
 	void BeginUndoAction();
 	void EndUndoAction();
 	void DeleteUndoHistory();
+	void SetUndoMemoryLimit(int bytes);
+	int GetUndoMemoryLimit() const;
+	void SetUndoSpill(bool spill);
+	bool GetUndoSpill() const;
 
 	/// To perform an undo, StartUndo is called to retrieve the number of steps, then UndoStep is
 	/// called that many times. Similarly for redo.
@@ -246,6 +283,4 @@ public:
 	void ClearLevels();
 };
 
-#define CELL_SIZE	2
-
 #endif
@@ -5,97 +5,68 @@
 // Copyright 1998-2001 by Neil Hodgson <neilh@scintilla.org>
 // The License.txt file describes the conditions under which this software may be distributed.
 
+#include <string.h>
+
 #include "Platform.h"
 
 #include "ContractionState.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
 
-OneLine::OneLine() {
-	displayLine = 0;
-	//docLine = 0;
-	visible = true;
-	height = 1;
-	expanded = true;
-}
-
-ContractionState::ContractionState() {
-	lines = 0;
-	size = 0;
-	linesInDoc = 1;
-	linesInDisplay = 1;
-	valid = false;
-	docLines = 0;
-	sizeDocLines = 0;
+ContractionState::ContractionState() : visible(0), expanded(0), heights(0), displayLines(0), linesInDocument(1) {
 }
 
 ContractionState::~ContractionState() {
 	Clear();
 }
 
-void ContractionState::MakeValid() const {
-	if (!valid) {
-		// Could be cleverer by keeping the index of the last still valid entry
-		// rather than invalidating all.
-		linesInDisplay = 0;
-		for (int lineInDoc=0; lineInDoc<linesInDoc; lineInDoc++) {
-			lines[lineInDoc].displayLine = linesInDisplay;
-			if (lines[lineInDoc].visible) {
-				linesInDisplay += lines[lineInDoc].height;
-			}
-		}
-		if (sizeDocLines < linesInDisplay) {
-			delete []docLines;
-			int *docLinesNew = new int[linesInDisplay + growSize];
-			if (!docLinesNew) {
-				docLines = 0;
-				sizeDocLines = 0;
-				return;
-			}
-			docLines = docLinesNew;
-			sizeDocLines = linesInDisplay + growSize;
-		}
-
-		int lineInDisplay=0;
-		for (int line=0; line<linesInDoc; line++) {
-			if (lines[line].visible) {
-				for (int linePiece=0; linePiece<lines[line].height; linePiece++) {
-					docLines[lineInDisplay] = line;
-					lineInDisplay++;
-				}
-			}
-		}
-		valid = true;
+void ContractionState::EnsureData() {
+	if (OneToOne()) {
+		visible = new SplitVector<char>();
+		expanded = new SplitVector<char>();
+		heights = new SplitVector<int>();
+		displayLines = new Partitioning(4);
+		int lines = linesInDocument;
+		linesInDocument = 0;
+		InsertLines(0, lines);
 	}
 }
 
 void ContractionState::Clear() {
-	delete []lines;
-	lines = 0;
-	size = 0;
-	linesInDoc = 1;
-	linesInDisplay = 1;
-	delete []docLines;
-	docLines = 0;
-	sizeDocLines = 0;
+	delete visible;
+	visible = 0;
+	delete expanded;
+	expanded = 0;
+	delete heights;
+	heights = 0;
+	delete displayLines;
+	displayLines = 0;
+	linesInDocument = 1;
 }
 
 int ContractionState::LinesInDoc() const {
-	return linesInDoc;
+	if (OneToOne()) {
+		return linesInDocument;
+	} else {
+		// The display lines hold one more partition, starting after the last line
+		return displayLines->Partitions() - 1;
+	}
 }
 
 int ContractionState::LinesDisplayed() const {
-	if (size != 0) {
-		MakeValid();
+	if (OneToOne()) {
+		return linesInDocument;
+	} else {
+		return displayLines->PositionFromPartition(LinesInDoc());
 	}
-	return linesInDisplay;
 }
 
 int ContractionState::DisplayFromDoc(int lineDoc) const {
-	if (size == 0) {
+	if (OneToOne()) {
 		return lineDoc;
 	}
-	MakeValid();
-	if ((lineDoc >= 0) && (lineDoc < linesInDoc)) {
-		return lines[lineDoc].displayLine;
+	if ((lineDoc >= 0) && (lineDoc < LinesInDoc())) {
+		return displayLines->PositionFromPartition(lineDoc);
 	}
 	return -1;
 }
@@ -103,141 +74,108 @@ int ContractionState::DisplayFromDoc(int lineDoc) const {
 int ContractionState::DocFromDisplay(int lineDisplay) const {
 	if (lineDisplay <= 0)
 		return 0;
-	if (lineDisplay >= linesInDisplay)
-		return linesInDoc;
-	if (size == 0)
+	if (lineDisplay >= LinesDisplayed())
+		return LinesInDoc();
+	if (OneToOne())
 		return lineDisplay;
-	MakeValid();
-	if (docLines) {	// Valid allocation
-		return docLines[lineDisplay];
-	} else {
-		return 0;
-	}
-}
-
-void ContractionState::Grow(int sizeNew) {
-	OneLine *linesNew = new OneLine[sizeNew];
-	if (linesNew) {
-		int i = 0;
-		for (; i < size; i++) {
-			linesNew[i] = lines[i];
-		}
-		for (; i < sizeNew; i++) {
-			linesNew[i].displayLine = i;
-		}
-		delete []lines;
-		lines = linesNew;
-		size = sizeNew;
-		valid = false;
-	} else {
-		//Platform::DebugPrintf("No memory available\n");
-		// TODO: Blow up
-	}
+	// Hidden lines are empty partitions: the visible line is the last one starting at lineDisplay
+	return displayLines->PartitionFromPosition(lineDisplay);
 }
 
 void ContractionState::InsertLines(int lineDoc, int lineCount) {
-	if (size == 0) {
-		linesInDoc += lineCount;
-		linesInDisplay += lineCount;
+	if (lineCount <= 0)
+		return;
+	if (OneToOne()) {
+		linesInDocument += lineCount;
 		return;
 	}
-	//Platform::DebugPrintf("InsertLine[%d] = %d\n", lineDoc);
-	if ((linesInDoc + lineCount + 2) >= size) {
-		Grow(linesInDoc + lineCount + growSize);
-	}
-	linesInDoc += lineCount;
-	for (int i = linesInDoc; i >= lineDoc + lineCount; i--) {
-		lines[i].visible = lines[i - lineCount].visible;
-		lines[i].height = lines[i - lineCount].height;
-		linesInDisplay += lines[i].height;
-		lines[i].expanded = lines[i - lineCount].expanded;
-	}
-	for (int d=0;d<lineCount;d++) {
-		lines[lineDoc+d].visible = true;	// Should inherit visibility from context ?
-		lines[lineDoc+d].height = 1;
-		lines[lineDoc+d].expanded = true;
+	// New lines are visible, expanded and one display line high
+	visible->InsertValue(lineDoc, lineCount, 1);
+	expanded->InsertValue(lineDoc, lineCount, 1);
+	heights->InsertValue(lineDoc, lineCount, 1);
+	int lineDisplay = displayLines->PositionFromPartition(lineDoc);
+	int *positions = new int[lineCount];
+	for (int i = 0; i < lineCount; i++) {
+		positions[i] = lineDisplay + i;
 	}
-	valid = false;
+	displayLines->InsertPartitions(lineDoc, positions, lineCount);
+	delete []positions;
+	displayLines->InsertText(lineDoc + lineCount - 1, lineCount);
 }
 
 void ContractionState::DeleteLines(int lineDoc, int lineCount) {
-	if (size == 0) {
-		linesInDoc -= lineCount;
-		linesInDisplay -= lineCount;
+	if (OneToOne()) {
+		linesInDocument -= lineCount;
 		return;
 	}
-	int deltaDisplayed = 0;
-	for (int d=0;d<lineCount;d++) {
-		if (lines[lineDoc+d].visible)
-			deltaDisplayed -= lines[lineDoc+d].height;
+	for (int d = 0; d < lineCount; d++) {
+		if (GetVisible(lineDoc + d)) {
+			displayLines->InsertText(lineDoc, -heights->ValueAt(lineDoc + d));
+		}
+		displayLines->RemovePartition(lineDoc);
 	}
-	for (int i = lineDoc; i < linesInDoc-lineCount; i++) {
-		if (i != 0) // Line zero is always visible
-			lines[i].visible = lines[i + lineCount].visible;
-		lines[i].expanded = lines[i + lineCount].expanded;
-		lines[i].height = lines[i + lineCount].height;
+	visible->DeleteRange(lineDoc, lineCount);
+	expanded->DeleteRange(lineDoc, lineCount);
+	heights->DeleteRange(lineDoc, lineCount);
+	// Line zero is always visible
+	if ((lineDoc == 0) && (visible->Length() > 0) && !GetVisible(0)) {
+		visible->SetValueAt(0, 1);
+		displayLines->InsertText(0, heights->ValueAt(0));
 	}
-	linesInDoc -= lineCount;
-	linesInDisplay += deltaDisplayed;
-	valid = false;
 }
 
 bool ContractionState::GetVisible(int lineDoc) const {
-	if (size == 0)
+	if (OneToOne())
 		return true;
-	if ((lineDoc >= 0) && (lineDoc < linesInDoc)) {
-		return lines[lineDoc].visible;
+	if ((lineDoc >= 0) && (lineDoc < visible->Length())) {
+		return visible->ValueAt(lineDoc) == 1;
 	} else {
 		return false;
 	}
 }
 
-bool ContractionState::SetVisible(int lineDocStart, int lineDocEnd, bool visible) {
+bool ContractionState::SetVisible(int lineDocStart, int lineDocEnd, bool isVisible) {
 	if (lineDocStart == 0)
 		lineDocStart++;
 	if (lineDocStart > lineDocEnd)
 		return false;
-	if (size == 0) {
-		Grow(linesInDoc + growSize);
-	}
-	// TODO: modify docLine members to mirror displayLine
+	if (OneToOne() && isVisible)
+		return false;
+	EnsureData();
 	int delta = 0;
-	// Change lineDocs
-	if ((lineDocStart <= lineDocEnd) && (lineDocStart >= 0) && (lineDocEnd < linesInDoc)) {
-		for (int line=lineDocStart; line <= lineDocEnd; line++) {
-			if (lines[line].visible != visible) {
-				delta += visible ? lines[line].height : -lines[line].height;
-				lines[line].visible = visible;
+	if ((lineDocStart >= 0) && (lineDocEnd < LinesInDoc())) {
+		for (int line = lineDocStart; line <= lineDocEnd; line++) {
+			if (GetVisible(line) != isVisible) {
+				int difference = isVisible ? heights->ValueAt(line) : -heights->ValueAt(line);
+				visible->SetValueAt(line, isVisible ? 1 : 0);
+				displayLines->InsertText(line, difference);
+				delta += difference;
 			}
 		}
 	}
-	linesInDisplay += delta;
-	valid = false;
 	return delta != 0;
 }
 
 bool ContractionState::GetExpanded(int lineDoc) const {
-	if (size == 0)
+	if (OneToOne())
 		return true;
-	if ((lineDoc >= 0) && (lineDoc < linesInDoc)) {
-		return lines[lineDoc].expanded;
+	if ((lineDoc >= 0) && (lineDoc < expanded->Length())) {
+		return expanded->ValueAt(lineDoc) == 1;
 	} else {
 		return false;
 	}
 }
 
-bool ContractionState::SetExpanded(int lineDoc, bool expanded) {
-	if (size == 0) {
-		if (expanded) {
-			// If in completely expanded state then setting
-			// one line to expanded has no effect.
-			return false;
-		}
-		Grow(linesInDoc + growSize);
+bool ContractionState::SetExpanded(int lineDoc, bool isExpanded) {
+	if (OneToOne() && isExpanded) {
+		// If in completely expanded state then setting
+		// one line to expanded has no effect.
+		return false;
 	}
-	if ((lineDoc >= 0) && (lineDoc < linesInDoc)) {
-		if (lines[lineDoc].expanded != expanded) {
-			lines[lineDoc].expanded = expanded;
+	EnsureData();
+	if ((lineDoc >= 0) && (lineDoc < LinesInDoc())) {
+		if ((expanded->ValueAt(lineDoc) == 1) != isExpanded) {
+			expanded->SetValueAt(lineDoc, isExpanded ? 1 : 0);
 			return true;
 		}
 	}
@@ -245,10 +183,10 @@ bool ContractionState::SetExpanded(int lineDoc, bool expanded) {
 }
 
 int ContractionState::GetHeight(int lineDoc) const {
-	if (size == 0)
+	if (OneToOne())
 		return 1;
-	if ((lineDoc >= 0) && (lineDoc < linesInDoc)) {
-		return lines[lineDoc].height;
+	if ((lineDoc >= 0) && (lineDoc < heights->Length())) {
+		return heights->ValueAt(lineDoc);
 	} else {
 		return 1;
 	}
@@ -257,19 +195,20 @@ int ContractionState::GetHeight(int lineDoc) const {
 // Set the number of display lines needed for this line.
 // Return true if this is a change.
 bool ContractionState::SetHeight(int lineDoc, int height) {
-	if (lineDoc > linesInDoc)
+	if ((lineDoc < 0) || (lineDoc >= LinesInDoc()))
+		return false;
+	if (OneToOne() && (height == 1)) {
+		// If in completely expanded state then all lines
+		// assumed to have height of one so no effect here.
 		return false;
-	if (size == 0) {
-		if (height == 1) {
-			// If in completely expanded state then all lines
-			// assumed to have height of one so no effect here.
-			return false;
-		}
-		Grow(linesInDoc + growSize);
 	}
-	if (lines[lineDoc].height != height) {
-		lines[lineDoc].height = height;
-		valid = false;
+	EnsureData();
+	int heightOld = heights->ValueAt(lineDoc);
+	if (heightOld != height) {
+		if (GetVisible(lineDoc)) {
+			displayLines->InsertText(lineDoc, height - heightOld);
+		}
+		heights->SetValueAt(lineDoc, height);
 		return true;
 	} else {
 		return false;
@@ -277,13 +216,7 @@ bool ContractionState::SetHeight(int lineDoc, int height) {
 }
 
 void ContractionState::ShowAll() {
-	delete []lines;
-	lines = 0;
-	size = 0;
-
-	delete []docLines;
-	docLines = 0;
-	sizeDocLines = 0;
-
-	linesInDisplay = linesInDoc;
+	int lines = LinesInDoc();
+	Clear();
+	linesInDocument = lines;
 }
@@ -8,33 +8,29 @@
 #ifndef CONTRACTIONSTATE_H
 #define CONTRACTIONSTATE_H
 
-/**
- */
-class OneLine {
-public:
-	int displayLine;	///< Position within set of visible lines
-	//int docLine;		///< Inverse of @a displayLine
-	int height;	///< Number of display lines needed to show all of the line
-	bool visible;
-	bool expanded;
-
-	OneLine();
-	virtual ~OneLine() {}
-};
+template <typename T> class SplitVector;
+class Partitioning;
 
 /**
+ * Visibility, expansion and height of each document line, and the display line of each.
+ * While every line is visible, expanded and one display line high, nothing is allocated.
+ * Otherwise the per line values are held in gap buffers and the display line starts in a
+ * Partitioning, so that inserting or hiding lines does not renumber the whole document.
  */
 class ContractionState {
-	void Grow(int sizeNew);
-	enum { growSize = 4000 };
-	int linesInDoc;
-	mutable int linesInDisplay;
-	mutable OneLine *lines;
-	int size;
-	mutable int *docLines;
-	mutable int sizeDocLines;
-	mutable bool valid;
-	void MakeValid() const;
+	// These contain 1 element for every document line.
+	SplitVector<char> *visible;
+	SplitVector<char> *expanded;
+	SplitVector<int> *heights;
+	Partitioning *displayLines;
+	int linesInDocument;
+
+	void EnsureData();
+	bool OneToOne() const {
+		// True when each document line is exactly one display line so need for
+		// complex data structures.
+		return visible == 0;
+	}
 
 public:
 	ContractionState();
@@ -14,6 +14,8 @@
 
 #include "Scintilla.h"
 #include "SVector.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
 #include "CellBuffer.h"
 #include "CharClassify.h"
 #include "Document.h"
@@ -52,6 +54,13 @@ Document::Document() {
 	stylingBitsMask = 0x1F;
 	stylingMask = 0;
 	endStyled = 0;
+	endStyledKept = -1;
+	endModified = 0;
+	lineKeptCheck = -1;
+	styleKeptCheck = 0;
+	lineStateKeptCheck = 0;
+	levelKeptCheck = 0;
+	levelNextKeptCheck = 0;
 	styleClock = 0;
 	enteredCount = 0;
 	enteredReadOnlyCount = 0;
@@ -350,6 +359,38 @@ void Document::ModifiedAt(int pos) {
 		endStyled = pos;
 }
 
+/**
+ * Called before ModifiedAt for an insertion or a deletion: the styling after the
+ * modification is kept and moved with the text, the modified range is extended.
+ */
+void Document::ModifiedKept(int pos, int lengthInserted, int lengthDeleted) {
+	if (endStyledKept < 0) {
+		if (endStyled <= (pos + lengthDeleted))
+			return;
+		endStyledKept = endStyled;
+		endModified = pos;
+	}
+	if (lengthDeleted > 0) {
+		if (endStyledKept >= (pos + lengthDeleted))
+			endStyledKept -= lengthDeleted;
+		else if (endStyledKept > pos)
+			endStyledKept = pos;
+		if (endModified >= (pos + lengthDeleted))
+			endModified -= lengthDeleted;
+		else if (endModified > pos)
+			endModified = pos;
+	} else {
+		if (endStyledKept > pos)
+			endStyledKept += lengthInserted;
+		if (endModified > pos)
+			endModified += lengthInserted;
+	}
+	if (endModified < (pos + lengthInserted))
+		endModified = pos + lengthInserted;
+	if (endStyledKept <= endModified)
+		DiscardStyledKept();
+}
+
 void Document::CheckReadOnly() {
 	if (cb.IsReadOnly() && enteredReadOnlyCount == 0) {
 		enteredReadOnlyCount++;
@@ -358,10 +399,9 @@ void Document::CheckReadOnly() {
 	}
 }
 
-// Document only modified by gateways DeleteChars, InsertStyledString, Undo, Redo, and SetStyleAt.
+// Document only modified by gateways DeleteChars, InsertString, Undo, Redo, and SetStyleAt.
 // SetStyleAt does not change the persistent state of a document
 
-// Unlike Undo, Redo, and InsertStyledString, the pos argument is a cell number not a char number
 bool Document::DeleteChars(int pos, int len) {
 	if (len == 0)
 		return false;
@@ -380,9 +420,10 @@ bool Document::DeleteChars(int pos, int len) {
 			        0, 0));
 			int prevLinesTotal = LinesTotal();
 			bool startSavePoint = cb.IsSavePoint();
-			const char *text = cb.DeleteChars(pos * 2, len * 2);
+			const char *text = cb.DeleteChars(pos, len);
 			if (startSavePoint && cb.IsCollectingUndo())
 				NotifySavePoint(!startSavePoint);
+			ModifiedKept(pos, 0, len);
 			if ((pos < Length()) || (pos == 0))
 				ModifiedAt(pos);
 			else
@@ -400,34 +441,26 @@ bool Document::DeleteChars(int pos, int len) {
 
 /**
  * Insert a styled string (char/style pairs) with a length.
+ * The position is a cell number: twice the character position.
  */
 bool Document::InsertStyledString(int position, char *s, int insertLength) {
-	CheckReadOnly();
-	if (enteredCount != 0) {
-		return false;
-	} else {
-		enteredCount++;
-		if (!cb.IsReadOnly()) {
-			NotifyModified(
-			    DocModification(
-			        SC_MOD_BEFOREINSERT | SC_PERFORMED_USER,
-			        position / 2, insertLength / 2,
-			        0, s));
-			int prevLinesTotal = LinesTotal();
-			bool startSavePoint = cb.IsSavePoint();
-			const char *text = cb.InsertString(position, s, insertLength);
-			if (startSavePoint && cb.IsCollectingUndo())
-				NotifySavePoint(!startSavePoint);
-			ModifiedAt(position / 2);
-			NotifyModified(
-			    DocModification(
-			        SC_MOD_INSERTTEXT | SC_PERFORMED_USER,
-			        position / 2, insertLength / 2,
-			        LinesTotal() - prevLinesTotal, text));
+	bool changed = false;
+	int lengthText = insertLength / 2;
+	if (lengthText > 0) {
+		char *text = new char[lengthText];
+		if (text) {
+			for (int i = 0; i < lengthText; i++)
+				text[i] = s[i*2];
+			changed = InsertString(position / 2, text, static_cast<size_t>(lengthText));
+			delete []text;
+			if (changed) {
+				// Styles are stored apart from the text
+				for (int i = 0; i < lengthText; i++)
+					cb.SetStyleAt(position / 2 + i, s[i*2 + 1]);
+			}
 		}
-		enteredCount--;
 	}
-	return !cb.IsReadOnly();
+	return changed;
 }
 
 int Document::Undo() {
@@ -452,6 +485,10 @@ int Document::Undo() {
 				}
 				cb.PerformUndoStep();
 				int cellPosition = action.position;
+				if (action.at == removeAction)
+					ModifiedKept(cellPosition, action.lenData, 0);
+				else
+					ModifiedKept(cellPosition, 0, action.lenData);
 				ModifiedAt(cellPosition);
 				newPos = cellPosition;
 
@@ -506,6 +543,10 @@ int Document::Redo() {
 									SC_MOD_BEFOREDELETE | SC_PERFORMED_REDO, action));
 				}
 				cb.PerformRedoStep();
+				if (action.at == insertAction)
+					ModifiedKept(action.position, action.lenData, 0);
+				else
+					ModifiedKept(action.position, 0, action.lenData);
 				ModifiedAt(action.position);
 				newPos = action.position;
 
@@ -544,10 +585,9 @@ int Document::Redo() {
  * Insert a single character.
  */
 bool Document::InsertChar(int pos, char ch) {
-	char chs[2];
+	char chs[1];
 	chs[0] = ch;
-	chs[1] = 0;
-	return InsertStyledString(pos*2, chs, 2);
+	return InsertString(pos, chs, 1);
 }
 
 /**
@@ -561,20 +601,36 @@ bool Document::InsertString(int position, const char *s) {
  * Insert a string with a length.
  */
 bool Document::InsertString(int position, const char *s, size_t insertLength) {
-	bool changed = false;
-	if (insertLength > 0) {
-		char *sWithStyle = new char[insertLength * 2];
-		if (sWithStyle) {
-			for (size_t i = 0; i < insertLength; i++) {
-				sWithStyle[i*2] = s[i];
-				sWithStyle[i*2 + 1] = 0;
-			}
-			changed = InsertStyledString(position*2, sWithStyle,
-				static_cast<int>(insertLength*2));
-			delete []sWithStyle;
+	if (insertLength == 0)
+		return false;
+	CheckReadOnly();
+	if (enteredCount != 0) {
+		return false;
+	} else {
+		enteredCount++;
+		if (!cb.IsReadOnly()) {
+			int lengthInsert = static_cast<int>(insertLength);
+			NotifyModified(
+			    DocModification(
+			        SC_MOD_BEFOREINSERT | SC_PERFORMED_USER,
+			        position, lengthInsert,
+			        0, s));
+			int prevLinesTotal = LinesTotal();
+			bool startSavePoint = cb.IsSavePoint();
+			const char *text = cb.InsertString(position, s, lengthInsert);
+			if (startSavePoint && cb.IsCollectingUndo())
+				NotifySavePoint(!startSavePoint);
+			ModifiedKept(position, lengthInsert, 0);
+			ModifiedAt(position);
+			NotifyModified(
+			    DocModification(
+			        SC_MOD_INSERTTEXT | SC_PERFORMED_USER,
+			        position, lengthInsert,
+			        LinesTotal() - prevLinesTotal, text));
 		}
+		enteredCount--;
 	}
-	return changed;
+	return !cb.IsReadOnly();
 }
 
 void Document::ChangeChar(int pos, char ch) {
@@ -1274,6 +1330,7 @@ void Document::SetCharClasses(const unsigned char *chars, CharClassify::cc newCh
 }
 
 void Document::SetStylingBits(int bits) {
+	DiscardStyledKept();
 	stylingBits = bits;
 	stylingBitsMask = 0;
 	for (int bit = 0; bit < stylingBits; bit++) {
@@ -1283,6 +1340,10 @@ void Document::SetStylingBits(int bits) {
 }
 
 void Document::StartStyling(int position, char mask) {
+	if (position > endStyled) {
+		// Not continuing the styled part: the kept styling can no longer be checked
+		DiscardStyledKept();
+	}
 	stylingMask = mask;
 	endStyled = position;
 }
@@ -1344,6 +1405,64 @@ bool Document::EnsureStyledTo(int pos) {
 	return pos <= GetEndStyled();
 }
 
+/**
+ * Before styling from start to end: remember the state at the end of the line before end,
+ * if that line is in the kept styling and will be restyled.
+ */
+void Document::CheckStyledKeptStart(int start, int end) {
+	lineKeptCheck = -1;
+	if (endStyledKept < 0)
+		return;
+	if (end >= endStyledKept) {
+		// Styling covers the kept part
+		DiscardStyledKept();
+		return;
+	}
+	if (start > endStyled)
+		return;
+	int line = LineFromPosition(end);
+	if ((line < 1) || (LineStart(line) != end))
+		return;
+	line--;
+	int lineStart = LineStart(line);
+	if ((lineStart < start) || (lineStart < endModified))
+		return;
+	lineKeptCheck = line;
+	styleKeptCheck = StyleAt(end - 1) & stylingBitsMask;
+	lineStateKeptCheck = GetLineState(line);
+	levelKeptCheck = GetLevel(line);
+	levelNextKeptCheck = GetLevel(line + 1);
+}
+
+/**
+ * After styling: if the line checked ends in the same style and line state, and has the same
+ * fold level as before, as the following line (which folders start from), the lexer would
+ * produce the kept styling again, which is therefore still valid.
+ * Otherwise the styling now extends over part of the kept styling, which stops there.
+ */
+bool Document::CheckStyledKeptEnd() {
+	int line = lineKeptCheck;
+	lineKeptCheck = -1;
+	if (endStyledKept < 0)
+		return false;
+	if ((line >= 0) && (endStyled >= LineStart(line + 1))) {
+		int end = LineStart(line + 1);
+		if (((StyleAt(end - 1) & stylingBitsMask) == styleKeptCheck) &&
+			(GetLineState(line) == lineStateKeptCheck) &&
+			(GetLevel(line) == levelKeptCheck) &&
+			(GetLevel(line + 1) == levelNextKeptCheck)) {
+			endStyled = endStyledKept;
+			DiscardStyledKept();
+			return true;
+		}
+	}
+	if (endModified < endStyled)
+		endModified = endStyled;
+	if (endStyledKept <= endModified)
+		DiscardStyledKept();
+	return false;
+}
+
 void Document::IncrementStyleClock() {
 	styleClock++;
 	if (styleClock > 0x100000) {
@@ -96,6 +96,16 @@ private:
 	CharClassify charClass;
 	char stylingMask;
 	int endStyled;
+	/// Styling and fold levels after the text modified since the last styling are kept,
+	/// from endModified to endStyledKept (-1 if none), until restyling shows whether the
+	/// lexer state converged to the one they were computed from.
+	int endStyledKept;
+	int endModified;
+	int lineKeptCheck;
+	int styleKeptCheck;
+	int lineStateKeptCheck;
+	int levelKeptCheck;
+	int levelNextKeptCheck;
 	int styleClock;
 	int enteredCount;
 	int enteredReadOnlyCount;
@@ -103,6 +113,8 @@ private:
 	WatcherWithUserData *watchers;
 	int lenWatchers;
 
+	void ModifiedKept(int pos, int lengthInserted, int lengthDeleted);
+
 	bool matchesValid;
 	RESearch *pre;
 	char *substituted;
@@ -142,6 +154,10 @@ public:
 	bool CanUndo() { return cb.CanUndo(); }
 	bool CanRedo() { return cb.CanRedo(); }
 	void DeleteUndoHistory() { cb.DeleteUndoHistory(); }
+	void SetUndoMemoryLimit(int bytes) { cb.SetUndoMemoryLimit(bytes); }
+	int GetUndoMemoryLimit() const { return cb.GetUndoMemoryLimit(); }
+	void SetUndoSpill(bool spill) { cb.SetUndoSpill(spill); }
+	bool GetUndoSpill() const { return cb.GetUndoSpill(); }
 	bool SetUndoCollection(bool collectUndo) {
 		return cb.SetUndoCollection(collectUndo);
 	}
@@ -174,6 +190,9 @@ public:
 		cb.GetCharRange(buffer, position, lengthRetrieve);
 	}
 	char StyleAt(int position) { return cb.StyleAt(position); }
+	/// The text as one contiguous, NUL terminated block, valid until the next modification.
+	const char *BufferPointer() { return cb.BufferPointer(); }
+	const char *RangePointer(int position, int rangeLength) { return cb.RangePointer(position, rangeLength); }
 	int GetMark(int line) { return cb.GetMark(line); }
 	int AddMark(int line, int markerNum);
 	void AddMarkSet(int line, int valueSet);
@@ -197,7 +216,7 @@ public:
 	int NextWordStart(int pos, int delta);
 	int NextWordEnd(int pos, int delta);
 	int Length() { return cb.Length(); }
-	void Allocate(int newSize) { cb.Allocate(newSize*2); }
+	void Allocate(int newSize) { cb.Allocate(newSize); }
 	long FindText(int minPos, int maxPos, const char *s,
 		bool caseSensitive, bool word, bool wordStart, bool regExp, bool posix, int *length);
 	long FindText(int iMessage, unsigned long wParam, long lParam);
@@ -214,6 +233,9 @@ public:
 	bool SetStyles(int length, char *styles);
 	int GetEndStyled() { return endStyled; }
 	bool EnsureStyledTo(int pos);
+	void CheckStyledKeptStart(int start, int end);
+	bool CheckStyledKeptEnd();
+	void DiscardStyledKept() { endStyledKept = -1; lineKeptCheck = -1; }
 	int GetStyleClock() { return styleClock; }
 	void IncrementStyleClock();
 
@@ -20,6 +20,8 @@
 
 #include "ContractionState.h"
 #include "SVector.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
 #include "CellBuffer.h"
 #include "KeyMap.h"
 #include "Indicator.h"
@@ -3680,6 +3682,7 @@ void Editor::ClearAll() {
 }
 
 void Editor::ClearDocumentStyle() {
+    pdoc->DiscardStyledKept();
     pdoc->StartStyling(0, '\377');
     pdoc->SetStyleFor(pdoc->Length(), 0);
     cs.ShowAll();
@@ -5966,6 +5969,12 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
     case SCI_GETTEXTLENGTH:
         return pdoc->Length();
 
+    case SCI_GETCHARACTERPOINTER:
+        return reinterpret_cast<sptr_t>(pdoc->BufferPointer());
+
+    case SCI_GETRANGEPOINTER:
+        return reinterpret_cast<sptr_t>(pdoc->RangePointer(wParam, lParam));
+
     case SCI_CUT:
         Cut();
         SetLastXChosen();
@@ -6013,6 +6022,20 @@ sptr_t Editor::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lParam) {
         pdoc->DeleteUndoHistory();
         return 0;
 
+    case SCI_SETUNDOMEMORYLIMIT:
+        pdoc->SetUndoMemoryLimit(wParam);
+        return 0;
+
+    case SCI_GETUNDOMEMORYLIMIT:
+        return pdoc->GetUndoMemoryLimit();
+
+    case SCI_SETUNDOSPILL:
+        pdoc->SetUndoSpill(wParam != 0);
+        return 0;
+
+    case SCI_GETUNDOSPILL:
+        return pdoc->GetUndoSpill();
+
     case SCI_GETFIRSTVISIBLELINE:
         return topLine;
 
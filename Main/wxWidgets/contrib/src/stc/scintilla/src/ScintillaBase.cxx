@@ -22,6 +22,8 @@
 #endif
 #include "ContractionState.h"
 #include "SVector.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
 #include "CellBuffer.h"
 #include "CallTip.h"
 #include "KeyMap.h"
@@ -43,6 +45,7 @@ ScintillaBase::ScintillaBase() {
 #ifdef SCI_LEXER
     lexLanguage = SCLEX_CONTAINER;
     performingStyle = false;
+    styleNeededNotify = false;
     lexCurrent = 0;
     for (int wl = 0;wl < numWordLists;wl++)
         keyWordLists[wl] = new WordList;
@@ -513,12 +516,16 @@ void ScintillaBase::Colourise(int start, int end) {
         styler.SetCodePage(pdoc->dbcsCodePage);
 
         if (lexCurrent && (len > 0)) {    // Should always succeed as null lexer should always be available
+            // Styling after an edit stops being extended once the lexer is back in the
+            // state it had there: the styling and fold levels that follow are kept.
+            pdoc->CheckStyledKeptStart(start, end);
             lexCurrent->Lex(start, len, styleStart, keyWordLists, styler);
             styler.Flush();
             if (styler.GetPropertyInt("fold")) {
                 lexCurrent->Fold(start, len, styleStart, keyWordLists, styler);
                 styler.Flush();
             }
+            pdoc->CheckStyledKeptEnd();
         }
 
         performingStyle = false;
@@ -528,7 +535,9 @@ void ScintillaBase::Colourise(int start, int end) {
 
 void ScintillaBase::NotifyStyleToNeeded(int endStyleNeeded) {
 #ifdef SCI_LEXER
-    if (lexLanguage != SCLEX_CONTAINER) {
+    // [:COMET:]: the container chooses where lexing starts (before painting a view far
+    // from the styled text, for example) and colourises with SCI_COLOURISE
+    if ((lexLanguage != SCLEX_CONTAINER) && !styleNeededNotify) {
         int endStyled = WndProc(SCI_GETENDSTYLED, 0, 0);
         int lineEndStyled = WndProc(SCI_LINEFROMPOSITION, endStyled, 0);
         endStyled = WndProc(SCI_POSITIONFROMLINE, lineEndStyled, 0);
@@ -588,6 +597,12 @@ sptr_t ScintillaBase::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lPara
         break;
     //
 
+    // [:COMET:]:
+    case SCI_SETSTYLENEEDEDNOTIFY:
+        styleNeededNotify = wParam != 0;
+        break;
+    //
+
     case SCI_AUTOCGETCURRENT:
         return AutoCompleteGetCurrent();
 
@@ -713,6 +728,7 @@ sptr_t ScintillaBase::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lPara
     case SCI_SETLEXER:
         SetLexer(wParam);
         lexLanguage = wParam;
+        pdoc->DiscardStyledKept();
         break;
 
     case SCI_GETLEXER:
@@ -731,6 +747,7 @@ sptr_t ScintillaBase::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lPara
     case SCI_SETPROPERTY:
         props.Set(reinterpret_cast<const char *>(wParam),
                   reinterpret_cast<const char *>(lParam));
+        pdoc->DiscardStyledKept();
         break;
 
     case SCI_GETPROPERTY: {
@@ -763,10 +780,12 @@ sptr_t ScintillaBase::WndProc(unsigned int iMessage, uptr_t wParam, sptr_t lPara
             keyWordLists[wParam]->Clear();
             keyWordLists[wParam]->Set(reinterpret_cast<const char *>(lParam));
         }
+        pdoc->DiscardStyledKept();
         break;
 
     case SCI_SETLEXERLANGUAGE:
         SetLexerLanguage(reinterpret_cast<const char *>(lParam));
+        pdoc->DiscardStyledKept();
         break;
 
     case SCI_GETSTYLEBITSNEEDED:
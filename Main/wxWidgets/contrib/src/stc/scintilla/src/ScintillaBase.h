@@ -41,6 +41,7 @@ protected:
     int maxListWidth;        /// Maximum width of list, in average character widths
 
     bool performingStyle;    ///< Prevent reentrance
+    bool styleNeededNotify;  ///< [:COMET:] container asked before lexing (SCN_STYLENEEDED)
 
 #ifdef SCI_LEXER
     int lexLanguage;
@@ -0,0 +1,116 @@
+// Scintilla source code edit control
+/** @file CellBufferBench.cxx
+ ** Line index benchmark: lines inserted one by one in the middle of a large document.
+ **/
+// The License.txt file describes the conditions under which this software may be distributed.
+
+// Build, from this directory (zlib is used by the undo spill):
+//     g++ -O2 -I../include -I../src -I../../../../../src/zlib CellBufferBench.cxx ../src/CellBuffer.cxx -lz -o CellBufferBench
+// Run:
+//     ./CellBufferBench [lines]
+// With the stepped Partitioning, the time per inserted line stays the same whatever the
+// document size; with the former flat line array, it grew with the number of lines.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
+
+#include "Platform.h"
+
+#include "Scintilla.h"
+#include "SVector.h"
+#include "SplitVector.h"
+#include "Partitioning.h"
+#include "CellBuffer.h"
+
+void Platform::DebugPrintf(const char *format, ...) {
+	va_list pArguments;
+	va_start(pArguments, format);
+	vfprintf(stderr, format, pArguments);
+	va_end(pArguments);
+}
+
+void Platform::Assert(const char *c, const char *file, int line) {
+	fprintf(stderr, "Assertion [%s] failed at %s %d\n", c, file, line);
+	abort();
+}
+
+static double Now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static const char lineText[] = "local x = 1\n";
+static const int lineLength = sizeof(lineText) - 1;
+
+/// Document of lines lines, with a fold level set on each line as the lexers do
+static void Fill(CellBuffer &cb, int lines) {
+	const int chunkLines = 4096;
+	char *chunk = new char[chunkLines * lineLength];
+	for (int i = 0; i < chunkLines; i++)
+		memcpy(chunk + i * lineLength, lineText, lineLength);
+	for (int done = 0; done < lines; done += chunkLines) {
+		int count = (lines - done < chunkLines) ? (lines - done) : chunkLines;
+		cb.InsertString(cb.Length(), chunk, count * lineLength);
+	}
+	delete []chunk;
+	for (int line = 0; line < cb.Lines(); line++)
+		cb.SetLevel(line, SC_FOLDLEVELBASE);
+}
+
+/// Inserts lines lines one by one in the middle of a document of lines lines.
+/// Returns the time in seconds and checks the line index afterwards.
+static double InsertMiddle(int lines) {
+	CellBuffer cb;
+	cb.SetUndoCollection(false);
+	Fill(cb, lines);
+
+	const int lineMiddle = lines / 2;
+	int position = cb.LineStart(lineMiddle);
+	double start = Now();
+	for (int i = 0; i < lines; i++) {
+		cb.InsertString(position, lineText, lineLength);
+		cb.SetLevel(lineMiddle + i, SC_FOLDLEVELBASE + 1);
+		position += lineLength;
+	}
+	double elapsed = Now() - start;
+
+	// Every line start is where it should be
+	if (cb.Lines() != (2 * lines + 1)) {
+		fprintf(stderr, "! %d lines instead of %d\n", cb.Lines(), 2 * lines + 1);
+		exit(1);
+	}
+	for (int line = 0; line < cb.Lines(); line++) {
+		if (cb.LineStart(line) != line * lineLength) {
+			fprintf(stderr, "! line %d starts at %d instead of %d\n", line, cb.LineStart(line), line * lineLength);
+			exit(1);
+		}
+	}
+	if ((cb.GetLevel(lineMiddle) != SC_FOLDLEVELBASE + 1) || (cb.GetLevel(lineMiddle + lines) != SC_FOLDLEVELBASE)) {
+		fprintf(stderr, "! fold levels not moved with the lines\n");
+		exit(1);
+	}
+	return elapsed;
+}
+
+int main(int argc, char *argv[]) {
+	int lines = (argc > 1) ? atoi(argv[1]) : 1000000;
+	if (lines < 1)
+		lines = 1000000;
+
+	// Growing documents: the time per line should not grow with the size
+	for (int size = lines / 8; size < lines; size *= 2) {
+		if (size < 1)
+			continue;
+		double elapsed = InsertMiddle(size);
+		printf("%9d lines inserted in the middle of %9d lines: %8.3f s, %7.1f ns per line\n",
+			size, size, elapsed, elapsed * 1e9 / size);
+	}
+	double elapsed = InsertMiddle(lines);
+	printf("%9d lines inserted in the middle of %9d lines: %8.3f s, %7.1f ns per line\n",
+		lines, lines, elapsed, elapsed * 1e9 / lines);
+	return 0;
+}
@@ -1436,6 +1436,12 @@ void wxStyledTextCtrl::SetExtraDescent(int iDescent) {
 }
 // <<
 
+// >> [:COMET:]:
+void wxStyledTextCtrl::SetStyleNeededNotify(bool bNotify) {
+    SendMsg(SCI_SETSTYLENEEDEDNOTIFY, bNotify ? 1 : 0, 0);
+}
+// <<
+
 // Sets the position that starts the target which is used for updating the
 // document without affecting the scroll position.
 void wxStyledTextCtrl::SetTargetStart(int pos) {
@@ -2589,6 +2595,41 @@ int wxStyledTextCtrl::GetCaretLineBackAlpha() {
     return SendMsg(2471, 0, 0);
 }
 
+// Compact the document buffer and return a read-only pointer to the
+// characters in the document, valid until the next modification.
+const char* wxStyledTextCtrl::GetCharacterPointer() {
+    return (const char*)SendMsg(2520, 0, 0);
+}
+
+// Return a read-only pointer to a range of characters in the document.
+// May move the gap so that the range is contiguous, avoiding a copy
+// of the whole document. Valid until the next modification.
+const char* wxStyledTextCtrl::GetRangePointer(int position, int rangeLength) {
+    return (const char*)SendMsg(2643, position, rangeLength);
+}
+
+// Set the memory budget in bytes for the undo data (0 for no limit).
+// When exceeded, old undo data is spilled or the oldest operations are dropped.
+void wxStyledTextCtrl::SetUndoMemoryLimit(int bytes) {
+    SendMsg(2644, bytes, 0);
+}
+
+// Get the memory budget for the undo data.
+int wxStyledTextCtrl::GetUndoMemoryLimit() {
+    return SendMsg(2645, 0, 0);
+}
+
+// Set whether undo data over the memory budget is kept compressed in a temporary file
+// instead of dropping the oldest operations.
+void wxStyledTextCtrl::SetUndoSpill(bool spill) {
+    SendMsg(2646, spill, 0);
+}
+
+// Is undo data over the memory budget kept in a temporary file?
+bool wxStyledTextCtrl::GetUndoSpill() {
+    return SendMsg(2647, 0, 0) != 0;
+}
+
 // Start notifying the container of all key presses and commands.
 void wxStyledTextCtrl::StartRecord() {
     SendMsg(3001, 0, 0);
@@ -3090,6 +3131,11 @@ void wxStyledTextCtrl::AppendTextRaw(const char* text)
     SendMsg(SCI_APPENDTEXT, strlen(text), (wxIntPtr)text);
 }
 
+int wxStyledTextCtrl::ReplaceTargetRaw(const char* text, int length)
+{
+    return SendMsg(SCI_REPLACETARGET, length, (wxIntPtr)text);
+}
+
 
 
 